@@ -63,6 +63,7 @@
 #include <memory>
 #include <optional>
 #include <variant>
+#include <vector>
 
 #include "absl/base/nullability.h"
 #include "absl/status/status.h"
@@ -74,6 +75,7 @@
 #include "meet_clients/api/participants_resource.h"
 #include "meet_clients/api/session_control_resource.h"
 #include "meet_clients/api/video_assignment_resource.h"
+#include "api/media_types.h"
 #include "api/ref_count.h"
 #include "api/scoped_refptr.h"
 #include "api/video/video_frame.h"
@@ -82,6 +84,61 @@ ABSL_POINTERS_DEFAULT_NONNULL
 
 namespace meet {
 
+/// Scaling of the decoded frames of a receiving video stream to a fixed size,
+/// e.g. for models that take small, square frames.
+///
+/// Frames are scaled with SIMD scalers on a thread of the stream's own, rather
+/// than on WebRTC's decoding thread, into buffers that are reused once the
+/// observer releases them.
+struct VideoScalingOptions {
+  /// Quality of the scaling, from fastest to smoothest.
+  enum class FilterMode { kNone, kLinear, kBilinear, kBox };
+
+  /// Size of delivered frames. Must be positive.
+  int width = 0;
+  int height = 0;
+  FilterMode filter_mode = FilterMode::kBox;
+  /// If true, frames are cropped around their center to the aspect ratio of
+  /// `width` and `height` before they are scaled, rather than stretched.
+  bool keep_aspect_ratio = true;
+};
+
+/// Limits on the decoded frames delivered for a receiving video stream through
+/// `MediaApiClientObserverInterface::OnVideoFrame`.
+///
+/// Frames beyond the limits are dropped or downscaled before they reach the
+/// observer, so consumers that only need e.g. low rate thumbnails do not pay
+/// for handling every frame at full resolution.
+struct ReceivingVideoStreamOptions {
+  /// If set, frames are dropped so that at most this many frames per second
+  /// are delivered. Must be positive.
+  std::optional<int> max_framerate;
+  /// If set, frames with more pixels than this are downscaled before they are
+  /// delivered. Must be positive.
+  std::optional<int> max_pixel_count;
+  /// The width and height of delivered frames are multiples of this. Must be
+  /// positive.
+  int resolution_alignment = 1;
+  /// If set, frames are scaled to a fixed size after the limits above are
+  /// applied. Frames are then delivered on the stream's scaling thread.
+  std::optional<VideoScalingOptions> scaling;
+};
+
+/// Counters of the buffers the client writes video frames to when it converts,
+/// downscales or scales them. Once the client is receiving steadily, misses
+/// should stop growing.
+struct VideoBufferPoolStats {
+  /// Buffers reused after the observer released them.
+  int64_t hits = 0;
+  /// Buffers allocated, because every pooled buffer of the frame's resolution
+  /// was in use.
+  int64_t misses = 0;
+  /// Frames dropped before they were downscaled or scaled, because the
+  /// stream's scaling thread fell behind, e.g. as the observer was slow to
+  /// return from `OnVideoFrame`.
+  int64_t dropped_frames = 0;
+};
+
 struct MediaApiClientConfiguration {
   /// For values greater than zero, the Meet Media API client will establish
   /// that many video SRTP streams. After the session is initialized, no other
@@ -95,6 +152,33 @@ struct MediaApiClientConfiguration {
   /// be created nor intentionally terminated. All connections will be cleaned
   /// up after the session is complete.
   bool enable_audio_streams = false;
+  /// If enabled, encoded audio and video frames are delivered through
+  /// `MediaApiClientObserverInterface::OnEncodedFrame` as they are received,
+  /// before they are decoded.
+  bool enable_encoded_frames = false;
+  /// If disabled, received frames are never decoded, and
+  /// `MediaApiClientObserverInterface::OnAudioFrame` and
+  /// `MediaApiClientObserverInterface::OnVideoFrame` are never invoked.
+  /// Decoding is the dominant CPU cost of receiving media, so consumers that
+  /// only need encoded frames (e.g. for recording) should disable it. Since
+  /// nothing reaches the decoder, WebRTC may request additional key frames
+  /// from Meet servers.
+  ///
+  /// May only be disabled if `enable_encoded_frames` is enabled.
+  bool enable_decoded_frames = true;
+  /// Options for each receiving video stream, in the order the streams are
+  /// signaled. Streams without an entry deliver every frame at full
+  /// resolution. Options can be changed after the session is initialized with
+  /// `MediaApiClientInterface::SetReceivingVideoStreamOptions`.
+  ///
+  /// Must not have more entries than `receiving_video_stream_count`.
+  std::vector<ReceivingVideoStreamOptions> receiving_video_stream_options;
+  /// Maximum number of buffers of each resolution that the client keeps for
+  /// reuse by frames it converts, downscales or scales. Frames are held by the
+  /// observer for as long as it keeps a reference to them; while all pooled
+  /// buffers are held, new buffers are allocated without being kept. Must be
+  /// positive.
+  int max_pooled_video_buffers = 16;
 };
 
 /// Messages that can be sent to Meet servers.
@@ -155,6 +239,36 @@ struct VideoFrame {
   uint32_t synchronization_source;
 };
 
+/// An audio or video frame as received from Meet servers, before decoding.
+struct EncodedFrame {
+  /// Either `webrtc::MediaType::AUDIO` or `webrtc::MediaType::VIDEO`.
+  webrtc::MediaType media_type;
+  /// The encoded frame. Only valid for the duration of the callback.
+  absl::Span<const uint8_t> data;
+  /// MIME type of the frame's codec, e.g. "video/VP9" or "audio/opus". Only
+  /// valid for the duration of the callback.
+  absl::string_view mime_type;
+  /// RTP timestamp of the frame. Video uses a 90 kHz clock, while audio uses
+  /// the codec's clock rate.
+  uint32_t rtp_timestamp;
+  /// Whether the frame can be decoded without any previous frame. Audio frames
+  /// are always independently decodable.
+  bool is_key_frame;
+  /// Contributing source (CSRC) of the frame. This ID is used to identify which
+  /// participant in the conference generated the frame.
+  ///
+  /// @see [WebRTC Contributing
+  /// Source](https://www.w3.org/TR/webrtc/#dom-rtcrtpcontributingsource)
+  uint32_t contributing_source;
+  /// Synchronization source (SSRC) of the frame. This ID identifies which
+  /// media stream the frame originated from. The SSRC is for debugging
+  /// purposes only.
+  ///
+  /// @see [WebRTC Synchronization
+  /// Source](https://www.w3.org/TR/webrtc/#dom-rtcrtpsynchronizationsource)
+  uint32_t synchronization_source;
+};
+
 /// Interface for observing client events.
 ///
 /// Methods are invoked on internal threads, and therefore observer
@@ -222,6 +336,17 @@ class MediaApiClientObserverInterface : public webrtc::RefCountInterface {
   /// This will only be invoked while in the
   /// `meet::SessionStatus::ConferenceConnectionState::kJoined` state.
   virtual void OnVideoFrame(VideoFrame frame) = 0;
+
+  /// Callback for receiving encoded audio and video frames.
+  ///
+  /// Only invoked if `MediaApiClientConfiguration::enable_encoded_frames` is
+  /// enabled. Frames of each stream are delivered in the order in which they
+  /// are depacketized. Unlike the other callbacks, this has a default no-op
+  /// implementation, since most observers only consume decoded media.
+  ///
+  /// This will only be invoked while in the
+  /// `meet::SessionStatus::ConferenceConnectionState::kJoined` state.
+  virtual void OnEncodedFrame(EncodedFrame frame) {}
 };
 
 /// Interface for the Meet Media API client.
@@ -284,6 +409,19 @@ class MediaApiClientInterface {
   /// `MediaApiClientObserverInterface`.
   virtual absl::Status SendRequest(const MessageToServer& request) = 0;
 
+  /// Replaces the options of a receiving video stream. Frames decoded after
+  /// this returns are delivered according to `options`.
+  ///
+  /// @param stream_index Index of the stream, in the order the streams are
+  /// signaled. Must be less than
+  /// `MediaApiClientConfiguration::receiving_video_stream_count`.
+  virtual absl::Status SetReceivingVideoStreamOptions(
+      int stream_index, const ReceivingVideoStreamOptions& options) = 0;
+
+  /// Returns the counters of the buffers used for converted, downscaled and
+  /// scaled video frames, and of the frames dropped before scaling.
+  virtual VideoBufferPoolStats GetVideoBufferPoolStats() const = 0;
+
   /// Creates a new instance of `MediaApiClientInterface`.
   ///
   /// It is configured with the required codecs to support streaming media from
@@ -18,19 +18,33 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/base/nullability.h"
 #include "absl/log/log.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "meet_clients/api/media_api_client_interface.h"
+#include "meet_clients/internal/i420_buffer_pool.h"
+#include "meet_clients/internal/video_frame_scaler.h"
+#include "api/array_view.h"
+#include "api/frame_transformer_interface.h"
+#include "api/media_types.h"
 #include "api/rtp_packet_info.h"
 #include "api/rtp_packet_infos.h"
 #include "api/transport/rtp/rtp_source.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
 #include "api/video/video_frame.h"
+#include "api/video/video_frame_buffer.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
 
 ABSL_POINTERS_DEFAULT_NONNULL
 
@@ -121,11 +135,201 @@ void ConferenceVideoTrack::OnFrame(const webrtc::VideoFrame& frame) {
     return;
   }
 
-  callback_(VideoFrame{.frame = frame,
-                       // It is expected that there will be only one CSRC per
-                       // video frame.
-                       .contributing_source = packet_info.csrcs().front(),
-                       .synchronization_source = packet_info.ssrc()});
+  int cropped_width = 0;
+  int cropped_height = 0;
+  int adapted_width = 0;
+  int adapted_height = 0;
+  if (!video_adapter_.AdaptFrameResolution(
+          frame.width(), frame.height(),
+          frame.timestamp_us() * webrtc::kNumNanosecsPerMicrosec,
+          &cropped_width, &cropped_height, &adapted_width, &adapted_height)) {
+    // Dropped to honor the max framerate.
+    return;
+  }
+  bool downscale =
+      adapted_width != frame.width() || adapted_height != frame.height();
+  // It is expected that there will be only one CSRC per video frame.
+  uint32_t csrc = packet_info.csrcs().front();
+  uint32_t ssrc = packet_info.ssrc();
+
+  {
+    absl::MutexLock lock(&scaling_mutex_);
+    // If the scaling thread cannot be started, frames are downscaled here.
+    if (downscale) {
+      StartScalingThread();
+    }
+    if (scaling_thread_ != nullptr) {
+      if (queued_scaling_frames_ >= kMaxQueuedScalingFrames) {
+        // Dropped rather than letting the backlog grow without bound.
+        dropped_frames_++;
+        return;
+      }
+      queued_scaling_frames_++;
+      scaling_thread_->PostTask([this, frame, scaler = scaler_, csrc, ssrc,
+                                 cropped_width, cropped_height, adapted_width,
+                                 adapted_height]() mutable {
+        frame = AdaptFrame(frame, cropped_width, cropped_height, adapted_width,
+                           adapted_height);
+        if (scaler != nullptr) {
+          frame.set_video_frame_buffer(
+              scaler->Scale(*frame.video_frame_buffer()));
+        }
+        callback_(VideoFrame{.frame = frame,
+                             .contributing_source = csrc,
+                             .synchronization_source = ssrc});
+        queued_scaling_frames_--;
+      });
+      return;
+    }
+  }
+
+  callback_(VideoFrame{.frame = AdaptFrame(frame, cropped_width,
+                                           cropped_height, adapted_width,
+                                           adapted_height),
+                       .contributing_source = csrc,
+                       .synchronization_source = ssrc});
+}
+
+webrtc::VideoFrame ConferenceVideoTrack::AdaptFrame(
+    const webrtc::VideoFrame& frame, int cropped_width, int cropped_height,
+    int adapted_width, int adapted_height) const {
+  if (adapted_width == frame.width() && adapted_height == frame.height()) {
+    return frame;
+  }
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> i420 =
+      buffer_pool_->ToI420(*frame.video_frame_buffer());
+  webrtc::scoped_refptr<webrtc::I420Buffer> adapted_buffer =
+      buffer_pool_->CreateBuffer(adapted_width, adapted_height);
+  adapted_buffer->CropAndScaleFrom(*i420, (frame.width() - cropped_width) / 2,
+                                   (frame.height() - cropped_height) / 2,
+                                   cropped_width, cropped_height);
+  webrtc::VideoFrame adapted_frame = frame;
+  adapted_frame.set_video_frame_buffer(std::move(adapted_buffer));
+  return adapted_frame;
+}
+
+bool ConferenceVideoTrack::StartScalingThread() {
+  if (scaling_thread_ != nullptr) {
+    return true;
+  }
+  std::unique_ptr<webrtc::Thread> scaling_thread = webrtc::Thread::Create();
+  scaling_thread->SetName(absl::StrCat("video_scaling_thread_", mid_),
+                          nullptr);
+  if (!scaling_thread->Start()) {
+    LOG(ERROR) << "Failed to start scaling thread for mid: " << mid_;
+    return false;
+  }
+  scaling_thread_ = std::move(scaling_thread);
+  return true;
+}
+
+ConferenceVideoTrack::~ConferenceVideoTrack() {
+  if (dropped_frames_ > 0) {
+    LOG(WARNING) << "Dropped " << dropped_frames_
+                 << " frames waiting to be scaled for mid: " << mid_;
+  }
+  absl::MutexLock lock(&scaling_mutex_);
+  // Stop the scaling thread before the callback is destroyed. Frames waiting to
+  // be scaled are discarded.
+  if (scaling_thread_ != nullptr) {
+    scaling_thread_->Stop();
+  }
+}
+
+void ConferenceVideoTrack::SetScalingOptions(
+    std::optional<VideoScalingOptions> options) {
+  absl::MutexLock lock(&scaling_mutex_);
+  if (!options.has_value()) {
+    // Frames keep being delivered on the scaling thread, if there is one, so
+    // that they are not delivered out of order.
+    scaler_ = nullptr;
+    return;
+  }
+  if (!StartScalingThread()) {
+    return;
+  }
+  scaler_ =
+      std::make_shared<VideoFrameScaler>(*std::move(options), buffer_pool_);
+}
+
+void ConferenceFrameTransformer::Transform(
+    std::unique_ptr<webrtc::TransformableFrameInterface> transformable_frame) {
+  std::optional<uint32_t> csrc;
+  bool is_key_frame = true;
+  if (media_type_ == webrtc::MediaType::VIDEO) {
+    auto& video_frame =
+        static_cast<webrtc::TransformableVideoFrameInterface&>(
+            *transformable_frame);
+    is_key_frame = video_frame.IsKeyFrame();
+    std::vector<uint32_t> csrcs = video_frame.Metadata().GetCsrcs();
+    if (!csrcs.empty()) {
+      // It is expected that there will be only one CSRC per video frame.
+      csrc = csrcs.front();
+    }
+  } else {
+    auto& audio_frame =
+        static_cast<webrtc::TransformableAudioFrameInterface&>(
+            *transformable_frame);
+    // As with decoded audio, skip the CSRC that marks the loudest speaker.
+    for (uint32_t contributing_source :
+         audio_frame.GetContributingSources()) {
+      if (contributing_source != kLoudestSpeakerCsrc) {
+        csrc = contributing_source;
+        break;
+      }
+    }
+  }
+
+  if (csrc.has_value()) {
+    webrtc::ArrayView<const uint8_t> data = transformable_frame->GetData();
+    std::string mime_type = transformable_frame->GetMimeType();
+    callback_(EncodedFrame{
+        .media_type = media_type_,
+        .data = absl::MakeConstSpan(data.data(), data.size()),
+        .mime_type = mime_type,
+        .rtp_timestamp = transformable_frame->GetTimestamp(),
+        .is_key_frame = is_key_frame,
+        .contributing_source = *csrc,
+        .synchronization_source = transformable_frame->GetSsrc()});
+  } else {
+    // Before real audio starts flowing, silent audio frames will be received
+    // without a CSRC. Log at a low level to avoid cluttering the logs.
+    VLOG(2) << "Encoded frame is missing CSRC for mid: " << mid_;
+  }
+
+  if (!forward_to_decoder_) {
+    return;
+  }
+  webrtc::scoped_refptr<webrtc::TransformedFrameCallback> decoder_callback;
+  {
+    absl::MutexLock lock(&mutex_);
+    decoder_callback = decoder_callback_;
+  }
+  if (decoder_callback != nullptr) {
+    decoder_callback->OnTransformedFrame(std::move(transformable_frame));
+  }
+}
+
+void ConferenceFrameTransformer::RegisterTransformedFrameCallback(
+    webrtc::scoped_refptr<webrtc::TransformedFrameCallback> callback) {
+  absl::MutexLock lock(&mutex_);
+  decoder_callback_ = std::move(callback);
+}
+
+void ConferenceFrameTransformer::RegisterTransformedFrameSinkCallback(
+    webrtc::scoped_refptr<webrtc::TransformedFrameCallback> callback,
+    uint32_t ssrc) {
+  RegisterTransformedFrameCallback(std::move(callback));
+}
+
+void ConferenceFrameTransformer::UnregisterTransformedFrameCallback() {
+  absl::MutexLock lock(&mutex_);
+  decoder_callback_ = nullptr;
+}
+
+void ConferenceFrameTransformer::UnregisterTransformedFrameSinkCallback(
+    uint32_t ssrc) {
+  UnregisterTransformedFrameCallback();
 }
 
 }  // namespace meet
@@ -17,22 +17,33 @@
 #ifndef CPP_INTERNAL_CONFERENCE_MEDIA_TRACKS_H_
 #define CPP_INTERNAL_CONFERENCE_MEDIA_TRACKS_H_
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <variant>
 
 #include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/functional/any_invocable.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "meet_clients/api/media_api_client_interface.h"
+#include "meet_clients/internal/i420_buffer_pool.h"
+#include "meet_clients/internal/video_frame_scaler.h"
+#include "api/frame_transformer_interface.h"
 #include "api/media_stream_interface.h"
+#include "api/media_types.h"
 #include "api/rtp_receiver_interface.h"
 #include "api/scoped_refptr.h"
 #include "api/video/video_frame.h"
 #include "api/video/video_sink_interface.h"
+#include "api/video/video_source_interface.h"
+#include "media/base/video_adapter.h"
+#include "rtc_base/thread.h"
 
 ABSL_POINTERS_DEFAULT_NONNULL
 
@@ -67,20 +78,125 @@ class ConferenceAudioTrack : public webrtc::AudioTrackSinkInterface {
 
 // Adapter class for webrtc::VideoSinkInterface that converts
 // webrtc::VideoFrames to meet::VideoFrames and calls the callback.
+//
+// Remote video tracks deliver every decoded frame to their sinks regardless of
+// the sinks' wants, so the track drops and downscales frames itself to honor
+// the wants set with `SetSinkWants`.
+//
+// Once frames need to be downscaled for the wants, or scaling has been
+// configured with `SetScalingOptions`, frames are downscaled, scaled and
+// delivered on a scaling thread of the track's own, so that scaling does not
+// hold up WebRTC's decoding thread.
 class ConferenceVideoTrack
     : public webrtc::VideoSinkInterface<webrtc::VideoFrame> {
  public:
   using VideoFrameCallback = absl::AnyInvocable<void(VideoFrame frame)>;
 
-  explicit ConferenceVideoTrack(std::string mid, VideoFrameCallback callback)
-      : mid_(std::move(mid)), callback_(std::move(callback)) {}
+  // Frames that are downscaled or scaled are written to buffers from
+  // `buffer_pool`. If it is null, the track uses a pool of its own.
+  explicit ConferenceVideoTrack(
+      std::string mid, VideoFrameCallback callback,
+      /*absl_nullable*/ std::shared_ptr<I420BufferPool> buffer_pool = nullptr)
+      : mid_(std::move(mid)),
+        callback_(std::move(callback)),
+        buffer_pool_(buffer_pool != nullptr
+                         ? std::move(buffer_pool)
+                         : std::make_shared<I420BufferPool>()) {}
+  ~ConferenceVideoTrack() override;
 
   void OnFrame(const webrtc::VideoFrame& frame) override;
 
+  // Applies the max framerate, max pixel count and resolution alignment of
+  // `wants` to subsequent frames. May be called on any thread.
+  void SetSinkWants(const webrtc::VideoSinkWants& wants) {
+    video_adapter_.OnSinkWants(wants);
+  }
+  // Scales subsequent frames as configured by `options`, or stops scaling them
+  // if `options` is empty. May be called on any thread.
+  void SetScalingOptions(std::optional<VideoScalingOptions> options);
+
+  // Returns the number of frames dropped because `kMaxQueuedScalingFrames`
+  // frames were already waiting to be scaled. May be called on any thread.
+  int64_t dropped_frames() const { return dropped_frames_; }
+
  private:
+  // Frames received while this many frames are waiting to be scaled and
+  // delivered are dropped.
+  static constexpr int kMaxQueuedScalingFrames = 3;
+
+  // Starts the scaling thread, if it has not been started yet. Returns false
+  // if it could not be started.
+  bool StartScalingThread() ABSL_EXCLUSIVE_LOCKS_REQUIRED(scaling_mutex_);
+  // Returns `frame` cropped and downscaled as decided by `video_adapter_`, or
+  // `frame` itself if the adapted size is the frame's size.
+  webrtc::VideoFrame AdaptFrame(const webrtc::VideoFrame& frame,
+                                int cropped_width, int cropped_height,
+                                int adapted_width, int adapted_height) const;
+
   // Media line from the SDP offer/answer that identifies this track.
   std::string mid_;
   VideoFrameCallback callback_;
+  const std::shared_ptr<I420BufferPool> buffer_pool_;
+  // Thread-safe.
+  webrtc::VideoAdapter video_adapter_;
+
+  absl::Mutex scaling_mutex_;
+  // Null if frames are not scaled. Only used on `scaling_thread_`.
+  /*absl_nullable*/ std::shared_ptr<VideoFrameScaler> scaler_
+      ABSL_GUARDED_BY(scaling_mutex_);
+  std::atomic<int> queued_scaling_frames_ = 0;
+  std::atomic<int64_t> dropped_frames_ = 0;
+  // Created once scaling is first configured.
+  /*absl_nullable*/ std::unique_ptr<webrtc::Thread> scaling_thread_
+      ABSL_GUARDED_BY(scaling_mutex_);
+};
+
+// Frame transformer that delivers a receiver's encoded frames, as
+// meet::EncodedFrames, to the callback before they reach the decoder.
+//
+// If `forward_to_decoder` is false, frames are dropped after the callback, so
+// that they are never decoded.
+//
+// This class is thread-safe.
+class ConferenceFrameTransformer : public webrtc::FrameTransformerInterface {
+ public:
+  using EncodedFrameCallback = absl::AnyInvocable<void(EncodedFrame frame)>;
+
+  ConferenceFrameTransformer(std::string mid, webrtc::MediaType media_type,
+                             EncodedFrameCallback callback,
+                             bool forward_to_decoder)
+      : mid_(std::move(mid)),
+        media_type_(media_type),
+        callback_(std::move(callback)),
+        forward_to_decoder_(forward_to_decoder) {}
+
+  void Transform(std::unique_ptr<webrtc::TransformableFrameInterface>
+                     transformable_frame) override;
+
+  // Audio receivers register a single callback, while video receivers register
+  // a callback per SSRC. Since each receiver has its own transformer, both are
+  // treated the same.
+  void RegisterTransformedFrameCallback(
+      webrtc::scoped_refptr<webrtc::TransformedFrameCallback> callback)
+      override;
+  void RegisterTransformedFrameSinkCallback(
+      webrtc::scoped_refptr<webrtc::TransformedFrameCallback> callback,
+      uint32_t ssrc) override;
+  void UnregisterTransformedFrameCallback() override;
+  void UnregisterTransformedFrameSinkCallback(uint32_t ssrc) override;
+
+ private:
+  // Media line from the SDP offer/answer that identifies this track.
+  std::string mid_;
+  webrtc::MediaType media_type_;
+  EncodedFrameCallback callback_;
+  bool forward_to_decoder_;
+
+  absl::Mutex mutex_;
+  // Callback for handing frames back to the receiver, so that they are
+  // decoded.
+  /*absl_nullable*/ webrtc::scoped_refptr<webrtc::TransformedFrameCallback>
+      decoder_callback_ ABSL_GUARDED_BY(mutex_);
 };
 
 // Convenience type for holding either an audio or video track.
@@ -17,6 +17,7 @@
 #include "meet_clients/internal/conference_media_tracks.h"
 
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <utility>
@@ -28,15 +29,26 @@
 #include "absl/base/log_severity.h"
 #include "absl/base/nullability.h"
 #include "absl/log/globals.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
 #include "meet_clients/api/media_api_client_interface.h"
+#include "api/array_view.h"
+#include "api/frame_transformer_interface.h"
+#include "api/make_ref_counted.h"
+#include "api/media_types.h"
 #include "api/rtp_packet_info.h"
 #include "api/rtp_packet_infos.h"
 #include "api/scoped_refptr.h"
 #include "api/test/mock_rtpreceiver.h"
+#include "api/test/mock_transformable_audio_frame.h"
+#include "api/test/mock_transformable_video_frame.h"
 #include "api/transport/rtp/rtp_source.h"
 #include "api/units/timestamp.h"
 #include "api/video/i420_buffer.h"
 #include "api/video/video_frame.h"
+#include "api/video/video_frame_metadata.h"
+#include "api/video/video_source_interface.h"
+#include "rtc_base/thread.h"
 
 ABSL_POINTERS_DEFAULT_NONNULL
 
@@ -46,13 +58,24 @@ namespace {
 using ::base_logging::ERROR;
 using ::base_logging::INFO;
 using ::testing::_;
+using ::testing::AllOf;
 using ::testing::kDoNotCaptureLogsYet;
+using ::testing::ElementsAre;
+using ::testing::Ge;
+using ::testing::Le;
 using ::testing::MockFunction;
 using ::testing::Return;
 using ::testing::ScopedMockLog;
 using ::testing::SizeIs;
 using ::testing::UnorderedElementsAre;
 
+class MockTransformedFrameCallback : public webrtc::TransformedFrameCallback {
+ public:
+  MOCK_METHOD(void, OnTransformedFrame,
+              (std::unique_ptr<webrtc::TransformableFrameInterface>),
+              (override));
+};
+
 TEST(ConferenceAudioTrackTest, CallsObserverWithAudioFrameFromLoudestSpeaker) {
   webrtc::scoped_refptr<webrtc::MockRtpReceiver> mock_receiver(
       new webrtc::MockRtpReceiver());
@@ -396,5 +419,234 @@ TEST(ConferenceVideoTrackTest, LogsErrorWithMissingPacketCsrcs) {
   EXPECT_EQ(message, "VideoFrame is missing CSRC for mid: mid");
 }
 
+webrtc::VideoFrame CreateVideoFrame(int width, int height,
+                                    int64_t timestamp_us) {
+  webrtc::RtpPacketInfo packet_info;
+  packet_info.set_csrcs({123});
+  packet_info.set_ssrc(456);
+  return webrtc::VideoFrame::Builder()
+      .set_packet_infos(webrtc::RtpPacketInfos({packet_info}))
+      .set_video_frame_buffer(webrtc::I420Buffer::Create(width, height))
+      .set_timestamp_us(timestamp_us)
+      .build();
+}
+
+TEST(ConferenceVideoTrackTest, DropsFramesAboveMaxFramerate) {
+  int received_frames = 0;
+  ConferenceVideoTrack video_track(
+      "mid", [&received_frames](VideoFrame /*frame*/) { received_frames++; });
+  webrtc::VideoSinkWants wants;
+  wants.max_framerate_fps = 5;
+  video_track.SetSinkWants(wants);
+
+  // Two seconds of 30 fps video.
+  for (int i = 0; i < 60; i++) {
+    video_track.OnFrame(CreateVideoFrame(42, 42, i * 1'000'000 / 30));
+  }
+
+  EXPECT_THAT(received_frames, AllOf(Ge(9), Le(11)));
+}
+
+TEST(ConferenceVideoTrackTest, DownscalesFramesAboveMaxPixelCount) {
+  absl::Notification received;
+  std::optional<webrtc::VideoFrame> received_frame;
+  webrtc::Thread* delivering_thread = nullptr;
+  ConferenceVideoTrack video_track("mid", [&](VideoFrame frame) {
+    received_frame = frame.frame;
+    delivering_thread = webrtc::Thread::Current();
+    received.Notify();
+  });
+  webrtc::VideoSinkWants wants;
+  wants.max_pixel_count = 640 * 360;
+  wants.resolution_alignment = 16;
+  video_track.SetSinkWants(wants);
+
+  video_track.OnFrame(CreateVideoFrame(1280, 720, /*timestamp_us=*/0));
+
+  // Downscaling is done on the scaling thread, rather than the thread that
+  // delivered the frame.
+  ASSERT_TRUE(received.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  EXPECT_NE(delivering_thread, nullptr);
+  EXPECT_NE(delivering_thread, webrtc::Thread::Current());
+  EXPECT_LT(received_frame->width(), 1280);
+  EXPECT_LE(received_frame->size(), 640 * 360);
+  EXPECT_EQ(received_frame->width() % 16, 0);
+  EXPECT_EQ(received_frame->height() % 16, 0);
+}
+
+TEST(ConferenceVideoTrackTest, DeliversFramesUnchangedWithDefaultWants) {
+  std::optional<webrtc::VideoFrame> received_frame;
+  ConferenceVideoTrack video_track(
+      "mid",
+      [&received_frame](VideoFrame frame) { received_frame = frame.frame; });
+  video_track.SetSinkWants(webrtc::VideoSinkWants());
+  webrtc::VideoFrame frame = CreateVideoFrame(1280, 720, /*timestamp_us=*/0);
+
+  video_track.OnFrame(frame);
+
+  ASSERT_TRUE(received_frame.has_value());
+  EXPECT_EQ(received_frame->video_frame_buffer(), frame.video_frame_buffer());
+}
+
+TEST(ConferenceVideoTrackTest, ScalesFramesOnScalingThread) {
+  absl::Notification received;
+  std::optional<webrtc::VideoFrame> received_frame;
+  webrtc::Thread* delivering_thread = nullptr;
+  ConferenceVideoTrack video_track("mid", [&](VideoFrame frame) {
+    received_frame = frame.frame;
+    delivering_thread = webrtc::Thread::Current();
+    received.Notify();
+  });
+  video_track.SetScalingOptions(
+      VideoScalingOptions{.width = 224, .height = 224});
+
+  video_track.OnFrame(CreateVideoFrame(1280, 720, /*timestamp_us=*/0));
+
+  ASSERT_TRUE(received.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  EXPECT_EQ(received_frame->width(), 224);
+  EXPECT_EQ(received_frame->height(), 224);
+  EXPECT_NE(delivering_thread, nullptr);
+  EXPECT_NE(delivering_thread, webrtc::Thread::Current());
+}
+
+TEST(ConferenceVideoTrackTest, CountsFramesDroppedWhileScalingFallsBehind) {
+  absl::Notification first_received;
+  absl::Notification release_callback;
+  int received_frames = 0;
+  ConferenceVideoTrack video_track("mid", [&](VideoFrame frame) {
+    if (++received_frames == 1) {
+      first_received.Notify();
+      release_callback.WaitForNotification();
+    }
+  });
+  video_track.SetScalingOptions(
+      VideoScalingOptions{.width = 224, .height = 224});
+
+  // The first frame blocks the scaling thread, and counts as queued until it
+  // has been delivered, so only two more frames are queued.
+  video_track.OnFrame(CreateVideoFrame(1280, 720, /*timestamp_us=*/0));
+  ASSERT_TRUE(first_received.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  for (int i = 1; i < 5; i++) {
+    video_track.OnFrame(CreateVideoFrame(1280, 720, i * 100'000));
+  }
+
+  EXPECT_EQ(video_track.dropped_frames(), 2);
+  release_callback.Notify();
+}
+
+constexpr uint8_t kEncodedData[] = {1, 2, 3, 4};
+
+TEST(ConferenceFrameTransformerTest, CallsCallbackWithEncodedVideoFrame) {
+  std::optional<EncodedFrame> received_frame;
+  std::vector<uint8_t> received_data;
+  auto transformer = webrtc::make_ref_counted<ConferenceFrameTransformer>(
+      "mid", webrtc::MediaType::VIDEO,
+      [&](EncodedFrame frame) {
+        received_data.assign(frame.data.begin(), frame.data.end());
+        EXPECT_EQ(frame.mime_type, "video/VP8");
+        received_frame.emplace(frame);
+      },
+      /*forward_to_decoder=*/true);
+  auto decoder_callback =
+      webrtc::make_ref_counted<MockTransformedFrameCallback>();
+  EXPECT_CALL(*decoder_callback, OnTransformedFrame);
+  transformer->RegisterTransformedFrameSinkCallback(decoder_callback,
+                                                    /*ssrc=*/456);
+  auto frame = std::make_unique<webrtc::MockTransformableVideoFrame>();
+  webrtc::VideoFrameMetadata metadata;
+  metadata.SetCsrcs({123});
+  ON_CALL(*frame, Metadata).WillByDefault(Return(metadata));
+  ON_CALL(*frame, IsKeyFrame).WillByDefault(Return(true));
+  ON_CALL(*frame, GetData)
+      .WillByDefault(Return(webrtc::ArrayView<const uint8_t>(kEncodedData)));
+  ON_CALL(*frame, GetSsrc).WillByDefault(Return(456));
+  ON_CALL(*frame, GetTimestamp).WillByDefault(Return(90000));
+  ON_CALL(*frame, GetMimeType).WillByDefault(Return("video/VP8"));
+
+  transformer->Transform(std::move(frame));
+
+  ASSERT_TRUE(received_frame.has_value());
+  EXPECT_EQ(received_frame->media_type, webrtc::MediaType::VIDEO);
+  EXPECT_THAT(received_data, ElementsAre(1, 2, 3, 4));
+  EXPECT_EQ(received_frame->rtp_timestamp, 90000);
+  EXPECT_TRUE(received_frame->is_key_frame);
+  EXPECT_EQ(received_frame->contributing_source, 123);
+  EXPECT_EQ(received_frame->synchronization_source, 456);
+}
+
+TEST(ConferenceFrameTransformerTest,
+     CallsCallbackWithEncodedAudioFrameSkippingLoudestSpeakerCsrc) {
+  std::optional<EncodedFrame> received_frame;
+  auto transformer = webrtc::make_ref_counted<ConferenceFrameTransformer>(
+      "mid", webrtc::MediaType::AUDIO,
+      [&](EncodedFrame frame) { received_frame.emplace(frame); },
+      /*forward_to_decoder=*/true);
+  auto frame = std::make_unique<webrtc::MockTransformableAudioFrame>();
+  const uint32_t csrcs[] = {kLoudestSpeakerCsrc, 111};
+  ON_CALL(*frame, GetContributingSources)
+      .WillByDefault(Return(webrtc::ArrayView<const uint32_t>(csrcs)));
+  ON_CALL(*frame, GetData)
+      .WillByDefault(Return(webrtc::ArrayView<const uint8_t>(kEncodedData)));
+  ON_CALL(*frame, GetSsrc).WillByDefault(Return(333));
+
+  transformer->Transform(std::move(frame));
+
+  ASSERT_TRUE(received_frame.has_value());
+  EXPECT_EQ(received_frame->media_type, webrtc::MediaType::AUDIO);
+  EXPECT_TRUE(received_frame->is_key_frame);
+  EXPECT_EQ(received_frame->contributing_source, 111);
+  EXPECT_EQ(received_frame->synchronization_source, 333);
+}
+
+TEST(ConferenceFrameTransformerTest, SkipsFrameWithMissingCsrc) {
+  MockFunction<void(EncodedFrame)> callback;
+  EXPECT_CALL(callback, Call).Times(0);
+  auto transformer = webrtc::make_ref_counted<ConferenceFrameTransformer>(
+      "mid", webrtc::MediaType::AUDIO, callback.AsStdFunction(),
+      /*forward_to_decoder=*/true);
+  auto frame = std::make_unique<webrtc::MockTransformableAudioFrame>();
+  ON_CALL(*frame, GetContributingSources)
+      .WillByDefault(Return(webrtc::ArrayView<const uint32_t>()));
+
+  transformer->Transform(std::move(frame));
+}
+
+TEST(ConferenceFrameTransformerTest, DropsFrameIfNotForwardingToDecoder) {
+  MockFunction<void(EncodedFrame)> callback;
+  EXPECT_CALL(callback, Call);
+  auto transformer = webrtc::make_ref_counted<ConferenceFrameTransformer>(
+      "mid", webrtc::MediaType::VIDEO, callback.AsStdFunction(),
+      /*forward_to_decoder=*/false);
+  auto decoder_callback =
+      webrtc::make_ref_counted<MockTransformedFrameCallback>();
+  EXPECT_CALL(*decoder_callback, OnTransformedFrame).Times(0);
+  transformer->RegisterTransformedFrameSinkCallback(decoder_callback,
+                                                    /*ssrc=*/456);
+  auto frame = std::make_unique<webrtc::MockTransformableVideoFrame>();
+  webrtc::VideoFrameMetadata metadata;
+  metadata.SetCsrcs({123});
+  ON_CALL(*frame, Metadata).WillByDefault(Return(metadata));
+
+  transformer->Transform(std::move(frame));
+}
+
+TEST(ConferenceFrameTransformerTest, StopsForwardingAfterUnregister) {
+  auto transformer = webrtc::make_ref_counted<ConferenceFrameTransformer>(
+      "mid", webrtc::MediaType::VIDEO, [](EncodedFrame /*frame*/) {},
+      /*forward_to_decoder=*/true);
+  auto decoder_callback =
+      webrtc::make_ref_counted<MockTransformedFrameCallback>();
+  EXPECT_CALL(*decoder_callback, OnTransformedFrame).Times(0);
+  transformer->RegisterTransformedFrameSinkCallback(decoder_callback,
+                                                    /*ssrc=*/456);
+  transformer->UnregisterTransformedFrameSinkCallback(/*ssrc=*/456);
+  auto frame = std::make_unique<webrtc::MockTransformableVideoFrame>();
+  webrtc::VideoFrameMetadata metadata;
+  metadata.SetCsrcs({123});
+  ON_CALL(*frame, Metadata).WillByDefault(Return(metadata));
+
+  transformer->Transform(std::move(frame));
+}
+
 }  // namespace
 }  // namespace meet
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/internal/i420_buffer_pool.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/synchronization/mutex.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
+#include "api/video/video_frame_buffer.h"
+#include "common_video/include/video_frame_buffer_pool.h"
+#include "libyuv/convert.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace meet {
+
+webrtc::scoped_refptr<webrtc::I420Buffer> I420BufferPool::CreateBuffer(
+    int width, int height) {
+  absl::MutexLock lock(&mutex_);
+  auto [it, inserted] = pools_.try_emplace(std::make_pair(width, height));
+  if (inserted) {
+    if (static_cast<int>(pools_.size()) > options_.max_resolutions) {
+      // Release the buffers of the least recently used resolution. Buffers
+      // still in use stay valid, as they are reference counted.
+      auto least_recently_used = pools_.end();
+      for (auto pool = pools_.begin(); pool != pools_.end(); ++pool) {
+        if (pool != it && (least_recently_used == pools_.end() ||
+                           pool->second->last_used <
+                               least_recently_used->second->last_used)) {
+          least_recently_used = pool;
+        }
+      }
+      pools_.erase(least_recently_used);
+    }
+    it->second =
+        std::make_unique<ResolutionPool>(options_.max_buffers_per_resolution);
+  }
+  ResolutionPool& resolution_pool = *it->second;
+  resolution_pool.last_used = ++use_counter_;
+
+  /*absl_nullable*/ webrtc::scoped_refptr<webrtc::I420Buffer> buffer =
+      resolution_pool.pool.CreateI420Buffer(width, height);
+  if (buffer == nullptr) {
+    // Every buffer of the resolution is in use.
+    stats_.misses++;
+    return webrtc::I420Buffer::Create(width, height);
+  }
+  if (resolution_pool.known_buffers.insert(buffer.get()).second) {
+    stats_.misses++;
+  } else {
+    stats_.hits++;
+  }
+  return buffer;
+}
+
+webrtc::scoped_refptr<webrtc::I420BufferInterface> I420BufferPool::ToI420(
+    webrtc::VideoFrameBuffer& buffer) {
+  if (buffer.type() != webrtc::VideoFrameBuffer::Type::kNV12) {
+    return buffer.ToI420();
+  }
+  const webrtc::NV12BufferInterface& nv12 = *buffer.GetNV12();
+  webrtc::scoped_refptr<webrtc::I420Buffer> i420 =
+      CreateBuffer(nv12.width(), nv12.height());
+  libyuv::NV12ToI420(nv12.DataY(), nv12.StrideY(), nv12.DataUV(),
+                     nv12.StrideUV(), i420->MutableDataY(), i420->StrideY(),
+                     i420->MutableDataU(), i420->StrideU(),
+                     i420->MutableDataV(), i420->StrideV(), nv12.width(),
+                     nv12.height());
+  return i420;
+}
+
+I420BufferPool::Stats I420BufferPool::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+}  // namespace meet
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_INTERNAL_I420_BUFFER_POOL_H_
+#define CPP_INTERNAL_I420_BUFFER_POOL_H_
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
+#include "api/video/video_frame_buffer.h"
+#include "common_video/include/video_frame_buffer_pool.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace meet {
+
+// A pool of I420 buffers for converted and scaled video frames, keyed by
+// resolution.
+//
+// Buffers are reused once every other reference to them has been released, so
+// that steady-state video does not allocate a buffer for every frame. Each
+// resolution has its own `webrtc::VideoFrameBufferPool`, so that streams of
+// different resolutions do not evict each other's buffers.
+//
+// This class is thread-safe.
+class I420BufferPool {
+ public:
+  struct Options {
+    // Maximum number of buffers of each resolution kept for reuse. While that
+    // many are in use, buffers of the resolution are allocated without being
+    // kept.
+    int max_buffers_per_resolution = 16;
+    // Maximum number of resolutions whose buffers are kept. The buffers of the
+    // least recently used resolution are released to make room for a new one.
+    int max_resolutions = 4;
+  };
+
+  struct Stats {
+    // Buffers reused from the pool.
+    int64_t hits = 0;
+    // Buffers allocated, because the pool had no free buffer of the
+    // resolution.
+    int64_t misses = 0;
+  };
+
+  I420BufferPool() : I420BufferPool(Options()) {}
+  explicit I420BufferPool(Options options) : options_(std::move(options)) {}
+
+  // Returns a `width` by `height` buffer with undefined contents.
+  webrtc::scoped_refptr<webrtc::I420Buffer> CreateBuffer(int width,
+                                                         int height);
+  // Returns `buffer` as I420. I420 buffers are returned as is, and NV12
+  // buffers are converted into a buffer of the pool. Other buffers are
+  // converted by `ToI420()`, which allocates.
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> ToI420(
+      webrtc::VideoFrameBuffer& buffer);
+
+  Stats GetStats() const;
+
+ private:
+  struct ResolutionPool {
+    explicit ResolutionPool(int max_buffers)
+        : pool(/*zero_initialize=*/false, max_buffers) {}
+
+    webrtc::VideoFrameBufferPool pool;
+    // Buffers the pool has handed out before, to tell reused buffers from new
+    // ones.
+    absl::flat_hash_set<const webrtc::I420Buffer*> known_buffers;
+    int64_t last_used = 0;
+  };
+
+  const Options options_;
+
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::pair<int, int>, std::unique_ptr<ResolutionPool>>
+      pools_ ABSL_GUARDED_BY(mutex_);
+  // Incremented for every buffer, to order the resolutions by last use.
+  int64_t use_counter_ ABSL_GUARDED_BY(mutex_) = 0;
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace meet
+
+#endif  // CPP_INTERNAL_I420_BUFFER_POOL_H_
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/internal/i420_buffer_pool.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
+#include "api/video/nv12_buffer.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace meet {
+namespace {
+
+MATCHER_P2(StatsAre, hits, misses, "") {
+  return arg.hits == hits && arg.misses == misses;
+}
+
+TEST(I420BufferPoolTest, ReusesReleasedBuffers) {
+  I420BufferPool pool;
+  webrtc::scoped_refptr<webrtc::I420Buffer> first = pool.CreateBuffer(64, 32);
+  const webrtc::I420Buffer* first_buffer = first.get();
+  first = nullptr;
+
+  webrtc::scoped_refptr<webrtc::I420Buffer> second = pool.CreateBuffer(64, 32);
+
+  EXPECT_EQ(second.get(), first_buffer);
+  EXPECT_EQ(second->width(), 64);
+  EXPECT_EQ(second->height(), 32);
+  EXPECT_THAT(pool.GetStats(), StatsAre(/*hits=*/1, /*misses=*/1));
+}
+
+TEST(I420BufferPoolTest, AllocatesNewBuffersWhileBuffersAreInUse) {
+  I420BufferPool pool;
+  webrtc::scoped_refptr<webrtc::I420Buffer> first = pool.CreateBuffer(64, 32);
+
+  webrtc::scoped_refptr<webrtc::I420Buffer> second = pool.CreateBuffer(64, 32);
+
+  EXPECT_NE(second.get(), first.get());
+  EXPECT_THAT(pool.GetStats(), StatsAre(/*hits=*/0, /*misses=*/2));
+}
+
+TEST(I420BufferPoolTest, DoesNotKeepBuffersBeyondMaxBuffers) {
+  I420BufferPool pool({.max_buffers_per_resolution = 1});
+  webrtc::scoped_refptr<webrtc::I420Buffer> pooled = pool.CreateBuffer(64, 32);
+  webrtc::scoped_refptr<webrtc::I420Buffer> unpooled =
+      pool.CreateBuffer(64, 32);
+  const webrtc::I420Buffer* pooled_buffer = pooled.get();
+  pooled = nullptr;
+  unpooled = nullptr;
+
+  webrtc::scoped_refptr<webrtc::I420Buffer> reused = pool.CreateBuffer(64, 32);
+  webrtc::scoped_refptr<webrtc::I420Buffer> allocated =
+      pool.CreateBuffer(64, 32);
+
+  EXPECT_EQ(reused.get(), pooled_buffer);
+  EXPECT_THAT(pool.GetStats(), StatsAre(/*hits=*/1, /*misses=*/3));
+}
+
+TEST(I420BufferPoolTest, KeepsBuffersOfEachResolution) {
+  I420BufferPool pool({.max_resolutions = 2});
+  for (int i = 0; i < 3; i++) {
+    pool.CreateBuffer(64, 32);
+    pool.CreateBuffer(32, 16);
+  }
+
+  EXPECT_THAT(pool.GetStats(), StatsAre(/*hits=*/4, /*misses=*/2));
+}
+
+TEST(I420BufferPoolTest, ReleasesBuffersOfLeastRecentlyUsedResolution) {
+  I420BufferPool pool({.max_resolutions = 2});
+  pool.CreateBuffer(64, 32);
+  pool.CreateBuffer(32, 16);
+  pool.CreateBuffer(64, 32);
+  // Releases the buffers of 32x16, which was used least recently.
+  pool.CreateBuffer(16, 8);
+
+  pool.CreateBuffer(64, 32);
+  pool.CreateBuffer(32, 16);
+
+  EXPECT_THAT(pool.GetStats(), StatsAre(/*hits=*/2, /*misses=*/4));
+}
+
+TEST(I420BufferPoolTest, ReturnsI420BufferAsIs) {
+  I420BufferPool pool;
+  webrtc::scoped_refptr<webrtc::I420Buffer> buffer =
+      webrtc::I420Buffer::Create(64, 32);
+
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> i420 =
+      pool.ToI420(*buffer);
+
+  EXPECT_EQ(i420.get(), buffer.get());
+  EXPECT_THAT(pool.GetStats(), StatsAre(/*hits=*/0, /*misses=*/0));
+}
+
+TEST(I420BufferPoolTest, ConvertsNv12BufferIntoPooledBuffer) {
+  I420BufferPool pool;
+  webrtc::scoped_refptr<webrtc::NV12Buffer> nv12 =
+      webrtc::NV12Buffer::Create(64, 32);
+  nv12->InitializeData();
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> expected = nv12->ToI420();
+  pool.ToI420(*nv12);
+
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> i420 = pool.ToI420(*nv12);
+
+  ASSERT_EQ(i420->width(), 64);
+  ASSERT_EQ(i420->height(), 32);
+  for (int y = 0; y < 32; y++) {
+    EXPECT_EQ(memcmp(i420->DataY() + y * i420->StrideY(),
+                     expected->DataY() + y * expected->StrideY(), 64),
+              0);
+  }
+  for (int y = 0; y < 16; y++) {
+    EXPECT_EQ(memcmp(i420->DataU() + y * i420->StrideU(),
+                     expected->DataU() + y * expected->StrideU(), 32),
+              0);
+    EXPECT_EQ(memcmp(i420->DataV() + y * i420->StrideV(),
+                     expected->DataV() + y * expected->StrideV(), 32),
+              0);
+  }
+  EXPECT_THAT(pool.GetStats(), StatsAre(/*hits=*/1, /*misses=*/1));
+}
+
+}  // namespace
+}  // namespace meet
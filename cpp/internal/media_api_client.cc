@@ -36,6 +36,7 @@
 #include "meet_clients/api/session_control_resource.h"
 #include "meet_clients/api/video_assignment_resource.h"
 #include "meet_clients/internal/conference_media_tracks.h"
+#include "meet_clients/internal/i420_buffer_pool.h"
 #include "meet_clients/internal/stats_request_from_report.h"
 #include "meet_clients/internal/variant_utils.h"
 #include "api/make_ref_counted.h"
@@ -75,8 +76,45 @@ class OnRTCStatsCollected : public webrtc::RTCStatsCollectorCallback {
   Callback callback_;
 };
 
+webrtc::VideoSinkWants ToVideoSinkWants(
+    const ReceivingVideoStreamOptions& options) {
+  webrtc::VideoSinkWants wants;
+  if (options.max_framerate.has_value()) {
+    wants.max_framerate_fps = *options.max_framerate;
+  }
+  if (options.max_pixel_count.has_value()) {
+    wants.max_pixel_count = *options.max_pixel_count;
+  }
+  wants.resolution_alignment = options.resolution_alignment;
+  return wants;
+}
+
 }  // namespace
 
+absl::Status ValidateReceivingVideoStreamOptions(
+    const ReceivingVideoStreamOptions& options) {
+  if (options.max_framerate.has_value() && *options.max_framerate <= 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Max framerate must be positive; got ", *options.max_framerate));
+  }
+  if (options.max_pixel_count.has_value() && *options.max_pixel_count <= 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Max pixel count must be positive; got ", *options.max_pixel_count));
+  }
+  if (options.resolution_alignment <= 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Resolution alignment must be positive; got ",
+                     options.resolution_alignment));
+  }
+  if (options.scaling.has_value() &&
+      (options.scaling->width <= 0 || options.scaling->height <= 0)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Scaled size must be positive; got ",
+                     options.scaling->width, "x", options.scaling->height));
+  }
+  return absl::OkStatus();
+}
+
 absl::Status MediaApiClient::ConnectActiveConference(
     absl::string_view join_endpoint, absl::string_view conference_id,
     absl::string_view access_token, std::optional<int> connection_timeout_ms,
@@ -181,6 +219,46 @@ absl::Status MediaApiClient::SendRequest(const MessageToServer& request) {
       request);
 }
 
+absl::Status MediaApiClient::SetReceivingVideoStreamOptions(
+    int stream_index, const ReceivingVideoStreamOptions& options) {
+  if (absl::Status status = ValidateReceivingVideoStreamOptions(options);
+      !status.ok()) {
+    return status;
+  }
+  absl::MutexLock lock(&video_sinks_mutex_);
+  if (stream_index < 0 ||
+      stream_index >= static_cast<int>(video_stream_options_.size())) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Stream index must be in [0, ",
+                     video_stream_options_.size(), "); got ", stream_index));
+  }
+  video_stream_options_[stream_index] = options;
+  // If the stream has not been signaled yet, the options are applied once it
+  // is.
+  if (stream_index < static_cast<int>(video_sinks_.size())) {
+    webrtc::VideoSinkWants wants = ToVideoSinkWants(options);
+    VideoSink& video_sink = video_sinks_[stream_index];
+    video_sink.sink->SetSinkWants(wants);
+    video_sink.sink->SetScalingOptions(options.scaling);
+    video_sink.track->AddOrUpdateSink(video_sink.sink, wants);
+  }
+  return absl::OkStatus();
+}
+
+VideoBufferPoolStats MediaApiClient::GetVideoBufferPoolStats() const {
+  I420BufferPool::Stats stats = video_buffer_pool_->GetStats();
+  int64_t dropped_frames = 0;
+  {
+    absl::MutexLock lock(&video_sinks_mutex_);
+    for (const VideoSink& video_sink : video_sinks_) {
+      dropped_frames += video_sink.sink->dropped_frames();
+    }
+  }
+  return {.hits = stats.hits,
+          .misses = stats.misses,
+          .dropped_frames = dropped_frames};
+}
+
 void MediaApiClient::HandleTrackSignaled(
     webrtc::scoped_refptr<webrtc::RtpTransceiverInterface> transceiver) {
   // Tracks should only be signaled by the conference peer connection during its
@@ -200,6 +278,25 @@ void MediaApiClient::HandleTrackSignaled(
     mid = "unset";
   }
 
+  if (media_type != webrtc::MediaType::AUDIO &&
+      media_type != webrtc::MediaType::VIDEO) {
+    LOG(WARNING) << "Received remote track of unsupported media type: "
+                 << media_type;
+    return;
+  }
+
+  if (enable_encoded_frames_) {
+    receiver->SetDepacketizerToDecoderFrameTransformer(
+        webrtc::make_ref_counted<ConferenceFrameTransformer>(
+            mid, media_type,
+            std::bind_front(&MediaApiClientObserverInterface::OnEncodedFrame,
+                            observer_),
+            /*forward_to_decoder=*/enable_decoded_frames_));
+  }
+  if (!enable_decoded_frames_) {
+    return;
+  }
+
   switch (media_type) {
     case webrtc::MediaType::AUDIO: {
       auto conference_audio_track = std::make_unique<ConferenceAudioTrack>(
@@ -214,19 +311,30 @@ void MediaApiClient::HandleTrackSignaled(
       return;
     case webrtc::MediaType::VIDEO: {
       auto conference_video_track = std::make_unique<ConferenceVideoTrack>(
-          mid, std::bind_front(&MediaApiClientObserverInterface::OnVideoFrame,
-                               observer_));
-      auto video_track =
-          static_cast<webrtc::VideoTrackInterface*>(receiver_track.get());
-      video_track->AddOrUpdateSink(conference_video_track.get(),
-                                   webrtc::VideoSinkWants());
+          mid,
+          std::bind_front(&MediaApiClientObserverInterface::OnVideoFrame,
+                          observer_),
+          video_buffer_pool_);
+      auto video_track = webrtc::scoped_refptr<webrtc::VideoTrackInterface>(
+          static_cast<webrtc::VideoTrackInterface*>(receiver_track.get()));
+      absl::MutexLock lock(&video_sinks_mutex_);
+      ReceivingVideoStreamOptions options;
+      if (video_sinks_.size() < video_stream_options_.size()) {
+        options = video_stream_options_[video_sinks_.size()];
+      }
+      webrtc::VideoSinkWants wants = ToVideoSinkWants(options);
+      conference_video_track->SetSinkWants(wants);
+      if (options.scaling.has_value()) {
+        conference_video_track->SetScalingOptions(options.scaling);
+      }
+      video_track->AddOrUpdateSink(conference_video_track.get(), wants);
+      video_sinks_.push_back({.track = std::move(video_track),
+                              .sink = conference_video_track.get()});
       media_tracks_.push_back(std::move(conference_video_track));
     }
       return;
     default:
-      LOG(WARNING) << "Received remote track of unsupported media type: "
-                   << media_type;
-      break;
+      return;
   }
 }
 
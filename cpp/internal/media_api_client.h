@@ -37,6 +37,8 @@
 #include "meet_clients/internal/conference_data_channel_interface.h"
 #include "meet_clients/internal/conference_media_tracks.h"
 #include "meet_clients/internal/conference_peer_connection_interface.h"
+#include "meet_clients/internal/i420_buffer_pool.h"
+#include "api/media_stream_interface.h"
 #include "api/rtp_transceiver_interface.h"
 #include "api/scoped_refptr.h"
 #include "api/task_queue/pending_task_safety_flag.h"
@@ -46,6 +48,10 @@ ABSL_POINTERS_DEFAULT_NONNULL
 
 namespace meet {
 
+// Returns an error if `options` has a non-positive limit or scaled size.
+absl::Status ValidateReceivingVideoStreamOptions(
+    const ReceivingVideoStreamOptions& options);
+
 class MediaApiClient : public MediaApiClientInterface {
  public:
   // Container for data channels used by the client.
@@ -68,8 +74,17 @@ class MediaApiClient : public MediaApiClientInterface {
       webrtc::scoped_refptr<MediaApiClientObserverInterface> observer,
       std::unique_ptr<ConferencePeerConnectionInterface>
           conference_peer_connection,
-      ConferenceDataChannels data_channels)
+      ConferenceDataChannels data_channels, bool enable_encoded_frames = false,
+      bool enable_decoded_frames = true,
+      std::vector<ReceivingVideoStreamOptions> video_stream_options = {},
+      int max_pooled_video_buffers = 16)
       : stats_config_({.stats_request_id = 0, .allowlist = {}}),
+        enable_encoded_frames_(enable_encoded_frames),
+        enable_decoded_frames_(enable_decoded_frames),
+        video_buffer_pool_(std::make_shared<I420BufferPool>(
+            I420BufferPool::Options{.max_buffers_per_resolution =
+                                        max_pooled_video_buffers})),
+        video_stream_options_(std::move(video_stream_options)),
         client_thread_(std::move(client_thread)),
         worker_thread_(std::move(worker_thread)),
         observer_(std::move(observer)),
@@ -113,10 +128,19 @@ class MediaApiClient : public MediaApiClientInterface {
       std::optional<int> request_timeout_ms) override;
   absl::Status LeaveConference(int64_t request_id) override;
   absl::Status SendRequest(const MessageToServer& request) override;
+  absl::Status SetReceivingVideoStreamOptions(
+      int stream_index, const ReceivingVideoStreamOptions& options) override;
+  VideoBufferPoolStats GetVideoBufferPoolStats() const override;
 
  private:
   enum class State { kReady, kConnecting, kJoining, kJoined, kDisconnected };
 
+  // A sink registered with a received video track.
+  struct VideoSink {
+    webrtc::scoped_refptr<webrtc::VideoTrackInterface> track;
+    ConferenceVideoTrack* sink;
+  };
+
   // Configuration for collecting stats.
   //
   // https://developers.google.com/meet/media-api/guides/metrics
@@ -170,6 +194,24 @@ class MediaApiClient : public MediaApiClientInterface {
   absl::Mutex mutex_;
   State state_ ABSL_GUARDED_BY(mutex_) = State::kReady;
   StatsConfig stats_config_;
+  // Whether encoded frames are delivered to the observer via
+  // `OnEncodedFrame`.
+  bool enable_encoded_frames_;
+  // Whether frames are decoded and delivered to the observer via
+  // `OnAudioFrame` and `OnVideoFrame`.
+  bool enable_decoded_frames_;
+  // Buffers for the frames that video tracks downscale or scale, shared by all
+  // tracks.
+  const std::shared_ptr<I420BufferPool> video_buffer_pool_;
+
+  mutable absl::Mutex video_sinks_mutex_;
+  // Options of each receiving video stream, in the order the streams are
+  // signaled. Streams without an entry use default options.
+  std::vector<ReceivingVideoStreamOptions> video_stream_options_
+      ABSL_GUARDED_BY(video_sinks_mutex_);
+  // Sinks of the video tracks signaled so far, in the order they were
+  // signaled. The sinks are owned by `media_tracks_`.
+  std::vector<VideoSink> video_sinks_ ABSL_GUARDED_BY(video_sinks_mutex_);
 
   // Internal thread for client initiated asynchronous behavior.
   std::unique_ptr<webrtc::Thread> client_thread_;
@@ -18,6 +18,7 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "absl/base/nullability.h"
 #include "absl/status/status.h"
@@ -234,6 +235,30 @@ MediaApiClientFactory::CreateMediaApiClient(
         kMaxReceivingVideoStreamCount, "; got ",
         api_config.receiving_video_stream_count));
   }
+  if (!api_config.enable_decoded_frames && !api_config.enable_encoded_frames) {
+    return absl::InvalidArgumentError(
+        "Decoded frames may only be disabled if encoded frames are enabled");
+  }
+  if (api_config.max_pooled_video_buffers <= 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Max pooled video buffers must be positive; got ",
+                     api_config.max_pooled_video_buffers));
+  }
+  if (api_config.receiving_video_stream_options.size() >
+      api_config.receiving_video_stream_count) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Receiving video stream options must not have more entries than the "
+        "receiving video stream count; got ",
+        api_config.receiving_video_stream_options.size(), " entries for ",
+        api_config.receiving_video_stream_count, " streams"));
+  }
+  for (const ReceivingVideoStreamOptions& options :
+       api_config.receiving_video_stream_options) {
+    if (absl::Status status = ValidateReceivingVideoStreamOptions(options);
+        !status.ok()) {
+      return status;
+    }
+  }
   std::unique_ptr<webrtc::Thread> client_thread = webrtc::Thread::Create();
   client_thread->SetName("media_api_client_internal_thread", nullptr);
   if (!client_thread->Start()) {
@@ -286,10 +311,18 @@ MediaApiClientFactory::CreateMediaApiClient(
 
   conference_peer_connection->SetPeerConnection(std::move(peer_connection));
 
+  // Streams without options use default options, and can be given options
+  // later.
+  std::vector<ReceivingVideoStreamOptions> video_stream_options =
+      api_config.receiving_video_stream_options;
+  video_stream_options.resize(api_config.receiving_video_stream_count);
+
   return std::make_unique<MediaApiClient>(
       std::move(client_thread), std::move(worker_thread), std::move(observer),
       std::move(conference_peer_connection),
-      std::move(conference_data_channels).value());
+      std::move(conference_data_channels).value(),
+      api_config.enable_encoded_frames, api_config.enable_decoded_frames,
+      std::move(video_stream_options), api_config.max_pooled_video_buffers);
 }
 
 }  // namespace meet
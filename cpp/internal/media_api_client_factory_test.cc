@@ -148,6 +148,58 @@ TEST(MediaApiClientFactoryTest, FailsIfReceivingVideoStreamCountIsTooHigh) {
                        "equal to 3; got 4"));
 }
 
+TEST(MediaApiClientFactoryTest,
+     FailsIfReceivingVideoStreamOptionsExceedStreamCount) {
+  MediaApiClientFactory factory;
+
+  absl::StatusOr<std::unique_ptr<MediaApiClientInterface>>
+      media_api_client_status = factory.CreateMediaApiClient(
+          MediaApiClientConfiguration{
+              .receiving_video_stream_count = 1,
+              .receiving_video_stream_options = {{.max_framerate = 5},
+                                                 {.max_framerate = 5}},
+          },
+          webrtc::make_ref_counted<MockMediaApiClientObserver>());
+
+  EXPECT_THAT(media_api_client_status,
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Receiving video stream options must not have more "
+                       "entries than the receiving video stream count; got 2 "
+                       "entries for 1 streams"));
+}
+
+TEST(MediaApiClientFactoryTest, FailsIfReceivingVideoStreamOptionsAreInvalid) {
+  MediaApiClientFactory factory;
+
+  absl::StatusOr<std::unique_ptr<MediaApiClientInterface>>
+      media_api_client_status = factory.CreateMediaApiClient(
+          MediaApiClientConfiguration{
+              .receiving_video_stream_count = 1,
+              .receiving_video_stream_options = {{.resolution_alignment = 0}},
+          },
+          webrtc::make_ref_counted<MockMediaApiClientObserver>());
+
+  EXPECT_THAT(media_api_client_status,
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Resolution alignment must be positive; got 0"));
+}
+
+TEST(MediaApiClientFactoryTest, FailsIfMaxPooledVideoBuffersIsNotPositive) {
+  MediaApiClientFactory factory;
+
+  absl::StatusOr<std::unique_ptr<MediaApiClientInterface>>
+      media_api_client_status = factory.CreateMediaApiClient(
+          MediaApiClientConfiguration{
+              .receiving_video_stream_count = 1,
+              .max_pooled_video_buffers = 0,
+          },
+          webrtc::make_ref_counted<MockMediaApiClientObserver>());
+
+  EXPECT_THAT(media_api_client_status,
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Max pooled video buffers must be positive; got 0"));
+}
+
 TEST(MediaApiClientFactoryTest, FailsIfPeerConnectionFactoryFailsToCreate) {
   webrtc::scoped_refptr<webrtc::MockPeerConnectionFactoryInterface>
       peer_connection_factory =
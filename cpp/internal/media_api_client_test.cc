@@ -42,6 +42,7 @@
 #include "meet_clients/internal/conference_peer_connection.h"
 #include "meet_clients/internal/conference_peer_connection_interface.h"
 #include "meet_clients/internal/testing/mock_media_api_client_observer.h"
+#include "api/frame_transformer_interface.h"
 #include "api/make_ref_counted.h"
 #include "api/media_stream_interface.h"
 #include "api/media_types.h"
@@ -1119,6 +1120,235 @@ TEST(MediaApiClientTest, HandlesSignaledVideoTrack) {
   EXPECT_EQ(received_frame->synchronization_source, 456);
 }
 
+TEST(MediaApiClientTest,
+     AttachesFrameTransformerAndSkipsSinkIfDecodedFramesDisabled) {
+  webrtc::scoped_refptr<webrtc::MockVideoTrack> mock_video_track =
+      webrtc::MockVideoTrack::Create();
+  EXPECT_CALL(*mock_video_track, AddOrUpdateSink).Times(0);
+  auto mock_receiver = webrtc::scoped_refptr<webrtc::MockRtpReceiver>(
+      new webrtc::MockRtpReceiver());
+  ON_CALL(*mock_receiver, media_type)
+      .WillByDefault(Return(webrtc::MediaType::VIDEO));
+  ON_CALL(*mock_receiver, track).WillByDefault(Return(mock_video_track));
+  webrtc::scoped_refptr<webrtc::FrameTransformerInterface> frame_transformer;
+  EXPECT_CALL(*mock_receiver, SetDepacketizerToDecoderFrameTransformer)
+      .WillOnce(
+          [&frame_transformer](
+              webrtc::scoped_refptr<webrtc::FrameTransformerInterface>
+                  transformer) { frame_transformer = std::move(transformer); });
+  webrtc::scoped_refptr<webrtc::MockRtpTransceiver> mock_transceiver =
+      webrtc::MockRtpTransceiver::Create();
+  ON_CALL(*mock_transceiver, mid).WillByDefault(Return("mid"));
+  ON_CALL(*mock_transceiver, receiver).WillByDefault(Return(mock_receiver));
+  auto peer_connection = std::make_unique<MockConferencePeerConnection>();
+  ConferencePeerConnection::TrackSignaledCallback track_signaled_callback;
+  EXPECT_CALL(*peer_connection, SetTrackSignaledCallback)
+      .WillOnce([&](ConferencePeerConnection::TrackSignaledCallback callback) {
+        track_signaled_callback = std::move(callback);
+      });
+  MediaApiClient client(
+      CreateThread("client_thread"), CreateThread("worker_thread"),
+      webrtc::make_ref_counted<MockMediaApiClientObserver>(),
+      std::move(peer_connection), CreateConferenceDataChannels(),
+      /*enable_encoded_frames=*/true, /*enable_decoded_frames=*/false);
+
+  track_signaled_callback(std::move(mock_transceiver));
+
+  EXPECT_NE(frame_transformer, nullptr);
+}
+
+TEST(MediaApiClientTest, AppliesVideoStreamOptionsToSignaledVideoTracks) {
+  std::vector<webrtc::VideoSinkWants> first_track_wants;
+  webrtc::scoped_refptr<webrtc::MockVideoTrack> first_video_track =
+      webrtc::MockVideoTrack::Create();
+  ON_CALL(*first_video_track, AddOrUpdateSink)
+      .WillByDefault([&](webrtc::VideoSinkInterface<webrtc::VideoFrame>*,
+                         const webrtc::VideoSinkWants& wants) {
+        first_track_wants.push_back(wants);
+      });
+  std::vector<webrtc::VideoSinkWants> second_track_wants;
+  webrtc::scoped_refptr<webrtc::MockVideoTrack> second_video_track =
+      webrtc::MockVideoTrack::Create();
+  ON_CALL(*second_video_track, AddOrUpdateSink)
+      .WillByDefault([&](webrtc::VideoSinkInterface<webrtc::VideoFrame>*,
+                         const webrtc::VideoSinkWants& wants) {
+        second_track_wants.push_back(wants);
+      });
+  auto create_transceiver =
+      [](webrtc::scoped_refptr<webrtc::MockVideoTrack> video_track) {
+        auto mock_receiver = webrtc::scoped_refptr<webrtc::MockRtpReceiver>(
+            new webrtc::MockRtpReceiver());
+        ON_CALL(*mock_receiver, media_type)
+            .WillByDefault(Return(webrtc::MediaType::VIDEO));
+        ON_CALL(*mock_receiver, track).WillByDefault(Return(video_track));
+        webrtc::scoped_refptr<webrtc::MockRtpTransceiver> mock_transceiver =
+            webrtc::MockRtpTransceiver::Create();
+        ON_CALL(*mock_transceiver, mid).WillByDefault(Return("mid"));
+        ON_CALL(*mock_transceiver, receiver)
+            .WillByDefault(Return(mock_receiver));
+        return mock_transceiver;
+      };
+  auto peer_connection = std::make_unique<MockConferencePeerConnection>();
+  ConferencePeerConnection::TrackSignaledCallback track_signaled_callback;
+  EXPECT_CALL(*peer_connection, SetTrackSignaledCallback)
+      .WillOnce([&](ConferencePeerConnection::TrackSignaledCallback callback) {
+        track_signaled_callback = std::move(callback);
+      });
+  MediaApiClient client(
+      CreateThread("client_thread"), CreateThread("worker_thread"),
+      webrtc::make_ref_counted<MockMediaApiClientObserver>(),
+      std::move(peer_connection), CreateConferenceDataChannels(),
+      /*enable_encoded_frames=*/false, /*enable_decoded_frames=*/true,
+      /*video_stream_options=*/
+      {{.max_framerate = 5, .max_pixel_count = 320 * 180}, {}});
+
+  track_signaled_callback(create_transceiver(first_video_track));
+  track_signaled_callback(create_transceiver(second_video_track));
+  EXPECT_OK(client.SetReceivingVideoStreamOptions(
+      /*stream_index=*/1, {.max_framerate = 15, .resolution_alignment = 4}));
+
+  ASSERT_THAT(first_track_wants, SizeIs(1));
+  EXPECT_EQ(first_track_wants[0].max_framerate_fps, 5);
+  EXPECT_EQ(first_track_wants[0].max_pixel_count, 320 * 180);
+  EXPECT_EQ(first_track_wants[0].resolution_alignment, 1);
+  // The second stream starts with default options, and is then updated.
+  ASSERT_THAT(second_track_wants, SizeIs(2));
+  EXPECT_EQ(second_track_wants[0].max_framerate_fps,
+            webrtc::VideoSinkWants().max_framerate_fps);
+  EXPECT_EQ(second_track_wants[0].max_pixel_count,
+            webrtc::VideoSinkWants().max_pixel_count);
+  EXPECT_EQ(second_track_wants[1].max_framerate_fps, 15);
+  EXPECT_EQ(second_track_wants[1].resolution_alignment, 4);
+}
+
+TEST(MediaApiClientTest, AppliesVideoStreamOptionsSetBeforeTrackIsSignaled) {
+  std::optional<webrtc::VideoSinkWants> track_wants;
+  webrtc::scoped_refptr<webrtc::MockVideoTrack> mock_video_track =
+      webrtc::MockVideoTrack::Create();
+  ON_CALL(*mock_video_track, AddOrUpdateSink)
+      .WillByDefault([&](webrtc::VideoSinkInterface<webrtc::VideoFrame>*,
+                         const webrtc::VideoSinkWants& wants) {
+        track_wants = wants;
+      });
+  auto mock_receiver = webrtc::scoped_refptr<webrtc::MockRtpReceiver>(
+      new webrtc::MockRtpReceiver());
+  ON_CALL(*mock_receiver, media_type)
+      .WillByDefault(Return(webrtc::MediaType::VIDEO));
+  ON_CALL(*mock_receiver, track).WillByDefault(Return(mock_video_track));
+  webrtc::scoped_refptr<webrtc::MockRtpTransceiver> mock_transceiver =
+      webrtc::MockRtpTransceiver::Create();
+  ON_CALL(*mock_transceiver, mid).WillByDefault(Return("mid"));
+  ON_CALL(*mock_transceiver, receiver).WillByDefault(Return(mock_receiver));
+  auto peer_connection = std::make_unique<MockConferencePeerConnection>();
+  ConferencePeerConnection::TrackSignaledCallback track_signaled_callback;
+  EXPECT_CALL(*peer_connection, SetTrackSignaledCallback)
+      .WillOnce([&](ConferencePeerConnection::TrackSignaledCallback callback) {
+        track_signaled_callback = std::move(callback);
+      });
+  MediaApiClient client(
+      CreateThread("client_thread"), CreateThread("worker_thread"),
+      webrtc::make_ref_counted<MockMediaApiClientObserver>(),
+      std::move(peer_connection), CreateConferenceDataChannels(),
+      /*enable_encoded_frames=*/false, /*enable_decoded_frames=*/true,
+      /*video_stream_options=*/{{}});
+
+  EXPECT_OK(client.SetReceivingVideoStreamOptions(/*stream_index=*/0,
+                                                  {.max_framerate = 5}));
+  track_signaled_callback(std::move(mock_transceiver));
+
+  ASSERT_TRUE(track_wants.has_value());
+  EXPECT_EQ(track_wants->max_framerate_fps, 5);
+}
+
+TEST(MediaApiClientTest, ReusesBuffersOfDownscaledVideoFrames) {
+  webrtc::VideoSinkInterface<webrtc::VideoFrame>* video_track_sink = nullptr;
+  webrtc::scoped_refptr<webrtc::MockVideoTrack> mock_video_track =
+      webrtc::MockVideoTrack::Create();
+  ON_CALL(*mock_video_track, AddOrUpdateSink)
+      .WillByDefault(
+          [&video_track_sink](
+              webrtc::VideoSinkInterface<webrtc::VideoFrame>* sink,
+              const webrtc::VideoSinkWants&) { video_track_sink = sink; });
+  auto mock_receiver = webrtc::scoped_refptr<webrtc::MockRtpReceiver>(
+      new webrtc::MockRtpReceiver());
+  ON_CALL(*mock_receiver, media_type)
+      .WillByDefault(Return(webrtc::MediaType::VIDEO));
+  ON_CALL(*mock_receiver, track).WillByDefault(Return(mock_video_track));
+  webrtc::scoped_refptr<webrtc::MockRtpTransceiver> mock_transceiver =
+      webrtc::MockRtpTransceiver::Create();
+  ON_CALL(*mock_transceiver, mid).WillByDefault(Return("mid"));
+  ON_CALL(*mock_transceiver, receiver).WillByDefault(Return(mock_receiver));
+  auto observer = webrtc::make_ref_counted<MockMediaApiClientObserver>();
+  // Frames are downscaled and delivered on the stream's scaling thread.
+  int received_width = 0;
+  int received_count = 0;
+  absl::Notification received[2];
+  EXPECT_CALL(*observer, OnVideoFrame)
+      .Times(2)
+      .WillRepeatedly([&](VideoFrame frame) {
+        received_width = frame.frame.width();
+        received[received_count++].Notify();
+      });
+  auto peer_connection = std::make_unique<MockConferencePeerConnection>();
+  ConferencePeerConnection::TrackSignaledCallback track_signaled_callback;
+  EXPECT_CALL(*peer_connection, SetTrackSignaledCallback)
+      .WillOnce([&](ConferencePeerConnection::TrackSignaledCallback callback) {
+        track_signaled_callback = std::move(callback);
+      });
+  MediaApiClient client(
+      CreateThread("client_thread"), CreateThread("worker_thread"),
+      std::move(observer), std::move(peer_connection),
+      CreateConferenceDataChannels(),
+      /*enable_encoded_frames=*/false, /*enable_decoded_frames=*/true,
+      /*video_stream_options=*/{{.max_pixel_count = 320 * 180}});
+  track_signaled_callback(std::move(mock_transceiver));
+
+  webrtc::RtpPacketInfo packet_info;
+  packet_info.set_csrcs({123});
+  packet_info.set_ssrc(456);
+  for (int i = 0; i < 2; i++) {
+    webrtc::VideoFrame frame =
+        webrtc::VideoFrame::Builder()
+            .set_packet_infos(webrtc::RtpPacketInfos({packet_info}))
+            .set_video_frame_buffer(webrtc::I420Buffer::Create(1280, 720))
+            .set_timestamp_us(i * 100'000)
+            .build();
+    video_track_sink->OnFrame(frame);
+    ASSERT_TRUE(received[i].WaitForNotificationWithTimeout(absl::Seconds(1)));
+  }
+
+  EXPECT_LT(received_width, 1280);
+  // The downscaled buffer of the first frame was released by the observer, so
+  // the second frame reuses it.
+  VideoBufferPoolStats stats = client.GetVideoBufferPoolStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+}
+
+TEST(MediaApiClientTest, SetReceivingVideoStreamOptionsFailsWithInvalidInput) {
+  auto peer_connection = std::make_unique<MockConferencePeerConnection>();
+  MediaApiClient client(
+      CreateThread("client_thread"), CreateThread("worker_thread"),
+      webrtc::make_ref_counted<MockMediaApiClientObserver>(),
+      std::move(peer_connection), CreateConferenceDataChannels(),
+      /*enable_encoded_frames=*/false, /*enable_decoded_frames=*/true,
+      /*video_stream_options=*/{{}});
+
+  EXPECT_THAT(client.SetReceivingVideoStreamOptions(/*stream_index=*/1, {}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Stream index must be in [0, 1); got 1"));
+  EXPECT_THAT(client.SetReceivingVideoStreamOptions(/*stream_index=*/0,
+                                                    {.max_framerate = 0}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Max framerate must be positive; got 0"));
+  EXPECT_THAT(
+      client.SetReceivingVideoStreamOptions(
+          /*stream_index=*/0,
+          {.scaling = VideoScalingOptions{.width = 224, .height = 0}}),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               "Scaled size must be positive; got 224x0"));
+}
+
 TEST(MediaApiClientTest, LogsWarningIfSignaledTrackIsUnsupported) {
   auto mock_receiver = webrtc::scoped_refptr<webrtc::MockRtpReceiver>(
       new webrtc::MockRtpReceiver());
@@ -33,6 +33,7 @@ class MockMediaApiClientObserver : public MediaApiClientObserverInterface {
   MOCK_METHOD(void, OnMessageFromServer, (MessageFromServer), (override));
   MOCK_METHOD(void, OnAudioFrame, (AudioFrame), (override));
   MOCK_METHOD(void, OnVideoFrame, (VideoFrame), (override));
+  MOCK_METHOD(void, OnEncodedFrame, (EncodedFrame), (override));
 };
 
 }  // namespace meet
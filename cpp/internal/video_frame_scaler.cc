@@ -0,0 +1,97 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/internal/video_frame_scaler.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "meet_clients/api/media_api_client_interface.h"
+#include "meet_clients/internal/i420_buffer_pool.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
+#include "api/video/video_frame_buffer.h"
+#include "libyuv/scale.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace meet {
+namespace {
+
+libyuv::FilterMode ToLibyuvFilterMode(
+    VideoScalingOptions::FilterMode filter_mode) {
+  switch (filter_mode) {
+    case VideoScalingOptions::FilterMode::kNone:
+      return libyuv::kFilterNone;
+    case VideoScalingOptions::FilterMode::kLinear:
+      return libyuv::kFilterLinear;
+    case VideoScalingOptions::FilterMode::kBilinear:
+      return libyuv::kFilterBilinear;
+    case VideoScalingOptions::FilterMode::kBox:
+      return libyuv::kFilterBox;
+  }
+  return libyuv::kFilterBox;
+}
+
+}  // namespace
+
+VideoFrameScaler::VideoFrameScaler(VideoScalingOptions options,
+                                   std::shared_ptr<I420BufferPool> buffer_pool)
+    : options_(std::move(options)), buffer_pool_(std::move(buffer_pool)) {}
+
+webrtc::scoped_refptr<webrtc::I420BufferInterface> VideoFrameScaler::Scale(
+    webrtc::VideoFrameBuffer& buffer) {
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> source =
+      buffer_pool_->ToI420(buffer);
+  if (source->width() == options_.width &&
+      source->height() == options_.height) {
+    return source;
+  }
+
+  int crop_width = source->width();
+  int crop_height = source->height();
+  if (options_.keep_aspect_ratio) {
+    if (int64_t{crop_width} * options_.height >
+        int64_t{crop_height} * options_.width) {
+      crop_width = static_cast<int>(int64_t{crop_height} * options_.width /
+                                    options_.height);
+    } else {
+      crop_height = static_cast<int>(int64_t{crop_width} * options_.height /
+                                     options_.width);
+    }
+  }
+  // Offsets are even so that they fall on a chroma sample.
+  int offset_x = ((source->width() - crop_width) / 2) & ~1;
+  int offset_y = ((source->height() - crop_height) / 2) & ~1;
+
+  webrtc::scoped_refptr<webrtc::I420Buffer> scaled =
+      buffer_pool_->CreateBuffer(options_.width, options_.height);
+  libyuv::I420Scale(
+      source->DataY() + offset_y * source->StrideY() + offset_x,
+      source->StrideY(),
+      source->DataU() + offset_y / 2 * source->StrideU() + offset_x / 2,
+      source->StrideU(),
+      source->DataV() + offset_y / 2 * source->StrideV() + offset_x / 2,
+      source->StrideV(), crop_width, crop_height, scaled->MutableDataY(),
+      scaled->StrideY(), scaled->MutableDataU(), scaled->StrideU(),
+      scaled->MutableDataV(), scaled->StrideV(), options_.width,
+      options_.height, ToLibyuvFilterMode(options_.filter_mode));
+  return scaled;
+}
+
+}  // namespace meet
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_INTERNAL_VIDEO_FRAME_SCALER_H_
+#define CPP_INTERNAL_VIDEO_FRAME_SCALER_H_
+
+#include <memory>
+
+#include "absl/base/nullability.h"
+#include "meet_clients/api/media_api_client_interface.h"
+#include "meet_clients/internal/i420_buffer_pool.h"
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace meet {
+
+// Scales decoded video frames to a fixed size with libyuv's SIMD scalers.
+//
+// Frames are converted to I420 and scaled into buffers from `buffer_pool`, so
+// that buffers released by the observer are reused rather than reallocated for
+// every frame.
+//
+// This class is not thread-safe.
+class VideoFrameScaler {
+ public:
+  VideoFrameScaler(VideoScalingOptions options,
+                   std::shared_ptr<I420BufferPool> buffer_pool);
+
+  // Returns `buffer` scaled to the configured size. Buffers that already have
+  // the configured size are returned as I420 without scaling.
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> Scale(
+      webrtc::VideoFrameBuffer& buffer);
+
+  const VideoScalingOptions& options() const { return options_; }
+
+ private:
+  const VideoScalingOptions options_;
+  const std::shared_ptr<I420BufferPool> buffer_pool_;
+};
+
+}  // namespace meet
+
+#endif  // CPP_INTERNAL_VIDEO_FRAME_SCALER_H_
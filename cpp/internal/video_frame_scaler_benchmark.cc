@@ -0,0 +1,143 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks for scaling decoded frames to a small, fixed size, as for ML
+// ingestion, with `VideoFrameScaler` versus the scalar nearest neighbor loop
+// consumers often write themselves.
+//
+// Scaling runs on a single thread, so the "frames_per_core_second" counter is
+// the number of frames one core scales per second of CPU time. This is the
+// number to divide the expected frame rate of all scaled streams by to size a
+// host.
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/base/nullability.h"
+#include "meet_clients/api/media_api_client_interface.h"
+#include "meet_clients/internal/i420_buffer_pool.h"
+#include "meet_clients/internal/video_frame_scaler.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace meet {
+namespace {
+
+constexpr int kScaledSize = 224;
+
+webrtc::scoped_refptr<webrtc::I420Buffer> CreateFrame(int width, int height) {
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame =
+      webrtc::I420Buffer::Create(width, height);
+  for (int y = 0; y < height; y++) {
+    uint8_t* row = frame->MutableDataY() + y * frame->StrideY();
+    for (int x = 0; x < width; x++) {
+      row[x] = static_cast<uint8_t>(x + y);
+    }
+  }
+  for (int y = 0; y < frame->ChromaHeight(); y++) {
+    memset(frame->MutableDataU() + y * frame->StrideU(), 128,
+           frame->ChromaWidth());
+    memset(frame->MutableDataV() + y * frame->StrideV(), 128,
+           frame->ChromaWidth());
+  }
+  return frame;
+}
+
+void SetFramesPerCoreSecond(benchmark::State& state) {
+  state.counters["frames_per_core_second"] =
+      benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+}
+
+void ScalePlaneScalar(const uint8_t* source, int source_stride,
+                      int source_width, int source_height, uint8_t* scaled,
+                      int scaled_size) {
+  for (int y = 0; y < scaled_size; y++) {
+    const uint8_t* row =
+        source + (y * source_height / scaled_size) * source_stride;
+    for (int x = 0; x < scaled_size; x++) {
+      scaled[y * scaled_size + x] = row[x * source_width / scaled_size];
+    }
+  }
+}
+
+// Arguments are the source width and height.
+void BM_ScaleScalar(benchmark::State& state) {
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame = CreateFrame(
+      static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+  for (auto _ : state) {
+    // Consumers typically allocate the scaled frame for every frame.
+    std::vector<uint8_t> scaled(kScaledSize * kScaledSize * 3 / 2);
+    uint8_t* scaled_u = scaled.data() + kScaledSize * kScaledSize;
+    uint8_t* scaled_v = scaled_u + kScaledSize * kScaledSize / 4;
+    ScalePlaneScalar(frame->DataY(), frame->StrideY(), frame->width(),
+                     frame->height(), scaled.data(), kScaledSize);
+    ScalePlaneScalar(frame->DataU(), frame->StrideU(), frame->ChromaWidth(),
+                     frame->ChromaHeight(), scaled_u, kScaledSize / 2);
+    ScalePlaneScalar(frame->DataV(), frame->StrideV(), frame->ChromaWidth(),
+                     frame->ChromaHeight(), scaled_v, kScaledSize / 2);
+    benchmark::DoNotOptimize(scaled.data());
+  }
+  SetFramesPerCoreSecond(state);
+}
+
+// Arguments are the source width and height, and the filter mode.
+void BM_ScaleWithVideoFrameScaler(benchmark::State& state) {
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame = CreateFrame(
+      static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+  VideoFrameScaler scaler(
+      {.width = kScaledSize,
+       .height = kScaledSize,
+       .filter_mode =
+           static_cast<VideoScalingOptions::FilterMode>(state.range(2))},
+      std::make_shared<I420BufferPool>());
+  for (auto _ : state) {
+    // The scaled frame is released right away, as when the observer is done
+    // with it before the next frame, so its buffer is reused.
+    webrtc::scoped_refptr<webrtc::I420BufferInterface> scaled =
+        scaler.Scale(*frame);
+    benchmark::DoNotOptimize(scaled->DataY());
+  }
+  SetFramesPerCoreSecond(state);
+}
+
+void SourceSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"width", "height"});
+  benchmark->Args({1280, 720});
+  benchmark->Args({1920, 1080});
+}
+
+void SourceSizesAndFilterModes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"width", "height", "filter_mode"});
+  for (VideoScalingOptions::FilterMode filter_mode :
+       {VideoScalingOptions::FilterMode::kNone,
+        VideoScalingOptions::FilterMode::kBilinear,
+        VideoScalingOptions::FilterMode::kBox}) {
+    benchmark->Args({1280, 720, static_cast<int>(filter_mode)});
+    benchmark->Args({1920, 1080, static_cast<int>(filter_mode)});
+  }
+}
+
+BENCHMARK(BM_ScaleScalar)->Apply(SourceSizes);
+BENCHMARK(BM_ScaleWithVideoFrameScaler)->Apply(SourceSizesAndFilterModes);
+
+}  // namespace
+}  // namespace meet
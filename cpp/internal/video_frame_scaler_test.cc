@@ -0,0 +1,150 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/internal/video_frame_scaler.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "meet_clients/api/media_api_client_interface.h"
+#include "meet_clients/internal/i420_buffer_pool.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace meet {
+namespace {
+
+using ::testing::Each;
+using ::testing::ElementsAreArray;
+
+// Returns a frame whose left and right quarters are black, and whose center
+// half is gray.
+webrtc::scoped_refptr<webrtc::I420Buffer> CreateBandedFrame(int width,
+                                                            int height) {
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame =
+      webrtc::I420Buffer::Create(width, height);
+  for (int y = 0; y < height; y++) {
+    uint8_t* row = frame->MutableDataY() + y * frame->StrideY();
+    for (int x = 0; x < width; x++) {
+      row[x] = x < width / 4 || x >= width * 3 / 4 ? 0 : 128;
+    }
+  }
+  for (int y = 0; y < frame->ChromaHeight(); y++) {
+    memset(frame->MutableDataU() + y * frame->StrideU(), 128,
+           frame->ChromaWidth());
+    memset(frame->MutableDataV() + y * frame->StrideV(), 128,
+           frame->ChromaWidth());
+  }
+  return frame;
+}
+
+std::vector<uint8_t> LumaOf(const webrtc::I420BufferInterface& frame) {
+  std::vector<uint8_t> luma;
+  for (int y = 0; y < frame.height(); y++) {
+    const uint8_t* row = frame.DataY() + y * frame.StrideY();
+    luma.insert(luma.end(), row, row + frame.width());
+  }
+  return luma;
+}
+
+TEST(VideoFrameScalerTest, ScalesToConfiguredSize) {
+  VideoFrameScaler scaler({.width = 224, .height = 224},
+                          std::make_shared<I420BufferPool>());
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame =
+      CreateBandedFrame(1280, 720);
+
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> scaled =
+      scaler.Scale(*frame);
+
+  EXPECT_EQ(scaled->width(), 224);
+  EXPECT_EQ(scaled->height(), 224);
+}
+
+TEST(VideoFrameScalerTest, CropsCenterToKeepAspectRatio) {
+  VideoFrameScaler scaler(
+      {.width = 100,
+       .height = 100,
+       .filter_mode = VideoScalingOptions::FilterMode::kBox,
+       .keep_aspect_ratio = true},
+      std::make_shared<I420BufferPool>());
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame = CreateBandedFrame(400, 200);
+
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> scaled =
+      scaler.Scale(*frame);
+
+  // Only the gray center half of the frame is kept.
+  EXPECT_THAT(LumaOf(*scaled), Each(128));
+}
+
+TEST(VideoFrameScalerTest, StretchesIfNotKeepingAspectRatio) {
+  VideoFrameScaler scaler(
+      {.width = 100,
+       .height = 100,
+       .filter_mode = VideoScalingOptions::FilterMode::kNone,
+       .keep_aspect_ratio = false},
+      std::make_shared<I420BufferPool>());
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame = CreateBandedFrame(400, 200);
+
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> scaled =
+      scaler.Scale(*frame);
+
+  std::vector<uint8_t> luma = LumaOf(*scaled);
+  EXPECT_EQ(luma.front(), 0);
+  EXPECT_EQ(luma[50], 128);
+  EXPECT_EQ(luma.back(), 0);
+}
+
+TEST(VideoFrameScalerTest, ReturnsFrameOfConfiguredSizeWithoutScaling) {
+  VideoFrameScaler scaler({.width = 224, .height = 224},
+                          std::make_shared<I420BufferPool>());
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame = CreateBandedFrame(224, 224);
+
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> scaled =
+      scaler.Scale(*frame);
+
+  EXPECT_EQ(scaled->DataY(), frame->DataY());
+}
+
+TEST(VideoFrameScalerTest, ReusesReleasedBuffers) {
+  auto buffer_pool = std::make_shared<I420BufferPool>();
+  VideoFrameScaler scaler({.width = 224, .height = 224}, buffer_pool);
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame =
+      CreateBandedFrame(1280, 720);
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> first =
+      scaler.Scale(*frame);
+  const uint8_t* first_data = first->DataY();
+  std::vector<uint8_t> first_luma = LumaOf(*first);
+  first = nullptr;
+
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> second =
+      scaler.Scale(*frame);
+
+  EXPECT_EQ(second->DataY(), first_data);
+  EXPECT_THAT(LumaOf(*second), ElementsAreArray(first_luma));
+  EXPECT_EQ(buffer_pool->GetStats().hits, 1);
+  EXPECT_EQ(buffer_pool->GetStats().misses, 1);
+}
+
+}  // namespace
+}  // namespace meet
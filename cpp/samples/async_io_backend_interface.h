@@ -0,0 +1,72 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_ASYNC_IO_BACKEND_INTERFACE_H_
+#define CPP_SAMPLES_ASYNC_IO_BACKEND_INTERFACE_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "absl/base/attributes.h"
+#include "absl/base/nullability.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Interface for submitting file writes without blocking on storage.
+//
+// Writes always come from one of a fixed set of buffers that is handed to the
+// backend when it is created. Each buffer is in flight at most once at a time,
+// so the buffer index identifies a write when it completes.
+class AsyncIoBackendInterface {
+ public:
+  struct WriteRequest {
+    int fd ABSL_REQUIRE_EXPLICIT_INIT;
+    int64_t offset ABSL_REQUIRE_EXPLICIT_INIT;
+    int buffer_index ABSL_REQUIRE_EXPLICIT_INIT;
+    // The data to write. This is always part of the buffer at `buffer_index`.
+    absl::Span<const char> data ABSL_REQUIRE_EXPLICIT_INIT;
+  };
+
+  // Invoked on a backend thread once a write has finished. `result` is the
+  // number of bytes written, or a negated `errno` value on failure.
+  //
+  // Backends with several threads may invoke this concurrently.
+  using CompletionCallback =
+      absl::AnyInvocable<void(int buffer_index, int64_t result)>;
+
+  // Backends must not be destroyed while writes are in flight.
+  virtual ~AsyncIoBackendInterface() = default;
+
+  // Submits `requests` as a single batch. Returns without waiting for the
+  // writes to complete.
+  virtual void SubmitWrites(absl::Span<const WriteRequest> requests) = 0;
+};
+
+// Creates a backend that writes from `buffers` and reports completed writes to
+// `on_complete`.
+using AsyncIoBackendFactory =
+    absl::AnyInvocable<absl::StatusOr<std::unique_ptr<AsyncIoBackendInterface>>(
+        absl::Span<const absl::Span<char>> buffers,
+        AsyncIoBackendInterface::CompletionCallback on_complete)>;
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_ASYNC_IO_BACKEND_INTERFACE_H_
@@ -0,0 +1,338 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/async_output_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/async_io_backend_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/thread_pool_pwrite_backend.h"
+
+#if defined(WEBRTC_LINUX)
+#include "meet_clients/samples/io_uring_backend.h"
+#endif
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+// Number of threads used by the `pwrite` fallback. Enough to keep a few
+// concurrent segments moving when one write stalls.
+constexpr int kPwriteThreadCount = 4;
+
+absl::StatusOr<std::unique_ptr<AsyncIoBackendInterface>> CreateDefaultBackend(
+    absl::Span<const absl::Span<char>> buffers,
+    AsyncIoBackendInterface::CompletionCallback on_complete) {
+#if defined(WEBRTC_LINUX)
+  // `IoUringBackend::Create` only consumes the callback on success, so keep it
+  // around for the fallback.
+  auto shared_on_complete =
+      std::make_shared<AsyncIoBackendInterface::CompletionCallback>(
+          std::move(on_complete));
+  absl::StatusOr<std::unique_ptr<IoUringBackend>> io_uring_backend =
+      IoUringBackend::Create(buffers,
+                             [shared_on_complete](int buffer_index,
+                                                  int64_t result) {
+                               (*shared_on_complete)(buffer_index, result);
+                             });
+  if (io_uring_backend.ok()) {
+    LOG(INFO) << "Using io_uring for output files";
+    return std::move(io_uring_backend).value();
+  }
+  LOG(WARNING) << "io_uring is not available, falling back to pwrite: "
+               << io_uring_backend.status();
+  return ThreadPoolPwriteBackend::Create(
+      kPwriteThreadCount,
+      [shared_on_complete](int buffer_index, int64_t result) {
+        (*shared_on_complete)(buffer_index, result);
+      });
+#else
+  return ThreadPoolPwriteBackend::Create(kPwriteThreadCount,
+                                         std::move(on_complete));
+#endif
+}
+
+}  // namespace
+
+std::shared_ptr<AsyncOutputWriterPool> AsyncOutputWriterPool::Create(
+    Options options) {
+  absl::StatusOr<std::shared_ptr<AsyncOutputWriterPool>> pool =
+      Create(options, CreateDefaultBackend);
+  // The `pwrite` fallback cannot fail.
+  CHECK_OK(pool.status());
+  return *std::move(pool);
+}
+
+absl::StatusOr<std::shared_ptr<AsyncOutputWriterPool>>
+AsyncOutputWriterPool::Create(Options options,
+                              AsyncIoBackendFactory backend_factory) {
+  if (options.buffer_size == 0 || options.buffer_count <= 0 ||
+      options.submit_batch_size <= 0) {
+    return absl::InvalidArgumentError(
+        "Buffer size, buffer count, and submit batch size must be positive");
+  }
+  std::shared_ptr<AsyncOutputWriterPool> pool(new AsyncOutputWriterPool(
+      options,
+      std::vector<char>(options.buffer_size * options.buffer_count)));
+  absl::StatusOr<std::unique_ptr<AsyncIoBackendInterface>> backend =
+      backend_factory(pool->buffers_,
+                      [pool = pool.get()](int buffer_index, int64_t result) {
+                        pool->OnWriteComplete(buffer_index, result);
+                      });
+  if (!backend.ok()) {
+    return backend.status();
+  }
+  pool->backend_ = *std::move(backend);
+  return pool;
+}
+
+AsyncOutputWriterPool::AsyncOutputWriterPool(Options options,
+                                             std::vector<char> storage)
+    : options_(options),
+      storage_(std::move(storage)),
+      in_flight_files_(options.buffer_count),
+      in_flight_sizes_(options.buffer_count),
+      in_flight_offsets_(options.buffer_count),
+      in_flight_written_(options.buffer_count) {
+  buffers_.reserve(options_.buffer_count);
+  free_buffers_.reserve(options_.buffer_count);
+  for (int i = 0; i < options_.buffer_count; ++i) {
+    buffers_.push_back(absl::MakeSpan(storage_).subspan(
+        i * options_.buffer_size, options_.buffer_size));
+    free_buffers_.push_back(i);
+  }
+}
+
+AsyncOutputWriterPool::~AsyncOutputWriterPool() {
+  if (backend_ == nullptr) return;
+
+  Flush();
+  {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(this, &AsyncOutputWriterPool::AllBuffersFree));
+  }
+  // No writes are in flight, so the backend will not call back into the pool
+  // while it shuts down.
+  backend_.reset();
+}
+
+std::unique_ptr<OutputWriterInterface> AsyncOutputWriterPool::CreateWriter(
+    absl::string_view file_name) {
+  int fd = open(std::string(file_name).c_str(),
+                O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd >= 0) {
+    LOG(INFO) << "Opened file: " << file_name;
+  } else {
+    // If a file cannot be opened, the sample will still run, but written data
+    // will be lost.
+    LOG(ERROR) << "Failed to open file: " << file_name << ": "
+               << strerror(errno);
+  }
+  return std::make_unique<AsyncOutputFile>(
+      shared_from_this(),
+      fd >= 0 ? std::make_shared<FileState>(FileState{.fd = fd}) : nullptr);
+}
+
+AsyncOutputWriterPool::Stats AsyncOutputWriterPool::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+int AsyncOutputWriterPool::AcquireBuffer() {
+  {
+    absl::MutexLock lock(&mutex_);
+    if (!free_buffers_.empty()) {
+      int buffer_index = free_buffers_.back();
+      free_buffers_.pop_back();
+      return buffer_index;
+    }
+    ++stats_.buffer_waits;
+  }
+
+  // Every buffer is either queued or in flight. Queued buffers must be
+  // submitted, otherwise they will never be released.
+  Flush();
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(this, &AsyncOutputWriterPool::HasFreeBuffer));
+  int buffer_index = free_buffers_.back();
+  free_buffers_.pop_back();
+  return buffer_index;
+}
+
+void AsyncOutputWriterPool::QueueWrite(std::shared_ptr<FileState> file,
+                                       int buffer_index, size_t size,
+                                       int64_t offset) {
+  bool submit = false;
+  {
+    absl::MutexLock lock(&mutex_);
+    queued_writes_.push_back(AsyncIoBackendInterface::WriteRequest{
+        .fd = file->fd,
+        .offset = offset,
+        .buffer_index = buffer_index,
+        .data = GetBuffer(buffer_index).subspan(0, size)});
+    ++file->outstanding_writes;
+    in_flight_files_[buffer_index] = std::move(file);
+    in_flight_sizes_[buffer_index] = size;
+    in_flight_offsets_[buffer_index] = offset;
+    in_flight_written_[buffer_index] = 0;
+    submit = queued_writes_.size() >=
+             static_cast<size_t>(options_.submit_batch_size);
+  }
+  if (submit) {
+    Flush();
+  }
+}
+
+void AsyncOutputWriterPool::CloseFile(std::shared_ptr<FileState> file) {
+  absl::MutexLock lock(&mutex_);
+  file->closed = true;
+  if (file->outstanding_writes == 0) {
+    close(file->fd);
+  }
+}
+
+void AsyncOutputWriterPool::Flush() {
+  std::vector<AsyncIoBackendInterface::WriteRequest> writes;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (queued_writes_.empty()) return;
+    writes.swap(queued_writes_);
+    stats_.submitted_writes += writes.size();
+    ++stats_.submitted_batches;
+  }
+  backend_->SubmitWrites(writes);
+}
+
+void AsyncOutputWriterPool::OnWriteComplete(int buffer_index, int64_t result) {
+  std::optional<AsyncIoBackendInterface::WriteRequest> rest;
+  {
+    absl::MutexLock lock(&mutex_);
+    const std::shared_ptr<FileState>& file = in_flight_files_[buffer_index];
+    DCHECK(file != nullptr);
+    int64_t remaining =
+        in_flight_sizes_[buffer_index] - in_flight_written_[buffer_index];
+    if (result > 0 && result < remaining) {
+      // Later buffers of the file are written at fixed offsets, so the rest
+      // of this one must be written too, or the file would have a hole.
+      int64_t written = in_flight_written_[buffer_index] += result;
+      ++stats_.resubmitted_writes;
+      rest = AsyncIoBackendInterface::WriteRequest{
+          .fd = file->fd,
+          .offset = in_flight_offsets_[buffer_index] + written,
+          .buffer_index = buffer_index,
+          .data = GetBuffer(buffer_index)
+                      .subspan(written, in_flight_sizes_[buffer_index] -
+                                            written)};
+    } else {
+      ++stats_.completed_writes;
+      if (result != remaining) {
+        ++stats_.failed_writes;
+        LOG(ERROR) << "Failed to write " << remaining << " bytes to fd "
+                   << file->fd << ": "
+                   << (result < 0 ? strerror(-result) : "no data written");
+      }
+      if (--file->outstanding_writes == 0 && file->closed) {
+        close(file->fd);
+      }
+      in_flight_files_[buffer_index] = nullptr;
+      free_buffers_.push_back(buffer_index);
+    }
+  }
+  // Resubmitting from the completion callback is safe: the buffer stays in
+  // flight, so the backend has room for its write.
+  if (rest.has_value()) {
+    backend_->SubmitWrites({*rest});
+  }
+}
+
+AsyncOutputFile::~AsyncOutputFile() {
+  if (file_ != nullptr) {
+    Close();
+  }
+}
+
+void AsyncOutputFile::Write(const char* content, std::streamsize size) {
+  if (file_ == nullptr) return;
+
+  while (size > 0) {
+    if (current_buffer_ < 0) {
+      current_buffer_ = pool_->AcquireBuffer();
+      current_size_ = 0;
+    }
+    absl::Span<char> buffer = pool_->GetBuffer(current_buffer_);
+    size_t copy_size =
+        std::min<size_t>(size, buffer.size() - current_size_);
+    memcpy(buffer.data() + current_size_, content, copy_size);
+    current_size_ += copy_size;
+    content += copy_size;
+    size -= copy_size;
+    if (current_size_ == buffer.size()) {
+      SubmitCurrentBuffer();
+    }
+  }
+}
+
+void AsyncOutputFile::Close() {
+  if (file_ == nullptr) return;
+
+  if (current_buffer_ >= 0) {
+    SubmitCurrentBuffer();
+  }
+  pool_->CloseFile(file_);
+  file_ = nullptr;
+  // Submit the tail of the segment now rather than waiting for other writers
+  // to fill the batch.
+  pool_->Flush();
+}
+
+void AsyncOutputFile::SubmitCurrentBuffer() {
+  pool_->QueueWrite(file_, current_buffer_, current_size_, offset_);
+  offset_ += current_size_;
+  current_buffer_ = -1;
+  current_size_ = 0;
+}
+
+OutputWriterProvider CreateAsyncOutputFileProvider(
+    std::shared_ptr<AsyncOutputWriterPool> pool) {
+  return [pool = std::move(pool)](absl::string_view file_name) {
+    return pool->CreateWriter(file_name);
+  };
+}
+
+}  // namespace media_api_samples
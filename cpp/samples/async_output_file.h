@@ -0,0 +1,190 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_ASYNC_OUTPUT_FILE_H_
+#define CPP_SAMPLES_ASYNC_OUTPUT_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/async_io_backend_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// A fixed set of write buffers shared by `AsyncOutputFile`s, along with the
+// backend that writes them to storage.
+//
+// Writers copy data into a pool buffer and hand the buffer to the backend once
+// it is full. The buffer returns to the pool when the backend reports that the
+// write has completed. Full buffers are submitted in batches, so that several
+// segments' writes cost a single submission.
+//
+// Writes only block when every buffer is in flight, which means storage has
+// fallen behind by `buffer_count * buffer_size` bytes. Opening a file still
+// blocks its caller, so that the file exists once `CreateWriter` returns.
+//
+// Writes that complete short are resubmitted for the rest of their buffer, as
+// `pwrite` callers must do, so files never end up with holes.
+//
+// This class is thread-safe.
+class AsyncOutputWriterPool
+    : public std::enable_shared_from_this<AsyncOutputWriterPool> {
+ public:
+  struct Options {
+    // Size of each buffer, in bytes.
+    size_t buffer_size = 1 << 20;
+    int buffer_count = 32;
+    // Number of full buffers to accumulate before submitting them to the
+    // backend. Buffers are also submitted when a writer is closed or when no
+    // free buffer is left.
+    int submit_batch_size = 4;
+  };
+
+  struct Stats {
+    int64_t submitted_writes = 0;
+    int64_t completed_writes = 0;
+    int64_t failed_writes = 0;
+    // Number of times the rest of a short write was resubmitted.
+    int64_t resubmitted_writes = 0;
+    int64_t submitted_batches = 0;
+    // Number of times a writer had to wait for a buffer to be released.
+    int64_t buffer_waits = 0;
+  };
+
+  // Creates a pool backed by io_uring, falling back to a thread pool issuing
+  // `pwrite` calls when io_uring is not available.
+  static std::shared_ptr<AsyncOutputWriterPool> Create(Options options);
+  // Creates a pool with a custom backend, e.g. for testing.
+  static absl::StatusOr<std::shared_ptr<AsyncOutputWriterPool>> Create(
+      Options options, AsyncIoBackendFactory backend_factory);
+
+  // Waits for all submitted writes to complete.
+  ~AsyncOutputWriterPool();
+
+  // Opens `file_name`, truncating any existing file, and returns a writer for
+  // it. If the file cannot be opened, the returned writer drops all data.
+  //
+  // The file is opened on the calling thread, so that it can be renamed or
+  // opened by other wrappers as soon as this returns.
+  std::unique_ptr<OutputWriterInterface> CreateWriter(
+      absl::string_view file_name);
+
+  Stats GetStats() const;
+
+ private:
+  friend class AsyncOutputFile;
+
+  // State of an open file that outlives its writer until all of its writes
+  // have completed.
+  struct FileState {
+    int fd;
+    int outstanding_writes = 0;
+    bool closed = false;
+  };
+
+  AsyncOutputWriterPool(Options options, std::vector<char> storage);
+
+  // Returns the index of a free buffer, waiting for one if necessary.
+  int AcquireBuffer();
+  absl::Span<char> GetBuffer(int buffer_index) { return buffers_[buffer_index]; }
+  // Queues the first `size` bytes of the buffer to be written to `file` at
+  // `offset`.
+  void QueueWrite(std::shared_ptr<FileState> file, int buffer_index,
+                  size_t size, int64_t offset);
+  // Marks `file` as closed. The file descriptor is closed once all of its
+  // writes have completed.
+  void CloseFile(std::shared_ptr<FileState> file);
+  // Submits all queued writes to the backend.
+  void Flush();
+  void OnWriteComplete(int buffer_index, int64_t result);
+  bool HasFreeBuffer() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return !free_buffers_.empty();
+  }
+  bool AllBuffersFree() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return free_buffers_.size() == buffers_.size();
+  }
+
+  const Options options_;
+  // Backing memory for all buffers.
+  std::vector<char> storage_;
+  std::vector<absl::Span<char>> buffers_;
+  std::unique_ptr<AsyncIoBackendInterface> backend_;
+
+  mutable absl::Mutex mutex_;
+  std::vector<int> free_buffers_ ABSL_GUARDED_BY(mutex_);
+  // The file that each in-flight buffer is being written to, indexed by buffer.
+  std::vector<std::shared_ptr<FileState>> in_flight_files_
+      ABSL_GUARDED_BY(mutex_);
+  std::vector<int64_t> in_flight_sizes_ ABSL_GUARDED_BY(mutex_);
+  // File offset of each in-flight buffer, and how much of it has been written
+  // by earlier, short, writes.
+  std::vector<int64_t> in_flight_offsets_ ABSL_GUARDED_BY(mutex_);
+  std::vector<int64_t> in_flight_written_ ABSL_GUARDED_BY(mutex_);
+  std::vector<AsyncIoBackendInterface::WriteRequest> queued_writes_
+      ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+// An output writer that copies data into buffers from an
+// `AsyncOutputWriterPool`, so that writing never waits for storage unless the
+// whole pool is in flight.
+//
+// This class is not thread-safe.
+class AsyncOutputFile : public OutputWriterInterface {
+ public:
+  AsyncOutputFile(std::shared_ptr<AsyncOutputWriterPool> pool,
+                  std::shared_ptr<AsyncOutputWriterPool::FileState> file)
+      : pool_(std::move(pool)), file_(std::move(file)) {}
+  ~AsyncOutputFile() override;
+
+  void Write(const char* content, std::streamsize size) override;
+  // Submits any buffered data. This does not wait for the data to be written;
+  // the file may be renamed immediately afterwards.
+  void Close() override;
+
+ private:
+  void SubmitCurrentBuffer();
+
+  std::shared_ptr<AsyncOutputWriterPool> pool_;
+  /*absl_nullable*/ std::shared_ptr<AsyncOutputWriterPool::FileState> file_;
+  // The buffer currently being filled, or -1 if there is none.
+  int current_buffer_ = -1;
+  size_t current_size_ = 0;
+  // File offset of the start of the current buffer.
+  int64_t offset_ = 0;
+};
+
+// Returns a provider that creates `AsyncOutputFile`s backed by `pool`.
+OutputWriterProvider CreateAsyncOutputFileProvider(
+    std::shared_ptr<AsyncOutputWriterPool> pool);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_ASYNC_OUTPUT_FILE_H_
@@ -0,0 +1,294 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/async_output_file.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/async_io_backend_interface.h"
+#include "meet_clients/samples/io_uring_backend.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/thread_pool_pwrite_backend.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+using ::testing::SizeIs;
+
+// Backend that records submitted batches. Writes complete immediately unless
+// `complete_immediately` is false, in which case they complete when
+// `CompleteAll` is called.
+class FakeBackend : public AsyncIoBackendInterface {
+ public:
+  FakeBackend(CompletionCallback on_complete, bool complete_immediately)
+      : on_complete_(std::move(on_complete)),
+        complete_immediately_(complete_immediately) {}
+
+  void SubmitWrites(absl::Span<const WriteRequest> requests) override {
+    batches.emplace_back(requests.begin(), requests.end());
+    if (complete_immediately_) {
+      CompleteAll();
+    }
+  }
+
+  void CompleteAll() {
+    for (std::vector<WriteRequest>& batch : batches) {
+      for (WriteRequest& request : batch) {
+        if (request.buffer_index >= 0) {
+          on_complete_(request.buffer_index, request.data.size());
+          request.buffer_index = -1;
+        }
+      }
+    }
+  }
+
+  std::vector<std::vector<WriteRequest>> batches;
+
+ private:
+  CompletionCallback on_complete_;
+  bool complete_immediately_;
+};
+
+// Backend that writes at most `max_write_size` bytes of each request with
+// `pwrite`, as storage may do, and completes writes immediately.
+class ShortWriteBackend : public AsyncIoBackendInterface {
+ public:
+  ShortWriteBackend(CompletionCallback on_complete, size_t max_write_size)
+      : on_complete_(std::move(on_complete)),
+        max_write_size_(max_write_size) {}
+
+  void SubmitWrites(absl::Span<const WriteRequest> requests) override {
+    // Completing a write may submit more, so iterate over a copy.
+    std::vector<WriteRequest> writes(requests.begin(), requests.end());
+    for (const WriteRequest& write : writes) {
+      on_complete_(write.buffer_index,
+                   pwrite(write.fd, write.data.data(),
+                          std::min(write.data.size(), max_write_size_),
+                          write.offset));
+    }
+  }
+
+ private:
+  CompletionCallback on_complete_;
+  size_t max_write_size_;
+};
+
+std::shared_ptr<AsyncOutputWriterPool> CreatePoolWithFakeBackend(
+    AsyncOutputWriterPool::Options options, bool complete_immediately,
+    FakeBackend*& backend) {
+  absl::StatusOr<std::shared_ptr<AsyncOutputWriterPool>> pool =
+      AsyncOutputWriterPool::Create(
+          options, [&](absl::Span<const absl::Span<char>> buffers,
+                       AsyncIoBackendInterface::CompletionCallback on_complete)
+                       -> absl::StatusOr<
+                           std::unique_ptr<AsyncIoBackendInterface>> {
+            auto fake = std::make_unique<FakeBackend>(std::move(on_complete),
+                                                      complete_immediately);
+            backend = fake.get();
+            return fake;
+          });
+  EXPECT_TRUE(pool.ok());
+  return *std::move(pool);
+}
+
+std::string ReadFile(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+std::string CreateTestData(int size) {
+  std::string data;
+  for (int i = 0; i < size; ++i) {
+    data.push_back('a' + i % 26);
+  }
+  return data;
+}
+
+// Writes `data` in uneven pieces so that writes straddle buffer boundaries.
+void WriteInPieces(absl::string_view data, OutputWriterInterface& writer) {
+  int piece_size = 1;
+  while (!data.empty()) {
+    absl::string_view piece = data.substr(0, piece_size);
+    writer.Write(piece.data(), piece.size());
+    data.remove_prefix(piece.size());
+    piece_size = piece_size % 7 + 3;
+  }
+}
+
+TEST(AsyncOutputFileTest, SubmitsFullBuffersInBatches) {
+  FakeBackend* backend = nullptr;
+  std::shared_ptr<AsyncOutputWriterPool> pool = CreatePoolWithFakeBackend(
+      {.buffer_size = 4, .buffer_count = 8, .submit_batch_size = 2},
+      /*complete_immediately=*/true, backend);
+  std::string file_name = absl::StrCat(::testing::TempDir(), "batches");
+  std::unique_ptr<OutputWriterInterface> writer = pool->CreateWriter(file_name);
+
+  writer->Write("abcd", 4);
+  EXPECT_THAT(backend->batches, SizeIs(0));
+  writer->Write("efgh", 4);
+  ASSERT_THAT(backend->batches, SizeIs(1));
+  EXPECT_THAT(backend->batches[0], SizeIs(2));
+  EXPECT_EQ(backend->batches[0][0].offset, 0);
+  EXPECT_EQ(backend->batches[0][1].offset, 4);
+}
+
+TEST(AsyncOutputFileTest, CloseSubmitsPartialBufferWithoutWaiting) {
+  FakeBackend* backend = nullptr;
+  std::shared_ptr<AsyncOutputWriterPool> pool = CreatePoolWithFakeBackend(
+      {.buffer_size = 4, .buffer_count = 8, .submit_batch_size = 4},
+      /*complete_immediately=*/false, backend);
+  std::string file_name = absl::StrCat(::testing::TempDir(), "partial");
+  std::unique_ptr<OutputWriterInterface> writer = pool->CreateWriter(file_name);
+
+  writer->Write("abcdef", 6);
+  writer->Close();
+
+  ASSERT_THAT(backend->batches, SizeIs(1));
+  ASSERT_THAT(backend->batches[0], SizeIs(2));
+  EXPECT_EQ(backend->batches[0][1].offset, 4);
+  EXPECT_EQ(backend->batches[0][1].data.size(), 2);
+  EXPECT_EQ(pool->GetStats().completed_writes, 0);
+
+  backend->CompleteAll();
+  EXPECT_EQ(pool->GetStats().completed_writes, 2);
+}
+
+TEST(AsyncOutputFileTest, WaitsForBufferWhenAllBuffersAreInFlight) {
+  FakeBackend* backend = nullptr;
+  std::shared_ptr<AsyncOutputWriterPool> pool = CreatePoolWithFakeBackend(
+      {.buffer_size = 4, .buffer_count = 1, .submit_batch_size = 4},
+      /*complete_immediately=*/true, backend);
+  std::string file_name = absl::StrCat(::testing::TempDir(), "waits");
+  std::unique_ptr<OutputWriterInterface> writer = pool->CreateWriter(file_name);
+
+  writer->Write("abcdefgh", 8);
+
+  EXPECT_EQ(pool->GetStats().buffer_waits, 1);
+  EXPECT_EQ(pool->GetStats().submitted_writes, 1);
+}
+
+void ExpectWritesFileContents(AsyncIoBackendFactory backend_factory,
+                              absl::string_view name) {
+  std::string file_name = absl::StrCat(::testing::TempDir(), "", name);
+  std::string data = CreateTestData(1000);
+  {
+    absl::StatusOr<std::shared_ptr<AsyncOutputWriterPool>> pool =
+        AsyncOutputWriterPool::Create(
+            {.buffer_size = 64, .buffer_count = 4, .submit_batch_size = 2},
+            std::move(backend_factory));
+    ASSERT_TRUE(pool.ok());
+    std::unique_ptr<OutputWriterInterface> writer =
+        (*pool)->CreateWriter(file_name);
+    WriteInPieces(data, *writer);
+    writer->Close();
+    EXPECT_EQ((*pool)->GetStats().failed_writes, 0);
+    // Destroying the pool waits for all writes to complete.
+  }
+
+  EXPECT_EQ(ReadFile(file_name), data);
+}
+
+TEST(AsyncOutputFileTest, ResubmitsRestOfShortWrites) {
+  std::string file_name = absl::StrCat(::testing::TempDir(), "short_writes");
+  std::string data = CreateTestData(1000);
+  {
+    absl::StatusOr<std::shared_ptr<AsyncOutputWriterPool>> pool =
+        AsyncOutputWriterPool::Create(
+            {.buffer_size = 64, .buffer_count = 4, .submit_batch_size = 2},
+            [](absl::Span<const absl::Span<char>> buffers,
+               AsyncIoBackendInterface::CompletionCallback on_complete)
+                -> absl::StatusOr<std::unique_ptr<AsyncIoBackendInterface>> {
+              return std::make_unique<ShortWriteBackend>(
+                  std::move(on_complete), /*max_write_size=*/10);
+            });
+    ASSERT_TRUE(pool.ok());
+    std::unique_ptr<OutputWriterInterface> writer =
+        (*pool)->CreateWriter(file_name);
+    WriteInPieces(data, *writer);
+    writer->Close();
+
+    AsyncOutputWriterPool::Stats stats = (*pool)->GetStats();
+    EXPECT_EQ(stats.completed_writes, 16);
+    EXPECT_EQ(stats.failed_writes, 0);
+    // Each 64 byte buffer takes 7 writes of at most 10 bytes, and the last,
+    // 40 byte, buffer takes 4.
+    EXPECT_EQ(stats.resubmitted_writes, 15 * 6 + 3);
+  }
+
+  EXPECT_EQ(ReadFile(file_name), data);
+}
+
+TEST(AsyncOutputFileTest, WritesFileContentsWithPwriteBackend) {
+  ExpectWritesFileContents(
+      [](absl::Span<const absl::Span<char>> buffers,
+         AsyncIoBackendInterface::CompletionCallback on_complete)
+          -> absl::StatusOr<std::unique_ptr<AsyncIoBackendInterface>> {
+        return ThreadPoolPwriteBackend::Create(/*thread_count=*/3,
+                                               std::move(on_complete));
+      },
+      "pwrite");
+}
+
+TEST(AsyncOutputFileTest, WritesFileContentsWithIoUringBackend) {
+  if (!IoUringBackend::Create({}, [](int, int64_t) {}).ok()) {
+    GTEST_SKIP() << "io_uring is not available";
+  }
+
+  ExpectWritesFileContents(
+      [](absl::Span<const absl::Span<char>> buffers,
+         AsyncIoBackendInterface::CompletionCallback on_complete)
+          -> absl::StatusOr<std::unique_ptr<AsyncIoBackendInterface>> {
+        return IoUringBackend::Create(buffers, std::move(on_complete));
+      },
+      "io_uring");
+}
+
+TEST(AsyncOutputFileTest, DefaultPoolWritesFileContents) {
+  std::string file_name = absl::StrCat(::testing::TempDir(), "default");
+  std::string data = CreateTestData(5000);
+  {
+    OutputWriterProvider provider =
+        CreateAsyncOutputFileProvider(AsyncOutputWriterPool::Create(
+            {.buffer_size = 256, .buffer_count = 4, .submit_batch_size = 2}));
+    std::unique_ptr<OutputWriterInterface> writer = provider(file_name);
+    WriteInPieces(data, *writer);
+    writer->Close();
+  }
+
+  EXPECT_EQ(ReadFile(file_name), data);
+}
+
+}  // namespace
+}  // namespace media_api_samples
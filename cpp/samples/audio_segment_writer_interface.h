@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_AUDIO_SEGMENT_WRITER_INTERFACE_H_
+#define CPP_SAMPLES_AUDIO_SEGMENT_WRITER_INTERFACE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/functional/any_invocable.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Interface for writing the samples of a single audio segment.
+//
+// Samples are 48 kHz mono pcm16, as produced by the Meet Media API client.
+class AudioSegmentWriterInterface {
+ public:
+  virtual ~AudioSegmentWriterInterface() = default;
+  // Takes ownership of `pcm16`, so that writers may hand it to another thread
+  // without copying.
+  virtual void WriteSamples(std::vector<int16_t> pcm16) = 0;
+  // Finishes the segment and closes its output. Once this returns, the output
+  // file may be renamed.
+  virtual void Close() = 0;
+
+  // Closes `writer` like `Close`, destroys it, then calls `on_closed`, after
+  // which the output file may be renamed. Writers that finish segments on
+  // another thread return first, and do the rest on that thread.
+  static void CloseAsync(std::unique_ptr<AudioSegmentWriterInterface> writer,
+                         absl::AnyInvocable<void() &&> on_closed) {
+    AudioSegmentWriterInterface& closing = *writer;
+    closing.StartClose(std::move(writer), std::move(on_closed));
+  }
+
+ protected:
+  // Implements `CloseAsync` for this writer, which `self` owns. By default,
+  // closes it on the calling thread.
+  virtual void StartClose(std::unique_ptr<AudioSegmentWriterInterface> self,
+                          absl::AnyInvocable<void() &&> on_closed) {
+    Close();
+    self.reset();
+    std::move(on_closed)();
+  }
+};
+
+// Describes how audio segments are stored.
+struct AudioSegmentFormat {
+  using WriterFactory =
+      absl::AnyInvocable<std::unique_ptr<AudioSegmentWriterInterface>(
+          std::unique_ptr<OutputWriterInterface> output)>;
+
+  // Extension of segment files, without the leading dot.
+  std::string file_extension;
+  // Creates a writer for a segment that writes to `output`.
+  WriterFactory create_writer;
+  // Whether collectors index the frames of each segment in a sidecar file.
+  // As with video, only meaningful for raw pcm16 segments.
+  bool index_frames = false;
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_AUDIO_SEGMENT_WRITER_INTERFACE_H_
@@ -0,0 +1,422 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/binary_event_log.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/event_log_writer_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+constexpr absl::string_view kHeaderMagic = "MEVL";
+constexpr char kVersion = 1;
+constexpr char kBlockTag = 'B';
+constexpr char kFooterTag = 'F';
+constexpr absl::string_view kFooterMagic = "MEVF";
+
+// The columns of a block, in the order in which they are stored.
+enum Column {
+  // One byte per event.
+  kTypeColumn,
+  kTimeColumn,
+  kResourceIdColumn,
+  kDisplayNameColumn,
+  kParticipantKeyColumn,
+  kParticipantSessionNameColumn,
+  kAudioCsrcColumn,
+  // A count followed by that many contributing sources, per event.
+  kVideoCsrcsColumn,
+  // One byte per event, with the audio muted state in bit 0 and the video
+  // muted state in bit 1.
+  kMutedColumn,
+};
+static_assert(kMutedColumn + 1 == kBinaryEventLogColumnCount);
+
+void AppendVarint(std::string& output, uint64_t value) {
+  while (value >= 0x80) {
+    output.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  output.push_back(static_cast<char>(value));
+}
+
+bool ReadVarint(absl::string_view& input, uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && !input.empty(); shift += 7) {
+    uint8_t byte = input.front();
+    input.remove_prefix(1);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void AppendFixed32(std::string& output, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    output.push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+bool ReadFixed32(absl::string_view& input, uint32_t& value) {
+  if (input.size() < 4) return false;
+  value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(input[i])) << (8 * i);
+  }
+  input.remove_prefix(4);
+  return true;
+}
+
+bool ReadByte(absl::string_view& input, uint8_t& value) {
+  if (input.empty()) return false;
+  value = input.front();
+  input.remove_prefix(1);
+  return true;
+}
+
+}  // namespace
+
+BinaryEventLogWriter::BinaryEventLogWriter(
+    std::unique_ptr<OutputWriterInterface> writer, const Options& options)
+    : writer_(std::move(writer)),
+      events_per_block_(std::max(1, options.events_per_block)) {
+  output_buffer_ = absl::StrCat(kHeaderMagic, absl::string_view(&kVersion, 1));
+  writer_->Write(output_buffer_.data(), output_buffer_.size());
+  offset_ = output_buffer_.size();
+}
+
+BinaryEventLogWriter::~BinaryEventLogWriter() { Close(); }
+
+void BinaryEventLogWriter::Write(const EventLogEvent& event) {
+  if (closed_) return;
+
+  int64_t time = absl::ToUnixMicros(event.time);
+  if (block_.event_count == 0) {
+    block_.first_time = event.time;
+    previous_time_ = 0;
+  }
+  block_.last_time = event.time;
+
+  columns_[kTypeColumn].push_back(static_cast<char>(event.type));
+  AppendVarint(columns_[kTimeColumn], ZigZagEncode(time - previous_time_));
+  previous_time_ = time;
+  AppendVarint(columns_[kResourceIdColumn],
+               static_cast<uint64_t>(event.resource_id));
+  switch (event.type) {
+    case EventLogEventType::kParticipantUpdated:
+      AppendVarint(columns_[kDisplayNameColumn],
+                   InternString(event.display_name));
+      AppendVarint(columns_[kParticipantKeyColumn],
+                   InternString(event.participant_key));
+      break;
+    case EventLogEventType::kMediaEntryUpdated:
+      AppendVarint(columns_[kParticipantKeyColumn],
+                   InternString(event.participant_key));
+      AppendVarint(columns_[kParticipantSessionNameColumn],
+                   InternString(event.participant_session_name));
+      AppendVarint(columns_[kAudioCsrcColumn], event.audio_csrc);
+      AppendVarint(columns_[kVideoCsrcsColumn], event.video_csrcs.size());
+      for (uint32_t video_csrc : event.video_csrcs) {
+        AppendVarint(columns_[kVideoCsrcsColumn], video_csrc);
+      }
+      columns_[kMutedColumn].push_back(
+          static_cast<char>((event.audio_muted ? 1 : 0) |
+                            (event.video_muted ? 2 : 0)));
+      break;
+    case EventLogEventType::kParticipantDeleted:
+    case EventLogEventType::kMediaEntryDeleted:
+      break;
+  }
+
+  if (++block_.event_count == events_per_block_) {
+    WriteBlock();
+  }
+}
+
+void BinaryEventLogWriter::Close() {
+  if (closed_) return;
+  WriteBlock();
+  closed_ = true;
+
+  output_buffer_.clear();
+  output_buffer_.push_back(kFooterTag);
+  AppendVarint(output_buffer_, blocks_.size());
+  for (const BinaryEventLogBlock& block : blocks_) {
+    AppendVarint(output_buffer_, block.offset);
+    AppendVarint(output_buffer_, block.event_count);
+    AppendVarint(output_buffer_,
+                 ZigZagEncode(absl::ToUnixMicros(block.first_time)));
+    AppendVarint(output_buffer_,
+                 ZigZagEncode(absl::ToUnixMicros(block.last_time)));
+  }
+  AppendFixed32(output_buffer_, output_buffer_.size());
+  absl::StrAppend(&output_buffer_, kFooterMagic);
+  writer_->Write(output_buffer_.data(), output_buffer_.size());
+  writer_->Close();
+}
+
+void BinaryEventLogWriter::Flush() {
+  if (closed_) return;
+  WriteBlock();
+  writer_->Flush();
+}
+
+void BinaryEventLogWriter::WriteBlock() {
+  if (closed_ || block_.event_count == 0) return;
+
+  std::string payload_prefix;
+  AppendVarint(payload_prefix, block_.event_count);
+  AppendVarint(payload_prefix, new_string_count_);
+  std::array<std::string, kBinaryEventLogColumnCount> column_sizes;
+  size_t payload_size = payload_prefix.size() + new_strings_.size();
+  for (int i = 0; i < kBinaryEventLogColumnCount; ++i) {
+    AppendVarint(column_sizes[i], columns_[i].size());
+    payload_size += column_sizes[i].size() + columns_[i].size();
+  }
+
+  output_buffer_.clear();
+  output_buffer_.push_back(kBlockTag);
+  AppendFixed32(output_buffer_, payload_size);
+  absl::StrAppend(&output_buffer_, payload_prefix, new_strings_);
+  for (int i = 0; i < kBinaryEventLogColumnCount; ++i) {
+    absl::StrAppend(&output_buffer_, column_sizes[i], columns_[i]);
+    columns_[i].clear();
+  }
+  writer_->Write(output_buffer_.data(), output_buffer_.size());
+
+  block_.offset = offset_;
+  offset_ += output_buffer_.size();
+  blocks_.push_back(block_);
+  block_ = {};
+  new_strings_.clear();
+  new_string_count_ = 0;
+}
+
+uint64_t BinaryEventLogWriter::InternString(absl::string_view value) {
+  auto it = string_numbers_.find(value);
+  if (it != string_numbers_.end()) return it->second;
+
+  uint64_t number = string_numbers_.size();
+  string_numbers_.try_emplace(std::string(value), number);
+  AppendVarint(new_strings_, value.size());
+  absl::StrAppend(&new_strings_, value);
+  ++new_string_count_;
+  return number;
+}
+
+absl::StatusOr<std::unique_ptr<BinaryEventLogReader>>
+BinaryEventLogReader::Create(absl::string_view contents) {
+  if (!absl::ConsumePrefix(&contents, kHeaderMagic) || contents.empty()) {
+    return absl::InvalidArgumentError("Not a binary event log");
+  }
+  if (contents.front() != kVersion) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Unsupported binary event log version: ", int{contents.front()}));
+  }
+  contents.remove_prefix(1);
+
+  // Without a footer, all remaining data is blocks, the last of which may be
+  // cut short.
+  std::vector<BinaryEventLogBlock> index;
+  absl::string_view footer = contents;
+  uint32_t footer_size = 0;
+  if (!absl::ConsumeSuffix(&footer, kFooterMagic) ||
+      footer.size() < sizeof(footer_size)) {
+    return absl::WrapUnique(
+        new BinaryEventLogReader(contents, /*complete=*/false, {}));
+  }
+  absl::string_view footer_size_bytes = footer.substr(footer.size() - 4);
+  ReadFixed32(footer_size_bytes, footer_size);
+  footer.remove_suffix(4);
+  if (footer_size > footer.size()) {
+    return absl::DataLossError("Binary event log footer is corrupt");
+  }
+  absl::string_view blocks = footer.substr(0, footer.size() - footer_size);
+  footer.remove_prefix(blocks.size());
+
+  uint8_t tag = 0;
+  uint64_t block_count = 0;
+  if (!ReadByte(footer, tag) || tag != kFooterTag ||
+      !ReadVarint(footer, block_count)) {
+    return absl::DataLossError("Binary event log footer is corrupt");
+  }
+  for (uint64_t i = 0; i < block_count; ++i) {
+    uint64_t offset, event_count, first_time, last_time;
+    if (!ReadVarint(footer, offset) || !ReadVarint(footer, event_count) ||
+        !ReadVarint(footer, first_time) || !ReadVarint(footer, last_time)) {
+      return absl::DataLossError("Binary event log footer is corrupt");
+    }
+    index.push_back(
+        {.offset = static_cast<int64_t>(offset),
+         .event_count = static_cast<int64_t>(event_count),
+         .first_time = absl::FromUnixMicros(ZigZagDecode(first_time)),
+         .last_time = absl::FromUnixMicros(ZigZagDecode(last_time))});
+  }
+  return absl::WrapUnique(
+      new BinaryEventLogReader(blocks, /*complete=*/true, std::move(index)));
+}
+
+bool BinaryEventLogReader::Next(EventLogEvent& event) {
+  while (block_events_remaining_ == 0) {
+    if (!ReadBlock()) return false;
+  }
+  --block_events_remaining_;
+
+  uint8_t type = 0;
+  uint64_t time_delta, resource_id;
+  if (!ReadByte(columns_[kTypeColumn], type) ||
+      type > static_cast<uint8_t>(EventLogEventType::kMediaEntryDeleted) ||
+      !ReadVarint(columns_[kTimeColumn], time_delta) ||
+      !ReadVarint(columns_[kResourceIdColumn], resource_id)) {
+    return Fail("event is corrupt");
+  }
+  previous_time_ += ZigZagDecode(time_delta);
+  event = {.type = static_cast<EventLogEventType>(type),
+           .time = absl::FromUnixMicros(previous_time_),
+           .resource_id = static_cast<int64_t>(resource_id)};
+
+  switch (event.type) {
+    case EventLogEventType::kParticipantUpdated:
+      if (!ReadString(columns_[kDisplayNameColumn], event.display_name) ||
+          !ReadString(columns_[kParticipantKeyColumn],
+                      event.participant_key)) {
+        return Fail("participant update is corrupt");
+      }
+      break;
+    case EventLogEventType::kMediaEntryUpdated: {
+      uint64_t audio_csrc, video_csrc_count;
+      uint8_t muted = 0;
+      if (!ReadString(columns_[kParticipantKeyColumn],
+                      event.participant_key) ||
+          !ReadString(columns_[kParticipantSessionNameColumn],
+                      event.participant_session_name) ||
+          !ReadVarint(columns_[kAudioCsrcColumn], audio_csrc) ||
+          !ReadVarint(columns_[kVideoCsrcsColumn], video_csrc_count) ||
+          video_csrc_count > columns_[kVideoCsrcsColumn].size()) {
+        return Fail("media entry update is corrupt");
+      }
+      video_csrcs_.clear();
+      for (uint64_t i = 0; i < video_csrc_count; ++i) {
+        uint64_t video_csrc;
+        if (!ReadVarint(columns_[kVideoCsrcsColumn], video_csrc)) {
+          return Fail("media entry update is corrupt");
+        }
+        video_csrcs_.push_back(static_cast<uint32_t>(video_csrc));
+      }
+      if (!ReadByte(columns_[kMutedColumn], muted)) {
+        return Fail("media entry update is corrupt");
+      }
+      event.audio_csrc = static_cast<uint32_t>(audio_csrc);
+      event.video_csrcs = video_csrcs_;
+      event.audio_muted = (muted & 1) != 0;
+      event.video_muted = (muted & 2) != 0;
+      break;
+    }
+    case EventLogEventType::kParticipantDeleted:
+    case EventLogEventType::kMediaEntryDeleted:
+      break;
+  }
+  return true;
+}
+
+bool BinaryEventLogReader::ReadBlock() {
+  if (!status_.ok() || remaining_.empty()) return false;
+
+  uint8_t tag = 0;
+  uint32_t size = 0;
+  absl::string_view input = remaining_;
+  if (!ReadByte(input, tag) || tag != kBlockTag ||
+      !ReadFixed32(input, size) || size > input.size()) {
+    // Logs that were not closed may end with a partially written block.
+    return complete_ ? Fail("block header is corrupt") : false;
+  }
+  absl::string_view block = input.substr(0, size);
+  remaining_ = input.substr(size);
+
+  uint64_t event_count, new_string_count;
+  if (!ReadVarint(block, event_count) ||
+      !ReadVarint(block, new_string_count)) {
+    return Fail("block is corrupt");
+  }
+  for (uint64_t i = 0; i < new_string_count; ++i) {
+    uint64_t string_size;
+    if (!ReadVarint(block, string_size) || string_size > block.size()) {
+      return Fail("block strings are corrupt");
+    }
+    strings_.push_back(block.substr(0, string_size));
+    block.remove_prefix(string_size);
+  }
+  for (absl::string_view& column : columns_) {
+    uint64_t column_size;
+    if (!ReadVarint(block, column_size) || column_size > block.size()) {
+      return Fail("block columns are corrupt");
+    }
+    column = block.substr(0, column_size);
+    block.remove_prefix(column_size);
+  }
+  block_events_remaining_ = event_count;
+  previous_time_ = 0;
+  return true;
+}
+
+bool BinaryEventLogReader::ReadString(absl::string_view& column,
+                                      absl::string_view& value) {
+  uint64_t number;
+  if (!ReadVarint(column, number) || number >= strings_.size()) {
+    return false;
+  }
+  value = strings_[number];
+  return true;
+}
+
+bool BinaryEventLogReader::Fail(absl::string_view message) {
+  status_ = absl::DataLossError(absl::StrCat("Binary event log ", message));
+  block_events_remaining_ = 0;
+  remaining_ = {};
+  return false;
+}
+
+}  // namespace media_api_samples
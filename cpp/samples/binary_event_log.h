@@ -0,0 +1,180 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_BINARY_EVENT_LOG_H_
+#define CPP_SAMPLES_BINARY_EVENT_LOG_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/event_log_writer_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// A compact binary encoding of the event log, for tools that scan the logs of
+// many conferences.
+//
+// Events are stored in blocks, and each block stores its events column by
+// column:
+//
+//   file   := "MEVL" version:u8 block* footer?
+//   block  := 'B' size:fixed32 event_count:varint
+//             new_string_count:varint (size:varint bytes)*
+//             (column_size:varint column)*
+//   footer := 'F' block_count:varint
+//             (offset:varint event_count:varint first_time:zigzag
+//              last_time:zigzag)*
+//             footer_size:fixed32 "MEVF"
+//
+// Times are microseconds since the Unix epoch, and are stored in the time
+// column as zigzag-encoded differences from the previous event of the block.
+// Ids and contributing sources are varints. Strings are interned: a block
+// lists the strings first used in it, which are numbered after those of the
+// previous blocks, and string columns hold these numbers. Columns only hold
+// values for the event types that have the field; see `EventLogEvent`.
+//
+// The footer indexes the blocks by time. It is written on close, and a log
+// without one, e.g. after a crash, can still be read up to the last complete
+// block.
+
+// The number of columns of a block, see `binary_event_log.cc` for their order.
+inline constexpr int kBinaryEventLogColumnCount = 9;
+
+// An entry of the footer index.
+struct BinaryEventLogBlock {
+  // Offset of the block from the start of the file.
+  int64_t offset = 0;
+  int64_t event_count = 0;
+  absl::Time first_time;
+  absl::Time last_time;
+};
+
+// Writes events in the binary event log format.
+//
+// Events are buffered until a block is full or `Flush` is called, so a crash
+// loses the events written since then.
+//
+// This class is not thread-safe.
+class BinaryEventLogWriter : public EventLogWriterInterface {
+ public:
+  struct Options {
+    int events_per_block = 1024;
+  };
+
+  explicit BinaryEventLogWriter(std::unique_ptr<OutputWriterInterface> writer)
+      : BinaryEventLogWriter(std::move(writer), Options()) {}
+  BinaryEventLogWriter(std::unique_ptr<OutputWriterInterface> writer,
+                       const Options& options);
+  ~BinaryEventLogWriter() override;
+
+  void Write(const EventLogEvent& event) override;
+  // Writes the current block and the footer, and closes the wrapped writer.
+  void Close() override;
+
+  // Ends the current block, writes it to the wrapped writer, and flushes the
+  // wrapped writer.
+  void Flush() override;
+
+ private:
+  // Ends the current block, and writes it to the wrapped writer.
+  void WriteBlock();
+  // Returns the number of `value`, adding it to the block's new strings if it
+  // has not been used before.
+  uint64_t InternString(absl::string_view value);
+
+  std::unique_ptr<OutputWriterInterface> writer_;
+  const int events_per_block_;
+  bool closed_ = false;
+  // Bytes written so far, for the offsets in the footer.
+  int64_t offset_ = 0;
+
+  absl::flat_hash_map<std::string, uint64_t> string_numbers_;
+  std::string new_strings_;
+  int64_t new_string_count_ = 0;
+  std::array<std::string, kBinaryEventLogColumnCount> columns_;
+  int64_t previous_time_ = 0;
+  // The current block, and the blocks written so far.
+  BinaryEventLogBlock block_;
+  std::vector<BinaryEventLogBlock> blocks_;
+  // Reused to assemble blocks before they are written.
+  std::string output_buffer_;
+};
+
+// Reads events in the binary event log format.
+//
+// This class is not thread-safe.
+class BinaryEventLogReader {
+ public:
+  // Returns a reader of `contents`, which must outlive the reader. Fails if
+  // `contents` is not a binary event log.
+  static absl::StatusOr<std::unique_ptr<BinaryEventLogReader>> Create(
+      absl::string_view contents);
+
+  // Whether the log has a footer, i.e. its writer was closed.
+  bool complete() const { return complete_; }
+  // The footer index, or empty if the log is not complete.
+  const std::vector<BinaryEventLogBlock>& blocks() const { return blocks_; }
+
+  // Reads the next event into `event`, and returns false at the end of the
+  // log or if the log is corrupt, in which case `status` returns the error.
+  //
+  // The strings of `event` remain valid as long as `contents`, and its
+  // contributing sources until the next call.
+  bool Next(EventLogEvent& event);
+
+  absl::Status status() const { return status_; }
+
+ private:
+  BinaryEventLogReader(absl::string_view blocks, bool complete,
+                       std::vector<BinaryEventLogBlock> index)
+      : remaining_(blocks), complete_(complete), blocks_(std::move(index)) {}
+
+  // Starts reading the next block. Returns false if there is none.
+  bool ReadBlock();
+  bool ReadString(absl::string_view& column, absl::string_view& value);
+  bool Fail(absl::string_view message);
+
+  // The blocks that have not been read yet.
+  absl::string_view remaining_;
+  const bool complete_;
+  const std::vector<BinaryEventLogBlock> blocks_;
+  absl::Status status_;
+
+  std::vector<absl::string_view> strings_;
+  // The unread part of each column of the current block.
+  std::array<absl::string_view, kBinaryEventLogColumnCount> columns_;
+  int64_t block_events_remaining_ = 0;
+  int64_t previous_time_ = 0;
+  std::vector<uint32_t> video_csrcs_;
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_BINARY_EVENT_LOG_H_
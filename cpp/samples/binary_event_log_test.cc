@@ -0,0 +1,220 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/binary_event_log.h"
+
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/event_log_writer_interface.h"
+#include "meet_clients/samples/testing/mock_output_writer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+
+// An event with owned strings, for comparing read events.
+struct OwnedEvent {
+  EventLogEventType type;
+  absl::Time time;
+  int64_t resource_id;
+  std::string display_name;
+  std::string participant_key;
+  std::string participant_session_name;
+  uint32_t audio_csrc;
+  std::vector<uint32_t> video_csrcs;
+  bool audio_muted;
+  bool video_muted;
+
+  explicit OwnedEvent(const EventLogEvent& event)
+      : type(event.type),
+        time(event.time),
+        resource_id(event.resource_id),
+        display_name(event.display_name),
+        participant_key(event.participant_key),
+        participant_session_name(event.participant_session_name),
+        audio_csrc(event.audio_csrc),
+        video_csrcs(event.video_csrcs.begin(), event.video_csrcs.end()),
+        audio_muted(event.audio_muted),
+        video_muted(event.video_muted) {}
+
+  bool operator==(const OwnedEvent&) const = default;
+};
+
+std::unique_ptr<MockOutputWriter> CreateCapturingWriter(std::string& output) {
+  auto writer = std::make_unique<MockOutputWriter>();
+  EXPECT_CALL(*writer, Write(_, _))
+      .WillRepeatedly([&output](const char* content, std::streamsize size) {
+        output.append(content, size);
+      });
+  return writer;
+}
+
+const std::vector<uint32_t>& VideoCsrcs() {
+  static const auto* const video_csrcs = new std::vector<uint32_t>{22, 33};
+  return *video_csrcs;
+}
+
+std::vector<EventLogEvent> CreateTestEvents() {
+  absl::Time start = absl::FromUnixSeconds(1700000000);
+  return {
+      {.type = EventLogEventType::kParticipantUpdated,
+       .time = start,
+       .resource_id = 123,
+       .display_name = "display_name",
+       .participant_key = "participant_key"},
+      {.type = EventLogEventType::kMediaEntryUpdated,
+       .time = start,
+       .resource_id = 456,
+       .participant_key = "participant_key",
+       .participant_session_name = "session_name",
+       .audio_csrc = 11,
+       .video_csrcs = VideoCsrcs(),
+       .audio_muted = true},
+      {.type = EventLogEventType::kMediaEntryUpdated,
+       .time = start + absl::Milliseconds(1500),
+       .resource_id = 456,
+       .participant_key = "participant_key",
+       .participant_session_name = "session_name",
+       .audio_csrc = 11,
+       .video_muted = true},
+      {.type = EventLogEventType::kMediaEntryDeleted,
+       .time = start + absl::Seconds(3),
+       .resource_id = 456},
+      {.type = EventLogEventType::kParticipantDeleted,
+       .time = start + absl::Seconds(3),
+       .resource_id = 123},
+  };
+}
+
+std::vector<OwnedEvent> ReadAll(BinaryEventLogReader& reader) {
+  std::vector<OwnedEvent> events;
+  EventLogEvent event;
+  while (reader.Next(event)) {
+    events.push_back(OwnedEvent(event));
+  }
+  return events;
+}
+
+std::vector<OwnedEvent> ToOwned(const std::vector<EventLogEvent>& events) {
+  return std::vector<OwnedEvent>(events.begin(), events.end());
+}
+
+TEST(BinaryEventLogTest, RoundTripsEventsAcrossBlocks) {
+  std::string log;
+  BinaryEventLogWriter writer(CreateCapturingWriter(log),
+                              {.events_per_block = 2});
+  std::vector<EventLogEvent> events = CreateTestEvents();
+  for (const EventLogEvent& event : events) {
+    writer.Write(event);
+  }
+  writer.Close();
+
+  absl::StatusOr<std::unique_ptr<BinaryEventLogReader>> reader =
+      BinaryEventLogReader::Create(log);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  EXPECT_THAT(ReadAll(**reader), ElementsAreArray(ToOwned(events)));
+  EXPECT_TRUE((*reader)->status().ok());
+  EXPECT_TRUE((*reader)->complete());
+}
+
+TEST(BinaryEventLogTest, IndexesBlocksInFooter) {
+  std::string log;
+  BinaryEventLogWriter writer(CreateCapturingWriter(log),
+                              {.events_per_block = 2});
+  std::vector<EventLogEvent> events = CreateTestEvents();
+  for (const EventLogEvent& event : events) {
+    writer.Write(event);
+  }
+  writer.Close();
+
+  absl::StatusOr<std::unique_ptr<BinaryEventLogReader>> reader =
+      BinaryEventLogReader::Create(log);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  const std::vector<BinaryEventLogBlock>& blocks = (*reader)->blocks();
+  ASSERT_EQ(blocks.size(), 3);
+  EXPECT_EQ(blocks[0].offset, 5);
+  EXPECT_EQ(blocks[0].event_count, 2);
+  EXPECT_EQ(blocks[1].event_count, 2);
+  EXPECT_EQ(blocks[1].first_time, events[2].time);
+  EXPECT_EQ(blocks[1].last_time, events[3].time);
+  EXPECT_EQ(blocks[2].event_count, 1);
+  EXPECT_EQ(log[blocks[2].offset], 'B');
+}
+
+TEST(BinaryEventLogTest, ReadsCompleteBlocksOfUnclosedLog) {
+  std::string log;
+  BinaryEventLogWriter writer(CreateCapturingWriter(log),
+                              {.events_per_block = 2});
+  std::vector<EventLogEvent> events = CreateTestEvents();
+  for (const EventLogEvent& event : events) {
+    writer.Write(event);
+  }
+  writer.Flush();
+  // Simulate a crash while the last block was being written.
+  std::string truncated = log.substr(0, log.size() - 3);
+
+  absl::StatusOr<std::unique_ptr<BinaryEventLogReader>> reader =
+      BinaryEventLogReader::Create(truncated);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  EXPECT_FALSE((*reader)->complete());
+  EXPECT_THAT(ReadAll(**reader),
+              ElementsAreArray(ToOwned(
+                  std::vector<EventLogEvent>(events.begin(),
+                                             events.begin() + 4))));
+  EXPECT_TRUE((*reader)->status().ok());
+}
+
+TEST(BinaryEventLogTest, ReportsCorruptBlock) {
+  std::string log;
+  BinaryEventLogWriter writer(CreateCapturingWriter(log));
+  writer.Write(CreateTestEvents()[0]);
+  writer.Close();
+  // Make the block larger than the log. Since the log has a footer, this is
+  // corruption rather than a crash.
+  ASSERT_EQ(log[5], 'B');
+  log[8] = 0x7f;
+
+  absl::StatusOr<std::unique_ptr<BinaryEventLogReader>> reader =
+      BinaryEventLogReader::Create(log);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  EXPECT_THAT(ReadAll(**reader), ElementsAre());
+  EXPECT_EQ((*reader)->status().code(), absl::StatusCode::kDataLoss);
+}
+
+TEST(BinaryEventLogTest, RejectsOtherFiles) {
+  EXPECT_EQ(BinaryEventLogReader::Create("time=0,event=x\n").status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace media_api_samples
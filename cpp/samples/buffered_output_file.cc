@@ -0,0 +1,178 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/buffered_output_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+size_t PageSize() { return static_cast<size_t>(sysconf(_SC_PAGESIZE)); }
+
+}  // namespace
+
+std::unique_ptr<BufferedOutputFile> BufferedOutputFile::Open(
+    absl::string_view file_name, const Options& options) {
+  // `O_DIRECT` requires the buffer address, the file offset, and the write
+  // size to be aligned to the logical block size, which never exceeds the page
+  // size. Page-aligning the buffer and its size satisfies all three for every
+  // write except the last.
+  size_t page_size = PageSize();
+  size_t buffer_size =
+      std::max<size_t>(1, (options.buffer_size + page_size - 1) / page_size) *
+      page_size;
+  void* buffer = nullptr;
+  if (posix_memalign(&buffer, page_size, buffer_size) != 0) {
+    buffer = nullptr;
+  }
+
+  std::string file_name_string(file_name);
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  bool direct_io = options.direct_io;
+  int fd = -1;
+  if (buffer != nullptr) {
+    fd = open(file_name_string.c_str(), flags | (direct_io ? O_DIRECT : 0),
+              0644);
+    if (fd < 0 && direct_io && errno == EINVAL) {
+      // Some file systems, such as tmpfs, do not support `O_DIRECT`.
+      LOG(WARNING) << "O_DIRECT is not supported for " << file_name
+                   << ", falling back to buffered I/O";
+      direct_io = false;
+      fd = open(file_name_string.c_str(), flags, 0644);
+    }
+  }
+  if (fd >= 0) {
+    LOG(INFO) << "Opened file: " << file_name;
+  } else {
+    // If a file cannot be opened, the sample will still run, but written data
+    // will be lost.
+    LOG(ERROR) << "Failed to open file: " << file_name << ": "
+               << (buffer == nullptr ? "failed to allocate buffer"
+                                     : strerror(errno));
+  }
+
+  return absl::WrapUnique(new BufferedOutputFile(
+      fd, direct_io, options.drop_written_pages,
+      std::unique_ptr<char, FreeDeleter>(static_cast<char*>(buffer)),
+      buffer_size));
+}
+
+BufferedOutputFile::~BufferedOutputFile() { Close(); }
+
+void BufferedOutputFile::Write(const char* content, std::streamsize size) {
+  if (fd_ < 0) return;
+
+  while (size > 0) {
+    size_t copy_size =
+        std::min<size_t>(size, buffer_size_ - buffer_used_);
+    memcpy(buffer_.get() + buffer_used_, content, copy_size);
+    buffer_used_ += copy_size;
+    content += copy_size;
+    size -= copy_size;
+    if (buffer_used_ == buffer_size_) {
+      FlushBuffer();
+      if (fd_ < 0) return;
+    }
+  }
+}
+
+void BufferedOutputFile::Flush() {
+  if (fd_ < 0) return;
+  FlushBuffer();
+}
+
+void BufferedOutputFile::Close() {
+  if (fd_ < 0) return;
+
+  FlushBuffer();
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+void BufferedOutputFile::FlushBuffer() {
+  if (buffer_used_ == 0) return;
+
+  if (direct_io_ && buffer_used_ % PageSize() != 0) {
+    // Only the final write of a file, or one forced by `Flush`, can be
+    // partial. Switch to buffered I/O for the rest of the file, since such a
+    // write does not satisfy the `O_DIRECT` size requirements.
+    fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+    direct_io_ = false;
+  }
+
+  size_t written = 0;
+  while (written < buffer_used_) {
+    ssize_t result =
+        write(fd_, buffer_.get() + written, buffer_used_ - written);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      LOG(ERROR) << "Failed to write to fd " << fd_ << ": " << strerror(errno)
+                 << ". Further data will be dropped.";
+      close(fd_);
+      fd_ = -1;
+      return;
+    }
+    written += result;
+  }
+
+  int64_t buffer_start = file_size_;
+  file_size_ += buffer_used_;
+  buffer_used_ = 0;
+
+  if (drop_written_pages_ && !direct_io_) {
+    // Dirty pages cannot be dropped, so start writeback for this buffer now
+    // and drop the previous buffers, which have had time to be written back.
+    sync_file_range(fd_, buffer_start, file_size_ - buffer_start,
+                    SYNC_FILE_RANGE_WRITE);
+    if (buffer_start > dropped_until_) {
+      posix_fadvise(fd_, dropped_until_, buffer_start - dropped_until_,
+                    POSIX_FADV_DONTNEED);
+      dropped_until_ = buffer_start;
+    }
+  }
+}
+
+OutputWriterProvider CreateBufferedOutputFileProvider(
+    BufferedOutputFile::Options options) {
+  return [options](absl::string_view file_name) {
+    return BufferedOutputFile::Open(file_name, options);
+  };
+}
+
+}  // namespace media_api_samples
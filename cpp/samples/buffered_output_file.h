@@ -0,0 +1,109 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_BUFFERED_OUTPUT_FILE_H_
+#define CPP_SAMPLES_BUFFERED_OUTPUT_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <ios>
+#include <memory>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/strings/string_view.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// An output writer that collects data in a large page-aligned buffer and writes
+// it to a file one full buffer at a time.
+//
+// Compared to `OutputFile`, this issues far fewer system calls for raw media
+// segments. Optionally, it also keeps long recordings from filling the page
+// cache, either by bypassing it with `O_DIRECT` or by dropping pages once they
+// have been written back.
+//
+// This class is not thread-safe.
+class BufferedOutputFile : public OutputWriterInterface {
+ public:
+  struct Options {
+    // Size of the write buffer, in bytes. Rounded up to a multiple of the page
+    // size.
+    size_t buffer_size = 4 << 20;
+    // Whether to open the file with `O_DIRECT`. Falls back to buffered I/O if
+    // the file system does not support it.
+    bool direct_io = false;
+    // Whether to drop written data from the page cache with
+    // `posix_fadvise(POSIX_FADV_DONTNEED)`.
+    bool drop_written_pages = true;
+  };
+
+  // Opens `file_name`, truncating any existing file. If the file cannot be
+  // opened, the returned writer drops all data.
+  static std::unique_ptr<BufferedOutputFile> Open(absl::string_view file_name,
+                                                  const Options& options);
+
+  ~BufferedOutputFile() override;
+
+  void Write(const char* content, std::streamsize size) override;
+  // Writes the filled part of the buffer to the file. With `direct_io`, a
+  // buffer that is not a whole number of pages switches the file to buffered
+  // I/O for the rest of its writes.
+  void Flush() override;
+  void Close() override;
+
+ private:
+  struct FreeDeleter {
+    void operator()(char* buffer) const { free(buffer); }
+  };
+
+  BufferedOutputFile(int fd, bool direct_io, bool drop_written_pages,
+                     std::unique_ptr<char, FreeDeleter> buffer,
+                     size_t buffer_size)
+      : fd_(fd),
+        direct_io_(direct_io),
+        drop_written_pages_(drop_written_pages),
+        buffer_(std::move(buffer)),
+        buffer_size_(buffer_size) {}
+
+  // Writes the filled part of the buffer to the file.
+  void FlushBuffer();
+
+  // The file descriptor, or -1 if the file failed to open, failed to write, or
+  // has been closed.
+  int fd_;
+  bool direct_io_;
+  bool drop_written_pages_;
+  std::unique_ptr<char, FreeDeleter> buffer_;
+  size_t buffer_size_;
+  size_t buffer_used_ = 0;
+  // Number of bytes written to the file so far.
+  int64_t file_size_ = 0;
+  // Offset up to which written pages have been dropped from the page cache.
+  int64_t dropped_until_ = 0;
+};
+
+// Returns a provider that creates `BufferedOutputFile`s.
+OutputWriterProvider CreateBufferedOutputFileProvider(
+    BufferedOutputFile::Options options);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_BUFFERED_OUTPUT_FILE_H_
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/buffered_output_file.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+std::string ReadFile(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+std::string CreateTestData(int size) {
+  std::string data;
+  for (int i = 0; i < size; ++i) {
+    data.push_back('a' + i % 26);
+  }
+  return data;
+}
+
+// Writes `data` in uneven pieces so that writes straddle buffer boundaries.
+void WriteInPieces(absl::string_view data, OutputWriterInterface& writer) {
+  int piece_size = 1;
+  while (!data.empty()) {
+    absl::string_view piece = data.substr(0, piece_size);
+    writer.Write(piece.data(), piece.size());
+    data.remove_prefix(piece.size());
+    piece_size = piece_size * 3 % 1000 + 1;
+  }
+}
+
+class BufferedOutputFileTest : public ::testing::TestWithParam<bool> {};
+
+TEST_P(BufferedOutputFileTest, WritesAllData) {
+  std::string file_name =
+      absl::StrCat(::testing::TempDir(), "buffered_",
+                   GetParam() ? "direct" : "cached");
+  // Use a buffer smaller than the data to exercise several flushes, and a size
+  // that is not a multiple of the buffer to exercise the partial tail.
+  std::string data = CreateTestData(3 * sysconf(_SC_PAGESIZE) + 123);
+  std::unique_ptr<OutputWriterInterface> writer = BufferedOutputFile::Open(
+      file_name, {.buffer_size = 1, .direct_io = GetParam()});
+
+  WriteInPieces(data, *writer);
+  writer->Close();
+
+  EXPECT_EQ(ReadFile(file_name), data);
+}
+
+TEST_P(BufferedOutputFileTest, WritesChunksAndFlushesOnDestruction) {
+  std::string file_name =
+      absl::StrCat(::testing::TempDir(), "buffered_chunks_",
+                   GetParam() ? "direct" : "cached");
+  std::string data = CreateTestData(1000);
+  {
+    OutputWriterProvider provider = CreateBufferedOutputFileProvider(
+        {.buffer_size = 1 << 20, .direct_io = GetParam()});
+    std::unique_ptr<OutputWriterInterface> writer = provider(file_name);
+    absl::string_view view(data);
+    absl::Span<const char> chunks[] = {view.substr(0, 10), view.substr(10)};
+    writer->WriteChunks(chunks);
+  }
+
+  EXPECT_EQ(ReadFile(file_name), data);
+}
+
+TEST_P(BufferedOutputFileTest, FlushWritesBufferedData) {
+  std::string file_name =
+      absl::StrCat(::testing::TempDir(), "buffered_flush_",
+                   GetParam() ? "direct" : "cached");
+  std::string data = CreateTestData(1000);
+  std::unique_ptr<OutputWriterInterface> writer = BufferedOutputFile::Open(
+      file_name, {.buffer_size = 1 << 20, .direct_io = GetParam()});
+
+  writer->Write(data.data(), 100);
+  writer->Flush();
+  EXPECT_EQ(ReadFile(file_name), data.substr(0, 100));
+
+  // Writes after a partial flush still reach the file.
+  writer->Write(data.data() + 100, data.size() - 100);
+  writer->Close();
+  EXPECT_EQ(ReadFile(file_name), data);
+}
+
+TEST_P(BufferedOutputFileTest, DropsDataWhenFileCannotBeOpened) {
+  std::unique_ptr<OutputWriterInterface> writer = BufferedOutputFile::Open(
+      "/nonexistent_directory/file", {.direct_io = GetParam()});
+
+  writer->Write("abc", 3);
+  writer->Close();
+}
+
+INSTANTIATE_TEST_SUITE_P(DirectIo, BufferedOutputFileTest, ::testing::Bool());
+
+}  // namespace
+}  // namespace media_api_samples
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/csv_event_log_writer.h"
+
+#include <cstddef>
+
+#include "absl/base/nullability.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/event_log_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+constexpr absl::string_view kParticipantResourceUpdateFormat =
+    "time=%s,"
+    "event=updated participant resource,"
+    "display_name=%s,"
+    "participant_key=%s,"
+    "participant_id=%d\n";
+constexpr absl::string_view kParticipantResourceDeleteFormat =
+    "time=%s,"
+    "event=deleted participant resource,"
+    "participant_id=%d\n";
+constexpr absl::string_view kMediaEntryResourceUpdateFormat =
+    "time=%s,"
+    "event=updated media entry resource,"
+    "participant_session_name=%s,"
+    "participant_key=%s,"
+    "media_entry_id=%d,"
+    "audio_csrc=%d,"
+    // Because there may be multiple video contributing sources, they are
+    // appended after this, delimited by `|`.
+    "video_csrcs=";
+constexpr absl::string_view kMediaEntryResourceUpdateSuffixFormat =
+    ","
+    "audio_muted=%d,"
+    "video_muted=%d\n";
+constexpr absl::string_view kMediaEntryResourceDeleteFormat =
+    "time=%s,"
+    "event=deleted media entry resource,"
+    "media_entry_id=%d\n";
+
+}  // namespace
+
+void CsvEventLogWriter::Write(const EventLogEvent& event) {
+  if (event.time != formatted_time_) {
+    formatted_time_ = event.time;
+    formatted_time_string_ = absl::FormatTime(event.time);
+  }
+
+  buffer_.clear();
+  switch (event.type) {
+    case EventLogEventType::kParticipantUpdated:
+      absl::StrAppendFormat(&buffer_, kParticipantResourceUpdateFormat,
+                            formatted_time_string_, event.display_name,
+                            event.participant_key, event.resource_id);
+      break;
+    case EventLogEventType::kParticipantDeleted:
+      absl::StrAppendFormat(&buffer_, kParticipantResourceDeleteFormat,
+                            formatted_time_string_, event.resource_id);
+      break;
+    case EventLogEventType::kMediaEntryUpdated:
+      absl::StrAppendFormat(
+          &buffer_, kMediaEntryResourceUpdateFormat, formatted_time_string_,
+          event.participant_session_name, event.participant_key,
+          event.resource_id, event.audio_csrc);
+      for (size_t i = 0; i < event.video_csrcs.size(); ++i) {
+        absl::StrAppend(&buffer_, i > 0 ? "|" : "", event.video_csrcs[i]);
+      }
+      absl::StrAppendFormat(&buffer_, kMediaEntryResourceUpdateSuffixFormat,
+                            event.audio_muted, event.video_muted);
+      break;
+    case EventLogEventType::kMediaEntryDeleted:
+      absl::StrAppendFormat(&buffer_, kMediaEntryResourceDeleteFormat,
+                            formatted_time_string_, event.resource_id);
+      break;
+  }
+  writer_->Write(buffer_.data(), buffer_.size());
+}
+
+}  // namespace media_api_samples
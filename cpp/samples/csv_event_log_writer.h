@@ -0,0 +1,61 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_CSV_EVENT_LOG_WRITER_H_
+#define CPP_SAMPLES_CSV_EVENT_LOG_WRITER_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/event_log_writer_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Writes events as text lines that are easy to read, e.g.:
+//
+//   time=<time>,event=deleted participant resource,participant_id=<id>
+//
+// This class is not thread-safe.
+class CsvEventLogWriter : public EventLogWriterInterface {
+ public:
+  explicit CsvEventLogWriter(std::unique_ptr<OutputWriterInterface> writer)
+      : writer_(std::move(writer)) {}
+
+  void Write(const EventLogEvent& event) override;
+  void Flush() override { writer_->Flush(); }
+  void Close() override { writer_->Close(); }
+
+ private:
+  std::unique_ptr<OutputWriterInterface> writer_;
+  // Events are formatted into this buffer, which is reused so that writing an
+  // event does not allocate once the buffer has grown to the longest event.
+  std::string buffer_;
+  // Events of the same update share their time, so the last formatted time is
+  // reused.
+  absl::Time formatted_time_ = absl::InfinitePast();
+  std::string formatted_time_string_;
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_CSV_EVENT_LOG_WRITER_H_
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/durable_output_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "rtc_base/thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+absl::StatusOr<std::shared_ptr<DurableOutputWriterPool>>
+DurableOutputWriterPool::Create(Options options,
+                                OutputWriterProvider provider) {
+  if (options.commit_interval <= absl::ZeroDuration() ||
+      options.commit_bytes <= 0) {
+    return absl::InvalidArgumentError(
+        "Commit interval and commit bytes must be positive");
+  }
+  std::unique_ptr<webrtc::Thread> commit_thread = webrtc::Thread::Create();
+  commit_thread->SetName("commit_thread", nullptr);
+  if (!commit_thread->Start()) {
+    return absl::InternalError("Failed to start commit thread");
+  }
+  std::shared_ptr<DurableOutputWriterPool> pool(new DurableOutputWriterPool(
+      options, std::move(provider), std::move(commit_thread)));
+  pool->commit_thread_->PostTask(
+      [pool = pool.get()] { pool->RunCommitLoop(); });
+  return pool;
+}
+
+DurableOutputWriterPool::DurableOutputWriterPool(
+    Options options, OutputWriterProvider provider,
+    std::unique_ptr<webrtc::Thread> commit_thread)
+    : options_(options),
+      provider_(std::move(provider)),
+      commit_thread_(std::move(commit_thread)) {}
+
+DurableOutputWriterPool::~DurableOutputWriterPool() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopping_ = true;
+  }
+  // The commit loop makes a final commit before returning.
+  commit_thread_->Stop();
+
+  Stats stats = GetStats();
+  LOG(INFO) << "Committed " << stats.committed_bytes << " bytes in "
+            << stats.commits << " commits of " << stats.file_syncs
+            << " file syncs (" << stats.failed_syncs
+            << " failed); commits took " << stats.total_commit_time
+            << " (max " << stats.max_commit_time
+            << ", max file sync " << stats.max_file_sync_time
+            << "); data was unsynced for at most " << stats.max_unsynced_time;
+}
+
+std::unique_ptr<OutputWriterInterface> DurableOutputWriterPool::CreateWriter(
+    absl::string_view file_name) {
+  std::unique_ptr<OutputWriterInterface> output;
+  {
+    absl::MutexLock lock(&provider_mutex_);
+    output = provider_(file_name);
+  }
+  // Linux syncs a file's data through any of its descriptors, so a read-only
+  // descriptor is enough, and works whichever way `output` writes the file.
+  int fd = open(std::string(file_name).c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG(ERROR) << "Failed to open file for syncing: " << file_name << ": "
+               << strerror(errno);
+    return std::make_unique<DurableOutputFile>(shared_from_this(),
+                                               std::move(output), nullptr);
+  }
+  auto file = std::make_shared<SyncedFile>(
+      SyncedFile{.file_name = std::string(file_name), .fd = fd});
+  {
+    absl::MutexLock lock(&mutex_);
+    files_.push_back(file);
+  }
+  return std::make_unique<DurableOutputFile>(
+      shared_from_this(), std::move(output), std::move(file));
+}
+
+void DurableOutputWriterPool::Commit() {
+  absl::MutexLock commit_lock(&commit_mutex_);
+
+  // Files to sync, and whether each was closed when the commit started.
+  std::vector<std::pair<std::shared_ptr<SyncedFile>, bool>> files;
+  int64_t committed_bytes = 0;
+  absl::Time first_unsynced_write;
+  {
+    absl::MutexLock lock(&mutex_);
+    for (const std::shared_ptr<SyncedFile>& file : files_) {
+      // Closing a writer may flush data that was never reported as written,
+      // so closed files are always synced once more.
+      if (file->unsynced_bytes > 0 || file->closed) {
+        files.emplace_back(file, file->closed);
+        committed_bytes += file->unsynced_bytes;
+        file->unsynced_bytes = 0;
+      }
+    }
+    files_.erase(std::remove_if(files_.begin(), files_.end(),
+                                [](const std::shared_ptr<SyncedFile>& file) {
+                                  return file->closed;
+                                }),
+                 files_.end());
+    unsynced_bytes_ = 0;
+    first_unsynced_write = first_unsynced_write_;
+    first_unsynced_write_ = absl::InfiniteFuture();
+  }
+  if (files.empty()) {
+    return;
+  }
+
+  absl::Time commit_start = absl::Now();
+  absl::Duration max_file_sync_time;
+  int failed_syncs = 0;
+  for (const auto& [file, closed] : files) {
+    absl::Time sync_start = absl::Now();
+    if (fdatasync(file->fd) != 0) {
+      LOG(ERROR) << "Failed to sync file: " << file->file_name << ": "
+                 << strerror(errno);
+      failed_syncs++;
+    }
+    max_file_sync_time =
+        std::max(max_file_sync_time, absl::Now() - sync_start);
+    if (closed) {
+      close(file->fd);
+    }
+  }
+  absl::Time commit_end = absl::Now();
+
+  absl::MutexLock lock(&mutex_);
+  stats_.commits++;
+  stats_.file_syncs += files.size();
+  stats_.failed_syncs += failed_syncs;
+  stats_.committed_bytes += committed_bytes;
+  stats_.total_commit_time += commit_end - commit_start;
+  stats_.max_commit_time =
+      std::max(stats_.max_commit_time, commit_end - commit_start);
+  stats_.max_file_sync_time =
+      std::max(stats_.max_file_sync_time, max_file_sync_time);
+  if (first_unsynced_write != absl::InfiniteFuture()) {
+    stats_.max_unsynced_time =
+        std::max(stats_.max_unsynced_time, commit_end - first_unsynced_write);
+  }
+}
+
+DurableOutputWriterPool::Stats DurableOutputWriterPool::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void DurableOutputWriterPool::RunCommitLoop() {
+  while (true) {
+    bool stopping;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.AwaitWithTimeout(
+          absl::Condition(this, &DurableOutputWriterPool::CommitDue),
+          options_.commit_interval);
+      stopping = stopping_;
+    }
+    Commit();
+    if (stopping) {
+      return;
+    }
+  }
+}
+
+void DurableOutputWriterPool::RecordWrite(SyncedFile& file, int64_t size) {
+  absl::MutexLock lock(&mutex_);
+  if (first_unsynced_write_ == absl::InfiniteFuture()) {
+    first_unsynced_write_ = absl::Now();
+  }
+  file.unsynced_bytes += size;
+  unsynced_bytes_ += size;
+}
+
+void DurableOutputWriterPool::CloseFile(SyncedFile& file) {
+  absl::MutexLock lock(&mutex_);
+  file.closed = true;
+}
+
+DurableOutputFile::~DurableOutputFile() { Close(); }
+
+void DurableOutputFile::Write(const char* content, std::streamsize size) {
+  if (output_ == nullptr) {
+    return;
+  }
+  output_->Write(content, size);
+  if (file_ != nullptr) {
+    pool_->RecordWrite(*file_, size);
+  }
+}
+
+void DurableOutputFile::WriteChunks(
+    absl::Span<const absl::Span<const char>> chunks) {
+  if (output_ == nullptr) {
+    return;
+  }
+  output_->WriteChunks(chunks);
+  if (file_ != nullptr) {
+    int64_t size = 0;
+    for (absl::Span<const char> chunk : chunks) {
+      size += chunk.size();
+    }
+    pool_->RecordWrite(*file_, size);
+  }
+}
+
+void DurableOutputFile::Flush() {
+  if (output_ == nullptr) {
+    return;
+  }
+  output_->Flush();
+}
+
+void DurableOutputFile::Close() {
+  if (output_ == nullptr) {
+    return;
+  }
+  output_->Close();
+  output_ = nullptr;
+  if (file_ != nullptr) {
+    pool_->CloseFile(*file_);
+    file_ = nullptr;
+  }
+}
+
+OutputWriterProvider CreateDurableOutputFileProvider(
+    std::shared_ptr<DurableOutputWriterPool> pool) {
+  return [pool = std::move(pool)](absl::string_view file_name) {
+    return pool->CreateWriter(file_name);
+  };
+}
+
+}  // namespace media_api_samples
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_DURABLE_OUTPUT_FILE_H_
+#define CPP_SAMPLES_DURABLE_OUTPUT_FILE_H_
+
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "rtc_base/thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Makes the files written through another provider durable with group commits.
+//
+// Instead of syncing each file as it is written, a commit thread calls
+// `fdatasync` on every file with unsynced data at once, either every
+// `commit_interval` or as soon as `commit_bytes` have been written across all
+// files, whichever comes first. A crash therefore loses at most about that
+// much data, and a shorter interval or smaller threshold trades throughput for
+// less loss. Writers never wait for commits.
+//
+// Syncing covers the data that the wrapped writers have handed to the kernel.
+// Data still buffered by a writer, e.g. in a `BufferedOutputFile` buffer or an
+// in-flight asynchronous write, is covered by the commit after it reaches the
+// kernel. Closed files are synced once more before their descriptors are
+// released.
+//
+// This class is thread-safe.
+class DurableOutputWriterPool
+    : public std::enable_shared_from_this<DurableOutputWriterPool> {
+ public:
+  struct Options {
+    absl::Duration commit_interval = absl::Seconds(1);
+    // Bytes written across all files that trigger a commit before the
+    // interval has passed.
+    int64_t commit_bytes = 32 << 20;
+  };
+
+  struct Stats {
+    int64_t commits = 0;
+    int64_t file_syncs = 0;
+    int64_t failed_syncs = 0;
+    int64_t committed_bytes = 0;
+    // Time spent in commits, each of which syncs several files.
+    absl::Duration total_commit_time;
+    absl::Duration max_commit_time;
+    absl::Duration max_file_sync_time;
+    // Longest time from a write to the end of the commit that made it
+    // durable. This is the window in which a crash could have lost the write.
+    absl::Duration max_unsynced_time;
+  };
+
+  // Creates a pool making the files of `provider` durable.
+  static absl::StatusOr<std::shared_ptr<DurableOutputWriterPool>> Create(
+      Options options, OutputWriterProvider provider);
+
+  // Commits any unsynced data and stops the commit thread.
+  ~DurableOutputWriterPool();
+
+  // Opens `file_name` through the wrapped provider and returns a writer for
+  // it. If the file cannot be opened for syncing, data is still written but
+  // never synced.
+  std::unique_ptr<OutputWriterInterface> CreateWriter(
+      absl::string_view file_name);
+
+  // Syncs every file with unsynced data, and waits for the syncs.
+  void Commit();
+
+  Stats GetStats() const;
+
+ private:
+  friend class DurableOutputFile;
+
+  // A file registered for syncing.
+  struct SyncedFile {
+    std::string file_name;
+    // A read-only descriptor of the file, only used for syncing.
+    int fd;
+    int64_t unsynced_bytes = 0;
+    bool closed = false;
+  };
+
+  DurableOutputWriterPool(Options options, OutputWriterProvider provider,
+                          std::unique_ptr<webrtc::Thread> commit_thread);
+
+  void RunCommitLoop();
+  bool CommitDue() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return stopping_ || unsynced_bytes_ >= options_.commit_bytes;
+  }
+  void RecordWrite(SyncedFile& file, int64_t size);
+  void CloseFile(SyncedFile& file);
+
+  const Options options_;
+  // Providers are not required to be thread-safe.
+  absl::Mutex provider_mutex_;
+  OutputWriterProvider provider_ ABSL_GUARDED_BY(provider_mutex_);
+  std::unique_ptr<webrtc::Thread> commit_thread_;
+
+  // Only one commit runs at a time, so that each file is synced by one thread.
+  absl::Mutex commit_mutex_;
+
+  mutable absl::Mutex mutex_;
+  std::vector<std::shared_ptr<SyncedFile>> files_ ABSL_GUARDED_BY(mutex_);
+  // Bytes written across all files since the last commit.
+  int64_t unsynced_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Time of the earliest write not yet covered by a commit.
+  absl::Time first_unsynced_write_ ABSL_GUARDED_BY(mutex_) =
+      absl::InfiniteFuture();
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+// An output writer that forwards data to another writer and reports it to a
+// `DurableOutputWriterPool` for syncing.
+//
+// This class is not thread-safe.
+class DurableOutputFile : public OutputWriterInterface {
+ public:
+  DurableOutputFile(
+      std::shared_ptr<DurableOutputWriterPool> pool,
+      std::unique_ptr<OutputWriterInterface> output,
+      /*absl_nullable*/ std::shared_ptr<DurableOutputWriterPool::SyncedFile>
+          file)
+      : pool_(std::move(pool)),
+        output_(std::move(output)),
+        file_(std::move(file)) {}
+  ~DurableOutputFile() override;
+
+  void Write(const char* content, std::streamsize size) override;
+  void WriteChunks(absl::Span<const absl::Span<const char>> chunks) override;
+  // Flushes the wrapped writer. The data is synced by the next commit.
+  void Flush() override;
+  // Closes the wrapped writer. The file is synced by the next commit.
+  void Close() override;
+
+ private:
+  std::shared_ptr<DurableOutputWriterPool> pool_;
+  /*absl_nullable*/ std::unique_ptr<OutputWriterInterface> output_;
+  /*absl_nullable*/ std::shared_ptr<DurableOutputWriterPool::SyncedFile> file_;
+};
+
+// Returns a provider that creates `DurableOutputFile`s from `pool`.
+OutputWriterProvider CreateDurableOutputFileProvider(
+    std::shared_ptr<DurableOutputWriterPool> pool);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_DURABLE_OUTPUT_FILE_H_
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/durable_output_file.h"
+
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_file.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+std::string ReadFile(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+// Waits until `pool` has committed `bytes`, or a generous deadline passes.
+DurableOutputWriterPool::Stats WaitForCommittedBytes(
+    DurableOutputWriterPool& pool, int64_t bytes) {
+  absl::Time deadline = absl::Now() + absl::Seconds(10);
+  DurableOutputWriterPool::Stats stats = pool.GetStats();
+  while (stats.committed_bytes < bytes && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+    stats = pool.GetStats();
+  }
+  return stats;
+}
+
+TEST(DurableOutputFileTest, CommitsWhenBytesReachThreshold) {
+  std::string file_name = absl::StrCat(::testing::TempDir(), "durable_bytes");
+  absl::StatusOr<std::shared_ptr<DurableOutputWriterPool>> pool =
+      DurableOutputWriterPool::Create(
+          {.commit_interval = absl::InfiniteDuration(), .commit_bytes = 4},
+          CreateOutputFileProvider());
+  ASSERT_TRUE(pool.ok());
+
+  std::unique_ptr<OutputWriterInterface> writer =
+      (*pool)->CreateWriter(file_name);
+  writer->Write("abcd", 4);
+  DurableOutputWriterPool::Stats stats = WaitForCommittedBytes(**pool, 4);
+
+  EXPECT_GE(stats.commits, 1);
+  EXPECT_GE(stats.file_syncs, 1);
+  EXPECT_EQ(stats.failed_syncs, 0);
+  EXPECT_EQ(stats.committed_bytes, 4);
+  EXPECT_GE(stats.max_unsynced_time, stats.max_file_sync_time);
+  writer->Close();
+  EXPECT_EQ(ReadFile(file_name), "abcd");
+}
+
+TEST(DurableOutputFileTest, CommitsWhenIntervalPasses) {
+  std::string file_name =
+      absl::StrCat(::testing::TempDir(), "durable_interval");
+  absl::StatusOr<std::shared_ptr<DurableOutputWriterPool>> pool =
+      DurableOutputWriterPool::Create({.commit_interval = absl::Milliseconds(5),
+                                       .commit_bytes = int64_t{1} << 40},
+                                      CreateOutputFileProvider());
+  ASSERT_TRUE(pool.ok());
+
+  std::unique_ptr<OutputWriterInterface> writer =
+      (*pool)->CreateWriter(file_name);
+  writer->Write("ab", 2);
+  DurableOutputWriterPool::Stats stats = WaitForCommittedBytes(**pool, 2);
+
+  EXPECT_EQ(stats.committed_bytes, 2);
+  EXPECT_EQ(stats.failed_syncs, 0);
+}
+
+TEST(DurableOutputFileTest, CommitSyncsOnlyFilesWithUnsyncedData) {
+  absl::StatusOr<std::shared_ptr<DurableOutputWriterPool>> pool =
+      DurableOutputWriterPool::Create(
+          {.commit_interval = absl::InfiniteDuration(),
+           .commit_bytes = int64_t{1} << 40},
+          CreateOutputFileProvider());
+  ASSERT_TRUE(pool.ok());
+  std::unique_ptr<OutputWriterInterface> first_writer = (*pool)->CreateWriter(
+      absl::StrCat(::testing::TempDir(), "durable_first"));
+  std::unique_ptr<OutputWriterInterface> second_writer = (*pool)->CreateWriter(
+      absl::StrCat(::testing::TempDir(), "durable_second"));
+
+  first_writer->Write("abc", 3);
+  (*pool)->Commit();
+  // Nothing is left to sync.
+  (*pool)->Commit();
+
+  DurableOutputWriterPool::Stats stats = (*pool)->GetStats();
+  EXPECT_EQ(stats.commits, 1);
+  EXPECT_EQ(stats.file_syncs, 1);
+  EXPECT_EQ(stats.committed_bytes, 3);
+
+  // Closed files are synced once more, even without new writes.
+  first_writer->Close();
+  (*pool)->Commit();
+  stats = (*pool)->GetStats();
+  EXPECT_EQ(stats.commits, 2);
+  EXPECT_EQ(stats.file_syncs, 2);
+  EXPECT_EQ(stats.committed_bytes, 3);
+}
+
+TEST(DurableOutputFileTest, FailsWithNonPositiveOptions) {
+  absl::StatusOr<std::shared_ptr<DurableOutputWriterPool>> pool =
+      DurableOutputWriterPool::Create(
+          {.commit_interval = absl::ZeroDuration()},
+          CreateOutputFileProvider());
+  EXPECT_EQ(pool.status().code(), absl::StatusCode::kInvalidArgument);
+
+  pool = DurableOutputWriterPool::Create({.commit_bytes = 0},
+                                         CreateOutputFileProvider());
+  EXPECT_EQ(pool.status().code(), absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace media_api_samples
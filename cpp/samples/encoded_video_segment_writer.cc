@@ -0,0 +1,442 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/encoded_video_segment_writer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/video_segment_writer_interface.h"
+#include "api/environment/environment_factory.h"
+#include "api/scoped_refptr.h"
+#include "api/video/encoded_image.h"
+#include "api/video/video_bitrate_allocation.h"
+#include "api/video/video_frame.h"
+#include "api/video/video_frame_buffer.h"
+#include "api/video/video_frame_type.h"
+#include "api/video_codecs/scalability_mode.h"
+#include "api/video_codecs/sdp_video_format.h"
+#include "api/video_codecs/video_codec.h"
+#include "api/video_codecs/video_encoder.h"
+#include "api/video_codecs/video_encoder_factory_template.h"
+#include "api/video_codecs/video_encoder_factory_template_libaom_av1_adapter.h"
+#include "api/video_codecs/video_encoder_factory_template_libvpx_vp9_adapter.h"
+#include "rtc_base/thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+// IVF timestamps use the RTP video clock rate.
+constexpr int64_t kIvfTimebase = 90000;
+constexpr int kIvfFileHeaderSize = 32;
+constexpr int kIvfFrameHeaderSize = 12;
+// Lowest bitrate the rate controller may drop to, in kbps.
+constexpr int kMinBitrateKbps = 30;
+constexpr int kQpMax = 56;
+constexpr size_t kMaxPayloadSize = 1200;
+
+void PutLittleEndian(uint64_t value, int size, char* destination) {
+  for (int i = 0; i < size; ++i) {
+    destination[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+// Writes frames to an IVF file.
+//
+// The frame count in the IVF header is left as zero, since the output is not
+// seekable; decoders read frames until the end of the file.
+class IvfVideoSink : public EncodedVideoSinkInterface {
+ public:
+  IvfVideoSink(std::unique_ptr<OutputWriterInterface> output,
+               VideoEncoderPool::Codec codec, int width, int height)
+      : output_(std::move(output)),
+        codec_(codec),
+        width_(width),
+        height_(height) {}
+
+  void WriteFrame(absl::Span<const uint8_t> frame, absl::Time received_time,
+                  bool /*key_frame*/) override {
+    if (first_frame_time_ == absl::InfinitePast()) {
+      WriteFileHeader();
+      first_frame_time_ = received_time;
+    }
+    int64_t pts = absl::ToInt64Microseconds(received_time - first_frame_time_) *
+                  kIvfTimebase / 1000000;
+
+    char frame_header[kIvfFrameHeaderSize];
+    PutLittleEndian(frame.size(), 4, &frame_header[0]);
+    PutLittleEndian(pts, 8, &frame_header[4]);
+    absl::Span<const char> chunks[] = {
+        absl::Span<const char>(frame_header, sizeof(frame_header)),
+        absl::Span<const char>(reinterpret_cast<const char*>(frame.data()),
+                               frame.size())};
+    output_->WriteChunks(chunks);
+  }
+
+  void Close() override {
+    if (first_frame_time_ == absl::InfinitePast()) {
+      WriteFileHeader();
+    }
+    output_->Close();
+  }
+
+ private:
+  void WriteFileHeader() {
+    char header[kIvfFileHeaderSize] = {'D', 'K', 'I', 'F'};
+    PutLittleEndian(/*version=*/0, 2, &header[4]);
+    PutLittleEndian(kIvfFileHeaderSize, 2, &header[6]);
+    const char* fourcc =
+        codec_ == VideoEncoderPool::Codec::kVp9 ? "VP90" : "AV01";
+    std::copy(fourcc, fourcc + 4, &header[8]);
+    PutLittleEndian(width_, 2, &header[12]);
+    PutLittleEndian(height_, 2, &header[14]);
+    PutLittleEndian(kIvfTimebase, 4, &header[16]);
+    PutLittleEndian(/*timebase_numerator=*/1, 4, &header[20]);
+    // Bytes 24 to 31 hold the frame count and are reserved; both are left as
+    // zero.
+    output_->Write(header, sizeof(header));
+  }
+
+  std::unique_ptr<OutputWriterInterface> output_;
+  const VideoEncoderPool::Codec codec_;
+  const int width_;
+  const int height_;
+  absl::Time first_frame_time_ = absl::InfinitePast();
+};
+
+webrtc::VideoCodec CreateCodecSettings(const VideoEncoderPool::Options& options,
+                                       int width, int height) {
+  webrtc::VideoCodec codec;
+  codec.codecType = options.codec == VideoEncoderPool::Codec::kVp9
+                        ? webrtc::kVideoCodecVP9
+                        : webrtc::kVideoCodecAV1;
+  codec.width = width;
+  codec.height = height;
+  codec.startBitrate = options.target_bitrate_kbps;
+  codec.maxBitrate = options.target_bitrate_kbps;
+  codec.minBitrate = kMinBitrateKbps;
+  codec.maxFramerate = options.max_framerate;
+  codec.qpMax = kQpMax;
+  codec.mode = webrtc::VideoCodecMode::kRealtimeVideo;
+  codec.SetScalabilityMode(webrtc::ScalabilityMode::kL1T1);
+  codec.SetVideoEncoderComplexity(options.complexity);
+  // Recordings should keep every frame; the queue limit handles overload.
+  codec.SetFrameDropEnabled(false);
+  if (options.codec == VideoEncoderPool::Codec::kVp9) {
+    *codec.VP9() = webrtc::VideoEncoder::GetDefaultVp9Settings();
+    codec.VP9()->numberOfSpatialLayers = 1;
+    codec.VP9()->numberOfTemporalLayers = 1;
+  }
+  webrtc::SpatialLayer& layer = codec.spatialLayers[0];
+  layer.width = width;
+  layer.height = height;
+  layer.maxFramerate = options.max_framerate;
+  layer.numberOfTemporalLayers = 1;
+  layer.maxBitrate = options.target_bitrate_kbps;
+  layer.targetBitrate = options.target_bitrate_kbps;
+  layer.minBitrate = kMinBitrateKbps;
+  layer.qpMax = kQpMax;
+  layer.active = true;
+  return codec;
+}
+
+}  // namespace
+
+double VideoEncoderPool::Stats::EncodedFramesPerCoreSecond(
+    int cores_per_encoder) const {
+  double core_seconds = absl::ToDoubleSeconds(encode_time) * cores_per_encoder;
+  return core_seconds > 0 ? encoded_frames / core_seconds : 0;
+}
+
+absl::StatusOr<std::shared_ptr<VideoEncoderPool>> VideoEncoderPool::Create(
+    Options options) {
+  if (options.target_bitrate_kbps <= 0 || options.max_framerate <= 0 ||
+      options.key_frame_interval <= 0 || options.encoder_thread_count <= 0 ||
+      options.cores_per_encoder <= 0 || options.max_queued_frames <= 0) {
+    return absl::InvalidArgumentError(
+        "Video encoder options must all be positive");
+  }
+
+  std::vector<std::unique_ptr<webrtc::Thread>> threads;
+  for (int i = 0; i < options.encoder_thread_count; ++i) {
+    std::unique_ptr<webrtc::Thread> thread = webrtc::Thread::Create();
+    thread->SetName("video_encoder_thread", nullptr);
+    if (!thread->Start()) {
+      return absl::InternalError("Failed to start video encoder thread");
+    }
+    threads.push_back(std::move(thread));
+  }
+  return absl::WrapUnique(
+      new VideoEncoderPool(std::move(options), std::move(threads)));
+}
+
+VideoEncoderPool::VideoEncoderPool(
+    Options options, std::vector<std::unique_ptr<webrtc::Thread>> threads)
+    : options_(std::move(options)),
+      env_(webrtc::CreateEnvironment()),
+      encoder_factory_(std::make_unique<webrtc::VideoEncoderFactoryTemplate<
+                           webrtc::LibvpxVp9EncoderTemplateAdapter,
+                           webrtc::LibaomAv1EncoderTemplateAdapter>>()),
+      encoder_threads_(std::move(threads)) {}
+
+VideoEncoderPool::~VideoEncoderPool() {
+  Stats stats = GetStats();
+  LOG(INFO) << "Encoded " << stats.encoded_frames << " video frames ("
+            << stats.encoded_bytes << " bytes) in " << stats.encode_time << "; "
+            << stats.EncodedFramesPerCoreSecond(options_.cores_per_encoder)
+            << " fps per core; dropped " << stats.dropped_frames << " frames";
+}
+
+std::unique_ptr<VideoSegmentWriterInterface> VideoEncoderPool::CreateWriter(
+    std::unique_ptr<OutputWriterInterface> output, int width, int height) {
+  return CreateWriter(std::make_unique<IvfVideoSink>(std::move(output),
+                                                     options_.codec, width,
+                                                     height),
+                      width, height);
+}
+
+std::unique_ptr<VideoSegmentWriterInterface> VideoEncoderPool::CreateWriter(
+    std::unique_ptr<EncodedVideoSinkInterface> sink, int width, int height) {
+  webrtc::Thread* thread;
+  {
+    absl::MutexLock lock(&mutex_);
+    thread = encoder_threads_[next_thread_].get();
+    next_thread_ = (next_thread_ + 1) % encoder_threads_.size();
+  }
+  return std::make_unique<EncodedVideoSegmentWriter>(
+      shared_from_this(), *thread, std::move(sink), width, height);
+}
+
+VideoEncoderPool::Stats VideoEncoderPool::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void VideoEncoderPool::RecordEncodedFrame(absl::Duration encode_time) {
+  absl::MutexLock lock(&mutex_);
+  stats_.encoded_frames++;
+  stats_.encode_time += encode_time;
+}
+
+void VideoEncoderPool::RecordEncodedBytes(int64_t size) {
+  absl::MutexLock lock(&mutex_);
+  stats_.encoded_bytes += size;
+}
+
+void VideoEncoderPool::RecordDroppedFrame() {
+  absl::MutexLock lock(&mutex_);
+  stats_.dropped_frames++;
+}
+
+EncodedVideoSegmentWriter::EncodedVideoSegmentWriter(
+    std::shared_ptr<VideoEncoderPool> pool, webrtc::Thread& encoder_thread,
+    std::unique_ptr<EncodedVideoSinkInterface> sink, int width, int height)
+    : pool_(std::move(pool)),
+      encoder_thread_(encoder_thread),
+      width_(width),
+      height_(height),
+      sink_(std::move(sink)) {
+  encoder_thread_.PostTask([this] { InitEncoder(); });
+}
+
+EncodedVideoSegmentWriter::~EncodedVideoSegmentWriter() {
+  if (!closed_) {
+    Close();
+  }
+}
+
+void EncodedVideoSegmentWriter::WriteFrame(
+    webrtc::scoped_refptr<webrtc::I420BufferInterface> frame,
+    absl::Time received_time) {
+  DCHECK(!closed_);
+  DCHECK_EQ(frame->width(), width_);
+  DCHECK_EQ(frame->height(), height_);
+
+  if (queued_frames_.load(std::memory_order_relaxed) >=
+      pool_->options().max_queued_frames) {
+    pool_->RecordDroppedFrame();
+    return;
+  }
+  queued_frames_.fetch_add(1, std::memory_order_relaxed);
+  // The frame buffer is reference counted, so handing it to the encoder thread
+  // does not copy it.
+  encoder_thread_.PostTask(
+      [this, frame = std::move(frame), received_time]() mutable {
+        EncodeFrame(std::move(frame), received_time);
+        queued_frames_.fetch_sub(1, std::memory_order_relaxed);
+      });
+}
+
+void EncodedVideoSegmentWriter::Close() {
+  DCHECK(!closed_);
+  closed_ = true;
+  // Blocking here guarantees that all tasks referencing this writer have run,
+  // and that the output is closed before the segment is renamed.
+  encoder_thread_.BlockingCall([this] { ReleaseEncoder(); });
+}
+
+void EncodedVideoSegmentWriter::StartClose(
+    std::unique_ptr<VideoSegmentWriterInterface> self,
+    absl::AnyInvocable<void() &&> on_closed) {
+  DCHECK_EQ(self.get(), this);
+  DCHECK(!closed_);
+  closed_ = true;
+  // Tasks run in order, so this runs after every queued frame is encoded. The
+  // task owns the writer until then.
+  encoder_thread_.PostTask([this, self = std::move(self),
+                            on_closed = std::move(on_closed)]() mutable {
+    ReleaseEncoder();
+    self.reset();
+    std::move(on_closed)();
+  });
+}
+
+void EncodedVideoSegmentWriter::InitEncoder() {
+  DCHECK(encoder_thread_.IsCurrent());
+
+  const VideoEncoderPool::Options& options = pool_->options();
+  webrtc::SdpVideoFormat format = options.codec == VideoEncoderPool::Codec::kVp9
+                                      ? webrtc::SdpVideoFormat::VP9Profile0()
+                                      : webrtc::SdpVideoFormat::AV1Profile0();
+  std::unique_ptr<webrtc::VideoEncoder> encoder =
+      pool_->encoder_factory_->Create(pool_->env_, format);
+  if (encoder == nullptr) {
+    LOG(ERROR) << "Failed to create " << format.name << " encoder";
+    return;
+  }
+
+  webrtc::VideoCodec codec = CreateCodecSettings(options, width_, height_);
+  webrtc::VideoEncoder::Settings settings(
+      webrtc::VideoEncoder::Capabilities(/*loss_notification=*/false),
+      options.cores_per_encoder, kMaxPayloadSize);
+  if (int32_t result = encoder->InitEncode(&codec, settings);
+      result != WEBRTC_VIDEO_CODEC_OK) {
+    LOG(ERROR) << "Failed to initialize " << format.name
+               << " encoder: " << result;
+    return;
+  }
+  encoder->RegisterEncodeCompleteCallback(this);
+
+  webrtc::VideoBitrateAllocation allocation;
+  allocation.SetBitrate(/*spatial_index=*/0, /*temporal_index=*/0,
+                        options.target_bitrate_kbps * 1000);
+  encoder->SetRates(webrtc::VideoEncoder::RateControlParameters(
+      allocation, static_cast<double>(options.max_framerate)));
+  encoder_ = std::move(encoder);
+}
+
+void EncodedVideoSegmentWriter::EncodeFrame(
+    webrtc::scoped_refptr<webrtc::I420BufferInterface> frame,
+    absl::Time received_time) {
+  DCHECK(encoder_thread_.IsCurrent());
+
+  if (encoder_ == nullptr) {
+    pool_->RecordDroppedFrame();
+    return;
+  }
+
+  if (first_frame_time_ == absl::InfinitePast()) {
+    first_frame_time_ = received_time;
+  }
+  current_received_time_ = received_time;
+  int64_t rtp_timestamp =
+      absl::ToInt64Microseconds(received_time - first_frame_time_) *
+      kIvfTimebase / 1000000;
+  bool key_frame = frame_count_ % pool_->options().key_frame_interval == 0;
+  frame_count_++;
+
+  webrtc::VideoFrame video_frame =
+      webrtc::VideoFrame::Builder()
+          .set_video_frame_buffer(std::move(frame))
+          .set_rtp_timestamp(static_cast<uint32_t>(rtp_timestamp))
+          .set_timestamp_us(absl::ToUnixMicros(received_time))
+          .build();
+  std::vector<webrtc::VideoFrameType> frame_types = {
+      key_frame ? webrtc::VideoFrameType::kVideoFrameKey
+                : webrtc::VideoFrameType::kVideoFrameDelta};
+
+  absl::Time start = absl::Now();
+  int32_t result = encoder_->Encode(video_frame, &frame_types);
+  absl::Duration encode_time = absl::Now() - start;
+  encode_time_ += encode_time;
+  if (result != WEBRTC_VIDEO_CODEC_OK) {
+    LOG(ERROR) << "Failed to encode video frame: " << result;
+    pool_->RecordDroppedFrame();
+    return;
+  }
+  // Encoded frames were delivered synchronously through `OnEncodedImage`.
+  pool_->RecordEncodedFrame(encode_time);
+}
+
+webrtc::EncodedImageCallback::Result EncodedVideoSegmentWriter::OnEncodedImage(
+    const webrtc::EncodedImage& encoded_image,
+    const webrtc::CodecSpecificInfo* /*absl_nullable*/ codec_specific_info) {
+  DCHECK(encoder_thread_.IsCurrent());
+
+  sink_->WriteFrame(
+      absl::MakeConstSpan(encoded_image.data(), encoded_image.size()),
+      current_received_time_,
+      encoded_image._frameType == webrtc::VideoFrameType::kVideoFrameKey);
+  pool_->RecordEncodedBytes(encoded_image.size());
+  return Result(Result::OK);
+}
+
+void EncodedVideoSegmentWriter::ReleaseEncoder() {
+  DCHECK(encoder_thread_.IsCurrent());
+
+  if (encoder_ != nullptr) {
+    encoder_->Release();
+    encoder_.reset();
+  }
+  sink_->Close();
+
+  double core_seconds =
+      absl::ToDoubleSeconds(encode_time_) * pool_->options().cores_per_encoder;
+  LOG(INFO) << "Closed " << width_ << "x" << height_ << " video segment with "
+            << frame_count_ << " frames; "
+            << (core_seconds > 0 ? frame_count_ / core_seconds : 0.0)
+            << " fps per core";
+}
+
+VideoSegmentFormat CreateEncodedVideoSegmentFormat(
+    std::shared_ptr<VideoEncoderPool> pool) {
+  return {.file_extension = "ivf",
+          .create_writer = [pool = std::move(pool)](
+                               std::unique_ptr<OutputWriterInterface> output,
+                               int width, int height) {
+            return pool->CreateWriter(std::move(output), width, height);
+          }};
+}
+
+}  // namespace media_api_samples
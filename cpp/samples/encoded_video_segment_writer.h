@@ -0,0 +1,205 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_ENCODED_VIDEO_SEGMENT_WRITER_H_
+#define CPP_SAMPLES_ENCODED_VIDEO_SEGMENT_WRITER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/video_segment_writer_interface.h"
+#include "api/environment/environment.h"
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame_buffer.h"
+#include "api/video_codecs/video_codec.h"
+#include "api/video_codecs/video_encoder.h"
+#include "api/video_codecs/video_encoder_factory.h"
+#include "rtc_base/thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Stores the frames compressed by an `EncodedVideoSegmentWriter` in a
+// container.
+//
+// Methods are called on the segment's encoder thread.
+class EncodedVideoSinkInterface {
+ public:
+  virtual ~EncodedVideoSinkInterface() = default;
+
+  // `received_time` is when the collector received the uncompressed frame.
+  virtual void WriteFrame(absl::Span<const uint8_t> frame,
+                          absl::Time received_time, bool key_frame) = 0;
+  // Called once, after the last frame.
+  virtual void Close() = 0;
+};
+
+// A set of encoder threads that compress video segments with VP9 or AV1.
+//
+// Each segment is pinned to one encoder thread, so that its frames are encoded
+// in order without blocking the collector thread. Segments are assigned to
+// threads round-robin.
+//
+// This class is thread-safe.
+class VideoEncoderPool : public std::enable_shared_from_this<VideoEncoderPool> {
+ public:
+  enum class Codec { kVp9, kAv1 };
+
+  struct Options {
+    Codec codec = Codec::kVp9;
+    int target_bitrate_kbps = 500;
+    int max_framerate = 30;
+    // Lower complexity encodes faster at the cost of quality.
+    webrtc::VideoCodecComplexity complexity =
+        webrtc::VideoCodecComplexity::kComplexityNormal;
+    // Number of frames between forced key frames, so that segments can be
+    // seeked.
+    int key_frame_interval = 300;
+    int encoder_thread_count = 1;
+    // Number of cores each encoder may use.
+    int cores_per_encoder = 1;
+    // Frames received while this many frames of the same segment are waiting
+    // to be encoded are dropped, rather than letting the backlog grow without
+    // bound.
+    int max_queued_frames = 30;
+  };
+
+  struct Stats {
+    int64_t encoded_frames = 0;
+    int64_t dropped_frames = 0;
+    int64_t encoded_bytes = 0;
+    // Time spent in the encoder, summed over all segments.
+    absl::Duration encode_time;
+
+    // Returns the number of frames encoded per second of encoder time on a
+    // single core. This is the number to divide a host's expected frame rate
+    // by to size it.
+    double EncodedFramesPerCoreSecond(int cores_per_encoder) const;
+  };
+
+  static absl::StatusOr<std::shared_ptr<VideoEncoderPool>> Create(
+      Options options);
+
+  // Logs the pool's stats.
+  ~VideoEncoderPool();
+
+  // Returns a writer that encodes `width`x`height` frames into an IVF file
+  // written to `output`.
+  std::unique_ptr<VideoSegmentWriterInterface> CreateWriter(
+      std::unique_ptr<OutputWriterInterface> output, int width, int height);
+  // Returns a writer that encodes `width`x`height` frames and hands them to
+  // `sink`, for containers other than IVF.
+  std::unique_ptr<VideoSegmentWriterInterface> CreateWriter(
+      std::unique_ptr<EncodedVideoSinkInterface> sink, int width, int height);
+
+  const Options& options() const { return options_; }
+  Stats GetStats() const;
+
+ private:
+  friend class EncodedVideoSegmentWriter;
+
+  VideoEncoderPool(Options options,
+                   std::vector<std::unique_ptr<webrtc::Thread>> threads);
+
+  void RecordEncodedFrame(absl::Duration encode_time);
+  void RecordEncodedBytes(int64_t size);
+  void RecordDroppedFrame();
+
+  const Options options_;
+  const webrtc::Environment env_;
+  const std::unique_ptr<webrtc::VideoEncoderFactory> encoder_factory_;
+  std::vector<std::unique_ptr<webrtc::Thread>> encoder_threads_;
+
+  mutable absl::Mutex mutex_;
+  int next_thread_ ABSL_GUARDED_BY(mutex_) = 0;
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+// A video segment writer that encodes frames on one of a `VideoEncoderPool`'s
+// threads and hands them to a sink.
+//
+// This class is not thread-safe.
+class EncodedVideoSegmentWriter : public VideoSegmentWriterInterface,
+                                  public webrtc::EncodedImageCallback {
+ public:
+  EncodedVideoSegmentWriter(std::shared_ptr<VideoEncoderPool> pool,
+                            webrtc::Thread& encoder_thread,
+                            std::unique_ptr<EncodedVideoSinkInterface> sink,
+                            int width, int height);
+  ~EncodedVideoSegmentWriter() override;
+
+  void WriteFrame(webrtc::scoped_refptr<webrtc::I420BufferInterface> frame,
+                  absl::Time received_time) override;
+  // Waits for queued frames to be encoded, then closes the sink. Prefer
+  // `CloseAsync`, which encodes them without blocking the caller.
+  void Close() override;
+
+  // webrtc::EncodedImageCallback implementation. Called on the encoder thread.
+  Result OnEncodedImage(
+      const webrtc::EncodedImage& encoded_image,
+      const webrtc::CodecSpecificInfo* /*absl_nullable*/ codec_specific_info)
+      override;
+
+ protected:
+  // Closes the sink on the encoder thread once queued frames are encoded.
+  void StartClose(std::unique_ptr<VideoSegmentWriterInterface> self,
+                  absl::AnyInvocable<void() &&> on_closed) override;
+
+ private:
+  // The following methods are called on the encoder thread.
+  void InitEncoder();
+  void EncodeFrame(webrtc::scoped_refptr<webrtc::I420BufferInterface> frame,
+                   absl::Time received_time);
+  void ReleaseEncoder();
+
+  std::shared_ptr<VideoEncoderPool> pool_;
+  webrtc::Thread& encoder_thread_;
+  const int width_;
+  const int height_;
+  bool closed_ = false;
+  // Number of frames posted to the encoder thread that have not been encoded
+  // yet.
+  std::atomic<int> queued_frames_ = 0;
+
+  // The following fields are only accessed on the encoder thread.
+  std::unique_ptr<EncodedVideoSinkInterface> sink_;
+  /*absl_nullable*/ std::unique_ptr<webrtc::VideoEncoder> encoder_;
+  absl::Time first_frame_time_ = absl::InfinitePast();
+  int64_t frame_count_ = 0;
+  // Time the frame being encoded was received.
+  absl::Time current_received_time_;
+  absl::Duration encode_time_;
+};
+
+// Returns a format that writes `.ivf` segments encoded by `pool`.
+VideoSegmentFormat CreateEncodedVideoSegmentFormat(
+    std::shared_ptr<VideoEncoderPool> pool);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_ENCODED_VIDEO_SEGMENT_WRITER_H_
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/encoded_video_segment_writer.h"
+
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/testing/string_output_writer.h"
+#include "meet_clients/samples/video_segment_writer_interface.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+constexpr int kWidth = 64;
+constexpr int kHeight = 48;
+constexpr int kIvfFileHeaderSize = 32;
+constexpr int kIvfFrameHeaderSize = 12;
+
+uint64_t ReadLittleEndian(const std::string& data, size_t offset, int size) {
+  uint64_t value = 0;
+  for (int i = 0; i < size; ++i) {
+    value |= static_cast<uint64_t>(static_cast<uint8_t>(data[offset + i]))
+             << (8 * i);
+  }
+  return value;
+}
+
+webrtc::scoped_refptr<webrtc::I420BufferInterface> CreateFrame(int index) {
+  webrtc::scoped_refptr<webrtc::I420Buffer> buffer =
+      webrtc::I420Buffer::Create(kWidth, kHeight);
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      buffer->MutableDataY()[y * buffer->StrideY() + x] = x + y + index;
+    }
+  }
+  for (int y = 0; y < buffer->ChromaHeight(); ++y) {
+    for (int x = 0; x < buffer->ChromaWidth(); ++x) {
+      buffer->MutableDataU()[y * buffer->StrideU() + x] = 128;
+      buffer->MutableDataV()[y * buffer->StrideV() + x] = 128;
+    }
+  }
+  return buffer;
+}
+
+class EncodedVideoSegmentWriterTest
+    : public ::testing::TestWithParam<VideoEncoderPool::Codec> {};
+
+TEST_P(EncodedVideoSegmentWriterTest, WritesIvfFileWithEveryFrame) {
+  constexpr int kFrameCount = 10;
+  absl::StatusOr<std::shared_ptr<VideoEncoderPool>> pool =
+      VideoEncoderPool::Create(
+          {.codec = GetParam(), .key_frame_interval = 5});
+  ASSERT_TRUE(pool.ok()) << pool.status();
+  std::string output;
+  bool closed = false;
+  std::unique_ptr<VideoSegmentWriterInterface> writer = (*pool)->CreateWriter(
+      std::make_unique<StringOutputWriter>(output, closed), kWidth, kHeight);
+
+  for (int i = 0; i < kFrameCount; ++i) {
+    writer->WriteFrame(CreateFrame(i),
+                       absl::UnixEpoch() + i * absl::Milliseconds(33));
+  }
+  writer->Close();
+
+  EXPECT_TRUE(closed);
+  ASSERT_GE(output.size(), kIvfFileHeaderSize);
+  EXPECT_EQ(output.substr(0, 4), "DKIF");
+  EXPECT_EQ(output.substr(8, 4),
+            GetParam() == VideoEncoderPool::Codec::kVp9 ? "VP90" : "AV01");
+  EXPECT_EQ(ReadLittleEndian(output, 12, 2), kWidth);
+  EXPECT_EQ(ReadLittleEndian(output, 14, 2), kHeight);
+  EXPECT_EQ(ReadLittleEndian(output, 16, 4), 90000);
+  EXPECT_EQ(ReadLittleEndian(output, 20, 4), 1);
+
+  int frame_count = 0;
+  int64_t frame_bytes = 0;
+  size_t offset = kIvfFileHeaderSize;
+  while (offset + kIvfFrameHeaderSize <= output.size()) {
+    uint64_t size = ReadLittleEndian(output, offset, 4);
+    uint64_t pts = ReadLittleEndian(output, offset + 4, 8);
+    // 33 ms at 90 kHz.
+    EXPECT_EQ(pts, frame_count * 2970);
+    offset += kIvfFrameHeaderSize + size;
+    frame_bytes += size;
+    frame_count++;
+  }
+  EXPECT_EQ(offset, output.size());
+  EXPECT_EQ(frame_count, kFrameCount);
+
+  VideoEncoderPool::Stats stats = (*pool)->GetStats();
+  EXPECT_EQ(stats.encoded_frames, kFrameCount);
+  EXPECT_EQ(stats.dropped_frames, 0);
+  EXPECT_EQ(stats.encoded_bytes, frame_bytes);
+  EXPECT_GT(stats.EncodedFramesPerCoreSecond(/*cores_per_encoder=*/1), 0);
+}
+
+TEST_P(EncodedVideoSegmentWriterTest, ClosesOutputOnDestruction) {
+  absl::StatusOr<std::shared_ptr<VideoEncoderPool>> pool =
+      VideoEncoderPool::Create({.codec = GetParam()});
+  ASSERT_TRUE(pool.ok()) << pool.status();
+  std::string output;
+  bool closed = false;
+  VideoSegmentFormat format = CreateEncodedVideoSegmentFormat(*pool);
+
+  format.create_writer(std::make_unique<StringOutputWriter>(output, closed),
+                       kWidth, kHeight)
+      ->WriteFrame(CreateFrame(0), absl::UnixEpoch());
+
+  EXPECT_EQ(format.file_extension, "ivf");
+  EXPECT_TRUE(closed);
+  EXPECT_EQ((*pool)->GetStats().encoded_frames, 1);
+}
+
+TEST_P(EncodedVideoSegmentWriterTest, ClosesAsynchronously) {
+  constexpr int kFrameCount = 5;
+  absl::StatusOr<std::shared_ptr<VideoEncoderPool>> pool =
+      VideoEncoderPool::Create({.codec = GetParam()});
+  ASSERT_TRUE(pool.ok()) << pool.status();
+  std::string output;
+  bool closed = false;
+  std::unique_ptr<VideoSegmentWriterInterface> writer = (*pool)->CreateWriter(
+      std::make_unique<StringOutputWriter>(output, closed), kWidth, kHeight);
+  for (int i = 0; i < kFrameCount; ++i) {
+    writer->WriteFrame(CreateFrame(i),
+                       absl::UnixEpoch() + i * absl::Milliseconds(33));
+  }
+
+  absl::Notification on_closed;
+  VideoSegmentWriterInterface::CloseAsync(std::move(writer),
+                                          [&on_closed] { on_closed.Notify(); });
+  on_closed.WaitForNotification();
+
+  EXPECT_TRUE(closed);
+  EXPECT_EQ((*pool)->GetStats().encoded_frames, kFrameCount);
+}
+
+INSTANTIATE_TEST_SUITE_P(Codecs, EncodedVideoSegmentWriterTest,
+                         ::testing::Values(VideoEncoderPool::Codec::kVp9,
+                                           VideoEncoderPool::Codec::kAv1));
+
+TEST(VideoEncoderPoolTest, RejectsNonPositiveOptions) {
+  EXPECT_FALSE(VideoEncoderPool::Create({.target_bitrate_kbps = 0}).ok());
+  EXPECT_FALSE(VideoEncoderPool::Create({.encoder_thread_count = 0}).ok());
+  EXPECT_FALSE(VideoEncoderPool::Create({.max_queued_frames = 0}).ok());
+}
+
+}  // namespace
+}  // namespace media_api_samples
@@ -0,0 +1,217 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Benchmarks for writing and scanning the event log in the CSV and binary
+// formats.
+//
+// The events model a large conference, in which participants join, update
+// their media entries as they mute and unmute, and leave. Writing measures the
+// cost to the collector thread of logging an event, and scanning the cost to an
+// analytics tool of reading every field of every event.
+
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/base/nullability.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/binary_event_log.h"
+#include "meet_clients/samples/csv_event_log_writer.h"
+#include "meet_clients/samples/event_log_writer_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/testing/string_output_writer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+constexpr int kParticipants = 100;
+constexpr int kEventsPerParticipant = 20;
+
+// Events whose strings and contributing sources are owned by the test data.
+struct TestEvents {
+  std::vector<std::string> display_names;
+  std::vector<std::string> participant_keys;
+  std::vector<std::string> session_names;
+  std::vector<std::vector<uint32_t>> video_csrcs;
+  std::vector<EventLogEvent> events;
+};
+
+const TestEvents& GetTestEvents() {
+  static const TestEvents* const test_events = [] {
+    auto* test_events = new TestEvents();
+    for (int i = 0; i < kParticipants; ++i) {
+      test_events->display_names.push_back(absl::StrCat("Participant ", i));
+      test_events->participant_keys.push_back(
+          absl::StrCat("participant_key_", 1000000 + i));
+      test_events->session_names.push_back(
+          absl::StrCat("media_entry_key_", 2000000 + i));
+      test_events->video_csrcs.push_back(
+          {static_cast<uint32_t>(3000000 + 2 * i),
+           static_cast<uint32_t>(3000001 + 2 * i)});
+    }
+
+    absl::Time time = absl::FromUnixSeconds(1700000000);
+    for (int round = 0; round < kEventsPerParticipant; ++round) {
+      for (int i = 0; i < kParticipants; ++i) {
+        time += absl::Milliseconds(37);
+        EventLogEvent event = {.time = time};
+        if (round == 0) {
+          event.type = EventLogEventType::kParticipantUpdated;
+          event.resource_id = 10000 + i;
+          event.display_name = test_events->display_names[i];
+          event.participant_key = test_events->participant_keys[i];
+        } else if (round == kEventsPerParticipant - 1) {
+          event.type = i % 2 == 0 ? EventLogEventType::kMediaEntryDeleted
+                                  : EventLogEventType::kParticipantDeleted;
+          event.resource_id = i % 2 == 0 ? 20000 + i : 10000 + i;
+        } else {
+          event.type = EventLogEventType::kMediaEntryUpdated;
+          event.resource_id = 20000 + i;
+          event.participant_key = test_events->participant_keys[i];
+          event.participant_session_name = test_events->session_names[i];
+          event.audio_csrc = 4000000 + i;
+          event.video_csrcs = test_events->video_csrcs[i];
+          event.audio_muted = round % 2 == 0;
+          event.video_muted = round % 3 == 0;
+        }
+        test_events->events.push_back(event);
+      }
+    }
+    return test_events;
+  }();
+  return *test_events;
+}
+
+template <typename Writer>
+std::string WriteEventLog() {
+  std::string log;
+  Writer writer(std::make_unique<StringOutputWriter>(log));
+  for (const EventLogEvent& event : GetTestEvents().events) {
+    writer.Write(event);
+  }
+  writer.Close();
+  return log;
+}
+
+template <typename Writer>
+void BM_WriteEventLog(benchmark::State& state) {
+  const std::vector<EventLogEvent>& events = GetTestEvents().events;
+  // The log is collected in memory, so that the benchmark does not measure
+  // file I/O.
+  std::string log;
+  for (auto _ : state) {
+    log.clear();
+    Writer writer(std::make_unique<StringOutputWriter>(log));
+    for (const EventLogEvent& event : events) {
+      writer.Write(event);
+    }
+    writer.Close();
+    benchmark::DoNotOptimize(log.data());
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+  state.counters["bytes_per_event"] =
+      static_cast<double>(log.size()) / events.size();
+}
+
+// Parses every field of every line, as an analytics tool would.
+void BM_ScanCsvEventLog(benchmark::State& state) {
+  std::string log = WriteEventLog<CsvEventLogWriter>();
+  int64_t events = 0;
+  for (auto _ : state) {
+    events = 0;
+    int64_t checksum = 0;
+    for (absl::string_view line : absl::StrSplit(log, '\n')) {
+      if (line.empty()) continue;
+      for (absl::string_view field : absl::StrSplit(line, ',')) {
+        std::pair<absl::string_view, absl::string_view> key_value =
+            absl::StrSplit(field, absl::MaxSplits('=', 1));
+        if (key_value.first == "time") {
+          absl::Time time;
+          std::string error;
+          if (absl::ParseTime(absl::RFC3339_full, key_value.second, &time,
+                              &error)) {
+            checksum += absl::ToUnixMicros(time);
+          }
+        } else if (key_value.first == "video_csrcs") {
+          for (absl::string_view csrc : absl::StrSplit(key_value.second, '|')) {
+            uint32_t value;
+            if (absl::SimpleAtoi(csrc, &value)) checksum += value;
+          }
+        } else {
+          int64_t value;
+          if (absl::SimpleAtoi(key_value.second, &value)) {
+            checksum += value;
+          } else {
+            checksum += key_value.second.size();
+          }
+        }
+      }
+      ++events;
+    }
+    benchmark::DoNotOptimize(checksum);
+  }
+  state.SetItemsProcessed(state.iterations() * events);
+  state.SetBytesProcessed(state.iterations() * log.size());
+}
+
+void BM_ScanBinaryEventLog(benchmark::State& state) {
+  std::string log = WriteEventLog<BinaryEventLogWriter>();
+  int64_t events = 0;
+  for (auto _ : state) {
+    events = 0;
+    int64_t checksum = 0;
+    absl::StatusOr<std::unique_ptr<BinaryEventLogReader>> reader =
+        BinaryEventLogReader::Create(log);
+    if (!reader.ok()) {
+      state.SkipWithError(reader.status().ToString().c_str());
+      return;
+    }
+    EventLogEvent event;
+    while ((*reader)->Next(event)) {
+      checksum += absl::ToUnixMicros(event.time) + event.resource_id +
+                  event.display_name.size() + event.participant_key.size() +
+                  event.participant_session_name.size() + event.audio_csrc +
+                  event.audio_muted + event.video_muted;
+      for (uint32_t video_csrc : event.video_csrcs) {
+        checksum += video_csrc;
+      }
+      ++events;
+    }
+    benchmark::DoNotOptimize(checksum);
+  }
+  state.SetItemsProcessed(state.iterations() * events);
+  state.SetBytesProcessed(state.iterations() * log.size());
+}
+
+BENCHMARK(BM_WriteEventLog<CsvEventLogWriter>);
+BENCHMARK(BM_WriteEventLog<BinaryEventLogWriter>);
+BENCHMARK(BM_ScanCsvEventLog);
+BENCHMARK(BM_ScanBinaryEventLog);
+
+}  // namespace
+}  // namespace media_api_samples
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_EVENT_LOG_WRITER_INTERFACE_H_
+#define CPP_SAMPLES_EVENT_LOG_WRITER_INTERFACE_H_
+
+#include <cstdint>
+
+#include "absl/base/nullability.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Encodings of the participant and media entry event log.
+enum class EventLogFormat {
+  // One `time=...,event=...` line per event, see `CsvEventLogWriter`.
+  kCsv,
+  // Typed columns with interned strings, see `BinaryEventLogWriter`.
+  kBinary,
+};
+
+enum class EventLogEventType : uint8_t {
+  kParticipantUpdated = 0,
+  kParticipantDeleted = 1,
+  kMediaEntryUpdated = 2,
+  kMediaEntryDeleted = 3,
+};
+
+// A participant or media entry event.
+//
+// Only the fields of the event's type are set; the others are left at their
+// defaults. The event does not own its strings and contributing sources.
+struct EventLogEvent {
+  EventLogEventType type = EventLogEventType::kParticipantUpdated;
+  absl::Time time;
+  // The participant id for participant events, or the media entry id for
+  // media entry events.
+  int64_t resource_id = 0;
+
+  // Set for participant updates.
+  absl::string_view display_name;
+  // Set for participant and media entry updates.
+  absl::string_view participant_key;
+
+  // Set for media entry updates.
+  absl::string_view participant_session_name;
+  uint32_t audio_csrc = 0;
+  absl::Span<const uint32_t> video_csrcs;
+  bool audio_muted = false;
+  bool video_muted = false;
+};
+
+// Interface for writing participant and media entry events in some encoding.
+class EventLogWriterInterface {
+ public:
+  virtual ~EventLogWriterInterface() = default;
+  virtual void Write(const EventLogEvent& event) = 0;
+  // Hands the events written so far to the wrapped writer, for writers that
+  // buffer events, and flushes the wrapped writer.
+  virtual void Flush() {}
+  virtual void Close() = 0;
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_EVENT_LOG_WRITER_INTERFACE_H_
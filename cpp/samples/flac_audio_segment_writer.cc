@@ -0,0 +1,479 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/flac_audio_segment_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "absl/base/nullability.h"
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+constexpr int kSampleRate = 48000;
+constexpr int kBitsPerSample = 16;
+constexpr int kStreamInfoSize = 34;
+// Blocks of 4096 samples allow up to 64 partitions of 64 samples each.
+constexpr int kMaxPartitionOrder = 6;
+// Parameter 15 is reserved as an escape code for unencoded partitions.
+constexpr int kMaxRiceParameter = 14;
+
+// Writes big-endian bit fields, as used throughout FLAC, to a byte vector.
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<uint8_t>& bytes) : bytes_(bytes) {
+    bytes_.clear();
+  }
+
+  // Writes the low `bits` bits of `value`, where `bits` is at most 32.
+  void Write(uint32_t value, int bits) {
+    accumulator_ =
+        (accumulator_ << bits) | (value & ((uint64_t{1} << bits) - 1));
+    bit_count_ += bits;
+    while (bit_count_ >= 8) {
+      bit_count_ -= 8;
+      bytes_.push_back(static_cast<uint8_t>(accumulator_ >> bit_count_));
+    }
+  }
+
+  // Writes `value >> parameter` in unary (zeros terminated by a one),
+  // followed by the low `parameter` bits of `value`.
+  void WriteRice(uint32_t value, int parameter) {
+    uint32_t quotient = value >> parameter;
+    uint32_t remainder = value & ((uint32_t{1} << parameter) - 1);
+    if (quotient + 1 + parameter <= 32) {
+      Write((uint32_t{1} << parameter) | remainder, quotient + 1 + parameter);
+      return;
+    }
+    for (; quotient >= 32; quotient -= 32) {
+      Write(0, 32);
+    }
+    Write(1, quotient + 1);
+    Write(remainder, parameter);
+  }
+
+  // Pads the last byte with zeros.
+  void AlignToByte() {
+    if (bit_count_ > 0) {
+      Write(0, 8 - bit_count_);
+    }
+  }
+
+  const std::vector<uint8_t>& bytes() const { return bytes_; }
+
+ private:
+  std::vector<uint8_t>& bytes_;
+  // Bits that have not been flushed to `bytes_` are the low `bit_count_` bits.
+  uint64_t accumulator_ = 0;
+  int bit_count_ = 0;
+};
+
+constexpr std::array<uint8_t, 256> MakeCrc8Table() {
+  std::array<uint8_t, 256> table = {};
+  for (int i = 0; i < 256; ++i) {
+    uint8_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+constexpr std::array<uint16_t, 256> MakeCrc16Table() {
+  std::array<uint16_t, 256> table = {};
+  for (int i = 0; i < 256; ++i) {
+    uint16_t crc = i << 8;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+constexpr std::array<uint8_t, 256> kCrc8Table = MakeCrc8Table();
+constexpr std::array<uint16_t, 256> kCrc16Table = MakeCrc16Table();
+
+uint8_t Crc8(absl::Span<const uint8_t> data) {
+  uint8_t crc = 0;
+  for (uint8_t byte : data) {
+    crc = kCrc8Table[crc ^ byte];
+  }
+  return crc;
+}
+
+uint16_t Crc16(absl::Span<const uint8_t> data) {
+  uint16_t crc = 0;
+  for (uint8_t byte : data) {
+    crc = (crc << 8) ^ kCrc16Table[(crc >> 8) ^ byte];
+  }
+  return crc;
+}
+
+// Writes `value` with the UTF-8 style variable length coding FLAC uses for
+// frame numbers.
+void WriteFrameNumber(uint32_t value, BitWriter& writer) {
+  if (value < 0x80) {
+    writer.Write(value, 8);
+    return;
+  }
+  int continuation_bytes = value < 0x800       ? 1
+                           : value < 0x10000   ? 2
+                           : value < 0x200000  ? 3
+                           : value < 0x4000000 ? 4
+                                               : 5;
+  uint32_t leading_ones = (0xff00 >> (continuation_bytes + 1)) & 0xff;
+  writer.Write(leading_ones | (value >> (6 * continuation_bytes)), 8);
+  for (int i = continuation_bytes - 1; i >= 0; --i) {
+    writer.Write(0x80 | ((value >> (6 * i)) & 0x3f), 8);
+  }
+}
+
+// Writes `out[i] = in[i + 1] - in[i]` for the `count - 1` adjacent pairs of
+// `in`, and returns the sum of `|out[i]|`.
+//
+// Applying this `k` times yields the residual of FLAC's order `k` fixed
+// predictor. Residuals of 16-bit samples stay below 2^20 for `k` up to 4, so
+// 32-bit lane sums cannot overflow within a 4096 sample block.
+uint64_t Difference(const int32_t* in, int count, int32_t* out) {
+  int out_count = count - 1;
+  int i = 0;
+  uint64_t sum = 0;
+#if defined(__SSE2__)
+  __m128i lane_sums = _mm_setzero_si128();
+  for (; i + 4 <= out_count; i += 4) {
+    __m128i current =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    __m128i next =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 1));
+    __m128i difference = _mm_sub_epi32(next, current);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), difference);
+    // SSE2 has no 32-bit absolute value, so use `(x ^ sign) - sign`.
+    __m128i sign = _mm_srai_epi32(difference, 31);
+    lane_sums = _mm_add_epi32(
+        lane_sums, _mm_sub_epi32(_mm_xor_si128(difference, sign), sign));
+  }
+  alignas(16) uint32_t lanes[4];
+  _mm_store_si128(reinterpret_cast<__m128i*>(lanes), lane_sums);
+  sum = uint64_t{lanes[0]} + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__ARM_NEON)
+  uint32x4_t lane_sums = vdupq_n_u32(0);
+  for (; i + 4 <= out_count; i += 4) {
+    int32x4_t difference = vsubq_s32(vld1q_s32(in + i + 1), vld1q_s32(in + i));
+    vst1q_s32(out + i, difference);
+    lane_sums =
+        vaddq_u32(lane_sums, vreinterpretq_u32_s32(vabsq_s32(difference)));
+  }
+  sum = uint64_t{vgetq_lane_u32(lane_sums, 0)} +
+        vgetq_lane_u32(lane_sums, 1) + vgetq_lane_u32(lane_sums, 2) +
+        vgetq_lane_u32(lane_sums, 3);
+#endif
+  for (; i < out_count; ++i) {
+    out[i] = in[i + 1] - in[i];
+    sum += std::abs(out[i]);
+  }
+  return sum;
+}
+
+uint32_t ZigZag(int32_t residual) {
+  return (static_cast<uint32_t>(residual) << 1) ^
+         static_cast<uint32_t>(residual >> 31);
+}
+
+// Returns the Rice parameter that minimizes the estimated size of `count`
+// residuals whose zigzag encodings sum to `sum`, and adds that size to `bits`.
+int ChooseRiceParameter(int count, uint64_t sum, uint64_t& bits) {
+  int parameter = 0;
+  while (parameter < kMaxRiceParameter &&
+         (static_cast<uint64_t>(count) << (parameter + 1)) < sum) {
+    parameter++;
+  }
+  bits += static_cast<uint64_t>(count) * (parameter + 1) + (sum >> parameter);
+  return parameter;
+}
+
+// How a fixed predictor subframe's residual is Rice coded.
+struct RicePlan {
+  // Estimated size of the coded residual.
+  uint64_t bits = 0;
+  int partition_order = 0;
+  std::array<int, 1 << kMaxPartitionOrder> parameters = {};
+};
+
+// Chooses the partition order and per-partition Rice parameters that minimize
+// the size of `residual`, the order `order` residual of a block.
+RicePlan PlanResidual(absl::Span<const int32_t> residual, int block_size,
+                      int order) {
+  int max_partition_order = 0;
+  while (max_partition_order < kMaxPartitionOrder &&
+         block_size % (2 << max_partition_order) == 0 &&
+         (block_size >> (max_partition_order + 1)) > order) {
+    max_partition_order++;
+  }
+
+  // Sums of zigzag encoded residuals per partition, starting at the maximum
+  // partition order. Pairs are merged for each lower order.
+  std::array<uint64_t, 1 << kMaxPartitionOrder> sums = {};
+  int partition_size = block_size >> max_partition_order;
+  for (size_t i = 0; i < residual.size(); ++i) {
+    sums[(i + order) / partition_size] += ZigZag(residual[i]);
+  }
+
+  RicePlan best = {.bits = UINT64_MAX};
+  RicePlan plan;
+  for (int partition_order = max_partition_order; partition_order >= 0;
+       --partition_order) {
+    int partitions = 1 << partition_order;
+    int size = block_size >> partition_order;
+    plan.partition_order = partition_order;
+    // Coding method and partition order fields.
+    plan.bits = 2 + 4;
+    for (int j = 0; j < partitions; ++j) {
+      plan.bits += 4;
+      plan.parameters[j] = ChooseRiceParameter(j == 0 ? size - order : size,
+                                               sums[j], plan.bits);
+    }
+    if (plan.bits < best.bits) {
+      best = plan;
+    }
+    for (int j = 0; j < partitions / 2; ++j) {
+      sums[j] = sums[2 * j] + sums[2 * j + 1];
+    }
+  }
+  return best;
+}
+
+void WriteResidual(absl::Span<const int32_t> residual, int block_size,
+                   int order, const RicePlan& plan, BitWriter& writer) {
+  // Rice coding with 4-bit parameters.
+  writer.Write(0, 2);
+  writer.Write(plan.partition_order, 4);
+  int size = block_size >> plan.partition_order;
+  int i = 0;
+  for (int j = 0; j < (1 << plan.partition_order); ++j) {
+    int parameter = plan.parameters[j];
+    writer.Write(parameter, 4);
+    for (int end = (j + 1) * size - order; i < end; ++i) {
+      writer.WriteRice(ZigZag(residual[i]), parameter);
+    }
+  }
+}
+
+}  // namespace
+
+double FlacAudioSegmentWriter::Stats::CompressionRatio() const {
+  return encoded_bytes > 0
+             ? static_cast<double>(input_samples * sizeof(int16_t)) /
+                   encoded_bytes
+             : 0;
+}
+
+double FlacAudioSegmentWriter::Stats::EncodeNanosecondsPerSample() const {
+  return input_samples > 0
+             ? absl::ToDoubleNanoseconds(encode_time) / input_samples
+             : 0;
+}
+
+FlacAudioSegmentWriter::FlacAudioSegmentWriter(
+    std::unique_ptr<OutputWriterInterface> output)
+    : output_(std::move(output)) {
+  for (std::vector<int32_t>& residual : residuals_) {
+    residual.reserve(kBlockSize);
+  }
+
+  BitWriter writer(frame_);
+  writer.Write('f', 8);
+  writer.Write('L', 8);
+  writer.Write('a', 8);
+  writer.Write('C', 8);
+  // Stream info metadata block, which is also the last metadata block.
+  writer.Write(/*last_metadata_block=*/1, 1);
+  writer.Write(/*block_type=*/0, 7);
+  writer.Write(kStreamInfoSize, 24);
+  writer.Write(/*min_block_size=*/kBlockSize, 16);
+  writer.Write(/*max_block_size=*/kBlockSize, 16);
+  // Minimum and maximum frame sizes are unknown.
+  writer.Write(0, 24);
+  writer.Write(0, 24);
+  writer.Write(kSampleRate, 20);
+  writer.Write(/*channels - 1=*/0, 3);
+  writer.Write(kBitsPerSample - 1, 5);
+  // The total sample count (36 bits) and MD5 signature (128 bits) are unknown.
+  writer.Write(0, 4);
+  for (int i = 0; i < 5; ++i) {
+    writer.Write(0, 32);
+  }
+  Write(frame_);
+}
+
+FlacAudioSegmentWriter::~FlacAudioSegmentWriter() {
+  if (!closed_) {
+    Close();
+  }
+}
+
+void FlacAudioSegmentWriter::WriteSamples(std::vector<int16_t> pcm16) {
+  DCHECK(!closed_);
+
+  absl::Time start = absl::Now();
+  stats_.input_samples += pcm16.size();
+  if (pending_samples_.empty()) {
+    pending_samples_ = std::move(pcm16);
+  } else {
+    pending_samples_.insert(pending_samples_.end(), pcm16.begin(),
+                            pcm16.end());
+  }
+  size_t offset = 0;
+  for (; offset + kBlockSize <= pending_samples_.size(); offset += kBlockSize) {
+    EncodeBlock(absl::MakeConstSpan(&pending_samples_[offset], kBlockSize));
+  }
+  pending_samples_.erase(pending_samples_.begin(),
+                         pending_samples_.begin() + offset);
+  stats_.encode_time += absl::Now() - start;
+}
+
+void FlacAudioSegmentWriter::Close() {
+  DCHECK(!closed_);
+  closed_ = true;
+
+  absl::Time start = absl::Now();
+  if (!pending_samples_.empty()) {
+    EncodeBlock(pending_samples_);
+    pending_samples_.clear();
+  }
+  stats_.encode_time += absl::Now() - start;
+  output_->Close();
+
+  LOG(INFO) << "Closed FLAC audio segment with " << stats_.input_samples
+            << " samples; compression ratio " << stats_.CompressionRatio()
+            << ", " << stats_.EncodeNanosecondsPerSample()
+            << " ns per sample";
+}
+
+void FlacAudioSegmentWriter::EncodeBlock(absl::Span<const int16_t> block) {
+  int block_size = block.size();
+  DCHECK_GT(block_size, 0);
+  DCHECK_LE(block_size, kBlockSize);
+
+  // Compute the residuals of every fixed predictor, tracking the sum of their
+  // magnitudes as an estimate of how well each predicts the block.
+  std::array<uint64_t, kMaxFixedOrder + 1> magnitudes;
+  residuals_[0].assign(block.begin(), block.end());
+  magnitudes[0] = 0;
+  for (int32_t sample : residuals_[0]) {
+    magnitudes[0] += std::abs(sample);
+  }
+  int max_order = std::min(kMaxFixedOrder, block_size - 1);
+  for (int order = 1; order <= max_order; ++order) {
+    residuals_[order].resize(block_size - order);
+    magnitudes[order] =
+        Difference(residuals_[order - 1].data(), block_size - order + 1,
+                   residuals_[order].data());
+  }
+
+  BitWriter writer(frame_);
+  // Frame header.
+  writer.Write(/*sync_code=*/0x3ffe, 14);
+  writer.Write(/*reserved=*/0, 1);
+  writer.Write(/*variable_block_size=*/0, 1);
+  bool full_block = block_size == kBlockSize;
+  // Code 12 means 4096 samples; code 7 means the size follows the header.
+  writer.Write(full_block ? 12 : 7, 4);
+  writer.Write(/*48 kHz=*/10, 4);
+  writer.Write(/*mono=*/0, 4);
+  writer.Write(/*16 bits per sample=*/4, 3);
+  writer.Write(/*reserved=*/0, 1);
+  WriteFrameNumber(frame_number_++, writer);
+  if (!full_block) {
+    writer.Write(block_size - 1, 16);
+  }
+  writer.Write(Crc8(writer.bytes()), 8);
+
+  // Subframe.
+  if (block_size == 1 || magnitudes[1] == 0) {
+    // Every sample is the same, which is common for silence.
+    writer.Write(/*subframe_type=*/0, 8);
+    writer.Write(block[0], kBitsPerSample);
+  } else {
+    int best_order = 0;
+    for (int order = 1; order <= max_order; ++order) {
+      if (magnitudes[order] < magnitudes[best_order]) {
+        best_order = order;
+      }
+    }
+    RicePlan plan =
+        PlanResidual(residuals_[best_order], block_size, best_order);
+    if (best_order * kBitsPerSample + plan.bits <
+        static_cast<uint64_t>(block_size) * kBitsPerSample) {
+      // Fixed predictor subframe, with zero padding and wasted bits flags.
+      writer.Write(0x10 | (best_order << 1), 8);
+      // Warm-up samples.
+      for (int i = 0; i < best_order; ++i) {
+        writer.Write(block[i], kBitsPerSample);
+      }
+      WriteResidual(residuals_[best_order], block_size, best_order, plan,
+                    writer);
+    } else {
+      // Noise-like blocks are stored verbatim.
+      writer.Write(/*subframe_type=*/0x02, 8);
+      for (int16_t sample : block) {
+        writer.Write(sample, kBitsPerSample);
+      }
+    }
+  }
+  writer.AlignToByte();
+  writer.Write(Crc16(writer.bytes()), 16);
+  Write(frame_);
+}
+
+void FlacAudioSegmentWriter::Write(const std::vector<uint8_t>& bytes) {
+  output_->Write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  stats_.encoded_bytes += bytes.size();
+}
+
+AudioSegmentFormat CreateFlacAudioSegmentFormat() {
+  return {.file_extension = "flac",
+          .create_writer = [](std::unique_ptr<OutputWriterInterface> output)
+              -> std::unique_ptr<AudioSegmentWriterInterface> {
+            return std::make_unique<FlacAudioSegmentWriter>(std::move(output));
+          }};
+}
+
+}  // namespace media_api_samples
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_FLAC_AUDIO_SEGMENT_WRITER_H_
+#define CPP_SAMPLES_FLAC_AUDIO_SEGMENT_WRITER_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// An audio segment writer that losslessly compresses samples into a FLAC file,
+// for recordings that may not use a lossy codec.
+//
+// Each 4096 sample block is coded with the best of FLAC's fixed polynomial
+// predictors, whose residuals are computed with SIMD where available, and Rice
+// coded. Silent blocks collapse to a few bytes. Since this only costs a few
+// nanoseconds per sample, blocks are encoded on the calling thread.
+//
+// The output is not seekable, so the stream info header leaves the total
+// sample count and MD5 signature unset, which FLAC decoders accept.
+//
+// This class is not thread-safe.
+class FlacAudioSegmentWriter : public AudioSegmentWriterInterface {
+ public:
+  static constexpr int kBlockSize = 4096;
+  static constexpr int kMaxFixedOrder = 4;
+
+  struct Stats {
+    int64_t input_samples = 0;
+    int64_t encoded_bytes = 0;
+    absl::Duration encode_time;
+
+    // Returns the size of the pcm16 input divided by the size of the encoded
+    // output.
+    double CompressionRatio() const;
+    double EncodeNanosecondsPerSample() const;
+  };
+
+  explicit FlacAudioSegmentWriter(
+      std::unique_ptr<OutputWriterInterface> output);
+  ~FlacAudioSegmentWriter() override;
+
+  void WriteSamples(std::vector<int16_t> pcm16) override;
+  // Encodes the final, possibly partial, block and closes the output.
+  void Close() override;
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  void EncodeBlock(absl::Span<const int16_t> block);
+  void Write(const std::vector<uint8_t>& bytes);
+
+  std::unique_ptr<OutputWriterInterface> output_;
+  bool closed_ = false;
+  // Samples received but not yet encoded, since frames hold whole blocks.
+  std::vector<int16_t> pending_samples_;
+  int64_t frame_number_ = 0;
+  // Scratch buffers reused across blocks. `residuals_[k]` holds the residual
+  // of the order `k` fixed predictor, starting at the block's `k`th sample.
+  std::array<std::vector<int32_t>, kMaxFixedOrder + 1> residuals_;
+  std::vector<uint8_t> frame_;
+  Stats stats_;
+};
+
+// Returns a format that writes `.flac` segments.
+AudioSegmentFormat CreateFlacAudioSegmentFormat();
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_FLAC_AUDIO_SEGMENT_WRITER_H_
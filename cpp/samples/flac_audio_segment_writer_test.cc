@@ -0,0 +1,301 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/flac_audio_segment_writer.h"
+
+#include <cmath>
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/testing/string_output_writer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+constexpr int kBlockSize = FlacAudioSegmentWriter::kBlockSize;
+
+class BitReader {
+ public:
+  explicit BitReader(const std::string& data) : data_(data) {}
+
+  uint32_t Read(int bits) {
+    uint32_t value = 0;
+    for (int i = 0; i < bits; ++i) {
+      uint8_t byte = data_[position_ / 8];
+      value = (value << 1) | ((byte >> (7 - position_ % 8)) & 1);
+      position_++;
+    }
+    return value;
+  }
+  int32_t ReadSigned(int bits) {
+    uint32_t value = Read(bits);
+    return static_cast<int32_t>(value << (32 - bits)) >> (32 - bits);
+  }
+  int32_t ReadRice(int parameter) {
+    uint32_t quotient = 0;
+    while (Read(1) == 0) {
+      quotient++;
+    }
+    uint32_t value = (quotient << parameter) | Read(parameter);
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+  }
+  void AlignToByte() { position_ = (position_ + 7) / 8 * 8; }
+  size_t byte_position() const { return position_ / 8; }
+  bool AtEnd() const { return position_ >= data_.size() * 8; }
+
+ private:
+  const std::string& data_;
+  size_t position_ = 0;
+};
+
+// Bitwise CRCs, computed independently of the writer's tables.
+uint32_t Crc(const std::string& data, size_t begin, size_t end, int width,
+             uint32_t polynomial) {
+  uint32_t crc = 0;
+  uint32_t top_bit = 1u << (width - 1);
+  uint32_t mask = (width == 32) ? 0xffffffff : (1u << width) - 1;
+  for (size_t i = begin; i < end; ++i) {
+    crc ^= static_cast<uint32_t>(static_cast<uint8_t>(data[i])) << (width - 8);
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = ((crc & top_bit) ? (crc << 1) ^ polynomial : crc << 1) & mask;
+    }
+  }
+  return crc;
+}
+
+// Decodes the subset of FLAC that the writer produces, failing the test if
+// the stream is malformed.
+std::vector<int16_t> DecodeFlac(const std::string& data) {
+  std::vector<int16_t> samples;
+  BitReader reader(data);
+  EXPECT_EQ(data.substr(0, 4), "fLaC");
+  reader.Read(32);
+  EXPECT_EQ(reader.Read(1), 1);  // Last metadata block.
+  EXPECT_EQ(reader.Read(7), 0);  // Stream info.
+  EXPECT_EQ(reader.Read(24), 34);
+  EXPECT_EQ(reader.Read(16), kBlockSize);
+  EXPECT_EQ(reader.Read(16), kBlockSize);
+  reader.Read(48);
+  EXPECT_EQ(reader.Read(20), 48000);
+  EXPECT_EQ(reader.Read(3), 0);
+  EXPECT_EQ(reader.Read(5), 15);
+  reader.Read(36);
+  reader.Read(128);
+
+  while (!reader.AtEnd() && !::testing::Test::HasFailure()) {
+    size_t frame_start = reader.byte_position();
+    EXPECT_EQ(reader.Read(14), 0x3ffe);
+    reader.Read(2);
+    uint32_t block_size_code = reader.Read(4);
+    EXPECT_EQ(reader.Read(4), 10);
+    EXPECT_EQ(reader.Read(4), 0);
+    EXPECT_EQ(reader.Read(3), 4);
+    reader.Read(1);
+    // Frame number.
+    uint32_t leading_byte = reader.Read(8);
+    while ((leading_byte & 0xc0) == 0xc0) {
+      EXPECT_EQ(reader.Read(8) & 0xc0, 0x80);
+      leading_byte = (leading_byte << 1) & 0xff;
+    }
+    int block_size = block_size_code == 12 ? kBlockSize : 0;
+    if (block_size_code == 7) {
+      block_size = reader.Read(16) + 1;
+    }
+    EXPECT_GT(block_size, 0);
+    size_t header_end = reader.byte_position();
+    EXPECT_EQ(reader.Read(8), Crc(data, frame_start, header_end, 8, 0x07));
+
+    EXPECT_EQ(reader.Read(1), 0);
+    uint32_t type = reader.Read(6);
+    EXPECT_EQ(reader.Read(1), 0);
+    std::vector<int32_t> block;
+    if (type == 0) {
+      block.assign(block_size, reader.ReadSigned(16));
+    } else if (type == 1) {
+      for (int i = 0; i < block_size; ++i) {
+        block.push_back(reader.ReadSigned(16));
+      }
+    } else {
+      EXPECT_EQ(type & 0x38, 0x08);
+      int order = type & 0x07;
+      for (int i = 0; i < order; ++i) {
+        block.push_back(reader.ReadSigned(16));
+      }
+      EXPECT_EQ(reader.Read(2), 0);
+      int partition_order = reader.Read(4);
+      int partition_size = block_size >> partition_order;
+      for (int j = 0; j < (1 << partition_order); ++j) {
+        int parameter = reader.Read(4);
+        EXPECT_LT(parameter, 15);
+        int count = j == 0 ? partition_size - order : partition_size;
+        for (int k = 0; k < count; ++k) {
+          int32_t residual = reader.ReadRice(parameter);
+          size_t n = block.size();
+          int32_t prediction = 0;
+          switch (order) {
+            case 1:
+              prediction = block[n - 1];
+              break;
+            case 2:
+              prediction = 2 * block[n - 1] - block[n - 2];
+              break;
+            case 3:
+              prediction = 3 * block[n - 1] - 3 * block[n - 2] + block[n - 3];
+              break;
+            case 4:
+              prediction = 4 * block[n - 1] - 6 * block[n - 2] +
+                           4 * block[n - 3] - block[n - 4];
+              break;
+          }
+          block.push_back(prediction + residual);
+        }
+      }
+    }
+    EXPECT_EQ(block.size(), block_size);
+    samples.insert(samples.end(), block.begin(), block.end());
+
+    reader.AlignToByte();
+    size_t frame_end = reader.byte_position();
+    EXPECT_EQ(reader.Read(16), Crc(data, frame_start, frame_end, 16, 0x8005));
+  }
+  return samples;
+}
+
+// Voiced bursts of a few harmonics with a slow envelope, separated by pauses,
+// over a low noise floor.
+std::vector<int16_t> CreateSpeechLikeAudio(int sample_count) {
+  std::mt19937 random(1234);
+  std::normal_distribution<double> noise(0, 20);
+  std::vector<int16_t> samples(sample_count);
+  for (int i = 0; i < sample_count; ++i) {
+    double t = i / 48000.0;
+    double phrase = std::fmod(t, 1.5);
+    double envelope =
+        phrase < 1.0 ? std::pow(std::sin(M_PI * phrase), 2) : 0.0;
+    double pitch = 140 + 30 * std::sin(2 * M_PI * 0.7 * t);
+    double voiced = 0;
+    for (int harmonic = 1; harmonic <= 6; ++harmonic) {
+      voiced += std::sin(2 * M_PI * pitch * harmonic * t) / harmonic;
+    }
+    samples[i] = static_cast<int16_t>(4000 * envelope * voiced + noise(random));
+  }
+  return samples;
+}
+
+std::string Encode(const std::vector<int16_t>& samples, int chunk_size,
+                   FlacAudioSegmentWriter::Stats* stats = nullptr) {
+  std::string output;
+  bool closed = false;
+  FlacAudioSegmentWriter writer(
+      std::make_unique<StringOutputWriter>(output, closed));
+  for (size_t i = 0; i < samples.size(); i += chunk_size) {
+    writer.WriteSamples(std::vector<int16_t>(
+        samples.begin() + i,
+        samples.begin() + std::min(samples.size(), i + chunk_size)));
+  }
+  writer.Close();
+  EXPECT_TRUE(closed);
+  if (stats != nullptr) {
+    *stats = writer.stats();
+  }
+  return output;
+}
+
+TEST(FlacAudioSegmentWriterTest, LosslesslyCompressesSpeechByAtLeastTwoTimes) {
+  std::vector<int16_t> samples = CreateSpeechLikeAudio(48000 * 3);
+  FlacAudioSegmentWriter::Stats stats;
+
+  std::string output = Encode(samples, /*chunk_size=*/480, &stats);
+
+  EXPECT_EQ(DecodeFlac(output), samples);
+  EXPECT_EQ(stats.input_samples, samples.size());
+  EXPECT_EQ(stats.encoded_bytes, output.size());
+  EXPECT_GE(stats.CompressionRatio(), 2.0);
+  EXPECT_GT(stats.EncodeNanosecondsPerSample(), 0);
+}
+
+TEST(FlacAudioSegmentWriterTest, CollapsesSilence) {
+  std::vector<int16_t> samples(kBlockSize * 10, 0);
+
+  std::string output = Encode(samples, /*chunk_size=*/480);
+
+  EXPECT_EQ(DecodeFlac(output), samples);
+  EXPECT_LT(output.size(), 200);
+}
+
+TEST(FlacAudioSegmentWriterTest, StoresNoiseVerbatim) {
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> distribution(-32768, 32767);
+  std::vector<int16_t> samples(kBlockSize * 2);
+  for (int16_t& sample : samples) {
+    sample = distribution(random);
+  }
+
+  std::string output = Encode(samples, /*chunk_size=*/480);
+
+  EXPECT_EQ(DecodeFlac(output), samples);
+  // Stream header, plus at most 16 bytes of framing per block.
+  EXPECT_LE(output.size(), 42 + samples.size() * 2 + 2 * 16);
+}
+
+TEST(FlacAudioSegmentWriterTest, EncodesPartialBlocks) {
+  for (int sample_count : {1, 2, 5, 100, kBlockSize - 1, kBlockSize + 1,
+                           3 * kBlockSize + 777}) {
+    std::vector<int16_t> samples = CreateSpeechLikeAudio(sample_count);
+
+    std::string output = Encode(samples, /*chunk_size=*/333);
+
+    EXPECT_EQ(DecodeFlac(output), samples) << sample_count;
+  }
+}
+
+TEST(FlacAudioSegmentWriterTest, HandlesFullScaleTransitions) {
+  std::vector<int16_t> samples;
+  for (int i = 0; i < kBlockSize + 50; ++i) {
+    samples.push_back(i % 2 == 0 ? 32767 : -32768);
+  }
+
+  std::string output = Encode(samples, /*chunk_size=*/kBlockSize);
+
+  EXPECT_EQ(DecodeFlac(output), samples);
+}
+
+TEST(FlacAudioSegmentWriterTest, ClosesOutputOnDestruction) {
+  std::string output;
+  bool closed = false;
+  {
+    FlacAudioSegmentWriter writer(
+        std::make_unique<StringOutputWriter>(output, closed));
+    writer.WriteSamples(std::vector<int16_t>(100, 7));
+  }
+
+  EXPECT_TRUE(closed);
+  EXPECT_EQ(DecodeFlac(output), std::vector<int16_t>(100, 7));
+}
+
+}  // namespace
+}  // namespace media_api_samples
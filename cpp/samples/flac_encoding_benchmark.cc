@@ -0,0 +1,99 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Benchmarks for losslessly encoding audio segments as FLAC.
+//
+// Each iteration hands one 10 ms frame of 48 kHz mono audio, as delivered by
+// the client, to a FLAC segment writer. The reported `ns_per_sample` counter
+// is the encoding cost per sample, and `compression_ratio` is the pcm16 size
+// divided by the FLAC size.
+
+#include <cmath>
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/base/nullability.h"
+#include "meet_clients/samples/flac_audio_segment_writer.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+constexpr int kFrameSamples = 480;
+// Ten seconds of audio, cycled through by the benchmark.
+constexpr int kDistinctFrames = 1000;
+
+class NullOutputWriter : public OutputWriterInterface {
+ public:
+  void Write(const char* content, std::streamsize size) override {}
+  void Close() override {}
+};
+
+// Voiced bursts of a few harmonics with a slow envelope, separated by pauses,
+// over a low noise floor, scaled by `level`.
+std::vector<std::vector<int16_t>> CreateSpeechLikeFrames(double level) {
+  std::mt19937 random(1234);
+  std::normal_distribution<double> noise(0, 20);
+  std::vector<std::vector<int16_t>> frames(kDistinctFrames);
+  for (int f = 0; f < kDistinctFrames; ++f) {
+    frames[f].resize(kFrameSamples);
+    for (int i = 0; i < kFrameSamples; ++i) {
+      double t = (f * kFrameSamples + i) / 48000.0;
+      double phrase = std::fmod(t, 1.5);
+      double envelope =
+          phrase < 1.0 ? std::pow(std::sin(M_PI * phrase), 2) : 0.0;
+      double pitch = 140 + 30 * std::sin(2 * M_PI * 0.7 * t);
+      double voiced = 0;
+      for (int harmonic = 1; harmonic <= 6; ++harmonic) {
+        voiced += std::sin(2 * M_PI * pitch * harmonic * t) / harmonic;
+      }
+      frames[f][i] = static_cast<int16_t>(level * envelope * voiced +
+                                           noise(random));
+    }
+  }
+  return frames;
+}
+
+void BM_EncodeFlac(benchmark::State& state) {
+  std::vector<std::vector<int16_t>> frames =
+      CreateSpeechLikeFrames(/*level=*/state.range(0));
+  FlacAudioSegmentWriter writer(std::make_unique<NullOutputWriter>());
+
+  int64_t frame_index = 0;
+  for (auto _ : state) {
+    writer.WriteSamples(frames[frame_index % kDistinctFrames]);
+    frame_index++;
+  }
+  writer.Close();
+
+  const FlacAudioSegmentWriter::Stats& stats = writer.stats();
+  state.SetItemsProcessed(stats.input_samples);
+  state.counters["ns_per_sample"] = stats.EncodeNanosecondsPerSample();
+  state.counters["compression_ratio"] = stats.CompressionRatio();
+}
+
+// Arguments are peak voice levels: quiet, typical and loud speech.
+BENCHMARK(BM_EncodeFlac)->Arg(1000)->Arg(4000)->Arg(16000);
+
+}  // namespace
+}  // namespace media_api_samples
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/frame_buffer_pool.h"
+
+#include <cstring>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
+#include "api/video/nv12_buffer.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+MATCHER_P2(StatsAre, hits, misses, "") {
+  return arg.hits == hits && arg.misses == misses;
+}
+
+TEST(FrameBufferPoolTest, ReusesReleasedBuffers) {
+  FrameBufferPool pool;
+  webrtc::scoped_refptr<webrtc::I420Buffer> first = pool.CreateBuffer(64, 32);
+  const webrtc::I420Buffer* first_buffer = first.get();
+  first = nullptr;
+
+  webrtc::scoped_refptr<webrtc::I420Buffer> second = pool.CreateBuffer(64, 32);
+  webrtc::scoped_refptr<webrtc::I420Buffer> third = pool.CreateBuffer(64, 32);
+
+  EXPECT_EQ(second.get(), first_buffer);
+  EXPECT_NE(third.get(), first_buffer);
+  EXPECT_THAT(pool.GetStats(), StatsAre(/*hits=*/1, /*misses=*/2));
+}
+
+TEST(FrameBufferPoolTest, ReleasesBuffersOfLeastRecentlyUsedResolution) {
+  FrameBufferPool pool({.max_resolutions = 2});
+  pool.CreateBuffer(64, 32);
+  pool.CreateBuffer(32, 16);
+  pool.CreateBuffer(64, 32);
+  // Releases the buffers of 32x16, which was used least recently.
+  pool.CreateBuffer(16, 8);
+
+  pool.CreateBuffer(64, 32);
+  pool.CreateBuffer(32, 16);
+
+  EXPECT_THAT(pool.GetStats(), StatsAre(/*hits=*/2, /*misses=*/4));
+}
+
+TEST(FrameBufferPoolTest, ConvertsNv12BufferIntoPooledBuffer) {
+  FrameBufferPool pool;
+  webrtc::scoped_refptr<webrtc::NV12Buffer> nv12 =
+      webrtc::NV12Buffer::Create(64, 32);
+  nv12->InitializeData();
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> expected = nv12->ToI420();
+  pool.ToI420(*nv12);
+
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> i420 = pool.ToI420(*nv12);
+
+  ASSERT_EQ(i420->width(), 64);
+  ASSERT_EQ(i420->height(), 32);
+  for (int y = 0; y < 32; y++) {
+    EXPECT_EQ(memcmp(i420->DataY() + y * i420->StrideY(),
+                     expected->DataY() + y * expected->StrideY(), 64),
+              0);
+  }
+  EXPECT_THAT(pool.GetStats(), StatsAre(/*hits=*/1, /*misses=*/1));
+}
+
+}  // namespace
+}  // namespace media_api_samples
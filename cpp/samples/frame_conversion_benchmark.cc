@@ -0,0 +1,104 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks for the time a video frame costs the thread that delivers it,
+// i.e. WebRTC's decoding thread, when the collector converts it to I420 there
+// versus hands it to a `FrameConversionPool`.
+//
+// Frames are 720p NV12 buffers, as produced by hardware decoders, so that
+// `ToI420()` has to convert rather than return the buffer itself. Only the
+// delivering thread's time is measured: the pool is drained with timing
+// paused.
+
+#include <cstdint>
+#include <memory>
+
+#include "benchmark/benchmark.h"
+#include "absl/base/nullability.h"
+#include "absl/status/statusor.h"
+#include "meet_clients/samples/frame_conversion_pool.h"
+#include "api/scoped_refptr.h"
+#include "api/video/nv12_buffer.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+constexpr int kFrameWidth = 1280;
+constexpr int kFrameHeight = 720;
+// Number of frames handed to the pool before waiting for it to catch up, about
+// a second of video.
+constexpr int kFramesInFlight = 30;
+
+webrtc::scoped_refptr<webrtc::VideoFrameBuffer> CreateNv12Frame() {
+  webrtc::scoped_refptr<webrtc::NV12Buffer> frame =
+      webrtc::NV12Buffer::Create(kFrameWidth, kFrameHeight);
+  frame->InitializeData();
+  return frame;
+}
+
+void BM_ConvertOnDeliveringThread(benchmark::State& state) {
+  webrtc::scoped_refptr<webrtc::VideoFrameBuffer> frame = CreateNv12Frame();
+  for (auto _ : state) {
+    webrtc::scoped_refptr<webrtc::I420BufferInterface> i420 = frame->ToI420();
+    benchmark::DoNotOptimize(i420);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_HandOffToConversionPool(benchmark::State& state) {
+  absl::StatusOr<std::shared_ptr<FrameConversionPool>> pool =
+      FrameConversionPool::Create(
+          {.thread_count = static_cast<int>(state.range(0))});
+  if (!pool.ok()) {
+    state.SkipWithError("Failed to create frame conversion pool");
+    return;
+  }
+  webrtc::scoped_refptr<webrtc::VideoFrameBuffer> frame = CreateNv12Frame();
+
+  int64_t frame_index = 0;
+  for (auto _ : state) {
+    // As in `MultiUserMediaCollector::OnVideoFrame`, only a reference to the
+    // buffer is taken on this thread.
+    (*pool)->PostTask(/*key=*/frame_index, [buffer = frame] {
+      webrtc::scoped_refptr<webrtc::I420BufferInterface> i420 =
+          buffer->ToI420();
+      benchmark::DoNotOptimize(i420);
+    });
+    if (++frame_index % kFramesInFlight == 0) {
+      state.PauseTiming();
+      (*pool)->Flush();
+      state.ResumeTiming();
+    }
+  }
+  (*pool)->Flush();
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ConvertOnDeliveringThread);
+// Arguments are the number of conversion threads. Since draining the pool is
+// not timed, the iteration count is fixed rather than grown until the timed
+// part takes long enough.
+BENCHMARK(BM_HandOffToConversionPool)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Iterations(100 * kFramesInFlight);
+
+}  // namespace
+}  // namespace media_api_samples
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/frame_conversion_pool.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "meet_clients/samples/frame_buffer_pool.h"
+#include "rtc_base/thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+absl::StatusOr<std::shared_ptr<FrameConversionPool>>
+FrameConversionPool::Create(Options options) {
+  if (options.thread_count <= 0) {
+    return absl::InvalidArgumentError(
+        "Frame conversion thread count must be positive");
+  }
+  if (options.max_pooled_buffers <= 0) {
+    return absl::InvalidArgumentError(
+        "Frame conversion max pooled buffers must be positive");
+  }
+
+  std::vector<std::unique_ptr<webrtc::Thread>> threads;
+  for (int i = 0; i < options.thread_count; ++i) {
+    std::unique_ptr<webrtc::Thread> thread = webrtc::Thread::Create();
+    thread->SetName("frame_conversion_thread", nullptr);
+    if (!thread->Start()) {
+      return absl::InternalError("Failed to start frame conversion thread");
+    }
+    threads.push_back(std::move(thread));
+  }
+  return absl::WrapUnique(
+      new FrameConversionPool(std::move(threads), options.max_pooled_buffers));
+}
+
+FrameConversionPool::~FrameConversionPool() {
+  FrameBufferPool::Stats stats = buffer_pool_.GetStats();
+  LOG(INFO) << "Frame conversion buffers: " << stats.hits << " reused, "
+            << stats.misses << " allocated";
+}
+
+void FrameConversionPool::PostTask(uint32_t key,
+                                   absl::AnyInvocable<void() &&> task) {
+  threads_[key % threads_.size()]->PostTask(std::move(task));
+}
+
+void FrameConversionPool::Flush() {
+  for (const std::unique_ptr<webrtc::Thread>& thread : threads_) {
+    thread->BlockingCall([] {});
+  }
+}
+
+}  // namespace media_api_samples
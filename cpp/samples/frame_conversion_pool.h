@@ -0,0 +1,79 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_FRAME_CONVERSION_POOL_H_
+#define CPP_SAMPLES_FRAME_CONVERSION_POOL_H_
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
+#include "meet_clients/samples/frame_buffer_pool.h"
+#include "rtc_base/thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// A set of worker threads that convert received video frames, e.g. to I420,
+// so that the threads delivering frames return to decoding right away.
+//
+// Each key, e.g. a contributing source, is pinned to one thread, so that its
+// frames are converted and handed on in the order they were received. Tasks
+// convert frames into buffers from `buffer_pool()`, so that steady-state video
+// does not allocate a buffer for every frame.
+//
+// This class is thread-safe.
+class FrameConversionPool {
+ public:
+  struct Options {
+    int thread_count = 2;
+    // Maximum number of buffers of each resolution kept for reuse.
+    int max_pooled_buffers = 16;
+  };
+
+  static absl::StatusOr<std::shared_ptr<FrameConversionPool>> Create(
+      Options options);
+
+  // Logs the buffer pool's stats.
+  ~FrameConversionPool();
+
+  // Runs `task` on the thread of `key`, after the tasks posted before it with
+  // the same key.
+  void PostTask(uint32_t key, absl::AnyInvocable<void() &&> task);
+  // Blocks until the tasks posted so far have run.
+  void Flush();
+
+  FrameBufferPool& buffer_pool() { return buffer_pool_; }
+
+ private:
+  FrameConversionPool(std::vector<std::unique_ptr<webrtc::Thread>> threads,
+                      int max_pooled_buffers)
+      : buffer_pool_({.max_buffers_per_resolution = max_pooled_buffers}),
+        threads_(std::move(threads)) {}
+
+  // Outlives the threads, whose tasks use it.
+  FrameBufferPool buffer_pool_;
+  const std::vector<std::unique_ptr<webrtc::Thread>> threads_;
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_FRAME_CONVERSION_POOL_H_
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/frame_conversion_pool.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+using ::testing::ElementsAre;
+
+TEST(FrameConversionPoolTest, RunsTasksOfAKeyInOrder) {
+  absl::StatusOr<std::shared_ptr<FrameConversionPool>> pool =
+      FrameConversionPool::Create({.thread_count = 4});
+  ASSERT_TRUE(pool.ok()) << pool.status();
+
+  // Only tasks of one key touch this, so they need no synchronization.
+  std::vector<int> order;
+  for (int i = 0; i < 5; ++i) {
+    (*pool)->PostTask(/*key=*/7, [&order, i] { order.push_back(i); });
+  }
+  (*pool)->Flush();
+
+  EXPECT_THAT(order, ElementsAre(0, 1, 2, 3, 4));
+}
+
+TEST(FrameConversionPoolTest, RunsTasksOfDifferentKeysOnDifferentThreads) {
+  absl::StatusOr<std::shared_ptr<FrameConversionPool>> pool =
+      FrameConversionPool::Create({.thread_count = 2});
+  ASSERT_TRUE(pool.ok()) << pool.status();
+
+  std::thread::id first_thread;
+  std::thread::id second_thread;
+  (*pool)->PostTask(/*key=*/1,
+                    [&] { first_thread = std::this_thread::get_id(); });
+  (*pool)->PostTask(/*key=*/2,
+                    [&] { second_thread = std::this_thread::get_id(); });
+  (*pool)->Flush();
+
+  EXPECT_NE(first_thread, std::thread::id());
+  EXPECT_NE(first_thread, second_thread);
+  EXPECT_NE(first_thread, std::this_thread::get_id());
+}
+
+TEST(FrameConversionPoolTest, RejectsNonPositiveThreadCount) {
+  EXPECT_EQ(FrameConversionPool::Create({.thread_count = 0}).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(FrameConversionPoolTest, ReusesBuffersOfBufferPool) {
+  absl::StatusOr<std::shared_ptr<FrameConversionPool>> pool =
+      FrameConversionPool::Create({.thread_count = 1, .max_pooled_buffers = 2});
+  ASSERT_TRUE(pool.ok()) << pool.status();
+
+  for (int i = 0; i < 3; ++i) {
+    (*pool)->PostTask(/*key=*/1, [&pool] {
+      (*pool)->buffer_pool().CreateBuffer(/*width=*/64, /*height=*/32);
+    });
+  }
+  (*pool)->Flush();
+
+  EXPECT_EQ((*pool)->buffer_pool().GetStats().hits, 2);
+  EXPECT_EQ((*pool)->buffer_pool().GetStats().misses, 1);
+}
+
+TEST(FrameConversionPoolTest, RejectsNonPositiveMaxPooledBuffers) {
+  EXPECT_EQ(FrameConversionPool::Create({.max_pooled_buffers = 0})
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace media_api_samples
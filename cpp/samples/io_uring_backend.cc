@@ -0,0 +1,294 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/io_uring_backend.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/async_io_backend_interface.h"
+#include "rtc_base/platform_thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+// `user_data` of the no-op entry used to stop the completion thread. Buffer
+// indices are never negative, so this cannot collide with a write.
+constexpr uint64_t kWakeupUserData = std::numeric_limits<uint64_t>::max();
+// How long to wait before retrying a system call that failed for lack of
+// resources, or a failed wait for completions.
+constexpr absl::Duration kRetryDelay = absl::Milliseconds(1);
+
+// glibc does not provide wrappers for the io_uring system calls.
+int IoUringSetup(unsigned entries, io_uring_params& params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+}
+
+int IoUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                 unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+int IoUringRegister(int ring_fd, unsigned opcode, const void* arg,
+                    unsigned nr_args) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+unsigned* RingField(void* ring, uint32_t offset) {
+  return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<IoUringBackend>> IoUringBackend::Create(
+    absl::Span<const absl::Span<char>> buffers,
+    CompletionCallback on_complete) {
+  // At most one write per buffer is in flight, plus the wakeup entry. The
+  // kernel sizes the completion queue at twice the submission queue, so
+  // completions can never overflow.
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  Ring ring;
+  ring.fd = IoUringSetup(buffers.size() + 1, params);
+  if (ring.fd < 0) {
+    return absl::UnavailableError(
+        absl::StrCat("io_uring_setup failed: ", strerror(errno)));
+  }
+
+  // Releases everything mapped so far if a later step fails.
+  auto fail = [&ring](absl::string_view step) {
+    absl::Status status =
+        absl::UnavailableError(absl::StrCat(step, " failed: ", strerror(errno)));
+    if (ring.sqes != nullptr) munmap(ring.sqes, ring.sqes_size);
+    if (ring.cq_ring != nullptr && ring.cq_ring != ring.sq_ring) {
+      munmap(ring.cq_ring, ring.cq_ring_size);
+    }
+    if (ring.sq_ring != nullptr) munmap(ring.sq_ring, ring.sq_ring_size);
+    close(ring.fd);
+    return status;
+  };
+
+  ring.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring.cq_ring_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    ring.sq_ring_size = ring.cq_ring_size =
+        std::max(ring.sq_ring_size, ring.cq_ring_size);
+  }
+  void* sq_ring = mmap(nullptr, ring.sq_ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED) return fail("Mapping the submission queue");
+  ring.sq_ring = sq_ring;
+  if (single_mmap) {
+    ring.cq_ring = ring.sq_ring;
+  } else {
+    void* cq_ring =
+        mmap(nullptr, ring.cq_ring_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) return fail("Mapping the completion queue");
+    ring.cq_ring = cq_ring;
+  }
+  ring.sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, ring.sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) return fail("Mapping the submission entries");
+  ring.sqes = static_cast<io_uring_sqe*>(sqes);
+
+  ring.sq_head = RingField(ring.sq_ring, params.sq_off.head);
+  ring.sq_tail = RingField(ring.sq_ring, params.sq_off.tail);
+  ring.sq_mask = *RingField(ring.sq_ring, params.sq_off.ring_mask);
+  ring.sq_array = RingField(ring.sq_ring, params.sq_off.array);
+  ring.cq_head = RingField(ring.cq_ring, params.cq_off.head);
+  ring.cq_tail = RingField(ring.cq_ring, params.cq_off.tail);
+  ring.cq_mask = *RingField(ring.cq_ring, params.cq_off.ring_mask);
+  ring.cqes = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(ring.cq_ring) +
+                                              params.cq_off.cqes);
+
+  // Registering buffers pins their pages, which may exceed `RLIMIT_MEMLOCK` on
+  // older kernels. Plain writes still work in that case, so only log it.
+  std::vector<iovec> iovecs;
+  iovecs.reserve(buffers.size());
+  for (absl::Span<char> buffer : buffers) {
+    iovecs.push_back({.iov_base = buffer.data(), .iov_len = buffer.size()});
+  }
+  if (IoUringRegister(ring.fd, IORING_REGISTER_BUFFERS, iovecs.data(),
+                      iovecs.size()) == 0) {
+    ring.fixed_buffers = true;
+  } else {
+    LOG(WARNING) << "Failed to register io_uring buffers, falling back to "
+                    "unregistered writes: "
+                 << strerror(errno);
+  }
+
+  auto backend = absl::WrapUnique(
+      new IoUringBackend(std::move(ring), std::move(on_complete)));
+  backend->completion_thread_ = webrtc::PlatformThread::SpawnJoinable(
+      [backend = backend.get()] { backend->RunCompletionLoop(); },
+      "io_uring_completion");
+  return backend;
+}
+
+IoUringBackend::~IoUringBackend() {
+  stopping_ = true;
+  {
+    absl::MutexLock lock(&submit_mutex_);
+    io_uring_sqe& sqe = QueueSqe();
+    sqe.opcode = IORING_OP_NOP;
+    sqe.user_data = kWakeupUserData;
+    int error = 0;
+    if (Enter(/*to_submit=*/1, error) > 0) {
+      // The completion thread stops once its own wait fails.
+      LOG(ERROR) << "Failed to submit the io_uring wakeup: " << strerror(error);
+    }
+  }
+  completion_thread_.Finalize();
+
+  if (ring_.fixed_buffers) {
+    IoUringRegister(ring_.fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+  }
+  munmap(ring_.sqes, ring_.sqes_size);
+  if (ring_.cq_ring != ring_.sq_ring) munmap(ring_.cq_ring, ring_.cq_ring_size);
+  munmap(ring_.sq_ring, ring_.sq_ring_size);
+  close(ring_.fd);
+}
+
+void IoUringBackend::SubmitWrites(absl::Span<const WriteRequest> requests) {
+  if (requests.empty()) return;
+
+  unsigned unsubmitted;
+  int error = 0;
+  {
+    absl::MutexLock lock(&submit_mutex_);
+    for (const WriteRequest& request : requests) {
+      io_uring_sqe& sqe = QueueSqe();
+      sqe.opcode =
+          ring_.fixed_buffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+      sqe.fd = request.fd;
+      sqe.off = request.offset;
+      sqe.addr = reinterpret_cast<uint64_t>(request.data.data());
+      sqe.len = request.data.size();
+      if (ring_.fixed_buffers) sqe.buf_index = request.buffer_index;
+      sqe.user_data = request.buffer_index;
+    }
+    // The whole batch is handed to the kernel with a single system call.
+    unsubmitted = Enter(requests.size(), error);
+  }
+  // The kernel takes entries in order, so the rejected ones end the batch.
+  // Their buffers are returned outside the lock, since the callback may submit
+  // again.
+  for (const WriteRequest& request :
+       requests.subspan(requests.size() - unsubmitted)) {
+    on_complete_(request.buffer_index, -error);
+  }
+}
+
+io_uring_sqe& IoUringBackend::QueueSqe() {
+  // Only the submitting thread advances the tail; the kernel advances the
+  // head. The queue can hold an entry for every buffer, so it never fills up.
+  unsigned index = sq_tail_ & ring_.sq_mask;
+  io_uring_sqe& sqe = ring_.sqes[index];
+  memset(&sqe, 0, sizeof(sqe));
+  ring_.sq_array[index] = index;
+  // The new tail is published to the kernel in `Enter`, once the caller has
+  // filled in the entry.
+  ++sq_tail_;
+  return sqe;
+}
+
+unsigned IoUringBackend::Enter(unsigned to_submit, int& error) {
+  __atomic_store_n(ring_.sq_tail, sq_tail_, __ATOMIC_RELEASE);
+  while (to_submit > 0) {
+    int submitted = IoUringEnter(ring_.fd, to_submit, 0, 0);
+    if (submitted >= 0) {
+      to_submit -= submitted;
+      continue;
+    }
+    if (errno == EINTR) continue;
+    if (errno == EAGAIN || errno == EBUSY) {
+      // The kernel is out of memory for requests, or its completion backlog
+      // is full. The completion thread keeps draining it, so try again.
+      absl::SleepFor(kRetryDelay);
+      continue;
+    }
+    error = errno;
+    LOG(ERROR) << "io_uring_enter failed: " << strerror(error);
+    // Without SQPOLL, the kernel only reads entries inside io_uring_enter, so
+    // the ones it has not taken can be unpublished.
+    sq_tail_ -= to_submit;
+    __atomic_store_n(ring_.sq_tail, sq_tail_, __ATOMIC_RELEASE);
+    return to_submit;
+  }
+  return 0;
+}
+
+void IoUringBackend::RunCompletionLoop() {
+  while (true) {
+    if (IoUringEnter(ring_.fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+        errno != EINTR) {
+      // Writes already submitted may still complete, so keep reaping until
+      // the backend is destroyed, which only happens once they all have.
+      if (stopping_) return;
+      LOG_EVERY_N_SEC(ERROR, 10)
+          << "io_uring_enter failed while waiting for completions: "
+          << strerror(errno);
+      absl::SleepFor(kRetryDelay);
+    }
+
+    bool stop = false;
+    unsigned head = *ring_.cq_head;
+    unsigned tail = __atomic_load_n(ring_.cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      const io_uring_cqe& cqe = ring_.cqes[head & ring_.cq_mask];
+      if (cqe.user_data == kWakeupUserData) {
+        stop = true;
+        continue;
+      }
+      on_complete_(static_cast<int>(cqe.user_data), cqe.res);
+    }
+    __atomic_store_n(ring_.cq_head, head, __ATOMIC_RELEASE);
+    if (stop) return;
+  }
+}
+
+}  // namespace media_api_samples
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_IO_URING_BACKEND_H_
+#define CPP_SAMPLES_IO_URING_BACKEND_H_
+
+#include <linux/io_uring.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/async_io_backend_interface.h"
+#include "rtc_base/platform_thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// An asynchronous I/O backend that submits writes through io_uring.
+//
+// The pool buffers are registered with the kernel when possible, so writes are
+// issued as `IORING_OP_WRITE_FIXED` and the kernel does not need to map the
+// buffer pages for every write. Completions are reaped on a dedicated thread.
+//
+// This class is thread-safe.
+class IoUringBackend : public AsyncIoBackendInterface {
+ public:
+  // Creates a backend, or returns an error if io_uring is not available (for
+  // example, on older kernels or when it is disabled by seccomp).
+  static absl::StatusOr<std::unique_ptr<IoUringBackend>> Create(
+      absl::Span<const absl::Span<char>> buffers,
+      CompletionCallback on_complete);
+
+  ~IoUringBackend() override;
+
+  void SubmitWrites(absl::Span<const WriteRequest> requests) override;
+
+ private:
+  // The kernel-shared state of an io_uring instance.
+  struct Ring {
+    int fd = -1;
+    void* sq_ring = nullptr;
+    size_t sq_ring_size = 0;
+    void* cq_ring = nullptr;
+    size_t cq_ring_size = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqes_size = 0;
+
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    bool fixed_buffers = false;
+  };
+
+  IoUringBackend(Ring ring, CompletionCallback on_complete)
+      : ring_(std::move(ring)), on_complete_(std::move(on_complete)) {}
+
+  // Queues a submission queue entry and returns it for the caller to fill in.
+  io_uring_sqe& QueueSqe() ABSL_EXCLUSIVE_LOCKS_REQUIRED(submit_mutex_);
+  // Submits the last `to_submit` queued entries to the kernel, retrying while
+  // it is short of resources. On any other failure, withdraws the entries the
+  // kernel did not take and returns their count, with `error` set to `errno`.
+  unsigned Enter(unsigned to_submit, int& error)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(submit_mutex_);
+  // Reaps completions until the wakeup entry queued by the destructor is seen,
+  // or until waiting fails once the destructor has started.
+  void RunCompletionLoop();
+
+  Ring ring_;
+  CompletionCallback on_complete_;
+  // Serializes access to the submission queue.
+  absl::Mutex submit_mutex_;
+  // The submission queue tail, including entries not yet published.
+  unsigned sq_tail_ ABSL_GUARDED_BY(submit_mutex_) = 0;
+  std::atomic<bool> stopping_ = false;
+  webrtc::PlatformThread completion_thread_;
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_IO_URING_BACKEND_H_
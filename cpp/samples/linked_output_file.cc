@@ -0,0 +1,195 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/linked_output_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/log/log.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "meet_clients/samples/output_file.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+std::string DirectoryOf(absl::string_view file_name) {
+  size_t separator = file_name.rfind('/');
+  if (separator == absl::string_view::npos) {
+    return ".";
+  }
+  return std::string(file_name.substr(0, separator == 0 ? 1 : separator));
+}
+
+std::string DescriptorPath(int fd) {
+  return absl::StrCat("/proc/self/fd/", fd);
+}
+
+// Links the file `fd` under `file_name`.
+bool Link(int fd, const std::string& file_name) {
+  if (linkat(AT_FDCWD, DescriptorPath(fd).c_str(), AT_FDCWD,
+             file_name.c_str(), AT_SYMLINK_FOLLOW) == 0) {
+    return true;
+  }
+  // Without /proc, `AT_EMPTY_PATH` links the descriptor directly, but
+  // requires `CAP_DAC_READ_SEARCH`.
+  return errno == ENOENT &&
+         linkat(fd, "", AT_FDCWD, file_name.c_str(), AT_EMPTY_PATH) == 0;
+}
+
+}  // namespace
+
+LinkedOutputWriterPool::~LinkedOutputWriterPool() {
+  absl::MutexLock lock(&mutex_);
+  for (const auto& [file_name, fd] : anonymous_files_) {
+    LOG(WARNING) << "Linking file that was never finalized: " << file_name;
+    LinkFile(fd, file_name);
+  }
+  anonymous_files_.clear();
+
+  LOG(INFO) << "Created " << stats_.anonymous_files << " anonymous files ("
+            << stats_.linked_files << " linked, " << stats_.discarded_files
+            << " discarded, " << stats_.failed_links << " failed to link) and "
+            << stats_.named_files << " named files with "
+            << stats_.directory_operations << " directory operations";
+}
+
+std::unique_ptr<OutputWriterInterface> LinkedOutputWriterPool::CreateWriter(
+    absl::string_view file_name) {
+  int fd = open(DirectoryOf(file_name).c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC,
+                0644);
+  if (fd < 0) {
+    // `O_TMPFILE` fails with `EOPNOTSUPP` on file systems without support, and
+    // with `EISDIR` or `ENOENT` on kernels that predate it.
+    LOG(WARNING) << "Failed to create anonymous file for " << file_name << ": "
+                 << strerror(errno) << ", creating it under its name";
+    {
+      absl::MutexLock lock(&mutex_);
+      stats_.named_files++;
+      stats_.directory_operations++;
+    }
+    absl::MutexLock lock(&provider_mutex_);
+    return provider_(file_name);
+  }
+  LOG(INFO) << "Created anonymous file for " << file_name;
+
+  std::unique_ptr<OutputWriterInterface> output;
+  {
+    absl::MutexLock lock(&provider_mutex_);
+    output = provider_(DescriptorPath(fd));
+  }
+  absl::MutexLock lock(&mutex_);
+  stats_.anonymous_files++;
+  auto [it, inserted] =
+      anonymous_files_.try_emplace(std::string(file_name), fd);
+  if (!inserted) {
+    // Creating a named file would have truncated the previous one.
+    close(it->second);
+    it->second = fd;
+    stats_.discarded_files++;
+  }
+  return output;
+}
+
+void LinkedOutputWriterPool::Rename(absl::string_view from,
+                                    absl::string_view to) {
+  absl::MutexLock lock(&mutex_);
+  auto it = anonymous_files_.find(from);
+  if (it == anonymous_files_.end()) {
+    stats_.directory_operations++;
+    RenameOutputFile(from, to);
+    return;
+  }
+  int fd = it->second;
+  anonymous_files_.erase(it);
+  LinkFile(fd, to);
+}
+
+void LinkedOutputWriterPool::Remove(absl::string_view file_name) {
+  absl::MutexLock lock(&mutex_);
+  auto it = anonymous_files_.find(file_name);
+  if (it == anonymous_files_.end()) {
+    stats_.directory_operations++;
+    RemoveOutputFile(file_name);
+    return;
+  }
+  close(it->second);
+  anonymous_files_.erase(it);
+  stats_.discarded_files++;
+}
+
+LinkedOutputWriterPool::Stats LinkedOutputWriterPool::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void LinkedOutputWriterPool::LinkFile(int fd, absl::string_view file_name) {
+  std::string file_name_string(file_name);
+  bool linked = Link(fd, file_name_string);
+  stats_.directory_operations++;
+  if (!linked && errno == EEXIST) {
+    // Match the rename this replaces, which replaces an existing file.
+    unlink(file_name_string.c_str());
+    linked = Link(fd, file_name_string);
+    stats_.directory_operations += 2;
+  }
+  if (linked) {
+    stats_.linked_files++;
+  } else {
+    LOG(ERROR) << "Failed to link file " << file_name << ": "
+               << strerror(errno);
+    stats_.failed_links++;
+  }
+  close(fd);
+}
+
+OutputWriterProvider CreateLinkedOutputFileProvider(
+    std::shared_ptr<LinkedOutputWriterPool> pool) {
+  return [pool = std::move(pool)](absl::string_view file_name) {
+    return pool->CreateWriter(file_name);
+  };
+}
+
+OutputFileRenamer CreateLinkedOutputFileRenamer(
+    std::shared_ptr<LinkedOutputWriterPool> pool) {
+  return [pool = std::move(pool)](absl::string_view from,
+                                  absl::string_view to) {
+    pool->Rename(from, to);
+  };
+}
+
+OutputFileRemover CreateLinkedOutputFileRemover(
+    std::shared_ptr<LinkedOutputWriterPool> pool) {
+  return [pool = std::move(pool)](absl::string_view file_name) {
+    pool->Remove(file_name);
+  };
+}
+
+}  // namespace media_api_samples
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_LINKED_OUTPUT_FILE_H_
+#define CPP_SAMPLES_LINKED_OUTPUT_FILE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Writes files through another provider as anonymous files, which only get a
+// name once they are finalized.
+//
+// Segments are written under a temporary name and renamed once their end is
+// known, which costs two directory operations per segment: creating the
+// temporary entry and renaming it. Instead, this pool creates each file with
+// `O_TMPFILE` in the directory of its name, and `Rename` links the finished
+// file under its final name with `linkat`, which is the only directory
+// operation the file ever causes. Files that are removed before being renamed,
+// such as unused pre-opened segment files, never touch their directory.
+//
+// The wrapped provider is asked for a `/proc/self/fd/` path, which reopens the
+// anonymous file, so any writer that opens files by name can be used. If a
+// file system does not support `O_TMPFILE`, files are created under their name
+// and renamed as usual.
+//
+// Anonymous files are not visible in their directory while they are written,
+// and files still open when the process crashes are lost. Files that are never
+// renamed or removed are linked under their original name when the pool is
+// destroyed.
+//
+// This class is thread-safe.
+class LinkedOutputWriterPool {
+ public:
+  struct Stats {
+    // Files created without a name.
+    int64_t anonymous_files = 0;
+    // Anonymous files linked under their final name.
+    int64_t linked_files = 0;
+    // Anonymous files removed before being linked.
+    int64_t discarded_files = 0;
+    // Files created under their name, because `O_TMPFILE` was not supported.
+    int64_t named_files = 0;
+    int64_t failed_links = 0;
+    // Directory entries created, renamed, or removed by the pool.
+    int64_t directory_operations = 0;
+  };
+
+  explicit LinkedOutputWriterPool(OutputWriterProvider provider)
+      : provider_(std::move(provider)) {}
+
+  // Links the files that were never renamed or removed under their original
+  // names.
+  ~LinkedOutputWriterPool();
+
+  // Creates an anonymous file in the directory of `file_name`, and returns a
+  // writer for it from the wrapped provider.
+  std::unique_ptr<OutputWriterInterface> CreateWriter(
+      absl::string_view file_name);
+
+  // Links the anonymous file created for `from` under `to`, replacing any
+  // existing file. Other files are renamed in place. Writers may still be
+  // flushing the file when it is linked.
+  void Rename(absl::string_view from, absl::string_view to);
+  // Drops the anonymous file created for `file_name`. Other files are
+  // removed in place.
+  void Remove(absl::string_view file_name);
+
+  Stats GetStats() const;
+
+ private:
+  // Links the anonymous file `fd` under `file_name`, and closes it.
+  void LinkFile(int fd, absl::string_view file_name)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Providers are not required to be thread-safe.
+  absl::Mutex provider_mutex_;
+  OutputWriterProvider provider_ ABSL_GUARDED_BY(provider_mutex_);
+
+  mutable absl::Mutex mutex_;
+  // Descriptors of the anonymous files that have not been linked or removed,
+  // by the name they were created with.
+  absl::flat_hash_map<std::string, int> anonymous_files_
+      ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Returns a provider that creates files from `pool`.
+OutputWriterProvider CreateLinkedOutputFileProvider(
+    std::shared_ptr<LinkedOutputWriterPool> pool);
+
+// Returns a renamer that finalizes files created by `pool`.
+OutputFileRenamer CreateLinkedOutputFileRenamer(
+    std::shared_ptr<LinkedOutputWriterPool> pool);
+
+// Returns a remover that drops files created by `pool`.
+OutputFileRemover CreateLinkedOutputFileRemover(
+    std::shared_ptr<LinkedOutputWriterPool> pool);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_LINKED_OUTPUT_FILE_H_
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/linked_output_file.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "meet_clients/samples/output_file.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+std::string ReadFile(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+bool FileExists(const std::string& file_name) {
+  return access(file_name.c_str(), F_OK) == 0;
+}
+
+// Creates an empty directory for the test and returns its path with a
+// trailing separator.
+std::string CreateDirectory(absl::string_view name) {
+  std::string directory = absl::StrCat(::testing::TempDir(), "linked_", name);
+  mkdir(directory.c_str(), 0755);
+  return absl::StrCat(directory, "/");
+}
+
+TEST(LinkedOutputFileTest, LinksFileUnderFinalNameOnRename) {
+  std::string directory = CreateDirectory("rename");
+  auto pool =
+      std::make_shared<LinkedOutputWriterPool>(CreateOutputFileProvider());
+
+  std::unique_ptr<OutputWriterInterface> writer =
+      pool->CreateWriter(absl::StrCat(directory, "audio_1_tmp.pcm"));
+  writer->Write("abc", 3);
+  writer->Close();
+  EXPECT_FALSE(FileExists(absl::StrCat(directory, "audio_1_tmp.pcm")));
+
+  pool->Rename(absl::StrCat(directory, "audio_1_tmp.pcm"),
+               absl::StrCat(directory, "audio_1_start_end.pcm"));
+
+  EXPECT_EQ(ReadFile(absl::StrCat(directory, "audio_1_start_end.pcm")),
+            "abc");
+  EXPECT_FALSE(FileExists(absl::StrCat(directory, "audio_1_tmp.pcm")));
+  LinkedOutputWriterPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(stats.anonymous_files, 1);
+  EXPECT_EQ(stats.linked_files, 1);
+  EXPECT_EQ(stats.directory_operations, 1);
+}
+
+TEST(LinkedOutputFileTest, RenameReplacesExistingFile) {
+  std::string directory = CreateDirectory("replace");
+  std::ofstream(absl::StrCat(directory, "video_1.yuv")) << "old";
+  auto pool =
+      std::make_shared<LinkedOutputWriterPool>(CreateOutputFileProvider());
+
+  std::unique_ptr<OutputWriterInterface> writer =
+      pool->CreateWriter(absl::StrCat(directory, "video_1_tmp.yuv"));
+  writer->Write("new", 3);
+  writer->Close();
+  pool->Rename(absl::StrCat(directory, "video_1_tmp.yuv"),
+               absl::StrCat(directory, "video_1.yuv"));
+
+  EXPECT_EQ(ReadFile(absl::StrCat(directory, "video_1.yuv")), "new");
+  EXPECT_EQ(pool->GetStats().failed_links, 0);
+}
+
+TEST(LinkedOutputFileTest, RemoveDropsFileWithoutDirectoryOperations) {
+  std::string directory = CreateDirectory("remove");
+  auto pool =
+      std::make_shared<LinkedOutputWriterPool>(CreateOutputFileProvider());
+
+  std::unique_ptr<OutputWriterInterface> writer =
+      pool->CreateWriter(absl::StrCat(directory, "media_1_tmp1.webm"));
+  writer->Close();
+  pool->Remove(absl::StrCat(directory, "media_1_tmp1.webm"));
+
+  EXPECT_FALSE(FileExists(absl::StrCat(directory, "media_1_tmp1.webm")));
+  LinkedOutputWriterPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(stats.discarded_files, 1);
+  EXPECT_EQ(stats.directory_operations, 0);
+}
+
+TEST(LinkedOutputFileTest, RenamesOtherFilesInPlace) {
+  std::string directory = CreateDirectory("other");
+  std::ofstream(absl::StrCat(directory, "event_log_tmp.csv")) << "log";
+  auto pool =
+      std::make_shared<LinkedOutputWriterPool>(CreateOutputFileProvider());
+
+  pool->Rename(absl::StrCat(directory, "event_log_tmp.csv"),
+               absl::StrCat(directory, "event_log.csv"));
+
+  EXPECT_EQ(ReadFile(absl::StrCat(directory, "event_log.csv")), "log");
+  EXPECT_EQ(pool->GetStats().directory_operations, 1);
+}
+
+TEST(LinkedOutputFileTest, LinksUnfinalizedFilesOnDestruction) {
+  std::string directory = CreateDirectory("unfinalized");
+  {
+    auto pool =
+        std::make_shared<LinkedOutputWriterPool>(CreateOutputFileProvider());
+    std::unique_ptr<OutputWriterInterface> writer =
+        pool->CreateWriter(absl::StrCat(directory, "audio_2_tmp.pcm"));
+    writer->Write("abc", 3);
+    writer->Close();
+  }
+
+  EXPECT_EQ(ReadFile(absl::StrCat(directory, "audio_2_tmp.pcm")), "abc");
+}
+
+TEST(LinkedOutputFileTest, CreatesNamedFileWhenAnonymousFileFails) {
+  auto pool =
+      std::make_shared<LinkedOutputWriterPool>(CreateOutputFileProvider());
+
+  pool->CreateWriter(absl::StrCat(::testing::TempDir(), "missing/audio.pcm"))
+      ->Close();
+
+  LinkedOutputWriterPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(stats.anonymous_files, 0);
+  EXPECT_EQ(stats.named_files, 1);
+}
+
+}  // namespace
+}  // namespace media_api_samples
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/mapped_output_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <memory>
+#include <string>
+
+#include "absl/base/nullability.h"
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+std::unique_ptr<MappedOutputFile> MappedOutputFile::Open(
+    absl::string_view file_name, const Options& options) {
+  // Mapping offsets must be page-aligned.
+  size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t extent_size =
+      std::max<size_t>(1, (options.extent_size + page_size - 1) / page_size) *
+      page_size;
+
+  // The mapping is shared and writable, which requires read access as well.
+  int fd = open(std::string(file_name).c_str(),
+                O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd >= 0) {
+    LOG(INFO) << "Opened file: " << file_name;
+  } else {
+    // If a file cannot be opened, the sample will still run, but written data
+    // will be lost.
+    LOG(ERROR) << "Failed to open file: " << file_name << ": "
+               << strerror(errno);
+  }
+  return absl::WrapUnique(new MappedOutputFile(fd, extent_size));
+}
+
+MappedOutputFile::~MappedOutputFile() { Close(); }
+
+void MappedOutputFile::Write(const char* content, std::streamsize size) {
+  while (size > 0 && fd_ >= 0) {
+    if (extent_ == nullptr || extent_used_ == extent_size_) {
+      if (!MapNextExtent()) return;
+    }
+    size_t copy_size = std::min<size_t>(size, extent_size_ - extent_used_);
+    memcpy(extent_ + extent_used_, content, copy_size);
+    extent_used_ += copy_size;
+    content += copy_size;
+    size -= copy_size;
+  }
+}
+
+void MappedOutputFile::Close() {
+  if (fd_ < 0) return;
+
+  int64_t file_size = extent_offset_;
+  if (extent_ != nullptr) {
+    munmap(extent_, extent_size_);
+    extent_ = nullptr;
+    file_size += extent_used_;
+  }
+  // Release the reserved but unused tail of the last extent.
+  if (ftruncate(fd_, file_size) != 0) {
+    LOG(ERROR) << "Failed to truncate fd " << fd_ << ": " << strerror(errno);
+  }
+  close(fd_);
+  fd_ = -1;
+}
+
+bool MappedOutputFile::MapNextExtent() {
+  if (extent_ != nullptr) {
+    munmap(extent_, extent_size_);
+    extent_ = nullptr;
+    extent_offset_ += extent_size_;
+    extent_used_ = 0;
+  }
+
+  int result = fallocate(fd_, 0, extent_offset_, extent_size_);
+  if (result != 0 && errno == EOPNOTSUPP) {
+    // Without `fallocate` support, extend the file without reserving space.
+    // Running out of space will then raise `SIGBUS` while copying.
+    result = ftruncate(fd_, extent_offset_ + extent_size_);
+  }
+  if (result != 0) {
+    Fail("reserve extent");
+    return false;
+  }
+
+  void* extent = mmap(nullptr, extent_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd_, extent_offset_);
+  if (extent == MAP_FAILED) {
+    Fail("map extent");
+    return false;
+  }
+  // Data is only ever appended, so pages around a write fault are not read
+  // ahead of time.
+  madvise(extent, extent_size_, MADV_RANDOM);
+  extent_ = static_cast<char*>(extent);
+  return true;
+}
+
+void MappedOutputFile::Fail(absl::string_view operation) {
+  LOG(ERROR) << "Failed to " << operation << " for fd " << fd_ << ": "
+             << strerror(errno) << ". Further data will be dropped.";
+  // Keep whatever was written before the failure.
+  if (ftruncate(fd_, extent_offset_ + extent_used_) != 0) {
+    LOG(ERROR) << "Failed to truncate fd " << fd_ << ": " << strerror(errno);
+  }
+  close(fd_);
+  fd_ = -1;
+}
+
+OutputWriterProvider CreateMappedOutputFileProvider(
+    MappedOutputFile::Options options) {
+  return [options](absl::string_view file_name) {
+    return MappedOutputFile::Open(file_name, options);
+  };
+}
+
+}  // namespace media_api_samples
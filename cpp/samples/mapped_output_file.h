@@ -0,0 +1,90 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_MAPPED_OUTPUT_FILE_H_
+#define CPP_SAMPLES_MAPPED_OUTPUT_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <memory>
+
+#include "absl/base/nullability.h"
+#include "absl/strings/string_view.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// An output writer that copies data directly into a memory mapping of the
+// file.
+//
+// The file is grown in large extents that are reserved up front with
+// `fallocate`, so that running out of disk space is reported when an extent is
+// added rather than as a `SIGBUS` while copying. Only the extent currently
+// being written is mapped. Writing a frame is then a `memcpy` per chunk, with
+// a system call only once per extent. The unused tail of the last extent is
+// truncated when the file is closed.
+//
+// This class is not thread-safe.
+class MappedOutputFile : public OutputWriterInterface {
+ public:
+  struct Options {
+    // Size of each extent, in bytes. Rounded up to a multiple of the page
+    // size.
+    size_t extent_size = 64 << 20;
+  };
+
+  // Opens `file_name`, truncating any existing file. If the file cannot be
+  // opened, the returned writer drops all data.
+  static std::unique_ptr<MappedOutputFile> Open(absl::string_view file_name,
+                                                const Options& options);
+
+  ~MappedOutputFile() override;
+
+  void Write(const char* content, std::streamsize size) override;
+  void Close() override;
+
+ private:
+  MappedOutputFile(int fd, size_t extent_size)
+      : fd_(fd), extent_size_(extent_size) {}
+
+  // Unmaps the current extent, if any, and maps the next one. Returns false if
+  // the extent could not be reserved or mapped.
+  bool MapNextExtent();
+  // Closes the file after a failure; further data is dropped.
+  void Fail(absl::string_view operation);
+
+  // The file descriptor, or -1 if the file failed to open, failed to grow, or
+  // has been closed.
+  int fd_;
+  size_t extent_size_;
+  // The mapping of the current extent, or null if none is mapped.
+  char* /*absl_nullable*/ extent_ = nullptr;
+  // File offset of the start of the current extent.
+  int64_t extent_offset_ = 0;
+  // Number of bytes written to the current extent.
+  size_t extent_used_ = 0;
+};
+
+// Returns a provider that creates `MappedOutputFile`s.
+OutputWriterProvider CreateMappedOutputFileProvider(
+    MappedOutputFile::Options options);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_MAPPED_OUTPUT_FILE_H_
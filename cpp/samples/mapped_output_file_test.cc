@@ -0,0 +1,101 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/mapped_output_file.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+std::string ReadFile(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+std::string CreateTestData(int size) {
+  std::string data;
+  for (int i = 0; i < size; ++i) {
+    data.push_back('a' + i % 26);
+  }
+  return data;
+}
+
+TEST(MappedOutputFileTest, WritesDataAcrossExtentsAndTruncatesTail) {
+  std::string file_name = absl::StrCat(::testing::TempDir(), "mapped");
+  // Extents are rounded up to the page size, so this spans several extents
+  // and ends partway through the last one.
+  std::string data = CreateTestData(5 * sysconf(_SC_PAGESIZE) / 2);
+  std::unique_ptr<OutputWriterInterface> writer =
+      MappedOutputFile::Open(file_name, {.extent_size = 1});
+
+  absl::string_view remaining(data);
+  while (!remaining.empty()) {
+    absl::string_view piece = remaining.substr(0, 1000);
+    writer->Write(piece.data(), piece.size());
+    remaining.remove_prefix(piece.size());
+  }
+  writer->Close();
+
+  EXPECT_EQ(ReadFile(file_name), data);
+}
+
+TEST(MappedOutputFileTest, WritesChunksAndClosesOnDestruction) {
+  std::string file_name = absl::StrCat(::testing::TempDir(), "mapped_chunks");
+  std::string data = CreateTestData(100);
+  {
+    OutputWriterProvider provider = CreateMappedOutputFileProvider({});
+    std::unique_ptr<OutputWriterInterface> writer = provider(file_name);
+    absl::string_view view(data);
+    absl::Span<const char> chunks[] = {view.substr(0, 10), view.substr(10)};
+    writer->WriteChunks(chunks);
+  }
+
+  EXPECT_EQ(ReadFile(file_name), data);
+}
+
+TEST(MappedOutputFileTest, EmptyFileHasNoReservedSpace) {
+  std::string file_name = absl::StrCat(::testing::TempDir(), "mapped_empty");
+  MappedOutputFile::Open(file_name, {})->Close();
+
+  EXPECT_EQ(ReadFile(file_name), "");
+}
+
+TEST(MappedOutputFileTest, DropsDataWhenFileCannotBeOpened) {
+  std::unique_ptr<OutputWriterInterface> writer =
+      MappedOutputFile::Open("/nonexistent_directory/file", {});
+
+  writer->Write("abc", 3);
+  writer->Close();
+}
+
+}  // namespace
+}  // namespace media_api_samples
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Splits a media chunk log written by the multi-user sample with --chunk_log
+// back into a raw stream per participant, as described in `media_chunk_log.h`.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "absl/base/nullability.h"
+#include "absl/cleanup/cleanup.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "meet_clients/samples/media_chunk_log.h"
+#include "meet_clients/samples/output_file.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+ABSL_FLAG(std::string, chunk_log, "", "The media chunk log to split.");
+
+ABSL_FLAG(std::string, output_file_prefix, "/tmp/test_output_",
+          "Directory and file prefix where the streams will be written.");
+
+int main(int argc, char** argv) {
+  absl::SetProgramUsageMessage(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  std::string chunk_log_path = absl::GetFlag(FLAGS_chunk_log);
+  if (chunk_log_path.empty()) {
+    LOG(ERROR) << "Chunk log is empty";
+    return EXIT_FAILURE;
+  }
+
+  // Logs of long conferences can be larger than memory, so the log is mapped
+  // rather than read, and its pages are loaded as the chunks are extracted.
+  int fd = open(chunk_log_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG(ERROR) << "Failed to open chunk log: " << chunk_log_path << ": "
+               << strerror(errno);
+    return EXIT_FAILURE;
+  }
+  absl::Cleanup close_file = [fd] { close(fd); };
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    LOG(ERROR) << "Failed to stat chunk log: " << chunk_log_path << ": "
+               << strerror(errno);
+    return EXIT_FAILURE;
+  }
+  size_t size = static_cast<size_t>(file_stat.st_size);
+  // Mapping an empty file fails, but an empty log is rejected as any other
+  // file that is not a chunk log.
+  void* data = nullptr;
+  if (size > 0) {
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      LOG(ERROR) << "Failed to map chunk log: " << chunk_log_path << ": "
+                 << strerror(errno);
+      return EXIT_FAILURE;
+    }
+    // Chunks are extracted in order.
+    madvise(data, size, MADV_SEQUENTIAL);
+  }
+  absl::Cleanup unmap_file = [data, size] {
+    if (data != nullptr) munmap(data, size);
+  };
+  absl::string_view contents(static_cast<const char*>(data), size);
+
+  media_api_samples::OutputWriterProvider provider =
+      media_api_samples::CreateOutputFileProvider();
+  if (absl::Status status = media_api_samples::ExtractMediaChunkStreams(
+          contents, absl::GetFlag(FLAGS_output_file_prefix), provider);
+      !status.ok()) {
+    LOG(ERROR) << "Failed to split chunk log: " << status;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
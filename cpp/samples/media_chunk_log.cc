@@ -0,0 +1,370 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/media_chunk_log.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/media_writing.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/segment_index.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+constexpr absl::string_view kHeader("MCHK\x01\0\0\0", 8);
+constexpr absl::string_view kIndexMagic = "MCIX";
+constexpr int64_t kChunkHeaderSize = 32;
+constexpr int64_t kIndexEntrySize = 24;
+constexpr int64_t kDirectoryEntrySize = 8;
+constexpr int64_t kDirectoryTrailerSize = 16;
+// The kind of index blocks, which are not media and so not a `MediaChunkKind`.
+constexpr uint8_t kIndexBlockKind = 3;
+
+void StoreLittleEndian(uint64_t value, int size, char* output) {
+  for (int i = 0; i < size; ++i) {
+    output[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+uint64_t LoadLittleEndian(const char* input, int size) {
+  uint64_t value = 0;
+  for (int i = 0; i < size; ++i) {
+    value |= uint64_t{static_cast<uint8_t>(input[i])} << (8 * i);
+  }
+  return value;
+}
+
+bool IsValidKind(uint8_t kind) {
+  return kind == static_cast<uint8_t>(MediaChunkKind::kAudio) ||
+         kind == static_cast<uint8_t>(MediaChunkKind::kVideo);
+}
+
+bool IsIndexBlock(const MediaChunk& chunk) {
+  return static_cast<uint8_t>(chunk.kind) == kIndexBlockKind;
+}
+
+void WriteRawChunkHeader(uint8_t kind, uint32_t contributing_source,
+                         int64_t received_time_us, uint32_t rtp_timestamp,
+                         int width, int height, int64_t payload_size,
+                         OutputWriterInterface& output) {
+  std::array<char, kChunkHeaderSize> header = {};
+  StoreLittleEndian(payload_size, 4, &header[0]);
+  header[4] = static_cast<char>(kind);
+  StoreLittleEndian(contributing_source, 4, &header[8]);
+  StoreLittleEndian(rtp_timestamp, 4, &header[12]);
+  StoreLittleEndian(received_time_us, 8, &header[16]);
+  StoreLittleEndian(width, 2, &header[24]);
+  StoreLittleEndian(height, 2, &header[26]);
+  output.Write(header.data(), header.size());
+}
+
+// Parses the chunk at the start of `chunks` into `chunk`, and sets `size` to
+// its size including the header. Returns an out of range error if the chunk is
+// cut short. Index blocks are parsed as well, see `IsIndexBlock`.
+absl::Status ParseChunk(absl::string_view chunks, MediaChunk& chunk,
+                        int64_t& size) {
+  if (chunks.size() < kChunkHeaderSize) {
+    return absl::OutOfRangeError("Chunk header is cut short");
+  }
+  const char* header = chunks.data();
+  int64_t payload_size = static_cast<int64_t>(LoadLittleEndian(header, 4));
+  uint8_t kind = static_cast<uint8_t>(header[4]);
+  if (!IsValidKind(kind) && kind != kIndexBlockKind) {
+    return absl::DataLossError(
+        absl::StrCat("Chunk has unknown kind ", int{kind}));
+  }
+  size = kChunkHeaderSize + payload_size;
+  if (size > chunks.size()) {
+    return absl::OutOfRangeError("Chunk payload is cut short");
+  }
+  chunk = {
+      .kind = static_cast<MediaChunkKind>(kind),
+      .contributing_source =
+          static_cast<uint32_t>(LoadLittleEndian(header + 8, 4)),
+      .received_time = absl::FromUnixMicros(
+          static_cast<int64_t>(LoadLittleEndian(header + 16, 8))),
+      .rtp_timestamp = static_cast<uint32_t>(LoadLittleEndian(header + 12, 4)),
+      .width = static_cast<int>(LoadLittleEndian(header + 24, 2)),
+      .height = static_cast<int>(LoadLittleEndian(header + 26, 2)),
+      .payload = chunks.substr(kChunkHeaderSize, payload_size)};
+  return absl::OkStatus();
+}
+
+// Appends the entries of the index block at `offset` of `contents` to
+// `index`. `chunks_end` is the offset of the directory.
+absl::Status ParseIndexBlock(absl::string_view contents, int64_t offset,
+                             int64_t chunks_end,
+                             std::vector<MediaChunkIndexEntry>& index) {
+  MediaChunk block;
+  int64_t size = 0;
+  if (offset < kHeader.size() || offset >= chunks_end ||
+      !ParseChunk(contents.substr(offset, chunks_end - offset), block, size)
+           .ok() ||
+      !IsIndexBlock(block) || block.payload.size() % kIndexEntrySize != 0) {
+    return absl::DataLossError("Media chunk log index is corrupt");
+  }
+  for (int64_t i = 0; i < block.payload.size(); i += kIndexEntrySize) {
+    const char* entry = block.payload.data() + i;
+    if (!IsValidKind(static_cast<uint8_t>(entry[20]))) {
+      return absl::DataLossError("Media chunk log index is corrupt");
+    }
+    index.push_back(
+        {.offset = static_cast<int64_t>(LoadLittleEndian(entry, 8)),
+         .received_time = absl::FromUnixMicros(
+             static_cast<int64_t>(LoadLittleEndian(entry + 8, 8))),
+         .contributing_source =
+             static_cast<uint32_t>(LoadLittleEndian(entry + 16, 4)),
+         .kind = static_cast<MediaChunkKind>(entry[20])});
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+MediaChunkLogWriter::MediaChunkLogWriter(
+    std::unique_ptr<OutputWriterInterface> output, int64_t index_block_entries)
+    : output_(std::move(output)),
+      index_block_entries_(std::max<int64_t>(1, index_block_entries)) {
+  output_->Write(kHeader.data(), kHeader.size());
+  offset_ = kHeader.size();
+}
+
+MediaChunkLogWriter::~MediaChunkLogWriter() { Close(); }
+
+void MediaChunkLogWriter::WriteAudio(uint32_t contributing_source,
+                                     absl::Time received_time,
+                                     absl::Span<const int16_t> pcm16) {
+  if (output_ == nullptr) return;
+  WriteChunkHeader(MediaChunkKind::kAudio, contributing_source, received_time,
+                   /*rtp_timestamp=*/0, /*width=*/0, /*height=*/0,
+                   pcm16.size() * sizeof(int16_t));
+  WritePcm16(pcm16, *output_);
+}
+
+void MediaChunkLogWriter::WriteVideo(uint32_t contributing_source,
+                                     absl::Time received_time,
+                                     uint32_t rtp_timestamp,
+                                     const webrtc::I420BufferInterface& frame) {
+  if (output_ == nullptr) return;
+  int64_t chroma_size =
+      int64_t{(frame.width() + 1) / 2} * ((frame.height() + 1) / 2);
+  WriteChunkHeader(MediaChunkKind::kVideo, contributing_source, received_time,
+                   rtp_timestamp, frame.width(), frame.height(),
+                   int64_t{frame.width()} * frame.height() + 2 * chroma_size);
+  WriteYuv420(frame, *output_, scratch_);
+}
+
+void MediaChunkLogWriter::WriteChunkHeader(
+    MediaChunkKind kind, uint32_t contributing_source, absl::Time received_time,
+    uint32_t rtp_timestamp, int width, int height, int64_t payload_size) {
+  // The block is written before the next chunk rather than after the last one,
+  // since the payload of the last one follows its header.
+  if (index_.size() >= index_block_entries_ * kIndexEntrySize) {
+    WriteIndexBlock();
+  }
+  int64_t received_time_us = absl::ToUnixMicros(received_time);
+  WriteRawChunkHeader(static_cast<uint8_t>(kind), contributing_source,
+                      received_time_us, rtp_timestamp, width, height,
+                      payload_size, *output_);
+
+  std::array<char, kIndexEntrySize> entry = {};
+  StoreLittleEndian(offset_, 8, &entry[0]);
+  StoreLittleEndian(received_time_us, 8, &entry[8]);
+  StoreLittleEndian(contributing_source, 4, &entry[16]);
+  entry[20] = static_cast<char>(kind);
+  index_.append(entry.data(), entry.size());
+  offset_ += kChunkHeaderSize + payload_size;
+}
+
+void MediaChunkLogWriter::WriteIndexBlock() {
+  WriteRawChunkHeader(kIndexBlockKind, /*contributing_source=*/0,
+                      /*received_time_us=*/0, /*rtp_timestamp=*/0,
+                      /*width=*/0, /*height=*/0, index_.size(), *output_);
+  output_->Write(index_.data(), index_.size());
+  index_block_offsets_.push_back(offset_);
+  offset_ += kChunkHeaderSize + index_.size();
+  index_.clear();
+}
+
+void MediaChunkLogWriter::Close() {
+  if (output_ == nullptr) return;
+  if (!index_.empty()) {
+    WriteIndexBlock();
+  }
+  std::string directory(
+      index_block_offsets_.size() * kDirectoryEntrySize + kDirectoryTrailerSize,
+      '\0');
+  char* next = directory.data();
+  for (int64_t block_offset : index_block_offsets_) {
+    StoreLittleEndian(block_offset, 8, next);
+    next += kDirectoryEntrySize;
+  }
+  StoreLittleEndian(offset_, 8, next);
+  StoreLittleEndian(index_block_offsets_.size(), 4, next + 8);
+  kIndexMagic.copy(next + 12, kIndexMagic.size());
+  output_->Write(directory.data(), directory.size());
+  output_->Close();
+  output_ = nullptr;
+  index_block_offsets_.clear();
+}
+
+absl::StatusOr<std::unique_ptr<MediaChunkLogReader>>
+MediaChunkLogReader::Create(absl::string_view contents) {
+  if (!absl::StartsWith(contents, kHeader)) {
+    return absl::InvalidArgumentError("Not a media chunk log");
+  }
+
+  // Without an index, all remaining data is chunks, the last of which may be
+  // cut short.
+  int64_t size = contents.size();
+  if (size < kHeader.size() + kDirectoryTrailerSize ||
+      !absl::EndsWith(contents, kIndexMagic)) {
+    return absl::WrapUnique(new MediaChunkLogReader(
+        contents, /*chunks_end=*/size, /*complete=*/false, {}));
+  }
+  const char* trailer = contents.data() + size - kDirectoryTrailerSize;
+  int64_t directory_offset =
+      static_cast<int64_t>(LoadLittleEndian(trailer, 8));
+  int64_t block_count = static_cast<int64_t>(LoadLittleEndian(trailer + 8, 4));
+  if (directory_offset < kHeader.size() ||
+      directory_offset + block_count * kDirectoryEntrySize +
+              kDirectoryTrailerSize !=
+          size) {
+    return absl::DataLossError("Media chunk log index is corrupt");
+  }
+  std::vector<MediaChunkIndexEntry> index;
+  for (int64_t i = 0; i < block_count; ++i) {
+    int64_t block_offset = static_cast<int64_t>(LoadLittleEndian(
+        contents.data() + directory_offset + i * kDirectoryEntrySize, 8));
+    if (absl::Status status =
+            ParseIndexBlock(contents, block_offset, directory_offset, index);
+        !status.ok()) {
+      return status;
+    }
+  }
+  return absl::WrapUnique(new MediaChunkLogReader(
+      contents, directory_offset, /*complete=*/true, std::move(index)));
+}
+
+absl::StatusOr<MediaChunk> MediaChunkLogReader::ReadChunk(
+    int64_t offset) const {
+  if (offset < kHeader.size() || offset >= chunks_end_) {
+    return absl::OutOfRangeError(
+        absl::StrCat("No media chunk at offset ", offset));
+  }
+  MediaChunk chunk;
+  int64_t size = 0;
+  absl::Status status = ParseChunk(
+      contents_.substr(offset, chunks_end_ - offset), chunk, size);
+  if (!status.ok()) {
+    return status;
+  }
+  if (IsIndexBlock(chunk)) {
+    return absl::OutOfRangeError(
+        absl::StrCat("No media chunk at offset ", offset));
+  }
+  return chunk;
+}
+
+bool MediaChunkLogReader::Next(MediaChunk& chunk) {
+  do {
+    if (!status_.ok() || next_offset_ >= chunks_end_) {
+      return false;
+    }
+    int64_t size = 0;
+    absl::Status status =
+        ParseChunk(contents_.substr(next_offset_, chunks_end_ - next_offset_),
+                   chunk, size);
+    if (absl::IsOutOfRange(status) && !complete_) {
+      // The writer stopped in the middle of this chunk.
+      next_offset_ = chunks_end_;
+      return false;
+    }
+    if (!status.ok()) {
+      status_ = absl::DataLossError(
+          absl::StrCat("Media chunk log is corrupt at offset ", next_offset_,
+                       ": ", status.message()));
+      return false;
+    }
+    next_offset_ += size;
+  } while (IsIndexBlock(chunk));
+  return true;
+}
+
+absl::Status ExtractMediaChunkStreams(absl::string_view contents,
+                                      absl::string_view output_file_prefix,
+                                      OutputWriterProvider& provider) {
+  absl::StatusOr<std::unique_ptr<MediaChunkLogReader>> reader =
+      MediaChunkLogReader::Create(contents);
+  if (!reader.ok()) {
+    return reader.status();
+  }
+
+  struct Stream {
+    std::unique_ptr<OutputWriterInterface> output;
+    SegmentIndexWriter index;
+  };
+  // Maps from file name to the stream written to it.
+  absl::flat_hash_map<std::string, std::unique_ptr<Stream>> streams;
+  MediaChunk chunk;
+  while ((*reader)->Next(chunk)) {
+    std::string file_name =
+        chunk.kind == MediaChunkKind::kAudio
+            ? absl::StrFormat("%saudio_%d.pcm", output_file_prefix,
+                              chunk.contributing_source)
+            : absl::StrFormat("%svideo_%d_%dx%d.yuv", output_file_prefix,
+                              chunk.contributing_source, chunk.width,
+                              chunk.height);
+    std::unique_ptr<Stream>& stream = streams[file_name];
+    if (stream == nullptr) {
+      stream = absl::WrapUnique(
+          new Stream{.output = provider(file_name),
+                     .index = SegmentIndexWriter(
+                         provider(SegmentIndexFileName(file_name)))});
+    }
+    stream->index.AddFrame(chunk.payload.size(), chunk.received_time,
+                           chunk.rtp_timestamp, chunk.contributing_source);
+    stream->output->Write(chunk.payload.data(), chunk.payload.size());
+  }
+  for (auto& [file_name, stream] : streams) {
+    stream->index.Close();
+    stream->output->Close();
+  }
+  return (*reader)->status();
+}
+
+}  // namespace media_api_samples
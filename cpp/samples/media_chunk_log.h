@@ -0,0 +1,189 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_MEDIA_CHUNK_LOG_H_
+#define CPP_SAMPLES_MEDIA_CHUNK_LOG_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// A single file holding the media of every participant of a conference, as an
+// alternative to one file per segment for conferences with many participants.
+//
+// Frames are appended as chunks in the order they are received. The index of
+// the chunks is written in blocks between them, so that the writer only keeps
+// the entries of one block in memory, and the offsets of the blocks are
+// appended on close:
+//
+//   file    := "MCHK" version:u8 0:u8[3] chunk* directory?
+//   chunk   := payload_size:u32 kind:u8 0:u8[3] contributing_source:u32
+//              rtp_timestamp:u32 received_time_us:i64 width:u16 height:u16
+//              0:u32 payload
+//   directory := block_offset:u64* directory_offset:u64 block_count:u32
+//                "MCIX"
+//
+// Integers are little-endian. Audio payloads (kind 1) are pcm16 samples and
+// video payloads (kind 2) are I420 frames, as in raw segments. Audio frames
+// are delivered without an RTP timestamp or dimensions, so these are zero for
+// them. Index blocks (kind 3) have no other fields, and their payload is an
+// entry for each chunk since the previous block:
+//
+//   entry   := offset:u64 received_time_us:i64 contributing_source:u32
+//              kind:u8 0:u8[3]
+//
+// A log without a directory, e.g. after a crash, can still be read up to its
+// last complete chunk, since chunks are self-describing.
+
+enum class MediaChunkKind : uint8_t {
+  kAudio = 1,
+  kVideo = 2,
+};
+
+// A chunk of a log.
+struct MediaChunk {
+  MediaChunkKind kind = MediaChunkKind::kAudio;
+  uint32_t contributing_source = 0;
+  absl::Time received_time;
+  uint32_t rtp_timestamp = 0;
+  int width = 0;
+  int height = 0;
+  absl::string_view payload;
+};
+
+// An entry of the index.
+struct MediaChunkIndexEntry {
+  // Offset of the chunk from the start of the file.
+  int64_t offset = 0;
+  absl::Time received_time;
+  uint32_t contributing_source = 0;
+  MediaChunkKind kind = MediaChunkKind::kAudio;
+};
+
+// Appends frames to a chunk log.
+//
+// This class is not thread-safe.
+class MediaChunkLogWriter {
+ public:
+  // The default number of entries of an index block, i.e. 96 KiB.
+  static constexpr int64_t kDefaultIndexBlockEntries = 4096;
+
+  explicit MediaChunkLogWriter(
+      std::unique_ptr<OutputWriterInterface> output,
+      int64_t index_block_entries = kDefaultIndexBlockEntries);
+  ~MediaChunkLogWriter();
+
+  void WriteAudio(uint32_t contributing_source, absl::Time received_time,
+                  absl::Span<const int16_t> pcm16);
+  void WriteVideo(uint32_t contributing_source, absl::Time received_time,
+                  uint32_t rtp_timestamp,
+                  const webrtc::I420BufferInterface& frame);
+  // Writes the last index block and the directory, and closes the wrapped
+  // writer.
+  void Close();
+
+ private:
+  void WriteChunkHeader(MediaChunkKind kind, uint32_t contributing_source,
+                        absl::Time received_time, uint32_t rtp_timestamp,
+                        int width, int height, int64_t payload_size);
+  void WriteIndexBlock();
+
+  /*absl_nullable*/ std::unique_ptr<OutputWriterInterface> output_;
+  const int64_t index_block_entries_;
+  // Bytes written so far, for the offsets of the index.
+  int64_t offset_ = 0;
+  // The encoded index entries of the chunks since the last index block.
+  std::string index_;
+  // The offsets of the index blocks written so far.
+  std::vector<int64_t> index_block_offsets_;
+  // Reused to pack frames whose planes have row padding.
+  std::vector<char> scratch_;
+};
+
+// Reads the chunks of a chunk log.
+//
+// This class is not thread-safe.
+class MediaChunkLogReader {
+ public:
+  // Returns a reader of `contents`, which must outlive the reader. Fails if
+  // `contents` is not a chunk log.
+  static absl::StatusOr<std::unique_ptr<MediaChunkLogReader>> Create(
+      absl::string_view contents);
+
+  // Whether the log has an index, i.e. its writer was closed.
+  bool complete() const { return complete_; }
+  // The index, or empty if the log is not complete.
+  const std::vector<MediaChunkIndexEntry>& index() const { return index_; }
+
+  // Reads the chunk at `offset`, e.g. from the index.
+  absl::StatusOr<MediaChunk> ReadChunk(int64_t offset) const;
+
+  // Reads the next chunk into `chunk`, skipping index blocks, and returns
+  // false at the end of the log or if the log is corrupt, in which case
+  // `status` returns the error. The payload of `chunk` remains valid as long
+  // as `contents`.
+  bool Next(MediaChunk& chunk);
+
+  absl::Status status() const { return status_; }
+
+ private:
+  MediaChunkLogReader(absl::string_view contents, int64_t chunks_end,
+                      bool complete, std::vector<MediaChunkIndexEntry> index)
+      : contents_(contents),
+        chunks_end_(chunks_end),
+        complete_(complete),
+        index_(std::move(index)) {}
+
+  absl::string_view contents_;
+  // The offset of the directory, or the size of the log if it has none.
+  const int64_t chunks_end_;
+  const bool complete_;
+  const std::vector<MediaChunkIndexEntry> index_;
+  // The offset of the next chunk to read.
+  int64_t next_offset_ = 8;
+  absl::Status status_;
+};
+
+// Splits the chunk log `contents` into a raw stream per participant, with a
+// segment index (see `segment_index.h`) next to each stream:
+//
+//   <output_file_prefix>audio_<contributing_source>.pcm
+//   <output_file_prefix>video_<contributing_source>_<width>x<height>.yuv
+//
+// Files are opened with `provider`. A log without an index is extracted up to
+// its last complete chunk.
+absl::Status ExtractMediaChunkStreams(absl::string_view contents,
+                                      absl::string_view output_file_prefix,
+                                      OutputWriterProvider& provider);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_MEDIA_CHUNK_LOG_H_
@@ -0,0 +1,258 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/media_chunk_log.h"
+
+#include <cstdint>
+#include <functional>
+#include <ios>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/segment_index.h"
+#include "meet_clients/samples/testing/media_data.h"
+#include "meet_clients/samples/testing/string_output_writer.h"
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+using ::testing::_;
+using ::testing::Each;
+using ::testing::Pair;
+using ::testing::UnorderedElementsAre;
+
+std::string AsString(const std::vector<int16_t>& pcm16) {
+  return std::string(reinterpret_cast<const char*>(pcm16.data()),
+                     pcm16.size() * sizeof(int16_t));
+}
+
+std::string AsString(const std::vector<char>& yuv) {
+  return std::string(yuv.begin(), yuv.end());
+}
+
+TEST(MediaChunkLogTest, ReadsChunksInOrder) {
+  absl::Time start = absl::FromUnixMillis(1700000000123);
+  AudioTestData audio = CreateAudioTestData(/*num_samples=*/10);
+  VideoTestData video = CreateVideoTestData(/*width=*/10, /*height=*/5);
+  std::string log;
+  bool closed = false;
+  MediaChunkLogWriter writer(std::make_unique<StringOutputWriter>(log, closed));
+
+  writer.WriteAudio(/*contributing_source=*/1, start, audio.pcm16);
+  writer.WriteVideo(/*contributing_source=*/2, start + absl::Milliseconds(10),
+                    /*rtp_timestamp=*/900,
+                    *video.meet_frame.frame.video_frame_buffer()->ToI420());
+  writer.Close();
+  EXPECT_TRUE(closed);
+
+  absl::StatusOr<std::unique_ptr<MediaChunkLogReader>> reader =
+      MediaChunkLogReader::Create(log);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  EXPECT_TRUE((*reader)->complete());
+  MediaChunk chunk;
+  ASSERT_TRUE((*reader)->Next(chunk));
+  EXPECT_EQ(chunk.kind, MediaChunkKind::kAudio);
+  EXPECT_EQ(chunk.contributing_source, 1);
+  EXPECT_EQ(chunk.received_time, start);
+  EXPECT_EQ(chunk.payload, AsString(audio.pcm16));
+  ASSERT_TRUE((*reader)->Next(chunk));
+  EXPECT_EQ(chunk.kind, MediaChunkKind::kVideo);
+  EXPECT_EQ(chunk.contributing_source, 2);
+  EXPECT_EQ(chunk.received_time, start + absl::Milliseconds(10));
+  EXPECT_EQ(chunk.rtp_timestamp, 900);
+  EXPECT_EQ(chunk.width, 10);
+  EXPECT_EQ(chunk.height, 5);
+  EXPECT_EQ(chunk.payload, AsString(video.yuv_data));
+  EXPECT_FALSE((*reader)->Next(chunk));
+  EXPECT_TRUE((*reader)->status().ok()) << (*reader)->status();
+}
+
+TEST(MediaChunkLogTest, IndexLocatesChunks) {
+  absl::Time start = absl::FromUnixMillis(1700000000123);
+  AudioTestData audio = CreateAudioTestData(/*num_samples=*/10);
+  std::string log;
+  bool closed = false;
+  MediaChunkLogWriter writer(std::make_unique<StringOutputWriter>(log, closed));
+  for (int i = 0; i < 3; ++i) {
+    writer.WriteAudio(/*contributing_source=*/i, start + absl::Seconds(i),
+                      audio.pcm16);
+  }
+  writer.Close();
+
+  absl::StatusOr<std::unique_ptr<MediaChunkLogReader>> reader =
+      MediaChunkLogReader::Create(log);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  ASSERT_EQ((*reader)->index().size(), 3);
+  const MediaChunkIndexEntry& entry = (*reader)->index()[2];
+  EXPECT_EQ(entry.received_time, start + absl::Seconds(2));
+  EXPECT_EQ(entry.contributing_source, 2);
+  EXPECT_EQ(entry.kind, MediaChunkKind::kAudio);
+  absl::StatusOr<MediaChunk> chunk = (*reader)->ReadChunk(entry.offset);
+  ASSERT_TRUE(chunk.ok()) << chunk.status();
+  EXPECT_EQ(chunk->contributing_source, 2);
+  EXPECT_EQ(chunk->payload, AsString(audio.pcm16));
+}
+
+TEST(MediaChunkLogTest, ReadsLogWithoutIndexUpToLastCompleteChunk) {
+  AudioTestData audio = CreateAudioTestData(/*num_samples=*/10);
+  std::string log;
+  bool closed = false;
+  MediaChunkLogWriter writer(std::make_unique<StringOutputWriter>(log, closed));
+  writer.WriteAudio(/*contributing_source=*/1, absl::UnixEpoch(), audio.pcm16);
+  writer.WriteAudio(/*contributing_source=*/2, absl::UnixEpoch(), audio.pcm16);
+  // Simulate a crash in the middle of the second chunk.
+  std::string crashed_log = log.substr(0, log.size() - 3);
+
+  absl::StatusOr<std::unique_ptr<MediaChunkLogReader>> reader =
+      MediaChunkLogReader::Create(crashed_log);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  EXPECT_FALSE((*reader)->complete());
+  EXPECT_TRUE((*reader)->index().empty());
+  MediaChunk chunk;
+  ASSERT_TRUE((*reader)->Next(chunk));
+  EXPECT_EQ(chunk.contributing_source, 1);
+  EXPECT_FALSE((*reader)->Next(chunk));
+  EXPECT_TRUE((*reader)->status().ok()) << (*reader)->status();
+}
+
+TEST(MediaChunkLogTest, IndexSpansBlocks) {
+  absl::Time start = absl::FromUnixMillis(1700000000123);
+  AudioTestData audio = CreateAudioTestData(/*num_samples=*/10);
+  std::string log;
+  bool closed = false;
+  MediaChunkLogWriter writer(std::make_unique<StringOutputWriter>(log, closed),
+                             /*index_block_entries=*/2);
+  for (int i = 0; i < 5; ++i) {
+    writer.WriteAudio(/*contributing_source=*/i, start + absl::Seconds(i),
+                      audio.pcm16);
+  }
+  writer.Close();
+
+  absl::StatusOr<std::unique_ptr<MediaChunkLogReader>> reader =
+      MediaChunkLogReader::Create(log);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  ASSERT_EQ((*reader)->index().size(), 5);
+  for (int i = 0; i < 5; ++i) {
+    const MediaChunkIndexEntry& entry = (*reader)->index()[i];
+    EXPECT_EQ(entry.received_time, start + absl::Seconds(i));
+    absl::StatusOr<MediaChunk> chunk = (*reader)->ReadChunk(entry.offset);
+    ASSERT_TRUE(chunk.ok()) << chunk.status();
+    EXPECT_EQ(chunk->contributing_source, i);
+  }
+  // Index blocks are skipped when reading in order.
+  MediaChunk chunk;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE((*reader)->Next(chunk));
+    EXPECT_EQ(chunk.contributing_source, i);
+  }
+  EXPECT_FALSE((*reader)->Next(chunk));
+  EXPECT_TRUE((*reader)->status().ok()) << (*reader)->status();
+}
+
+TEST(MediaChunkLogTest, ReadsLogCutAfterIndexBlock) {
+  AudioTestData audio = CreateAudioTestData(/*num_samples=*/10);
+  std::string log;
+  bool closed = false;
+  MediaChunkLogWriter writer(std::make_unique<StringOutputWriter>(log, closed),
+                             /*index_block_entries=*/1);
+  for (int i = 0; i < 3; ++i) {
+    writer.WriteAudio(/*contributing_source=*/i, absl::UnixEpoch(),
+                      audio.pcm16);
+  }
+  // Simulate a crash before the writer is closed, after the index blocks of
+  // the first two chunks.
+
+  absl::StatusOr<std::unique_ptr<MediaChunkLogReader>> reader =
+      MediaChunkLogReader::Create(log);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  EXPECT_FALSE((*reader)->complete());
+  MediaChunk chunk;
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE((*reader)->Next(chunk));
+    EXPECT_EQ(chunk.contributing_source, i);
+  }
+  EXPECT_FALSE((*reader)->Next(chunk));
+  EXPECT_TRUE((*reader)->status().ok()) << (*reader)->status();
+}
+
+TEST(MediaChunkLogTest, RejectsOtherFiles) {
+  EXPECT_EQ(MediaChunkLogReader::Create("not a chunk log").status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(MediaChunkLogTest, ExtractsStreamPerParticipant) {
+  absl::Time start = absl::FromUnixMillis(1700000000123);
+  AudioTestData audio = CreateAudioTestData(/*num_samples=*/10);
+  VideoTestData video = CreateVideoTestData(/*width=*/10, /*height=*/5);
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> frame =
+      video.meet_frame.frame.video_frame_buffer()->ToI420();
+  std::string log;
+  bool log_closed = false;
+  MediaChunkLogWriter writer(
+      std::make_unique<StringOutputWriter>(log, log_closed));
+  writer.WriteAudio(/*contributing_source=*/1, start, audio.pcm16);
+  writer.WriteVideo(/*contributing_source=*/2, start, /*rtp_timestamp=*/0,
+                    *frame);
+  writer.WriteAudio(/*contributing_source=*/1, start + absl::Milliseconds(10),
+                    audio.pcm16);
+  writer.WriteVideo(/*contributing_source=*/2, start + absl::Milliseconds(33),
+                    /*rtp_timestamp=*/3000, *frame);
+  writer.Close();
+
+  // Writers keep references to these values, so they need pointer stability.
+  std::map<std::string, std::string, std::less<>> files;
+  std::map<std::string, bool, std::less<>> closed;
+  OutputWriterProvider provider = [&](absl::string_view file_name) {
+    std::string name(file_name);
+    return std::make_unique<StringOutputWriter>(files[name], closed[name]);
+  };
+  ASSERT_TRUE(ExtractMediaChunkStreams(log, "out_", provider).ok());
+
+  EXPECT_THAT(files, UnorderedElementsAre(
+                         Pair("out_audio_1.pcm",
+                              AsString(audio.pcm16) + AsString(audio.pcm16)),
+                         Pair("out_audio_1.pcm.idx", _),
+                         Pair("out_video_2_10x5.yuv",
+                              AsString(video.yuv_data) +
+                                  AsString(video.yuv_data)),
+                         Pair("out_video_2_10x5.yuv.idx", _)));
+  EXPECT_THAT(closed, Each(Pair(_, true)));
+  absl::StatusOr<SegmentIndexReader> index =
+      SegmentIndexReader::Create(files["out_video_2_10x5.yuv.idx"]);
+  ASSERT_TRUE(index.ok()) << index.status();
+  ASSERT_EQ(index->frame_count(), 2);
+  SegmentIndexEntry entry = index->GetEntry(1);
+  EXPECT_EQ(entry.byte_offset, video.yuv_data.size());
+  EXPECT_EQ(entry.received_time, start + absl::Milliseconds(33));
+  EXPECT_EQ(entry.rtp_timestamp, 3000);
+}
+
+}  // namespace
+}  // namespace media_api_samples
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/media_format_flags.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
+#include "meet_clients/samples/encoded_video_segment_writer.h"
+#include "meet_clients/samples/flac_audio_segment_writer.h"
+#include "meet_clients/samples/muxed_segment_writer_interface.h"
+#include "meet_clients/samples/ogg_opus_segment_writer.h"
+#include "meet_clients/samples/raw_audio_segment_writer.h"
+#include "meet_clients/samples/raw_video_segment_writer.h"
+#include "meet_clients/samples/video_segment_writer_interface.h"
+#include "meet_clients/samples/webm_segment_writer.h"
+#include "api/video_codecs/video_codec.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+ABSL_FLAG(std::string, video_codec, "raw",
+          "How video segments are stored. One of:\n"
+          "  raw: uncompressed YUV420p frames in .yuv files.\n"
+          "  vp9: VP9 in .ivf files, encoded on dedicated encoder threads.\n"
+          "  av1: AV1 in .ivf files, encoded on dedicated encoder threads.");
+
+ABSL_FLAG(int, video_bitrate_kbps, 500,
+          "Target bitrate of each encoded video segment, in kbps.");
+
+ABSL_FLAG(std::string, video_encoder_complexity, "normal",
+          "Encoder speed and quality trade-off. One of low (fastest), normal, "
+          "high, higher, or max (slowest).");
+
+ABSL_FLAG(int, video_encoder_threads, 1,
+          "Number of threads that encode video segments. Each segment is "
+          "encoded on a single thread.");
+
+ABSL_FLAG(int, video_key_frame_interval, 300,
+          "Number of frames between key frames in encoded video segments.");
+
+ABSL_FLAG(std::string, audio_codec, "raw",
+          "How audio segments are stored. One of:\n"
+          "  raw: uncompressed 48 kHz mono pcm16 in .pcm files.\n"
+          "  opus: Opus in Ogg .opus files, encoded on dedicated encoder "
+          "threads.\n"
+          "  flac: lossless FLAC in .flac files, for archival recordings.");
+
+ABSL_FLAG(int, audio_bitrate_kbps, 32,
+          "Target bitrate of each Opus audio segment, in kbps.");
+
+ABSL_FLAG(int, audio_encoder_threads, 1,
+          "Number of threads that encode audio segments. Each segment is "
+          "encoded on a single thread.");
+
+ABSL_FLAG(bool, segment_index, false,
+          "Whether to write a sidecar index next to each raw segment, named "
+          "after the segment with an added .idx extension, recording the "
+          "offset, receive time, RTP timestamp and contributing source of "
+          "every frame. Segments stored with a codec are not indexed. Only the "
+          "multi-user collector writes indexes.");
+
+ABSL_FLAG(std::string, mux_format, "none",
+          "How a participant's audio and video are combined. One of:\n"
+          "  none: separate audio and video segments, as selected by "
+          "--audio_codec and --video_codec.\n"
+          "  webm: VP9 and Opus interleaved in a single .webm segment per "
+          "participant, playable while it is being written. Requires "
+          "--video_codec=vp9 and --audio_codec=opus.");
+
+ABSL_FLAG(absl::Duration, mux_cluster_duration, absl::Seconds(1),
+          "Approximate duration of the clusters of muxed segments. Clusters "
+          "are written as they complete, so this bounds how far a reader of a "
+          "live segment lags behind.");
+
+namespace media_api_samples {
+namespace {
+
+absl::StatusOr<webrtc::VideoCodecComplexity> ParseComplexity(
+    const std::string& complexity) {
+  if (complexity == "low") {
+    return webrtc::VideoCodecComplexity::kComplexityLow;
+  }
+  if (complexity == "normal") {
+    return webrtc::VideoCodecComplexity::kComplexityNormal;
+  }
+  if (complexity == "high") {
+    return webrtc::VideoCodecComplexity::kComplexityHigh;
+  }
+  if (complexity == "higher") {
+    return webrtc::VideoCodecComplexity::kComplexityHigher;
+  }
+  if (complexity == "max") {
+    return webrtc::VideoCodecComplexity::kComplexityMax;
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("Unknown video encoder complexity: ", complexity));
+}
+
+absl::StatusOr<std::shared_ptr<VideoEncoderPool>> CreateVideoEncoderPool(
+    const std::string& video_codec) {
+  VideoEncoderPool::Options options;
+  if (video_codec == "vp9") {
+    options.codec = VideoEncoderPool::Codec::kVp9;
+  } else if (video_codec == "av1") {
+    options.codec = VideoEncoderPool::Codec::kAv1;
+  } else {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unknown video codec: ", video_codec));
+  }
+  absl::StatusOr<webrtc::VideoCodecComplexity> complexity =
+      ParseComplexity(absl::GetFlag(FLAGS_video_encoder_complexity));
+  if (!complexity.ok()) {
+    return complexity.status();
+  }
+  options.complexity = *complexity;
+  options.target_bitrate_kbps = absl::GetFlag(FLAGS_video_bitrate_kbps);
+  options.encoder_thread_count = absl::GetFlag(FLAGS_video_encoder_threads);
+  options.key_frame_interval = absl::GetFlag(FLAGS_video_key_frame_interval);
+  return VideoEncoderPool::Create(std::move(options));
+}
+
+absl::StatusOr<std::shared_ptr<AudioEncoderPool>> CreateAudioEncoderPool() {
+  return AudioEncoderPool::Create(
+      {.target_bitrate_kbps = absl::GetFlag(FLAGS_audio_bitrate_kbps),
+       .encoder_thread_count = absl::GetFlag(FLAGS_audio_encoder_threads)});
+}
+
+}  // namespace
+
+absl::StatusOr<VideoSegmentFormat> CreateVideoSegmentFormatFromFlags() {
+  std::string video_codec = absl::GetFlag(FLAGS_video_codec);
+  if (video_codec == "raw") {
+    VideoSegmentFormat format = CreateRawVideoSegmentFormat();
+    format.index_frames = absl::GetFlag(FLAGS_segment_index);
+    return format;
+  }
+
+  absl::StatusOr<std::shared_ptr<VideoEncoderPool>> pool =
+      CreateVideoEncoderPool(video_codec);
+  if (!pool.ok()) {
+    return pool.status();
+  }
+  return CreateEncodedVideoSegmentFormat(*std::move(pool));
+}
+
+absl::StatusOr<AudioSegmentFormat> CreateAudioSegmentFormatFromFlags() {
+  std::string audio_codec = absl::GetFlag(FLAGS_audio_codec);
+  if (audio_codec == "raw") {
+    AudioSegmentFormat format = CreateRawAudioSegmentFormat();
+    format.index_frames = absl::GetFlag(FLAGS_segment_index);
+    return format;
+  }
+  if (audio_codec == "flac") {
+    return CreateFlacAudioSegmentFormat();
+  }
+  if (audio_codec != "opus") {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unknown audio codec: ", audio_codec));
+  }
+
+  absl::StatusOr<std::shared_ptr<AudioEncoderPool>> pool =
+      CreateAudioEncoderPool();
+  if (!pool.ok()) {
+    return pool.status();
+  }
+  return CreateOggOpusSegmentFormat(*std::move(pool));
+}
+
+absl::StatusOr<std::optional<MuxedSegmentFormat>>
+CreateMuxedSegmentFormatFromFlags() {
+  std::string mux_format = absl::GetFlag(FLAGS_mux_format);
+  if (mux_format == "none") {
+    return std::nullopt;
+  }
+  if (mux_format != "webm") {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unknown mux format: ", mux_format));
+  }
+  std::string video_codec = absl::GetFlag(FLAGS_video_codec);
+  if (video_codec != "vp9" || absl::GetFlag(FLAGS_audio_codec) != "opus") {
+    return absl::InvalidArgumentError(
+        "--mux_format=webm requires --video_codec=vp9 and --audio_codec=opus");
+  }
+
+  absl::StatusOr<std::shared_ptr<VideoEncoderPool>> video_pool =
+      CreateVideoEncoderPool(video_codec);
+  if (!video_pool.ok()) {
+    return video_pool.status();
+  }
+  absl::StatusOr<std::shared_ptr<AudioEncoderPool>> audio_pool =
+      CreateAudioEncoderPool();
+  if (!audio_pool.ok()) {
+    return audio_pool.status();
+  }
+  WebmSegmentWriter::Options options;
+  options.muxer.cluster_duration = absl::GetFlag(FLAGS_mux_cluster_duration);
+  options.muxer.max_cluster_duration =
+      std::max(options.muxer.max_cluster_duration,
+               options.muxer.cluster_duration);
+  if (options.muxer.cluster_duration <= absl::ZeroDuration() ||
+      options.muxer.max_cluster_duration >= absl::Seconds(32)) {
+    return absl::InvalidArgumentError(
+        "--mux_cluster_duration must be positive and below 32 seconds");
+  }
+  return CreateWebmSegmentFormat(*std::move(video_pool),
+                                 *std::move(audio_pool), std::move(options));
+}
+
+}  // namespace media_api_samples
@@ -0,0 +1,44 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_MEDIA_FORMAT_FLAGS_H_
+#define CPP_SAMPLES_MEDIA_FORMAT_FLAGS_H_
+
+#include <optional>
+
+#include "absl/base/nullability.h"
+#include "absl/status/statusor.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
+#include "meet_clients/samples/muxed_segment_writer_interface.h"
+#include "meet_clients/samples/video_segment_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Creates the video segment format selected by the `--video_codec` flag and
+// its related flags.
+absl::StatusOr<VideoSegmentFormat> CreateVideoSegmentFormatFromFlags();
+absl::StatusOr<AudioSegmentFormat> CreateAudioSegmentFormatFromFlags();
+// Creates the muxed segment format selected by the `--mux_format` flag, or
+// returns nullopt if audio and video are stored separately.
+absl::StatusOr<std::optional<MuxedSegmentFormat>>
+CreateMuxedSegmentFormatFromFlags();
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_MEDIA_FORMAT_FLAGS_H_
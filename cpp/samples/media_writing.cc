@@ -16,10 +16,13 @@
 
 #include "meet_clients/samples/media_writing.h"
 
+#include <array>
 #include <cstdint>
+#include <cstring>
 #include <vector>
 
 #include "absl/base/nullability.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/types/span.h"
 #include "meet_clients/samples/output_writer_interface.h"
 #include "api/video/video_frame_buffer.h"
@@ -34,15 +37,47 @@ namespace media_api_samples {
 //
 // See webrtc/rtc_base/byte_order.h.
 
-void WritePcm16(const std::vector<int16_t>& pcm16,
-                OutputWriterInterface& writer) {
-  for (int16_t sample : pcm16) {
-    writer.Write(reinterpret_cast<const char*>(&sample), sizeof(sample));
+namespace {
+
+// A plane of an I420 frame.
+struct Plane {
+  const uint8_t* data;
+  int stride;
+  int width;
+  int height;
+
+  // Whether the rows of the plane follow each other without padding.
+  bool contiguous() const { return stride == width || height <= 1; }
+  int64_t size() const { return int64_t{width} * height; }
+};
+
+// Copies the rows of `plane` back to back into `output`, which must have room
+// for `plane.size()` bytes.
+void PackPlane(const Plane& plane, char* output) {
+  // `memcpy` uses the widest vector instructions the CPU supports (e.g. AVX2
+  // or NEON), so rows are copied at memory bandwidth.
+  for (int i = 0; i < plane.height; ++i) {
+    std::memcpy(output + int64_t{i} * plane.width,
+                plane.data + int64_t{i} * plane.stride, plane.width);
   }
 }
 
+}  // namespace
+
+void WritePcm16(absl::Span<const int16_t> pcm16,
+                OutputWriterInterface& writer) {
+  writer.Write(reinterpret_cast<const char*>(pcm16.data()),
+               pcm16.size() * sizeof(int16_t));
+}
+
 void WriteYuv420(const webrtc::I420BufferInterface& i420,
                  OutputWriterInterface& writer) {
+  std::vector<char> scratch;
+  WriteYuv420(i420, writer, scratch);
+}
+
+void WriteYuv420(const webrtc::I420BufferInterface& i420,
+                 OutputWriterInterface& writer, std::vector<char>& scratch) {
   int width = i420.width();
   int height = i420.height();
   // Chroma planes (U and V) are half the width and height of the luma plane
@@ -55,38 +90,46 @@ void WriteYuv420(const webrtc::I420BufferInterface& i420,
   // This is because `stride` is the width of the memory block, while `width` is
   // the width of the image.
   //
-  // As a result, reading the planes works by advancing the pointer by `stride`
-  // each time but only reading `width` bytes from that pointer.
-
-  // Write Y plane (luma plane).
-  const uint8_t* y_plane = i420.DataY();
-  int y_stride = i420.StrideY();
-  absl::Span<const uint8_t> y_span(y_plane, y_stride * height);
-  for (int i = 0; i < height; ++i) {
-    writer.Write(reinterpret_cast<const char*>(
-                     y_span.subspan(i * y_stride, width).data()),
-                 width);
-  }
+  // As a result, a plane whose stride is larger than its width has padding
+  // after every row, and cannot be handed to the writer as is. Such planes are
+  // packed into `scratch`, while planes without padding are written straight
+  // from the frame. All planes are then handed to the writer at once.
+  std::array<Plane, 3> planes = {
+      Plane{i420.DataY(), i420.StrideY(), width, height},
+      Plane{i420.DataU(), i420.StrideU(), chroma_width, chroma_height},
+      Plane{i420.DataV(), i420.StrideV(), chroma_width, chroma_height}};
 
-  // Write U plane (first chroma plane).
-  const uint8_t* u_plane = i420.DataU();
-  int u_stride = i420.StrideU();
-  absl::Span<const uint8_t> u_span(u_plane, u_stride * chroma_height);
-  for (int i = 0; i < chroma_height; ++i) {
-    writer.Write(reinterpret_cast<const char*>(
-                     u_span.subspan(i * u_stride, chroma_width).data()),
-                 chroma_width);
+  int64_t packed_size = 0;
+  for (const Plane& plane : planes) {
+    if (!plane.contiguous()) {
+      packed_size += plane.size();
+    }
+  }
+  if (scratch.size() < packed_size) {
+    scratch.resize(packed_size);
   }
 
-  // Write V plane (second chroma plane).
-  const uint8_t* v_plane = i420.DataV();
-  int v_stride = i420.StrideV();
-  absl::Span<const uint8_t> v_span(v_plane, v_stride * chroma_height);
-  for (int i = 0; i < chroma_height; ++i) {
-    writer.Write(reinterpret_cast<const char*>(
-                     v_span.subspan(i * v_stride, chroma_width).data()),
-                 chroma_width);
+  absl::InlinedVector<absl::Span<const char>, 3> chunks;
+  char* packed = scratch.data();
+  for (const Plane& plane : planes) {
+    const char* data = reinterpret_cast<const char*>(plane.data);
+    if (!plane.contiguous()) {
+      PackPlane(plane, packed);
+      data = packed;
+      packed += plane.size();
+    }
+    // Planes that follow each other in memory, as in most decoded frames and
+    // in `scratch`, are merged into one chunk.
+    if (!chunks.empty() &&
+        chunks.back().data() + chunks.back().size() == data) {
+      chunks.back() = absl::Span<const char>(
+          chunks.back().data(), chunks.back().size() + plane.size());
+    } else {
+      chunks.push_back(absl::Span<const char>(data, plane.size()));
+    }
   }
+
+  writer.WriteChunks(chunks);
 }
 
 }  // namespace media_api_samples
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "absl/base/nullability.h"
+#include "absl/types/span.h"
 #include "meet_clients/samples/output_writer_interface.h"
 #include "api/video/video_frame_buffer.h"
 
@@ -29,10 +30,19 @@ ABSL_POINTERS_DEFAULT_NONNULL
 namespace media_api_samples {
 
 // Writes a PCM16 buffer to the output writer.
-void WritePcm16(const std::vector<int16_t>& pcm16,
-                OutputWriterInterface& writer);
+//
+// The whole buffer is written with a single call to `writer`.
+void WritePcm16(absl::Span<const int16_t> pcm16, OutputWriterInterface& writer);
 
 // Writes a YUV420p buffer to the output writer.
+//
+// All rows of the Y, U, and V planes are written with a single call to
+// `writer`. Planes without row padding are written in place, and others are
+// first packed into `scratch`, which is grown as needed and can be reused
+// across frames to avoid allocations.
+void WriteYuv420(const webrtc::I420BufferInterface& i420,
+                 OutputWriterInterface& writer, std::vector<char>& scratch);
+// As above, with a scratch buffer allocated for this frame if needed.
 void WriteYuv420(const webrtc::I420BufferInterface& i420,
                  OutputWriterInterface& writer);
 
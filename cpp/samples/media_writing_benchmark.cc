@@ -0,0 +1,188 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks for writing media frames to output writers.
+//
+// Each benchmark writes a single frame per iteration, comparing the original
+// per-sample / per-row write path with the bulk path used by `WritePcm16` and
+// `WriteYuv420`. Video frames are written both without row padding, which
+// `WriteYuv420` writes in place, and with padding, which it packs first.
+
+#include <cstdint>
+#include <fstream>
+#include <ios>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gmock/gmock.h"
+#include "absl/base/nullability.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/media_writing.h"
+#include "meet_clients/samples/output_file.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/testing/mock_output_writer.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+// 10 ms of 48 kHz mono audio.
+constexpr int kSamplesPerFrame = 480;
+
+// The original implementation, which issued one write per sample.
+void WritePcm16PerSample(absl::Span<const int16_t> pcm16,
+                         OutputWriterInterface& writer) {
+  for (int16_t sample : pcm16) {
+    writer.Write(reinterpret_cast<const char*>(&sample), sizeof(sample));
+  }
+}
+
+// The original implementation, which issued one write per plane row and
+// needed no scratch buffer.
+void WriteYuv420PerRow(const webrtc::I420BufferInterface& i420,
+                       OutputWriterInterface& writer,
+                       std::vector<char>& /*scratch*/) {
+  int chroma_width = (i420.width() + 1) / 2;
+  int chroma_height = (i420.height() + 1) / 2;
+  for (int i = 0; i < i420.height(); ++i) {
+    writer.Write(
+        reinterpret_cast<const char*>(i420.DataY() + i * i420.StrideY()),
+        i420.width());
+  }
+  for (int i = 0; i < chroma_height; ++i) {
+    writer.Write(
+        reinterpret_cast<const char*>(i420.DataU() + i * i420.StrideU()),
+        chroma_width);
+  }
+  for (int i = 0; i < chroma_height; ++i) {
+    writer.Write(
+        reinterpret_cast<const char*>(i420.DataV() + i * i420.StrideV()),
+        chroma_width);
+  }
+}
+
+std::unique_ptr<OutputWriterInterface> CreateDevNullFile() {
+  return std::make_unique<OutputFile>(
+      std::ofstream("/dev/null", std::ios::binary | std::ios::out));
+}
+
+std::unique_ptr<OutputWriterInterface> CreateMockWriter() {
+  return std::make_unique<::testing::NiceMock<MockOutputWriter>>();
+}
+
+webrtc::scoped_refptr<webrtc::I420Buffer> CreateFrame(int width, int height) {
+  webrtc::scoped_refptr<webrtc::I420Buffer> buffer =
+      webrtc::I420Buffer::Create(width, height);
+  webrtc::I420Buffer::SetBlack(buffer.get());
+  return buffer;
+}
+
+// Returns a frame whose rows are padded to multiples of 64 bytes, as decoders
+// and scalers often produce.
+webrtc::scoped_refptr<webrtc::I420Buffer> CreatePaddedFrame(int width,
+                                                           int height) {
+  auto align = [](int size) { return (size + 63) / 64 * 64; };
+  int chroma_stride = align((width + 1) / 2);
+  webrtc::scoped_refptr<webrtc::I420Buffer> buffer = webrtc::I420Buffer::Create(
+      width, height, align(width), chroma_stride, chroma_stride);
+  webrtc::I420Buffer::SetBlack(buffer.get());
+  return buffer;
+}
+
+template <std::unique_ptr<OutputWriterInterface> (*CreateWriter)(),
+          void (*WriteFrame)(absl::Span<const int16_t>,
+                             OutputWriterInterface&)>
+void BM_WritePcm16(benchmark::State& state) {
+  std::vector<int16_t> pcm16(kSamplesPerFrame, 1);
+  std::unique_ptr<OutputWriterInterface> writer = CreateWriter();
+  for (auto _ : state) {
+    WriteFrame(pcm16, *writer);
+  }
+  state.SetBytesProcessed(state.iterations() * pcm16.size() *
+                          sizeof(int16_t));
+}
+
+template <std::unique_ptr<OutputWriterInterface> (*CreateWriter)(),
+          webrtc::scoped_refptr<webrtc::I420Buffer> (*CreateFrame)(int, int),
+          void (*WriteFrame)(const webrtc::I420BufferInterface&,
+                             OutputWriterInterface&, std::vector<char>&)>
+void BM_WriteYuv420(benchmark::State& state) {
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame =
+      CreateFrame(state.range(0), state.range(1));
+  std::unique_ptr<OutputWriterInterface> writer = CreateWriter();
+  // Reused across frames, as segment writers do.
+  std::vector<char> scratch;
+  for (auto _ : state) {
+    WriteFrame(*frame, *writer, scratch);
+  }
+  int chroma_size = ((frame->width() + 1) / 2) * ((frame->height() + 1) / 2);
+  state.SetBytesProcessed(state.iterations() *
+                          (frame->width() * frame->height() + 2 * chroma_size));
+}
+
+BENCHMARK(BM_WritePcm16<CreateDevNullFile, WritePcm16PerSample>)
+    ->Name("BM_WritePcm16/OutputFile/PerSample");
+BENCHMARK(BM_WritePcm16<CreateDevNullFile, WritePcm16>)
+    ->Name("BM_WritePcm16/OutputFile/Bulk");
+BENCHMARK(BM_WritePcm16<CreateMockWriter, WritePcm16PerSample>)
+    ->Name("BM_WritePcm16/MockOutputWriter/PerSample");
+BENCHMARK(BM_WritePcm16<CreateMockWriter, WritePcm16>)
+    ->Name("BM_WritePcm16/MockOutputWriter/Bulk");
+
+// Common Meet resolutions, and odd sizes whose chroma planes are rounded up.
+void Yuv420Sizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Args({320, 180})
+      ->Args({321, 181})
+      ->Args({400, 400})
+      ->Args({640, 360})
+      ->Args({1280, 720})
+      ->Args({1279, 719})
+      ->Args({1920, 1080});
+}
+
+BENCHMARK(BM_WriteYuv420<CreateDevNullFile, CreateFrame, WriteYuv420PerRow>)
+    ->Name("BM_WriteYuv420/OutputFile/PerRow")
+    ->Apply(Yuv420Sizes);
+BENCHMARK(BM_WriteYuv420<CreateDevNullFile, CreateFrame, WriteYuv420>)
+    ->Name("BM_WriteYuv420/OutputFile/Bulk")
+    ->Apply(Yuv420Sizes);
+BENCHMARK(BM_WriteYuv420<CreateDevNullFile, CreatePaddedFrame,
+                         WriteYuv420PerRow>)
+    ->Name("BM_WriteYuv420/OutputFile/Padded/PerRow")
+    ->Apply(Yuv420Sizes);
+BENCHMARK(BM_WriteYuv420<CreateDevNullFile, CreatePaddedFrame, WriteYuv420>)
+    ->Name("BM_WriteYuv420/OutputFile/Padded/Bulk")
+    ->Apply(Yuv420Sizes);
+BENCHMARK(BM_WriteYuv420<CreateMockWriter, CreateFrame, WriteYuv420PerRow>)
+    ->Name("BM_WriteYuv420/MockOutputWriter/PerRow")
+    ->Apply(Yuv420Sizes);
+BENCHMARK(BM_WriteYuv420<CreateMockWriter, CreateFrame, WriteYuv420>)
+    ->Name("BM_WriteYuv420/MockOutputWriter/Bulk")
+    ->Apply(Yuv420Sizes);
+BENCHMARK(BM_WriteYuv420<CreateMockWriter, CreatePaddedFrame,
+                         WriteYuv420PerRow>)
+    ->Name("BM_WriteYuv420/MockOutputWriter/Padded/PerRow")
+    ->Apply(Yuv420Sizes);
+BENCHMARK(BM_WriteYuv420<CreateMockWriter, CreatePaddedFrame, WriteYuv420>)
+    ->Name("BM_WriteYuv420/MockOutputWriter/Padded/Bulk")
+    ->Apply(Yuv420Sizes);
+
+}  // namespace
+}  // namespace media_api_samples
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/media_writing.h"
+
+#include <cstdint>
+#include <ios>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/testing/media_data.h"
+#include "meet_clients/samples/testing/mock_output_writer.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+using ::testing::_;
+
+// Output writer that records every chunk it receives, along with the number of
+// calls made to it.
+class RecordingOutputWriter : public OutputWriterInterface {
+ public:
+  void Write(const char* content, std::streamsize size) override {
+    ++write_calls;
+    data.insert(data.end(), content, content + size);
+  }
+  void WriteChunks(absl::Span<const absl::Span<const char>> chunks) override {
+    ++write_chunks_calls;
+    for (absl::Span<const char> chunk : chunks) {
+      chunk_data.push_back(chunk.data());
+      data.insert(data.end(), chunk.begin(), chunk.end());
+    }
+  }
+  void Close() override {}
+
+  int write_calls = 0;
+  int write_chunks_calls = 0;
+  // The start of each chunk passed to `WriteChunks`.
+  std::vector<const char*> chunk_data;
+  std::vector<char> data;
+};
+
+// Returns an 11x7 frame whose rows are padded to the given strides, with every
+// pixel set to a different value.
+webrtc::scoped_refptr<webrtc::I420Buffer> CreatePaddedFrame(int stride_y,
+                                                           int stride_uv) {
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame = webrtc::I420Buffer::Create(
+      /*width=*/11, /*height=*/7, stride_y, stride_uv, stride_uv);
+  for (int y = 0; y < 7; ++y) {
+    for (int x = 0; x < 11; ++x) {
+      frame->MutableDataY()[y * stride_y + x] =
+          static_cast<uint8_t>(y * 11 + x);
+    }
+  }
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 0; x < 6; ++x) {
+      frame->MutableDataU()[y * stride_uv + x] =
+          static_cast<uint8_t>(100 + y * 6 + x);
+      frame->MutableDataV()[y * stride_uv + x] =
+          static_cast<uint8_t>(200 + y * 6 + x);
+    }
+  }
+  return frame;
+}
+
+// Returns the pixels of `frame` without row padding.
+std::vector<char> PackFrame(const webrtc::I420BufferInterface& frame) {
+  std::vector<char> packed;
+  auto append_plane = [&](const uint8_t* plane, int stride, int width,
+                          int height) {
+    for (int y = 0; y < height; ++y) {
+      const uint8_t* row = plane + y * stride;
+      packed.insert(packed.end(), row, row + width);
+    }
+  };
+  append_plane(frame.DataY(), frame.StrideY(), frame.width(), frame.height());
+  append_plane(frame.DataU(), frame.StrideU(), frame.ChromaWidth(),
+               frame.ChromaHeight());
+  append_plane(frame.DataV(), frame.StrideV(), frame.ChromaWidth(),
+               frame.ChromaHeight());
+  return packed;
+}
+
+TEST(MediaWritingTest, WritePcm16WritesAllSamplesInOneCall) {
+  AudioTestData test_data = CreateAudioTestData(/*num_samples=*/480);
+
+  MockOutputWriter writer;
+  std::vector<int16_t> written_pcm16;
+  EXPECT_CALL(writer, Write(_, _))
+      .WillOnce([&](const char* content, std::streamsize size) {
+        const auto* samples = reinterpret_cast<const int16_t*>(content);
+        written_pcm16.assign(samples, samples + size / sizeof(int16_t));
+      });
+
+  WritePcm16(test_data.pcm16, writer);
+
+  EXPECT_EQ(written_pcm16, test_data.pcm16);
+}
+
+TEST(MediaWritingTest, WritePcm16WithEmptyBufferWritesNothing) {
+  MockOutputWriter writer;
+  EXPECT_CALL(writer, Write(_, 0));
+
+  WritePcm16(std::vector<int16_t>(), writer);
+}
+
+TEST(MediaWritingTest, WriteYuv420WritesAllPlanesInOneCall) {
+  VideoTestData test_data = CreateVideoTestData(/*width=*/11, /*height=*/7);
+
+  RecordingOutputWriter writer;
+  WriteYuv420(*test_data.meet_frame.frame.video_frame_buffer()->GetI420(),
+              writer);
+
+  EXPECT_EQ(writer.write_chunks_calls, 1);
+  EXPECT_EQ(writer.write_calls, 0);
+  EXPECT_EQ(writer.data, test_data.yuv_data);
+}
+
+TEST(MediaWritingTest, WriteYuv420ForwardsChunksToWriteByDefault) {
+  VideoTestData test_data = CreateVideoTestData(/*width=*/10, /*height=*/5);
+
+  MockOutputWriter writer;
+  std::vector<char> written_yuv_data;
+  EXPECT_CALL(writer, Write(_, _))
+      .WillRepeatedly([&](const char* content, std::streamsize size) {
+        written_yuv_data.insert(written_yuv_data.end(), content,
+                                content + size);
+      });
+
+  WriteYuv420(*test_data.meet_frame.frame.video_frame_buffer()->GetI420(),
+              writer);
+
+  EXPECT_EQ(written_yuv_data, test_data.yuv_data);
+}
+
+TEST(MediaWritingTest, WriteYuv420WritesUnpaddedPlanesInPlace) {
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame =
+      CreatePaddedFrame(/*stride_y=*/11, /*stride_uv=*/6);
+
+  RecordingOutputWriter writer;
+  std::vector<char> scratch;
+  WriteYuv420(*frame, writer, scratch);
+
+  EXPECT_EQ(writer.write_chunks_calls, 1);
+  ASSERT_FALSE(writer.chunk_data.empty());
+  EXPECT_EQ(writer.chunk_data[0],
+            reinterpret_cast<const char*>(frame->DataY()));
+  EXPECT_TRUE(scratch.empty());
+  EXPECT_EQ(writer.data, PackFrame(*frame));
+}
+
+TEST(MediaWritingTest, WriteYuv420PacksPaddedPlanesIntoOneChunk) {
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame =
+      CreatePaddedFrame(/*stride_y=*/16, /*stride_uv=*/8);
+
+  RecordingOutputWriter writer;
+  std::vector<char> scratch;
+  WriteYuv420(*frame, writer, scratch);
+
+  EXPECT_EQ(writer.write_chunks_calls, 1);
+  EXPECT_EQ(writer.chunk_data.size(), 1);
+  EXPECT_EQ(writer.data, PackFrame(*frame));
+
+  // The scratch buffer is reused for the next frame.
+  const char* scratch_data = scratch.data();
+  writer.chunk_data.clear();
+  WriteYuv420(*frame, writer, scratch);
+  EXPECT_EQ(scratch.data(), scratch_data);
+  EXPECT_EQ(writer.chunk_data, std::vector<const char*>{scratch_data});
+}
+
+TEST(MediaWritingTest, WriteYuv420PacksOnlyPaddedPlanes) {
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame =
+      CreatePaddedFrame(/*stride_y=*/11, /*stride_uv=*/8);
+
+  RecordingOutputWriter writer;
+  std::vector<char> scratch;
+  WriteYuv420(*frame, writer, scratch);
+
+  EXPECT_EQ(writer.write_chunks_calls, 1);
+  EXPECT_EQ(writer.chunk_data[0],
+            reinterpret_cast<const char*>(frame->DataY()));
+  EXPECT_EQ(scratch.size(), 2 * 6 * 4);
+  EXPECT_EQ(writer.data, PackFrame(*frame));
+}
+
+}  // namespace
+}  // namespace media_api_samples
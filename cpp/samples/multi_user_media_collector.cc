@@ -16,25 +16,38 @@
 
 #include "meet_clients/samples/multi_user_media_collector.h"
 
+#include <atomic>
 #include <cstdint>
+#include <ios>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <variant>
 #include <vector>
 
 #include "absl/base/nullability.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "meet_clients/api/media_api_client_interface.h"
 #include "meet_clients/api/media_entries_resource.h"
 #include "meet_clients/api/participants_resource.h"
-#include "meet_clients/samples/media_writing.h"
+#include "meet_clients/samples/frame_buffer_pool.h"
+#include "meet_clients/samples/frame_conversion_pool.h"
+#include "meet_clients/samples/media_chunk_log.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/segment_index.h"
+#include "meet_clients/samples/storage_health_monitor.h"
 #include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
 #include "api/video/video_frame_buffer.h"
 
 ABSL_POINTERS_DEFAULT_NONNULL
@@ -42,40 +55,171 @@ ABSL_POINTERS_DEFAULT_NONNULL
 namespace media_api_samples {
 namespace {
 
-constexpr absl::string_view kTmpAudioFormat = "%saudio_%s_tmp.pcm";
-constexpr absl::string_view kTmpVideoFormat = "%svideo_%s_tmp_%dx%d.yuv";
-constexpr absl::string_view kFinishedAudioFormat = "%saudio_%s_%s_%s.pcm";
-constexpr absl::string_view kFinishedVideoFormat = "%svideo_%s_%s_%s_%dx%d.yuv";
+// The `tmp` tokens are followed by the part index of files after the first of
+// a segment.
+constexpr absl::string_view kTmpAudioFormat = "%saudio_%s_tmp%s.%s";
+constexpr absl::string_view kTmpVideoFormat = "%svideo_%s_tmp%s_%dx%d.%s";
+constexpr absl::string_view kFinishedAudioFormat = "%saudio_%s_%s_%s.%s";
+constexpr absl::string_view kFinishedVideoFormat =
+    "%svideo_%s_%s_%s_%dx%d.%s";
+constexpr absl::string_view kTmpMuxedFormat = "%smedia_%s_tmp%s.%s";
+constexpr absl::string_view kFinishedMuxedFormat = "%smedia_%s_%s_%s.%s";
+
+std::string PartToken(int part) {
+  return part == 0 ? "" : absl::StrCat(part);
+}
+
+// An output writer that counts the bytes written through it, so that segments
+// can be rotated by size whichever thread writes them.
+class CountingOutputWriter : public OutputWriterInterface {
+ public:
+  CountingOutputWriter(std::unique_ptr<OutputWriterInterface> output,
+                       std::shared_ptr<std::atomic<int64_t>> written_bytes)
+      : output_(std::move(output)), written_bytes_(std::move(written_bytes)) {}
+
+  void Write(const char* content, std::streamsize size) override {
+    output_->Write(content, size);
+    written_bytes_->fetch_add(size, std::memory_order_relaxed);
+  }
+  void WriteChunks(absl::Span<const absl::Span<const char>> chunks) override {
+    output_->WriteChunks(chunks);
+    int64_t size = 0;
+    for (absl::Span<const char> chunk : chunks) {
+      size += chunk.size();
+    }
+    written_bytes_->fetch_add(size, std::memory_order_relaxed);
+  }
+  void Flush() override { output_->Flush(); }
+  void Close() override { output_->Close(); }
+
+ private:
+  std::unique_ptr<OutputWriterInterface> output_;
+  std::shared_ptr<std::atomic<int64_t>> written_bytes_;
+};
+
+// Returns the size of an I420 frame of `width` by `height`.
+int64_t I420FrameSize(int width, int height) {
+  return int64_t{width} * height + 2 * int64_t{(width + 1) / 2} *
+                                       ((height + 1) / 2);
+}
+
+// Scales `buffer` into a buffer from `buffer_pool`, or into a new buffer if
+// `buffer_pool` is null.
+webrtc::scoped_refptr<webrtc::I420BufferInterface> DownscaleByHalf(
+    const webrtc::I420BufferInterface& buffer,
+    FrameBufferPool* /*absl_nullable*/ buffer_pool) {
+  int width = (buffer.width() + 1) / 2;
+  int height = (buffer.height() + 1) / 2;
+  webrtc::scoped_refptr<webrtc::I420Buffer> scaled =
+      buffer_pool != nullptr ? buffer_pool->CreateBuffer(width, height)
+                             : webrtc::I420Buffer::Create(width, height);
+  scaled->ScaleFrom(buffer);
+  return scaled;
+}
 
 }  // namespace
 
 void MultiUserMediaCollector::OnAudioFrame(meet::AudioFrame frame) {
   absl::Time received_time = absl::Now();
+  int64_t size = frame.pcm16.size() * sizeof(int16_t);
+  if (storage_monitor_ != nullptr) {
+    if (storage_monitor_->AdmitAudioFrame(size) ==
+        StorageHealthMonitor::FrameAction::kDrop) {
+      return;
+    }
+    storage_monitor_->RecordQueuedBytes(size);
+  }
   std::vector<int16_t> samples(frame.pcm16.begin(), frame.pcm16.end());
 
   collector_thread_->PostTask([this, samples = std::move(samples),
                                contributing_source = frame.contributing_source,
-                               received_time = received_time] {
+                               received_time = received_time,
+                               size]() mutable {
     HandleAudioData(std::move(samples), contributing_source, received_time);
+    if (storage_monitor_ != nullptr) {
+      storage_monitor_->RecordQueuedBytes(-size);
+    }
   });
 }
 
 void MultiUserMediaCollector::OnVideoFrame(meet::VideoFrame frame) {
   absl::Time received_time = absl::Now();
-  webrtc::scoped_refptr<webrtc::I420BufferInterface> buffer =
-      frame.frame.video_frame_buffer()->ToI420();
-
-  collector_thread_->PostTask([this, buffer = std::move(buffer),
-                               contributing_source = frame.contributing_source,
-                               received_time = received_time] {
-    HandleVideoData(std::move(buffer), contributing_source, received_time);
-  });
+  bool downscale = false;
+  int64_t size = 0;
+  if (storage_monitor_ != nullptr) {
+    // Decide before converting the frame, so that dropped frames cost nothing.
+    size = I420FrameSize(frame.frame.width(), frame.frame.height());
+    switch (storage_monitor_->AdmitVideoFrame(size)) {
+      case StorageHealthMonitor::FrameAction::kDrop:
+        return;
+      case StorageHealthMonitor::FrameAction::kDownscale:
+        downscale = true;
+        size = I420FrameSize((frame.frame.width() + 1) / 2,
+                             (frame.frame.height() + 1) / 2);
+        break;
+      case StorageHealthMonitor::FrameAction::kWrite:
+        break;
+    }
+    storage_monitor_->RecordQueuedBytes(size);
+  }
+  // Only take a reference to the decoded buffer here. Converting it, which
+  // may copy the whole frame, is left to the conversion pool so that this
+  // thread can get back to decoding.
+  auto convert = [this, buffer = frame.frame.video_frame_buffer(),
+                  contributing_source = frame.contributing_source,
+                  received_time = received_time,
+                  rtp_timestamp = frame.frame.rtp_timestamp(), downscale,
+                  size]() mutable {
+    FrameBufferPool* /*absl_nullable*/ buffer_pool =
+        conversion_pool_ != nullptr ? &conversion_pool_->buffer_pool()
+                                    : nullptr;
+    webrtc::scoped_refptr<webrtc::I420BufferInterface> i420 =
+        buffer_pool != nullptr ? buffer_pool->ToI420(*buffer)
+                               : buffer->ToI420();
+    buffer = nullptr;
+    if (downscale) {
+      i420 = DownscaleByHalf(*i420, buffer_pool);
+    }
+    collector_thread_->PostTask([this, i420 = std::move(i420),
+                                 contributing_source, received_time,
+                                 rtp_timestamp, size] {
+      HandleVideoData(std::move(i420), contributing_source, received_time,
+                      rtp_timestamp);
+      if (storage_monitor_ != nullptr) {
+        storage_monitor_->RecordQueuedBytes(-size);
+      }
+    });
+  };
+  if (conversion_pool_ == nullptr) {
+    convert();
+    return;
+  }
+  // Frames of a contributing source are converted on the same thread, so
+  // they reach the collector thread in order.
+  conversion_pool_->PostTask(frame.contributing_source, std::move(convert));
 }
 
 void MultiUserMediaCollector::HandleAudioData(std::vector<int16_t> samples,
                                               uint32_t contributing_source,
                                               absl::Time received_time) {
   DCHECK(collector_thread_->IsCurrent());
+  RestartSegmentsIfSpilled();
+
+  if (chunk_log_ != nullptr) {
+    chunk_log_->WriteAudio(contributing_source, received_time, samples);
+    return;
+  }
+
+  if (muxed_format_.has_value()) {
+    MuxedSegment* muxed_segment =
+        GetMuxedSegment(contributing_source, received_time);
+    if (muxed_segment != nullptr) {
+      muxed_segment->writer->WriteAudioSamples(std::move(samples),
+                                               received_time);
+      muxed_segment->last_frame_time = received_time;
+    }
+    return;
+  }
 
   AudioSegment* audio_segment = nullptr;
 
@@ -87,6 +231,11 @@ void MultiUserMediaCollector::HandleAudioData(std::vector<int16_t> samples,
       // Reuse the existing segment if the received frame is within the gap of
       // the previous frame.
       audio_segment = current_audio_segment;
+      if (PrepareRotation(*audio_segment, received_time, [&](int part) {
+            return AudioTmpFileName(audio_segment->file_identifier, part);
+          })) {
+        RotateAudioSegment(*audio_segment, received_time);
+      }
       // TODO: Make this heuristic calculation more testable.
       audio_segment->last_frame_time = received_time;
     } else {
@@ -116,12 +265,18 @@ void MultiUserMediaCollector::HandleAudioData(std::vector<int16_t> samples,
     }
 
     std::string file_identifier = std::move(file_identifier_status).value();
+    OpenedSegmentFile segment_file =
+        OpenSegmentFile(AudioTmpFileName(file_identifier, /*part=*/0),
+                        /*part=*/0);
+    std::unique_ptr<SegmentIndexWriter> index = OpenSegmentIndex(
+        segment_file.file.tmp_name, audio_format_.index_frames);
     auto new_audio_segment = std::make_unique<AudioSegment>(AudioSegment{
-        .writer = output_writer_provider_(absl::StrFormat(
-            kTmpAudioFormat, output_file_prefix_, file_identifier)),
+        .writer = audio_format_.create_writer(std::move(segment_file.output)),
         .file_identifier = std::move(file_identifier),
         .first_frame_time = received_time,
-        .last_frame_time = received_time});
+        .last_frame_time = received_time,
+        .file = std::move(segment_file.file),
+        .index = std::move(index)});
     audio_segment = new_audio_segment.get();
     audio_segments_[contributing_source] = std::move(new_audio_segment);
   }
@@ -129,13 +284,20 @@ void MultiUserMediaCollector::HandleAudioData(std::vector<int16_t> samples,
   DCHECK(audio_segment != nullptr);
   // At this point, either an existing segment is being appended to or a new
   // segment has been created.
-  WritePcm16(samples, *audio_segment->writer);
+  if (audio_segment->index != nullptr) {
+    audio_segment->index->AddFrame(samples.size() * sizeof(int16_t),
+                                   received_time, /*rtp_timestamp=*/0,
+                                   contributing_source);
+  }
+  audio_segment->writer->WriteSamples(std::move(samples));
 }
 
 void MultiUserMediaCollector::HandleVideoData(
     webrtc::scoped_refptr<webrtc::I420BufferInterface> buffer,
-    uint32_t contributing_source, absl::Time received_time) {
+    uint32_t contributing_source, absl::Time received_time,
+    uint32_t rtp_timestamp) {
   DCHECK(collector_thread_->IsCurrent());
+  RestartSegmentsIfSpilled();
 
   // Meet video frames are always in YUV420p format.
   const webrtc::I420BufferInterface* i420 = buffer->GetI420();
@@ -144,6 +306,35 @@ void MultiUserMediaCollector::HandleVideoData(
     return;
   }
 
+  if (chunk_log_ != nullptr) {
+    chunk_log_->WriteVideo(contributing_source, received_time, rtp_timestamp,
+                           *i420);
+    return;
+  }
+
+  if (muxed_format_.has_value()) {
+    MuxedSegment* muxed_segment =
+        GetMuxedSegment(contributing_source, received_time);
+    if (muxed_segment == nullptr) {
+      return;
+    }
+    if (!muxed_segment->writer->WriteVideoFrame(buffer, received_time)) {
+      // The segment cannot hold frames of this resolution, so close it and
+      // start a new one.
+      std::string file_identifier = muxed_segment->file_identifier;
+      CloseMuxedSegment(*muxed_segment);
+      muxed_segments_.erase(file_identifier);
+      muxed_segment = GetMuxedSegment(contributing_source, received_time);
+      if (muxed_segment == nullptr ||
+          !muxed_segment->writer->WriteVideoFrame(std::move(buffer),
+                                                  received_time)) {
+        return;
+      }
+    }
+    muxed_segment->last_frame_time = received_time;
+    return;
+  }
+
   VideoSegment* video_segment = nullptr;
 
   if (auto it = video_segments_.find(contributing_source);
@@ -156,6 +347,13 @@ void MultiUserMediaCollector::HandleVideoData(
       // Reuse the existing segment if the received frame is within the gap of
       // the previous frame and the resolution is the same.
       video_segment = current_video_segment;
+      if (PrepareRotation(*video_segment, received_time, [&](int part) {
+            return VideoTmpFileName(video_segment->file_identifier,
+                                    video_segment->width,
+                                    video_segment->height, part);
+          })) {
+        RotateVideoSegment(*video_segment, received_time);
+      }
       // TODO: Make this heuristic calculation more testable.
       video_segment->last_frame_time = received_time;
     } else {
@@ -186,16 +384,23 @@ void MultiUserMediaCollector::HandleVideoData(
     }
 
     std::string file_identifier = std::move(file_identifier_status).value();
-    std::string video_segment_name =
-        absl::StrFormat(kTmpVideoFormat, output_file_prefix_, file_identifier,
-                        buffer->width(), buffer->height());
+    OpenedSegmentFile segment_file = OpenSegmentFile(
+        VideoTmpFileName(file_identifier, buffer->width(), buffer->height(),
+                         /*part=*/0),
+        /*part=*/0);
+    std::unique_ptr<SegmentIndexWriter> index = OpenSegmentIndex(
+        segment_file.file.tmp_name, video_format_.index_frames);
     auto new_video_segment = std::make_unique<VideoSegment>(VideoSegment{
-        .writer = output_writer_provider_(std::move(video_segment_name)),
+        .writer = video_format_.create_writer(std::move(segment_file.output),
+                                              buffer->width(),
+                                              buffer->height()),
         .file_identifier = std::move(file_identifier),
         .width = buffer->width(),
         .height = buffer->height(),
         .first_frame_time = received_time,
-        .last_frame_time = received_time});
+        .last_frame_time = received_time,
+        .file = std::move(segment_file.file),
+        .index = std::move(index)});
     video_segment = new_video_segment.get();
     video_segments_[contributing_source] = std::move(new_video_segment);
   }
@@ -203,7 +408,58 @@ void MultiUserMediaCollector::HandleVideoData(
   DCHECK(video_segment != nullptr);
   // At this point, either an existing segment is being appended to or a new
   // segment has been created.
-  WriteYuv420(*i420, *video_segment->writer);
+  if (video_segment->index != nullptr) {
+    video_segment->index->AddFrame(
+        I420FrameSize(video_segment->width, video_segment->height),
+        received_time, rtp_timestamp, contributing_source);
+  }
+  video_segment->writer->WriteFrame(std::move(buffer), received_time);
+}
+
+MultiUserMediaCollector::MuxedSegment* /*absl_nullable*/
+MultiUserMediaCollector::GetMuxedSegment(uint32_t contributing_source,
+                                         absl::Time received_time) {
+  DCHECK(collector_thread_->IsCurrent());
+
+  absl::StatusOr<std::string> file_identifier_status =
+      resource_manager_->GetOutputFileIdentifier(contributing_source);
+  if (!file_identifier_status.ok()) {
+    // As with separate segments, resource updates may lag behind the media of
+    // a joining participant.
+    VLOG(1) << "No file identifier found for contributing source "
+            << contributing_source << ": "
+            << file_identifier_status.status().message();
+    return nullptr;
+  }
+  std::string file_identifier = std::move(file_identifier_status).value();
+
+  if (auto it = muxed_segments_.find(file_identifier);
+      it != muxed_segments_.end()) {
+    if (received_time - it->second->last_frame_time < segment_gap_threshold_) {
+      MuxedSegment& muxed_segment = *it->second;
+      if (PrepareRotation(muxed_segment, received_time, [&](int part) {
+            return MuxedTmpFileName(muxed_segment.file_identifier, part);
+          })) {
+        RotateMuxedSegment(muxed_segment, received_time);
+      }
+      return &muxed_segment;
+    }
+    CloseMuxedSegment(*it->second);
+    muxed_segments_.erase(it);
+  }
+
+  OpenedSegmentFile segment_file = OpenSegmentFile(
+      MuxedTmpFileName(file_identifier, /*part=*/0), /*part=*/0);
+  auto new_muxed_segment = std::make_unique<MuxedSegment>(MuxedSegment{
+      .writer = muxed_format_->create_writer(std::move(segment_file.output),
+                                             received_time),
+      .file_identifier = file_identifier,
+      .first_frame_time = received_time,
+      .last_frame_time = received_time,
+      .file = std::move(segment_file.file)});
+  MuxedSegment* muxed_segment = new_muxed_segment.get();
+  muxed_segments_[std::move(file_identifier)] = std::move(new_muxed_segment);
+  return muxed_segment;
 }
 
 void MultiUserMediaCollector::OnMessageFromServer(
@@ -230,14 +486,14 @@ void MultiUserMediaCollector::OnDisconnected(absl::Status status) {
   LOG(INFO) << "MultiUserMediaCollector::OnDisconnected " << status;
   collector_thread_->PostTask([this, status = std::move(status)] {
     disconnect_status_ = std::move(status);
-    for (auto& [contributing_source, audio_segment] : audio_segments_) {
-      CloseAudioSegment(*audio_segment);
+    CloseAllSegments();
+    if (chunk_log_ != nullptr) {
+      chunk_log_->Close();
+      RenameSegmentFile(absl::StrCat(output_file_prefix_, kChunkLogTmpFileName),
+                        absl::StrCat(output_file_prefix_, kChunkLogFileName));
     }
-    audio_segments_.clear();
-    for (auto& [contributing_source, video_segment] : video_segments_) {
-      CloseVideoSegment(*video_segment);
-    }
-    video_segments_.clear();
+    // Segments are only finished once their writers are done.
+    WaitForPendingCloses();
 
     disconnect_notification_.Notify();
 
@@ -251,32 +507,280 @@ void MultiUserMediaCollector::OnDisconnected(absl::Status status) {
   });
 }
 
+void MultiUserMediaCollector::CloseAllSegments() {
+  DCHECK(collector_thread_->IsCurrent());
+
+  for (auto& [contributing_source, audio_segment] : audio_segments_) {
+    CloseAudioSegment(*audio_segment);
+  }
+  audio_segments_.clear();
+  for (auto& [contributing_source, video_segment] : video_segments_) {
+    CloseVideoSegment(*video_segment);
+  }
+  video_segments_.clear();
+  for (auto& [file_identifier, muxed_segment] : muxed_segments_) {
+    CloseMuxedSegment(*muxed_segment);
+  }
+  muxed_segments_.clear();
+}
+
+void MultiUserMediaCollector::RestartSegmentsIfSpilled() {
+  DCHECK(collector_thread_->IsCurrent());
+
+  if (storage_monitor_ == nullptr) {
+    return;
+  }
+  int64_t spills = storage_monitor_->GetStats().spills;
+  if (spills == seen_spills_) {
+    return;
+  }
+  seen_spills_ = spills;
+  LOG(WARNING) << "Restarting segments in the spill directory";
+  CloseAllSegments();
+}
+
 void MultiUserMediaCollector::CloseAudioSegment(AudioSegment& audio_segment) {
   DCHECK(collector_thread_->IsCurrent());
 
-  audio_segment.writer->Close();
-  segment_renamer_(
-      absl::StrFormat(kTmpAudioFormat, output_file_prefix_,
-                      audio_segment.file_identifier),
-      absl::StrFormat(kFinishedAudioFormat, output_file_prefix_,
-                      audio_segment.file_identifier,
-                      absl::FormatTime(audio_segment.first_frame_time),
-                      absl::FormatTime(audio_segment.last_frame_time)));
+  std::string finished_name = absl::StrFormat(
+      kFinishedAudioFormat, output_file_prefix_, audio_segment.file_identifier,
+      absl::FormatTime(audio_segment.first_frame_time),
+      absl::FormatTime(audio_segment.last_frame_time),
+      audio_format_.file_extension);
+  // As with video, encoding writers finish on their encoder thread.
+  StartPendingClose();
+  AudioSegmentWriterInterface::CloseAsync(
+      std::move(audio_segment.writer),
+      [this, tmp_name = audio_segment.file.tmp_name,
+       finished_name = std::move(finished_name),
+       index = std::move(audio_segment.index)]() mutable {
+        RenameSegmentFile(tmp_name, finished_name);
+        CloseSegmentIndex(index, tmp_name, finished_name);
+        FinishPendingClose();
+      });
+  DiscardNextFile(audio_segment.next_file);
 }
 
 void MultiUserMediaCollector::CloseVideoSegment(VideoSegment& video_segment) {
   DCHECK(collector_thread_->IsCurrent());
 
-  video_segment.writer->Close();
-  segment_renamer_(
-      absl::StrFormat(kTmpVideoFormat, output_file_prefix_,
-                      video_segment.file_identifier, video_segment.width,
-                      video_segment.height),
-      absl::StrFormat(kFinishedVideoFormat, output_file_prefix_,
-                      video_segment.file_identifier,
-                      absl::FormatTime(video_segment.first_frame_time),
-                      absl::FormatTime(video_segment.last_frame_time),
-                      video_segment.width, video_segment.height));
+  std::string finished_name = absl::StrFormat(
+      kFinishedVideoFormat, output_file_prefix_, video_segment.file_identifier,
+      absl::FormatTime(video_segment.first_frame_time),
+      absl::FormatTime(video_segment.last_frame_time), video_segment.width,
+      video_segment.height, video_format_.file_extension);
+  // Encoding writers finish on their encoder thread, so that the collector
+  // thread does not wait for every queued frame to be encoded.
+  StartPendingClose();
+  VideoSegmentWriterInterface::CloseAsync(
+      std::move(video_segment.writer),
+      [this, tmp_name = video_segment.file.tmp_name,
+       finished_name = std::move(finished_name),
+       index = std::move(video_segment.index)]() mutable {
+        RenameSegmentFile(tmp_name, finished_name);
+        CloseSegmentIndex(index, tmp_name, finished_name);
+        FinishPendingClose();
+      });
+  DiscardNextFile(video_segment.next_file);
+}
+
+void MultiUserMediaCollector::CloseMuxedSegment(MuxedSegment& muxed_segment) {
+  DCHECK(collector_thread_->IsCurrent());
+
+  std::string finished_name = absl::StrFormat(
+      kFinishedMuxedFormat, output_file_prefix_, muxed_segment.file_identifier,
+      absl::FormatTime(muxed_segment.first_frame_time),
+      absl::FormatTime(muxed_segment.last_frame_time),
+      muxed_format_->file_extension);
+  // As with video, encoding writers finish on their encoder threads.
+  StartPendingClose();
+  MuxedSegmentWriterInterface::CloseAsync(
+      std::move(muxed_segment.writer),
+      [this, tmp_name = muxed_segment.file.tmp_name,
+       finished_name = std::move(finished_name)]() {
+        RenameSegmentFile(tmp_name, finished_name);
+        FinishPendingClose();
+      });
+  DiscardNextFile(muxed_segment.next_file);
+}
+
+void MultiUserMediaCollector::RotateAudioSegment(AudioSegment& audio_segment,
+                                                 absl::Time received_time) {
+  DCHECK(collector_thread_->IsCurrent());
+
+  OpenedSegmentFile next_file =
+      TakeNextFile(audio_segment, [&](int part) {
+        return AudioTmpFileName(audio_segment.file_identifier, part);
+      });
+  CloseAudioSegment(audio_segment);
+  audio_segment.writer =
+      audio_format_.create_writer(std::move(next_file.output));
+  audio_segment.file = std::move(next_file.file);
+  audio_segment.index = OpenSegmentIndex(audio_segment.file.tmp_name,
+                                         audio_format_.index_frames);
+  audio_segment.first_frame_time = received_time;
+}
+
+void MultiUserMediaCollector::RotateVideoSegment(VideoSegment& video_segment,
+                                                 absl::Time received_time) {
+  DCHECK(collector_thread_->IsCurrent());
+
+  OpenedSegmentFile next_file =
+      TakeNextFile(video_segment, [&](int part) {
+        return VideoTmpFileName(video_segment.file_identifier,
+                                video_segment.width, video_segment.height,
+                                part);
+      });
+  CloseVideoSegment(video_segment);
+  video_segment.writer = video_format_.create_writer(
+      std::move(next_file.output), video_segment.width, video_segment.height);
+  video_segment.file = std::move(next_file.file);
+  video_segment.index = OpenSegmentIndex(video_segment.file.tmp_name,
+                                         video_format_.index_frames);
+  video_segment.first_frame_time = received_time;
+}
+
+void MultiUserMediaCollector::RotateMuxedSegment(MuxedSegment& muxed_segment,
+                                                 absl::Time received_time) {
+  DCHECK(collector_thread_->IsCurrent());
+
+  OpenedSegmentFile next_file =
+      TakeNextFile(muxed_segment, [&](int part) {
+        return MuxedTmpFileName(muxed_segment.file_identifier, part);
+      });
+  CloseMuxedSegment(muxed_segment);
+  muxed_segment.writer = muxed_format_->create_writer(
+      std::move(next_file.output), received_time);
+  muxed_segment.file = std::move(next_file.file);
+  muxed_segment.first_frame_time = received_time;
+}
+
+template <typename Segment>
+bool MultiUserMediaCollector::PrepareRotation(
+    Segment& segment, absl::Time received_time,
+    absl::FunctionRef<std::string(int)> tmp_file_name) {
+  if (ReachedRotationLimit(segment.file, segment.first_frame_time,
+                           received_time, /*fraction=*/1)) {
+    return true;
+  }
+  if (!segment.next_file.has_value() &&
+      ReachedRotationLimit(segment.file, segment.first_frame_time,
+                           received_time, rotation_.preopen_fraction)) {
+    int part = segment.file.part + 1;
+    segment.next_file = OpenSegmentFile(tmp_file_name(part), part);
+  }
+  return false;
+}
+
+template <typename Segment>
+MultiUserMediaCollector::OpenedSegmentFile
+MultiUserMediaCollector::TakeNextFile(
+    Segment& segment, absl::FunctionRef<std::string(int)> tmp_file_name) {
+  if (!segment.next_file.has_value()) {
+    int part = segment.file.part + 1;
+    return OpenSegmentFile(tmp_file_name(part), part);
+  }
+  OpenedSegmentFile next_file = *std::move(segment.next_file);
+  segment.next_file.reset();
+  return next_file;
+}
+
+bool MultiUserMediaCollector::ReachedRotationLimit(const SegmentFile& file,
+                                                   absl::Time first_frame_time,
+                                                   absl::Time received_time,
+                                                   double fraction) const {
+  return (rotation_.max_bytes > 0 &&
+          file.written_bytes->load(std::memory_order_relaxed) >=
+              rotation_.max_bytes * fraction) ||
+         received_time - first_frame_time >= rotation_.max_duration * fraction;
+}
+
+MultiUserMediaCollector::OpenedSegmentFile
+MultiUserMediaCollector::OpenSegmentFile(std::string tmp_name, int part) {
+  auto written_bytes = std::make_shared<std::atomic<int64_t>>(0);
+  auto output = std::make_unique<CountingOutputWriter>(
+      output_writer_provider_(tmp_name), written_bytes);
+  return {.file = {.tmp_name = std::move(tmp_name),
+                   .part = part,
+                   .written_bytes = std::move(written_bytes)},
+          .output = std::move(output)};
+}
+
+std::unique_ptr<SegmentIndexWriter> MultiUserMediaCollector::OpenSegmentIndex(
+    absl::string_view tmp_name, bool index_frames) {
+  if (!index_frames) {
+    return nullptr;
+  }
+  return std::make_unique<SegmentIndexWriter>(
+      output_writer_provider_(SegmentIndexFileName(tmp_name)));
+}
+
+void MultiUserMediaCollector::CloseSegmentIndex(
+    std::unique_ptr<SegmentIndexWriter>& index, absl::string_view tmp_name,
+    absl::string_view finished_name) {
+  if (index == nullptr) {
+    return;
+  }
+  index->Close();
+  index = nullptr;
+  RenameSegmentFile(SegmentIndexFileName(tmp_name),
+                    SegmentIndexFileName(finished_name));
+}
+
+void MultiUserMediaCollector::RenameSegmentFile(
+    absl::string_view tmp_name, absl::string_view finished_name) {
+  absl::MutexLock lock(&files_mutex_);
+  segment_renamer_(tmp_name, finished_name);
+}
+
+void MultiUserMediaCollector::StartPendingClose() {
+  absl::MutexLock lock(&files_mutex_);
+  ++pending_closes_;
+}
+
+void MultiUserMediaCollector::FinishPendingClose() {
+  absl::MutexLock lock(&files_mutex_);
+  --pending_closes_;
+}
+
+void MultiUserMediaCollector::WaitForPendingCloses() {
+  absl::MutexLock lock(&files_mutex_);
+  files_mutex_.Await(absl::Condition(
+      +[](int* pending_closes) { return *pending_closes == 0; },
+      &pending_closes_));
+}
+
+void MultiUserMediaCollector::DiscardNextFile(
+    std::optional<OpenedSegmentFile>& next_file) {
+  if (!next_file.has_value()) {
+    return;
+  }
+  next_file->output->Close();
+  {
+    absl::MutexLock lock(&files_mutex_);
+    segment_remover_(next_file->file.tmp_name);
+  }
+  next_file.reset();
+}
+
+std::string MultiUserMediaCollector::AudioTmpFileName(
+    absl::string_view file_identifier, int part) const {
+  return absl::StrFormat(kTmpAudioFormat, output_file_prefix_, file_identifier,
+                         PartToken(part), audio_format_.file_extension);
+}
+
+std::string MultiUserMediaCollector::VideoTmpFileName(
+    absl::string_view file_identifier, int width, int height,
+    int part) const {
+  return absl::StrFormat(kTmpVideoFormat, output_file_prefix_, file_identifier,
+                         PartToken(part), width, height,
+                         video_format_.file_extension);
+}
+
+std::string MultiUserMediaCollector::MuxedTmpFileName(
+    absl::string_view file_identifier, int part) const {
+  return absl::StrFormat(kTmpMuxedFormat, output_file_prefix_, file_identifier,
+                         PartToken(part), muxed_format_->file_extension);
 }
 
 }  // namespace media_api_samples
@@ -17,10 +17,8 @@
 #ifndef CPP_SAMPLES_MULTI_USER_MEDIA_COLLECTOR_H_
 #define CPP_SAMPLES_MULTI_USER_MEDIA_COLLECTOR_H_
 
+#include <atomic>
 #include <cstdint>
-#include <cstdio>
-#include <fstream>
-#include <ios>
 #include <memory>
 #include <optional>
 #include <string>
@@ -29,20 +27,33 @@
 
 #include "absl/base/attributes.h"
 #include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/functional/any_invocable.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
 #include "meet_clients/api/media_api_client_interface.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
+#include "meet_clients/samples/event_log_writer_interface.h"
+#include "meet_clients/samples/frame_conversion_pool.h"
+#include "meet_clients/samples/media_chunk_log.h"
+#include "meet_clients/samples/muxed_segment_writer_interface.h"
 #include "meet_clients/samples/output_file.h"
 #include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/raw_audio_segment_writer.h"
+#include "meet_clients/samples/raw_video_segment_writer.h"
 #include "meet_clients/samples/resource_manager.h"
 #include "meet_clients/samples/resource_manager_interface.h"
+#include "meet_clients/samples/segment_index.h"
+#include "meet_clients/samples/storage_health_monitor.h"
+#include "meet_clients/samples/video_segment_writer_interface.h"
 #include "api/scoped_refptr.h"
 #include "api/video/video_frame_buffer.h"
 #include "rtc_base/thread.h"
@@ -51,6 +62,19 @@ ABSL_POINTERS_DEFAULT_NONNULL
 
 namespace media_api_samples {
 
+// Limits after which a segment continues in a new file, so that the finished
+// parts of long segments can be processed while the meeting is still going.
+struct SegmentRotationOptions {
+  // Size of a segment's file, in bytes, after which the segment moves to a new
+  // file. Zero disables rotation by size.
+  int64_t max_bytes = 0;
+  // Time span of a segment's file after which the segment moves to a new file.
+  absl::Duration max_duration = absl::InfiniteDuration();
+  // Fraction of either limit at which the next file is opened, so that
+  // rotating only has to close the current file.
+  double preopen_fraction = 0.9;
+};
+
 // A basic media collector that collects audio and video streams from the
 // conference.
 //
@@ -64,17 +88,41 @@ namespace media_api_samples {
 // format:
 //
 // Audio:
-//   <output_file_prefix>audio_<participant_identifiers>_tmp.pcm
+//   <output_file_prefix>audio_<participant_identifiers>_tmp.<extension>
 // Video:
-//   <output_file_prefix>video_<participant_identifiers>_tmp_<width>x<height>.yuv
+//   <output_file_prefix>video_<participant_identifiers>_tmp_<width>x<height>.<extension>
 //
 // Once a segment is finished, the `tmp` token will be replaced with the start
 // and end times of the segment:
 //
 // Audio:
-//   <output_file_prefix>audio_<participant_identifiers>_<start_time>_<end_time>.pcm
+//   <output_file_prefix>audio_<participant_identifiers>_<start_time>_<end_time>.<extension>
 // Video:
-//   <output_file_prefix>video_<participant_identifiers>_<start_time>_<end_time>_<width>x<height>.yuv
+//   <output_file_prefix>video_<participant_identifiers>_<start_time>_<end_time>_<width>x<height>.<extension>
+//
+// When `Options::muxed_format` is set, each participant's audio and
+// video are instead interleaved in a single segment, which ends on a gap in
+// both streams or on a resolution change:
+//
+//   <output_file_prefix>media_<participant_identifiers>_tmp.<extension>
+//   <output_file_prefix>media_<participant_identifiers>_<start_time>_<end_time>.<extension>
+//
+// If `SegmentRotationOptions` limits are set, a segment that reaches them
+// continues in a new file, starting with the frame that reached the limit. Each
+// file is renamed as above once finished. Files after the first of a segment
+// replace the `tmp` token with `tmp<n>`, where `n` is the file's index:
+//
+//   <output_file_prefix>audio_<participant_identifiers>_tmp1.<extension>
+//
+// When `Options::chunk_log` is set, no segments are written. The
+// frames of all participants are instead appended to a single chunk log (see
+// `media_chunk_log.h`), which is renamed once the collector disconnects:
+//
+//   <output_file_prefix>media_tmp.chunks
+//   <output_file_prefix>media.chunks
+//
+// File extensions depend on the `AudioSegmentFormat` and `VideoSegmentFormat`;
+// raw pcm16 segments use `pcm` and raw I420 segments use `yuv`.
 //
 // For video segments, the resolution of the segment will also be included in
 // the file name. The resolution is appended to the end of the file name so that
@@ -88,43 +136,104 @@ class MultiUserMediaCollector : public meet::MediaApiClientObserverInterface {
   using SegmentRenamer =
       absl::AnyInvocable<void(/*tmp_name=*/absl::string_view,
                               /*timestamped_name=*/absl::string_view)>;
+  // Lambda for removing segment files that were opened ahead of a rotation
+  // that did not happen.
+  using SegmentRemover =
+      absl::AnyInvocable<void(/*tmp_name=*/absl::string_view)>;
+
+  // Returns the name of the participant and media entry event log when
+  // encoded in `format`, relative to the output file prefix. It is opened
+  // through the output writer provider.
+  static absl::string_view EventLogFileName(EventLogFormat format) {
+    return format == EventLogFormat::kBinary ? "event_log.bin"
+                                             : "event_log.csv";
+  }
+
+  struct Options {
+    // Opens the collector's files, including the event log.
+    OutputWriterProvider output_writer_provider = CreateOutputFileProvider();
+    // Renames finished segments, and removes files that were opened ahead of a
+    // rotation that did not happen. Both must be able to handle files created
+    // by `output_writer_provider`.
+    SegmentRenamer segment_renamer = RenameOutputFile;
+    SegmentRemover segment_remover = RemoveOutputFile;
+    VideoSegmentFormat video_format = CreateRawVideoSegmentFormat();
+    AudioSegmentFormat audio_format = CreateRawAudioSegmentFormat();
+    // If set, each participant's audio and video are interleaved in segments
+    // of this format instead of `video_format` and `audio_format` segments.
+    std::optional<MuxedSegmentFormat> muxed_format;
+    // If true, all frames are appended to a chunk log instead of segments.
+    // This avoids the many small files of segments in conferences with many
+    // participants.
+    bool chunk_log = false;
+    // A frame received this long after the previous frame of its stream
+    // starts a new segment.
+    absl::Duration segment_gap_threshold = absl::Seconds(1);
+    SegmentRotationOptions rotation;
+    // If set, frames are degraded or dropped as it decides before being queued
+    // for the collector thread.
+    /*absl_nullable*/ std::shared_ptr<StorageHealthMonitor> storage_monitor;
+    // Encoding of the participant and media entry event log. Unused if a
+    // participant manager is injected.
+    EventLogFormat event_log_format = EventLogFormat::kCsv;
+    // If set, video frames are converted to I420 on its threads rather than on
+    // the thread that delivers them.
+    /*absl_nullable*/ std::shared_ptr<FrameConversionPool> conversion_pool;
+  };
 
   // Default constructor that writes media to real files and uses a real
   // participant manager.
   MultiUserMediaCollector(absl::string_view output_file_prefix,
                           absl::Duration segment_gap_threshold,
                           std::unique_ptr<webrtc::Thread> collector_thread)
+      : MultiUserMediaCollector(
+            output_file_prefix,
+            Options{.segment_gap_threshold = segment_gap_threshold},
+            std::move(collector_thread)) {}
+
+  // Constructor that writes media as configured by `options`, and uses a real
+  // participant manager.
+  MultiUserMediaCollector(absl::string_view output_file_prefix, Options options,
+                          std::unique_ptr<webrtc::Thread> collector_thread)
+      : MultiUserMediaCollector(output_file_prefix, std::move(options),
+                                /*resource_manager=*/nullptr,
+                                std::move(collector_thread)) {}
+
+  // Constructor that allows injecting a participant manager for testing. If
+  // `resource_manager` is null, a real participant manager is used.
+  MultiUserMediaCollector(
+      absl::string_view output_file_prefix, Options options,
+      /*absl_nullable*/ std::unique_ptr<ResourceManagerInterface>
+          resource_manager,
+      std::unique_ptr<webrtc::Thread> collector_thread)
       : output_file_prefix_(output_file_prefix),
-        output_writer_provider_([](absl::string_view file_name) {
-          std::ofstream file(std::string(file_name), std::ios::binary |
-                                                         std::ios::out |
-                                                         std::ios::trunc);
-          if (file.is_open()) {
-            LOG(INFO) << "Opened file: " << file_name;
-          } else {
-            // Files should normally open successfully.
-            //
-            // Potential causes for failure include:
-            // - The parent directory does not exist.
-            // - The system is out of disk space.
-            //
-            // If a file cannot be opened, the sample will still run, but
-            // written data will be lost.
-            LOG(ERROR) << "Failed to open file: " << file_name;
-          }
-          return std::make_unique<OutputFile>(std::move(file));
-        }),
-        segment_renamer_([](absl::string_view tmp_file_name,
-                            absl::string_view finished_file_name) {
-          std::rename(tmp_file_name.data(), finished_file_name.data());
-        }),
-        segment_gap_threshold_(segment_gap_threshold),
+        output_writer_provider_(std::move(options.output_writer_provider)),
+        video_format_(std::move(options.video_format)),
+        audio_format_(std::move(options.audio_format)),
+        muxed_format_(std::move(options.muxed_format)),
+        segment_renamer_(std::move(options.segment_renamer)),
+        segment_remover_(std::move(options.segment_remover)),
+        segment_gap_threshold_(options.segment_gap_threshold),
+        rotation_(options.rotation),
+        storage_monitor_(std::move(options.storage_monitor)),
+        conversion_pool_(std::move(options.conversion_pool)),
         audio_segments_(),
         video_segments_(),
-        resource_manager_(
-            std::make_unique<ResourceManager>(output_writer_provider_(
-                absl::StrCat(output_file_prefix_, "event_log.csv")))),
-        collector_thread_(std::move(collector_thread)) {}
+        resource_manager_(std::move(resource_manager)),
+        collector_thread_(std::move(collector_thread)) {
+    if (resource_manager_ == nullptr) {
+      resource_manager_ = std::make_unique<ResourceManager>(
+          output_writer_provider_(
+              absl::StrCat(output_file_prefix_,
+                           EventLogFileName(options.event_log_format))),
+          options.event_log_format);
+    }
+    if (options.chunk_log) {
+      chunk_log_ = std::make_unique<MediaChunkLogWriter>(
+          output_writer_provider_(
+              absl::StrCat(output_file_prefix_, kChunkLogTmpFileName)));
+    }
+  }
 
   // Constructor that allows injecting dependencies for testing.
   MultiUserMediaCollector(
@@ -133,16 +242,21 @@ class MultiUserMediaCollector : public meet::MediaApiClientObserverInterface {
       SegmentRenamer segment_renamer, absl::Duration segment_gap_threshold,
       std::unique_ptr<ResourceManagerInterface> resource_manager,
       std::unique_ptr<webrtc::Thread> collector_thread)
-      : output_file_prefix_(output_file_prefix),
-        output_writer_provider_(std::move(output_writer_provider)),
-        segment_renamer_(std::move(segment_renamer)),
-        segment_gap_threshold_(segment_gap_threshold),
-        audio_segments_(),
-        video_segments_(),
-        resource_manager_(std::move(resource_manager)),
-        collector_thread_(std::move(collector_thread)) {}
+      : MultiUserMediaCollector(
+            output_file_prefix,
+            Options{.output_writer_provider = std::move(output_writer_provider),
+                    .segment_renamer = std::move(segment_renamer),
+                    .segment_gap_threshold = segment_gap_threshold},
+            std::move(resource_manager), std::move(collector_thread)) {}
 
   ~MultiUserMediaCollector() override {
+    // Frames being converted post to the collector thread, so let them finish
+    // first.
+    if (conversion_pool_ != nullptr) {
+      conversion_pool_->Flush();
+    }
+    // Segments closing on other threads rename their files through members.
+    WaitForPendingCloses();
     // Stop the thread to ensure that enqueued tasks do not access member fields
     // after they have been destroyed.
     collector_thread_->Stop();
@@ -190,6 +304,9 @@ class MultiUserMediaCollector : public meet::MediaApiClientObserverInterface {
   }
 
  private:
+  static constexpr absl::string_view kChunkLogTmpFileName = "media_tmp.chunks";
+  static constexpr absl::string_view kChunkLogFileName = "media.chunks";
+
   using ContributingSource = uint32_t;
 
   // Audio and video streams are logically broken up into media "segments".
@@ -209,19 +326,54 @@ class MultiUserMediaCollector : public meet::MediaApiClientObserverInterface {
   // 2. The media collector is disconnected.
   // 3. For video segments, segments also end when a frame is received that has
   //    a different resolution than the current segment.
+  //
+  // Segments that reach the `rotation_` limits continue in a new file, with
+  // `first_frame_time` and `last_frame_time` describing the current file.
+  struct SegmentFile {
+    std::string tmp_name;
+    // Index of the file within its segment.
+    int part = 0;
+    // Bytes written to the file so far. Updated by the thread writing the
+    // file, which may not be the collector thread.
+    std::shared_ptr<const std::atomic<int64_t>> written_bytes;
+  };
+  // A segment file along with its output, before a segment writer takes it.
+  struct OpenedSegmentFile {
+    SegmentFile file;
+    std::unique_ptr<OutputWriterInterface> output;
+  };
   struct AudioSegment {
-    std::unique_ptr<OutputWriterInterface> writer ABSL_REQUIRE_EXPLICIT_INIT;
+    std::unique_ptr<AudioSegmentWriterInterface> writer
+        ABSL_REQUIRE_EXPLICIT_INIT;
     std::string file_identifier ABSL_REQUIRE_EXPLICIT_INIT;
     absl::Time first_frame_time ABSL_REQUIRE_EXPLICIT_INIT;
     absl::Time last_frame_time ABSL_REQUIRE_EXPLICIT_INIT;
+    SegmentFile file ABSL_REQUIRE_EXPLICIT_INIT;
+    // The file that the segment continues in, if opened ahead of rotation.
+    std::optional<OpenedSegmentFile> next_file;
+    // The index of the current file, if the audio format indexes frames.
+    /*absl_nullable*/ std::unique_ptr<SegmentIndexWriter> index;
   };
   struct VideoSegment {
-    std::unique_ptr<OutputWriterInterface> writer ABSL_REQUIRE_EXPLICIT_INIT;
+    std::unique_ptr<VideoSegmentWriterInterface> writer
+        ABSL_REQUIRE_EXPLICIT_INIT;
     std::string file_identifier ABSL_REQUIRE_EXPLICIT_INIT;
     int width ABSL_REQUIRE_EXPLICIT_INIT;
     int height ABSL_REQUIRE_EXPLICIT_INIT;
     absl::Time first_frame_time ABSL_REQUIRE_EXPLICIT_INIT;
     absl::Time last_frame_time ABSL_REQUIRE_EXPLICIT_INIT;
+    SegmentFile file ABSL_REQUIRE_EXPLICIT_INIT;
+    std::optional<OpenedSegmentFile> next_file;
+    /*absl_nullable*/ std::unique_ptr<SegmentIndexWriter> index;
+  };
+  struct MuxedSegment {
+    std::unique_ptr<MuxedSegmentWriterInterface> writer
+        ABSL_REQUIRE_EXPLICIT_INIT;
+    std::string file_identifier ABSL_REQUIRE_EXPLICIT_INIT;
+    absl::Time first_frame_time ABSL_REQUIRE_EXPLICIT_INIT;
+    absl::Time last_frame_time ABSL_REQUIRE_EXPLICIT_INIT;
+    SegmentFile file ABSL_REQUIRE_EXPLICIT_INIT;
+    std::optional<OpenedSegmentFile> next_file;
   };
 
   void HandleAudioData(std::vector<int16_t> samples,
@@ -229,20 +381,106 @@ class MultiUserMediaCollector : public meet::MediaApiClientObserverInterface {
                        absl::Time received_time);
   void HandleVideoData(
       webrtc::scoped_refptr<webrtc::I420BufferInterface> buffer,
+      ContributingSource contributing_source, absl::Time received_time,
+      uint32_t rtp_timestamp);
+
+  // Returns the muxed segment of the participant that `contributing_source`
+  // belongs to, starting a new segment if there is none or if the gap since
+  // its last frame is too long. Returns null if the participant is not known
+  // yet.
+  MuxedSegment* /*absl_nullable*/ GetMuxedSegment(
       ContributingSource contributing_source, absl::Time received_time);
 
-  // Closes the audio or video segment. This will rename the file to include
-  // the start and end times of the segment.
+  // Closes all segments.
+  void CloseAllSegments();
+  // Closes all segments once new files start going to the spill directory, so
+  // that they continue there.
+  void RestartSegmentsIfSpilled();
+
+  // Closes the audio, video or muxed segment. This will rename the file to
+  // include the start and end times of the segment, and remove the segment's
+  // next file if it was opened ahead of time. Writers that finish segments on
+  // their own threads rename the file from there, once they are done.
   void CloseAudioSegment(AudioSegment& audio_segment);
   void CloseVideoSegment(VideoSegment& video_segment);
+  void CloseMuxedSegment(MuxedSegment& muxed_segment);
+
+  // Closes the current file of the segment and continues the segment in its
+  // next file, starting at `received_time`.
+  void RotateAudioSegment(AudioSegment& audio_segment,
+                          absl::Time received_time);
+  void RotateVideoSegment(VideoSegment& video_segment,
+                          absl::Time received_time);
+  void RotateMuxedSegment(MuxedSegment& muxed_segment,
+                          absl::Time received_time);
+
+  // Returns whether `segment` should be rotated before writing a frame
+  // received at `received_time`. If the segment is close to rotating, opens
+  // its next file, named by `tmp_file_name` from the file's part index.
+  template <typename Segment>
+  bool PrepareRotation(Segment& segment, absl::Time received_time,
+                       absl::FunctionRef<std::string(int)> tmp_file_name);
+  // Returns the file that `segment` continues in, opening it unless it was
+  // opened ahead of time.
+  template <typename Segment>
+  OpenedSegmentFile TakeNextFile(
+      Segment& segment, absl::FunctionRef<std::string(int)> tmp_file_name);
+  // Returns whether `file`, started at `first_frame_time`, has reached
+  // `fraction` of the rotation limits by `received_time`.
+  bool ReachedRotationLimit(const SegmentFile& file,
+                            absl::Time first_frame_time,
+                            absl::Time received_time, double fraction) const;
+  OpenedSegmentFile OpenSegmentFile(std::string tmp_name, int part);
+  // Opens the index of the segment file `tmp_name` if `index_frames` is set,
+  // or returns null.
+  /*absl_nullable*/ std::unique_ptr<SegmentIndexWriter> OpenSegmentIndex(
+      absl::string_view tmp_name, bool index_frames);
+  // Closes `index`, if set, and renames it after its segment file.
+  void CloseSegmentIndex(
+      /*absl_nullable*/ std::unique_ptr<SegmentIndexWriter>& index,
+      absl::string_view tmp_name, absl::string_view finished_name);
+  // Renames a finished file. May be called from any thread.
+  void RenameSegmentFile(absl::string_view tmp_name,
+                         absl::string_view finished_name);
+  // Counts a segment whose writer is closing, until `FinishPendingClose`.
+  void StartPendingClose();
+  void FinishPendingClose();
+  // Waits for the writers of closed segments to finish, and their files to be
+  // renamed.
+  void WaitForPendingCloses();
+  // Closes and removes `next_file`, if set.
+  void DiscardNextFile(std::optional<OpenedSegmentFile>& next_file);
+
+  std::string AudioTmpFileName(absl::string_view file_identifier,
+                               int part) const;
+  std::string VideoTmpFileName(absl::string_view file_identifier, int width,
+                               int height, int part) const;
+  std::string MuxedTmpFileName(absl::string_view file_identifier,
+                               int part) const;
 
   std::string output_file_prefix_;
   OutputWriterProvider output_writer_provider_;
-  SegmentRenamer segment_renamer_;
+  VideoSegmentFormat video_format_;
+  AudioSegmentFormat audio_format_;
+  // If set, audio and video are written to muxed segments instead of the
+  // separate audio and video segments.
+  std::optional<MuxedSegmentFormat> muxed_format_;
+  // Segment writers may finish on other threads, and rename their files from
+  // there, so renames and removals are serialized.
+  absl::Mutex files_mutex_;
+  SegmentRenamer segment_renamer_ ABSL_GUARDED_BY(files_mutex_);
+  SegmentRemover segment_remover_ ABSL_GUARDED_BY(files_mutex_);
+  // Number of segments whose writers are still closing.
+  int pending_closes_ ABSL_GUARDED_BY(files_mutex_) = 0;
   // If a media frame is received more than `segment_gap_threshold_` after
   // the previous frame for a given segment, a new media segment will be
   // created and the previous segment will be closed.
   absl::Duration segment_gap_threshold_;
+  SegmentRotationOptions rotation_;
+  /*absl_nullable*/ std::shared_ptr<StorageHealthMonitor> storage_monitor_;
+  /*absl_nullable*/ std::shared_ptr<FrameConversionPool> conversion_pool_;
+  // The monitor's spill count when segments were last restarted.
+  int64_t seen_spills_ = 0;
 
   // Maps from contributing source to the current audio or video segment for
   // that source.
@@ -252,6 +490,16 @@ class MultiUserMediaCollector : public meet::MediaApiClientObserverInterface {
       audio_segments_;
   absl::flat_hash_map<ContributingSource, std::unique_ptr<VideoSegment>>
       video_segments_;
+  // Maps from file identifier to the current muxed segment of that
+  // participant, since a participant's audio and video streams have different
+  // contributing sources.
+  //
+  // Values in this map are never null.
+  absl::flat_hash_map<std::string, std::unique_ptr<MuxedSegment>>
+      muxed_segments_;
+  // If set, all frames are appended to this log instead of segments. It is
+  // closed, but kept, on disconnect.
+  /*absl_nullable*/ std::unique_ptr<MediaChunkLogWriter> chunk_log_;
 
   std::unique_ptr<ResourceManagerInterface> resource_manager_;
 
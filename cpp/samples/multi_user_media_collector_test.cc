@@ -32,15 +32,23 @@
 #include "absl/base/nullability.h"
 #include "absl/log/globals.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/notification.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "meet_clients/samples/frame_conversion_pool.h"
+#include "meet_clients/samples/media_chunk_log.h"
+#include "meet_clients/samples/muxed_segment_writer_interface.h"
+#include "meet_clients/samples/output_file.h"
 #include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/storage_health_monitor.h"
 #include "meet_clients/samples/testing/media_data.h"
 #include "meet_clients/samples/testing/mock_output_writer.h"
 #include "meet_clients/samples/testing/mock_resource_manager.h"
 #include "api/make_ref_counted.h"
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame_buffer.h"
 #include "rtc_base/thread.h"
 
 ABSL_POINTERS_DEFAULT_NONNULL
@@ -50,12 +58,60 @@ namespace {
 
 using ::base_logging::INFO;
 using ::testing::_;
+using ::testing::Expectation;
 using ::testing::kDoNotCaptureLogsYet;
 using ::testing::MatchesRegex;
 using ::testing::MockFunction;
 using ::testing::Return;
 using ::testing::ScopedMockLog;
 
+struct MuxedSegmentRecord {
+  int audio_writes = 0;
+  int video_writes = 0;
+  bool closed = false;
+};
+
+// Muxed segment writer that records its calls, and only accepts video of the
+// resolution of its first frame.
+class FakeMuxedSegmentWriter : public MuxedSegmentWriterInterface {
+ public:
+  explicit FakeMuxedSegmentWriter(MuxedSegmentRecord& record)
+      : record_(record) {}
+
+  bool WriteVideoFrame(webrtc::scoped_refptr<webrtc::I420BufferInterface> frame,
+                       absl::Time received_time) override {
+    if (width_ == 0) {
+      width_ = frame->width();
+      height_ = frame->height();
+    } else if (frame->width() != width_ || frame->height() != height_) {
+      return false;
+    }
+    record_.video_writes++;
+    return true;
+  }
+  void WriteAudioSamples(std::vector<int16_t> pcm16,
+                         absl::Time received_time) override {
+    record_.audio_writes++;
+  }
+  void Close() override { record_.closed = true; }
+
+ private:
+  MuxedSegmentRecord& record_;
+  int width_ = 0;
+  int height_ = 0;
+};
+
+// Returns a format of fake writers that add their records to `records`.
+MuxedSegmentFormat CreateFakeMuxedSegmentFormat(
+    std::vector<std::unique_ptr<MuxedSegmentRecord>>& records) {
+  return {.file_extension = "webm",
+          .create_writer = [&records](std::unique_ptr<OutputWriterInterface>,
+                                      absl::Time) {
+            records.push_back(std::make_unique<MuxedSegmentRecord>());
+            return std::make_unique<FakeMuxedSegmentWriter>(*records.back());
+          }};
+}
+
 TEST(MultiUserMediaCollectorTest, WaitForJoinedTimesOutBeforeJoining) {
   auto thread = webrtc::Thread::Create();
   thread->Start();
@@ -220,8 +276,10 @@ TEST(MultiUserMediaCollectorTest, ReceivesAudioFrameAndWritesToFile) {
   absl::Notification write_notification;
   EXPECT_CALL(*mock_output_file, Write(_, _))
       .WillRepeatedly([&](const char* content, std::streamsize size) {
-        EXPECT_EQ(size, sizeof(int16_t));
-        written_pcm16.push_back(reinterpret_cast<const int16_t*>(content)[0]);
+        EXPECT_EQ(size % sizeof(int16_t), 0);
+        const auto* samples = reinterpret_cast<const int16_t*>(content);
+        written_pcm16.insert(written_pcm16.end(), samples,
+                             samples + size / sizeof(int16_t));
         if (written_pcm16.size() == pcm16.size()) {
           write_notification.Notify();
         }
@@ -261,8 +319,8 @@ TEST(MultiUserMediaCollectorTest,
   absl::Notification write_notification;
   EXPECT_CALL(*mock_output_file, Write(_, _))
       .WillRepeatedly([&](const char* content, std::streamsize size) {
-        EXPECT_EQ(size, sizeof(int16_t));
-        written_pcm16_count++;
+        EXPECT_EQ(size % sizeof(int16_t), 0);
+        written_pcm16_count += size / sizeof(int16_t);
         if (written_pcm16_count ==
             test_data1.pcm16.size() + test_data2.pcm16.size()) {
           write_notification.Notify();
@@ -301,8 +359,8 @@ TEST(MultiUserMediaCollectorTest,
   absl::Notification write_notification1;
   EXPECT_CALL(*mock_output_file1, Write(_, _))
       .WillRepeatedly([&](const char* content, std::streamsize size) {
-        EXPECT_EQ(size, sizeof(int16_t));
-        written_pcm16_count1++;
+        EXPECT_EQ(size % sizeof(int16_t), 0);
+        written_pcm16_count1 += size / sizeof(int16_t);
         if (written_pcm16_count1 == test_data1.pcm16.size()) {
           write_notification1.Notify();
         }
@@ -316,8 +374,8 @@ TEST(MultiUserMediaCollectorTest,
   absl::Notification write_notification2;
   EXPECT_CALL(*mock_output_file2, Write(_, _))
       .WillRepeatedly([&](const char* content, std::streamsize size) {
-        EXPECT_EQ(size, sizeof(int16_t));
-        written_pcm16_count2++;
+        EXPECT_EQ(size % sizeof(int16_t), 0);
+        written_pcm16_count2 += size / sizeof(int16_t);
         if (written_pcm16_count2 == test_data2.pcm16.size()) {
           write_notification2.Notify();
         }
@@ -363,8 +421,8 @@ TEST(MultiUserMediaCollectorTest,
   absl::Notification write_notification1;
   EXPECT_CALL(*mock_output_file1, Write(_, _))
       .WillRepeatedly([&](const char* content, std::streamsize size) {
-        EXPECT_EQ(size, sizeof(int16_t));
-        written_pcm16_count1++;
+        EXPECT_EQ(size % sizeof(int16_t), 0);
+        written_pcm16_count1 += size / sizeof(int16_t);
         if (written_pcm16_count1 == test_data1.pcm16.size()) {
           write_notification1.Notify();
         }
@@ -382,8 +440,8 @@ TEST(MultiUserMediaCollectorTest,
   absl::Notification write_notification2;
   EXPECT_CALL(*mock_output_file2, Write(_, _))
       .WillRepeatedly([&](const char* content, std::streamsize size) {
-        EXPECT_EQ(size, sizeof(int16_t));
-        written_pcm16_count2++;
+        EXPECT_EQ(size % sizeof(int16_t), 0);
+        written_pcm16_count2 += size / sizeof(int16_t);
         if (written_pcm16_count2 == test_data2.pcm16.size()) {
           write_notification2.Notify();
         }
@@ -892,5 +950,437 @@ TEST(MultiUserMediaCollectorTest,
       log_notification.WaitForNotificationWithTimeout(absl::Seconds(1)));
 }
 
+TEST(MultiUserMediaCollectorTest, MuxesParticipantAudioAndVideoIntoOneSegment) {
+  // A participant's audio and video streams have different contributing
+  // sources, but the same file identifier.
+  AudioTestData audio_data = CreateAudioTestData(/*num_samples=*/10);
+  audio_data.frame.contributing_source = 1;
+  VideoTestData video_data = CreateVideoTestData(/*width=*/10, /*height=*/5);
+  video_data.meet_frame.contributing_source = 2;
+
+  MockFunction<std::unique_ptr<OutputWriterInterface>(absl::string_view)>
+      mock_output_file_provider;
+  EXPECT_CALL(mock_output_file_provider,
+              Call("test_media_identifier_1_tmp.webm"))
+      .WillOnce(Return(std::make_unique<MockOutputWriter>()));
+  auto mock_resource_manager = std::make_unique<MockResourceManager>();
+  EXPECT_CALL(*mock_resource_manager, GetOutputFileIdentifier(1))
+      .WillRepeatedly(Return("identifier_1"));
+  EXPECT_CALL(*mock_resource_manager, GetOutputFileIdentifier(2))
+      .WillRepeatedly(Return("identifier_1"));
+  MockFunction<void(absl::string_view, absl::string_view)> mock_renamer;
+  EXPECT_CALL(mock_renamer,
+              Call("test_media_identifier_1_tmp.webm",
+                   MatchesRegex("test_media_identifier_1_.*_.*\\.webm")));
+  std::vector<std::unique_ptr<MuxedSegmentRecord>> records;
+  auto thread = webrtc::Thread::Create();
+  thread->Start();
+  auto collector = webrtc::make_ref_counted<MultiUserMediaCollector>(
+      "test_",
+      MultiUserMediaCollector::Options{
+          .output_writer_provider =
+              std::move(mock_output_file_provider).AsStdFunction(),
+          .segment_renamer = std::move(mock_renamer).AsStdFunction(),
+          .muxed_format = CreateFakeMuxedSegmentFormat(records)},
+      std::move(mock_resource_manager), std::move(thread));
+
+  collector->OnAudioFrame(std::move(audio_data.frame));
+  collector->OnVideoFrame(std::move(video_data.meet_frame));
+  collector->OnDisconnected(absl::OkStatus());
+  ASSERT_EQ(collector->WaitForDisconnected(absl::Seconds(1)),
+            absl::OkStatus());
+
+  ASSERT_EQ(records.size(), 1u);
+  EXPECT_EQ(records[0]->audio_writes, 1);
+  EXPECT_EQ(records[0]->video_writes, 1);
+  EXPECT_TRUE(records[0]->closed);
+}
+
+TEST(MultiUserMediaCollectorTest,
+     StartsNewMuxedSegmentWhenWriterRejectsVideoFrame) {
+  VideoTestData video_data1 = CreateVideoTestData(/*width=*/10, /*height=*/5);
+  video_data1.meet_frame.contributing_source = 1;
+  VideoTestData video_data2 = CreateVideoTestData(/*width=*/20, /*height=*/10);
+  video_data2.meet_frame.contributing_source = 1;
+
+  MockFunction<std::unique_ptr<OutputWriterInterface>(absl::string_view)>
+      mock_output_file_provider;
+  EXPECT_CALL(mock_output_file_provider,
+              Call("test_media_identifier_1_tmp.webm"))
+      .Times(2)
+      .WillRepeatedly([](absl::string_view) {
+        return std::make_unique<MockOutputWriter>();
+      });
+  auto mock_resource_manager = std::make_unique<MockResourceManager>();
+  EXPECT_CALL(*mock_resource_manager, GetOutputFileIdentifier(1))
+      .WillRepeatedly(Return("identifier_1"));
+  MockFunction<void(absl::string_view, absl::string_view)> mock_renamer;
+  EXPECT_CALL(mock_renamer, Call("test_media_identifier_1_tmp.webm", _))
+      .Times(2);
+  std::vector<std::unique_ptr<MuxedSegmentRecord>> records;
+  auto thread = webrtc::Thread::Create();
+  thread->Start();
+  auto collector = webrtc::make_ref_counted<MultiUserMediaCollector>(
+      "test_",
+      MultiUserMediaCollector::Options{
+          .output_writer_provider =
+              std::move(mock_output_file_provider).AsStdFunction(),
+          .segment_renamer = std::move(mock_renamer).AsStdFunction(),
+          .muxed_format = CreateFakeMuxedSegmentFormat(records)},
+      std::move(mock_resource_manager), std::move(thread));
+
+  collector->OnVideoFrame(std::move(video_data1.meet_frame));
+  collector->OnVideoFrame(std::move(video_data2.meet_frame));
+  collector->OnDisconnected(absl::OkStatus());
+  ASSERT_EQ(collector->WaitForDisconnected(absl::Seconds(1)),
+            absl::OkStatus());
+
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(records[0]->video_writes, 1);
+  EXPECT_TRUE(records[0]->closed);
+  EXPECT_EQ(records[1]->video_writes, 1);
+  EXPECT_TRUE(records[1]->closed);
+}
+
+TEST(MultiUserMediaCollectorTest, RotatesSegmentIntoPreopenedFile) {
+  // Each frame writes 20 bytes, so the second frame reaches the preopen
+  // fraction and the third frame the rotation limit.
+  std::vector<AudioTestData> test_data;
+  for (int i = 0; i < 3; ++i) {
+    test_data.push_back(CreateAudioTestData(/*num_samples=*/10));
+    test_data.back().frame.contributing_source = 1;
+  }
+  auto mock_output_file1 = std::make_unique<MockOutputWriter>();
+  MockOutputWriter* mock_output_file1_ptr = mock_output_file1.get();
+  auto mock_output_file2 = std::make_unique<MockOutputWriter>();
+  EXPECT_CALL(*mock_output_file2, Close);
+
+  MockFunction<std::unique_ptr<OutputWriterInterface>(absl::string_view)>
+      mock_output_file_provider;
+  EXPECT_CALL(mock_output_file_provider,
+              Call("test_audio_identifier_1_tmp.pcm"))
+      .WillOnce(Return(std::move(mock_output_file1)));
+  Expectation preopen =
+      EXPECT_CALL(mock_output_file_provider,
+                  Call("test_audio_identifier_1_tmp1.pcm"))
+          .WillOnce(Return(std::move(mock_output_file2)));
+  // The next file is opened before the first one is closed.
+  EXPECT_CALL(*mock_output_file1_ptr, Close).After(preopen);
+  auto mock_resource_manager = std::make_unique<MockResourceManager>();
+  EXPECT_CALL(*mock_resource_manager, GetOutputFileIdentifier(1))
+      .WillOnce(Return("identifier_1"));
+  MockFunction<void(absl::string_view, absl::string_view)> mock_renamer;
+  EXPECT_CALL(mock_renamer,
+              Call("test_audio_identifier_1_tmp.pcm",
+                   MatchesRegex("test_audio_identifier_1_.*_.*\\.pcm")));
+  EXPECT_CALL(mock_renamer,
+              Call("test_audio_identifier_1_tmp1.pcm",
+                   MatchesRegex("test_audio_identifier_1_.*_.*\\.pcm")));
+  MockFunction<void(absl::string_view)> mock_remover;
+  EXPECT_CALL(mock_remover, Call).Times(0);
+  auto thread = webrtc::Thread::Create();
+  thread->Start();
+  auto collector = webrtc::make_ref_counted<MultiUserMediaCollector>(
+      "test_",
+      MultiUserMediaCollector::Options{
+          .output_writer_provider =
+              std::move(mock_output_file_provider).AsStdFunction(),
+          .segment_renamer = std::move(mock_renamer).AsStdFunction(),
+          .segment_remover = std::move(mock_remover).AsStdFunction(),
+          .rotation = {.max_bytes = 40, .preopen_fraction = 0.5}},
+      std::move(mock_resource_manager), std::move(thread));
+
+  for (AudioTestData& data : test_data) {
+    collector->OnAudioFrame(std::move(data.frame));
+  }
+  collector->OnDisconnected(absl::OkStatus());
+  EXPECT_EQ(collector->WaitForDisconnected(absl::Seconds(1)), absl::OkStatus());
+}
+
+TEST(MultiUserMediaCollectorTest, RemovesUnusedPreopenedFileOnClose) {
+  std::vector<AudioTestData> test_data;
+  for (int i = 0; i < 2; ++i) {
+    test_data.push_back(CreateAudioTestData(/*num_samples=*/10));
+    test_data.back().frame.contributing_source = 1;
+  }
+  auto mock_output_file1 = std::make_unique<MockOutputWriter>();
+  EXPECT_CALL(*mock_output_file1, Close);
+  auto mock_output_file2 = std::make_unique<MockOutputWriter>();
+  EXPECT_CALL(*mock_output_file2, Close);
+
+  MockFunction<std::unique_ptr<OutputWriterInterface>(absl::string_view)>
+      mock_output_file_provider;
+  EXPECT_CALL(mock_output_file_provider,
+              Call("test_audio_identifier_1_tmp.pcm"))
+      .WillOnce(Return(std::move(mock_output_file1)));
+  EXPECT_CALL(mock_output_file_provider,
+              Call("test_audio_identifier_1_tmp1.pcm"))
+      .WillOnce(Return(std::move(mock_output_file2)));
+  auto mock_resource_manager = std::make_unique<MockResourceManager>();
+  EXPECT_CALL(*mock_resource_manager, GetOutputFileIdentifier(1))
+      .WillOnce(Return("identifier_1"));
+  MockFunction<void(absl::string_view, absl::string_view)> mock_renamer;
+  EXPECT_CALL(mock_renamer, Call("test_audio_identifier_1_tmp.pcm", _));
+  MockFunction<void(absl::string_view)> mock_remover;
+  EXPECT_CALL(mock_remover, Call("test_audio_identifier_1_tmp1.pcm"));
+  auto thread = webrtc::Thread::Create();
+  thread->Start();
+  auto collector = webrtc::make_ref_counted<MultiUserMediaCollector>(
+      "test_",
+      MultiUserMediaCollector::Options{
+          .output_writer_provider =
+              std::move(mock_output_file_provider).AsStdFunction(),
+          .segment_renamer = std::move(mock_renamer).AsStdFunction(),
+          .segment_remover = std::move(mock_remover).AsStdFunction(),
+          .rotation = {.max_bytes = 40, .preopen_fraction = 0.5}},
+      std::move(mock_resource_manager), std::move(thread));
+
+  for (AudioTestData& data : test_data) {
+    collector->OnAudioFrame(std::move(data.frame));
+  }
+  collector->OnDisconnected(absl::OkStatus());
+  EXPECT_EQ(collector->WaitForDisconnected(absl::Seconds(1)), absl::OkStatus());
+}
+
+TEST(MultiUserMediaCollectorTest, RotatesMuxedSegmentByDuration) {
+  VideoTestData video_data1 = CreateVideoTestData(/*width=*/10, /*height=*/5);
+  video_data1.meet_frame.contributing_source = 1;
+  VideoTestData video_data2 = CreateVideoTestData(/*width=*/10, /*height=*/5);
+  video_data2.meet_frame.contributing_source = 1;
+
+  MockFunction<std::unique_ptr<OutputWriterInterface>(absl::string_view)>
+      mock_output_file_provider;
+  EXPECT_CALL(mock_output_file_provider,
+              Call("test_media_identifier_1_tmp.webm"))
+      .WillOnce(Return(std::make_unique<MockOutputWriter>()));
+  EXPECT_CALL(mock_output_file_provider,
+              Call("test_media_identifier_1_tmp1.webm"))
+      .WillOnce(Return(std::make_unique<MockOutputWriter>()));
+  auto mock_resource_manager = std::make_unique<MockResourceManager>();
+  EXPECT_CALL(*mock_resource_manager, GetOutputFileIdentifier(1))
+      .WillRepeatedly(Return("identifier_1"));
+  MockFunction<void(absl::string_view, absl::string_view)> mock_renamer;
+  EXPECT_CALL(mock_renamer, Call("test_media_identifier_1_tmp.webm", _));
+  EXPECT_CALL(mock_renamer, Call("test_media_identifier_1_tmp1.webm", _));
+  std::vector<std::unique_ptr<MuxedSegmentRecord>> records;
+  auto thread = webrtc::Thread::Create();
+  thread->Start();
+  auto collector = webrtc::make_ref_counted<MultiUserMediaCollector>(
+      "test_",
+      MultiUserMediaCollector::Options{
+          .output_writer_provider =
+              std::move(mock_output_file_provider).AsStdFunction(),
+          .segment_renamer = std::move(mock_renamer).AsStdFunction(),
+          .muxed_format = CreateFakeMuxedSegmentFormat(records),
+          .rotation = {.max_duration = absl::Milliseconds(100)}},
+      std::move(mock_resource_manager), std::move(thread));
+
+  collector->OnVideoFrame(std::move(video_data1.meet_frame));
+  // Wait past the rotation limit, but within the segment gap.
+  absl::SleepFor(absl::Milliseconds(200));
+  collector->OnVideoFrame(std::move(video_data2.meet_frame));
+  collector->OnDisconnected(absl::OkStatus());
+  ASSERT_EQ(collector->WaitForDisconnected(absl::Seconds(1)),
+            absl::OkStatus());
+
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(records[0]->video_writes, 1);
+  EXPECT_TRUE(records[0]->closed);
+  EXPECT_EQ(records[1]->video_writes, 1);
+  EXPECT_TRUE(records[1]->closed);
+}
+
+TEST(MultiUserMediaCollectorTest, ConvertsVideoFramesOnConversionPool) {
+  VideoTestData test_data = CreateVideoTestData(/*width=*/10, /*height=*/5);
+  test_data.meet_frame.contributing_source = 1;
+  std::vector<char> yuv_data = std::move(test_data.yuv_data);
+
+  auto mock_output_file = std::make_unique<MockOutputWriter>();
+  std::vector<char> written_yuv_data;
+  absl::Notification write_notification;
+  EXPECT_CALL(*mock_output_file, Write(_, _))
+      .WillRepeatedly([&](const char* content, std::streamsize size) {
+        written_yuv_data.insert(written_yuv_data.end(), content,
+                                content + size);
+        if (written_yuv_data.size() == 2 * yuv_data.size()) {
+          write_notification.Notify();
+        }
+      });
+  MockFunction<std::unique_ptr<OutputWriterInterface>(absl::string_view)>
+      mock_output_file_provider;
+  EXPECT_CALL(mock_output_file_provider,
+              Call("test_video_identifier_1_tmp_10x5.yuv"))
+      .WillOnce(Return(std::move(mock_output_file)));
+  auto mock_resource_manager = std::make_unique<MockResourceManager>();
+  EXPECT_CALL(*mock_resource_manager, GetOutputFileIdentifier(1))
+      .WillOnce(Return("identifier_1"));
+  absl::StatusOr<std::shared_ptr<FrameConversionPool>> conversion_pool =
+      FrameConversionPool::Create({.thread_count = 2});
+  ASSERT_TRUE(conversion_pool.ok());
+  auto renamer = MockFunction<void(absl::string_view, absl::string_view)>();
+  auto thread = webrtc::Thread::Create();
+  thread->Start();
+  auto collector = webrtc::make_ref_counted<MultiUserMediaCollector>(
+      "test_",
+      MultiUserMediaCollector::Options{
+          .output_writer_provider =
+              std::move(mock_output_file_provider).AsStdFunction(),
+          .segment_renamer = renamer.AsStdFunction(),
+          .conversion_pool = *conversion_pool},
+      std::move(mock_resource_manager), std::move(thread));
+
+  collector->OnVideoFrame(test_data.meet_frame);
+  collector->OnVideoFrame(std::move(test_data.meet_frame));
+
+  EXPECT_TRUE(
+      write_notification.WaitForNotificationWithTimeout(absl::Seconds(1)));
+  std::vector<char> expected_yuv_data = yuv_data;
+  expected_yuv_data.insert(expected_yuv_data.end(), yuv_data.begin(),
+                           yuv_data.end());
+  EXPECT_EQ(written_yuv_data, expected_yuv_data);
+}
+
+TEST(MultiUserMediaCollectorTest, DownscalesVideoUnderStoragePressure) {
+  VideoTestData test_data = CreateVideoTestData(/*width=*/10, /*height=*/5);
+  test_data.meet_frame.contributing_source = 1;
+
+  auto mock_output_file = std::make_unique<MockOutputWriter>();
+  absl::Notification write_notification;
+  EXPECT_CALL(*mock_output_file, Write(_, _)).WillRepeatedly([&] {
+    if (!write_notification.HasBeenNotified()) {
+      write_notification.Notify();
+    }
+  });
+  MockFunction<std::unique_ptr<OutputWriterInterface>(absl::string_view)>
+      mock_output_file_provider;
+  EXPECT_CALL(mock_output_file_provider,
+              Call("test_video_identifier_1_tmp_5x3.yuv"))
+      .WillOnce(Return(std::move(mock_output_file)));
+  auto mock_resource_manager = std::make_unique<MockResourceManager>();
+  EXPECT_CALL(*mock_resource_manager, GetOutputFileIdentifier(1))
+      .WillOnce(Return("identifier_1"));
+  absl::StatusOr<std::shared_ptr<StorageHealthMonitor>> storage_monitor =
+      StorageHealthMonitor::Create(
+          {.downscale_queued_bytes = 1},
+          {.provider = [](absl::string_view) { return nullptr; },
+           .renamer = [](absl::string_view, absl::string_view) {},
+           .remover = [](absl::string_view) {}});
+  ASSERT_TRUE(storage_monitor.ok());
+  // Simulate frames queued ahead of this one.
+  (*storage_monitor)->RecordQueuedBytes(1);
+  auto renamer = MockFunction<void(absl::string_view, absl::string_view)>();
+  auto thread = webrtc::Thread::Create();
+  thread->Start();
+  auto collector = webrtc::make_ref_counted<MultiUserMediaCollector>(
+      "test_",
+      MultiUserMediaCollector::Options{
+          .output_writer_provider =
+              std::move(mock_output_file_provider).AsStdFunction(),
+          .segment_renamer = renamer.AsStdFunction(),
+          .storage_monitor = *storage_monitor},
+      std::move(mock_resource_manager), std::move(thread));
+
+  collector->OnVideoFrame(std::move(test_data.meet_frame));
+
+  EXPECT_TRUE(
+      write_notification.WaitForNotificationWithTimeout(absl::Seconds(1)));
+  EXPECT_EQ((*storage_monitor)->GetStats().downscaled_video_frames, 1);
+}
+
+TEST(MultiUserMediaCollectorTest, DropsFramesBeyondStorageMonitorQueueLimit) {
+  AudioTestData audio_data = CreateAudioTestData(/*num_samples=*/10);
+  audio_data.frame.contributing_source = 1;
+  VideoTestData video_data = CreateVideoTestData(/*width=*/10, /*height=*/5);
+  video_data.meet_frame.contributing_source = 2;
+
+  MockFunction<std::unique_ptr<OutputWriterInterface>(absl::string_view)>
+      mock_output_file_provider;
+  EXPECT_CALL(mock_output_file_provider, Call).Times(0);
+  absl::StatusOr<std::shared_ptr<StorageHealthMonitor>> storage_monitor =
+      StorageHealthMonitor::Create(
+          {.max_queued_bytes = 1},
+          {.provider = [](absl::string_view) { return nullptr; },
+           .renamer = [](absl::string_view, absl::string_view) {},
+           .remover = [](absl::string_view) {}});
+  ASSERT_TRUE(storage_monitor.ok());
+  auto renamer = MockFunction<void(absl::string_view, absl::string_view)>();
+  auto thread = webrtc::Thread::Create();
+  thread->Start();
+  auto collector = webrtc::make_ref_counted<MultiUserMediaCollector>(
+      "test_",
+      MultiUserMediaCollector::Options{
+          .output_writer_provider =
+              std::move(mock_output_file_provider).AsStdFunction(),
+          .segment_renamer = renamer.AsStdFunction(),
+          .storage_monitor = *storage_monitor},
+      std::make_unique<MockResourceManager>(), std::move(thread));
+
+  collector->OnAudioFrame(std::move(audio_data.frame));
+  collector->OnVideoFrame(std::move(video_data.meet_frame));
+  collector->OnDisconnected(absl::OkStatus());
+  ASSERT_EQ(collector->WaitForDisconnected(absl::Seconds(1)),
+            absl::OkStatus());
+
+  StorageHealthMonitor::Stats stats = (*storage_monitor)->GetStats();
+  EXPECT_EQ(stats.dropped_audio_frames, 1);
+  EXPECT_EQ(stats.dropped_video_frames, 1);
+  EXPECT_EQ(stats.queued_bytes, 0);
+}
+
+TEST(MultiUserMediaCollectorTest, AppendsFramesToChunkLog) {
+  AudioTestData audio_data = CreateAudioTestData(/*num_samples=*/10);
+  audio_data.frame.contributing_source = 1;
+  VideoTestData video_data = CreateVideoTestData(/*width=*/10, /*height=*/5);
+  video_data.meet_frame.contributing_source = 2;
+
+  std::string chunk_log;
+  auto mock_chunk_log_file = std::make_unique<MockOutputWriter>();
+  EXPECT_CALL(*mock_chunk_log_file, Write(_, _))
+      .WillRepeatedly([&](const char* content, std::streamsize size) {
+        chunk_log.append(content, size);
+      });
+  EXPECT_CALL(*mock_chunk_log_file, Close());
+  MockFunction<std::unique_ptr<OutputWriterInterface>(absl::string_view)>
+      mock_output_file_provider;
+  EXPECT_CALL(mock_output_file_provider, Call("test_event_log.csv"))
+      .WillOnce(Return(std::make_unique<MockOutputWriter>()));
+  EXPECT_CALL(mock_output_file_provider, Call("test_media_tmp.chunks"))
+      .WillOnce(Return(std::move(mock_chunk_log_file)));
+  MockFunction<void(absl::string_view, absl::string_view)> renamer;
+  EXPECT_CALL(renamer, Call("test_media_tmp.chunks", "test_media.chunks"));
+  auto thread = webrtc::Thread::Create();
+  thread->Start();
+  auto collector = webrtc::make_ref_counted<MultiUserMediaCollector>(
+      "test_",
+      MultiUserMediaCollector::Options{
+          .output_writer_provider =
+              std::move(mock_output_file_provider).AsStdFunction(),
+          .segment_renamer = renamer.AsStdFunction(),
+          .chunk_log = true},
+      std::move(thread));
+
+  collector->OnAudioFrame(std::move(audio_data.frame));
+  collector->OnVideoFrame(std::move(video_data.meet_frame));
+  collector->OnDisconnected(absl::OkStatus());
+  ASSERT_EQ(collector->WaitForDisconnected(absl::Seconds(1)),
+            absl::OkStatus());
+
+  absl::StatusOr<std::unique_ptr<MediaChunkLogReader>> reader =
+      MediaChunkLogReader::Create(chunk_log);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  EXPECT_TRUE((*reader)->complete());
+  MediaChunk chunk;
+  ASSERT_TRUE((*reader)->Next(chunk));
+  EXPECT_EQ(chunk.kind, MediaChunkKind::kAudio);
+  EXPECT_EQ(chunk.contributing_source, 1);
+  ASSERT_TRUE((*reader)->Next(chunk));
+  EXPECT_EQ(chunk.kind, MediaChunkKind::kVideo);
+  EXPECT_EQ(chunk.contributing_source, 2);
+  EXPECT_EQ(chunk.payload,
+            absl::string_view(video_data.yuv_data.data(),
+                              video_data.yuv_data.size()));
+  EXPECT_FALSE((*reader)->Next(chunk));
+}
+
 }  // namespace
 }  // namespace media_api_samples
@@ -15,11 +15,13 @@
  */
 
 
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/base/nullability.h"
 #include "absl/flags/flag.h"
@@ -28,13 +30,26 @@
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "meet_clients/api/media_api_client_interface.h"
 #include "meet_clients/api/video_assignment_resource.h"
 #include "meet_clients/internal/media_api_client_factory.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
+#include "meet_clients/samples/event_log_writer_interface.h"
+#include "meet_clients/samples/frame_conversion_pool.h"
 #include "meet_clients/samples/multi_user_media_collector.h"
+#include "meet_clients/samples/media_format_flags.h"
+#include "meet_clients/samples/muxed_segment_writer_interface.h"
+#include "meet_clients/samples/output_writer_flags.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/storage_health_monitor.h"
+#include "meet_clients/samples/video_segment_writer_interface.h"
+#include "meet_clients/samples/zstd_output_writer.h"
 #include "api/make_ref_counted.h"
+#include "api/scoped_refptr.h"
 #include "rtc_base/thread.h"
 
 ABSL_POINTERS_DEFAULT_NONNULL
@@ -70,6 +85,64 @@ ABSL_FLAG(absl::Duration, segment_gap_threshold, absl::Seconds(1),
           "larger gap will result in fewer, sparser segments. A smaller gap "
           "will result in more, denser segments.");
 
+ABSL_FLAG(int, segment_max_size_mib, 0,
+          "If positive, segments continue in a new file once their file "
+          "reaches this size, in MiB, so that finished files of long segments "
+          "can be processed during the conference.");
+
+ABSL_FLAG(absl::Duration, segment_max_duration, absl::InfiniteDuration(),
+          "Time span after which segments continue in a new file, so that "
+          "finished files of long segments can be processed during the "
+          "conference.");
+
+ABSL_FLAG(int, max_queued_frames_mib, 256,
+          "Frames waiting to be written, in MiB, beyond which new frames are "
+          "dropped. Before this, video is downscaled and then dropped as "
+          "frames queue up or writes slow down.");
+
+ABSL_FLAG(std::string, spill_directory, "",
+          "If set, new segments are written to this directory once the output "
+          "directory runs low on space or writes stall, and open segments are "
+          "restarted there. Has no effect with --output_directories, which "
+          "places files itself.");
+
+ABSL_FLAG(int, min_free_space_mib, 0,
+          "If positive, free space of the output directories, in MiB, below "
+          "which new segments are written to --spill_directory, or video is "
+          "dropped if there is no spill directory or it is low on space too.");
+
+ABSL_FLAG(std::string, event_log_format, "csv",
+          "Encoding of the participant and media entry event log: \"csv\" "
+          "for event_log.csv, or \"binary\" for event_log.bin, a compact "
+          "columnar format for analytics tools.");
+
+ABSL_FLAG(bool, compress_event_log, false,
+          "Whether to compress the event log with zstd, adding .zst to its "
+          "name. Events are flushed to the file after each update, and at "
+          "least every second, so the log can be read after a crash.");
+
+ABSL_FLAG(int, video_conversion_threads, 2,
+          "Number of threads that convert received video frames to I420, so "
+          "that WebRTC's decoding thread is not held up by conversions. Frames "
+          "of a stream are converted in order on one thread. If 0, frames are "
+          "converted on the decoding thread.");
+
+ABSL_FLAG(int, max_pooled_video_buffers, 16,
+          "Maximum number of buffers of each resolution kept for reuse by "
+          "converted and scaled video frames, both by the client and by the "
+          "video conversion threads.");
+
+ABSL_FLAG(int, max_video_framerate, 0,
+          "If positive, received video is delivered at most at this frame "
+          "rate, and other frames are dropped before they are converted or "
+          "written.");
+
+ABSL_FLAG(bool, chunk_log, false,
+          "Whether to append the media of all participants to a single file, "
+          "media.chunks, instead of writing a file per segment. Split it into "
+          "per-participant streams with media_chunk_extractor. Cannot be "
+          "combined with a muxed format.");
+
 ABSL_FLAG(int, request_timeout_ms, 5000,
           "The timeout for requests to the Meet API.");
 
@@ -148,17 +221,177 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
+  absl::StatusOr<media_api_samples::OutputFiles> output_files =
+      media_api_samples::CreateOutputFilesFromFlags();
+  if (!output_files.ok()) {
+    LOG(ERROR) << "Failed to create output writer provider: "
+               << output_files.status();
+    return EXIT_FAILURE;
+  }
+
+  if (absl::GetFlag(FLAGS_max_queued_frames_mib) <= 0 ||
+      absl::GetFlag(FLAGS_min_free_space_mib) < 0) {
+    LOG(ERROR) << "Max queued frames size must be positive, and min free "
+                  "space must not be negative";
+    return EXIT_FAILURE;
+  }
+  // Sharded output places files itself, so it cannot spill.
+  std::vector<std::string> output_directories =
+      absl::GetFlag(FLAGS_output_directories);
+  std::string spill_directory;
+  if (output_directories.empty()) {
+    std::string::size_type directory_end = output_file_prefix.rfind('/');
+    output_directories.push_back(
+        directory_end == std::string::npos
+            ? "."
+            : output_file_prefix.substr(0, directory_end + 1));
+    spill_directory = absl::GetFlag(FLAGS_spill_directory);
+  }
+  absl::StatusOr<std::shared_ptr<media_api_samples::StorageHealthMonitor>>
+      storage_monitor = media_api_samples::StorageHealthMonitor::Create(
+          {.directories = std::move(output_directories),
+           .spill_directory = std::move(spill_directory),
+           .min_free_bytes =
+               int64_t{absl::GetFlag(FLAGS_min_free_space_mib)} << 20,
+           .max_queued_bytes =
+               int64_t{absl::GetFlag(FLAGS_max_queued_frames_mib)} << 20},
+          *std::move(output_files));
+  if (!storage_monitor.ok()) {
+    LOG(ERROR) << "Failed to create storage health monitor: "
+               << storage_monitor.status();
+    return EXIT_FAILURE;
+  }
+  media_api_samples::OutputFiles monitored_files =
+      media_api_samples::CreateStorageMonitoredOutputFiles(*storage_monitor);
+  media_api_samples::EventLogFormat event_log_format;
+  if (absl::GetFlag(FLAGS_event_log_format) == "csv") {
+    event_log_format = media_api_samples::EventLogFormat::kCsv;
+  } else if (absl::GetFlag(FLAGS_event_log_format) == "binary") {
+    event_log_format = media_api_samples::EventLogFormat::kBinary;
+  } else {
+    LOG(ERROR) << "Unknown event log format: "
+               << absl::GetFlag(FLAGS_event_log_format);
+    return EXIT_FAILURE;
+  }
+  if (absl::GetFlag(FLAGS_compress_event_log)) {
+    std::string event_log_file_name = absl::StrCat(
+        output_file_prefix,
+        media_api_samples::MultiUserMediaCollector::EventLogFileName(
+            event_log_format));
+    monitored_files.provider =
+        [provider = std::move(monitored_files.provider),
+         event_log_file_name = std::move(event_log_file_name)](
+            absl::string_view file_name) mutable
+        -> std::unique_ptr<media_api_samples::OutputWriterInterface> {
+      if (file_name != event_log_file_name) {
+        return provider(file_name);
+      }
+      // The resource manager flushes the log after each update, which flushes
+      // the compressor and the file. Flushing keeps the compression history,
+      // so this costs little compression.
+      return media_api_samples::ZstdOutputWriter::Create(
+          provider(absl::StrCat(file_name, ".zst")), {});
+    };
+  }
+
+  if (absl::GetFlag(FLAGS_segment_max_size_mib) < 0 ||
+      absl::GetFlag(FLAGS_segment_max_duration) <= absl::ZeroDuration()) {
+    LOG(ERROR) << "Segment max size must not be negative, and segment max "
+                  "duration must be positive";
+    return EXIT_FAILURE;
+  }
+  media_api_samples::SegmentRotationOptions rotation = {
+      .max_bytes =
+          static_cast<int64_t>(absl::GetFlag(FLAGS_segment_max_size_mib))
+          << 20,
+      .max_duration = absl::GetFlag(FLAGS_segment_max_duration)};
+
+  absl::StatusOr<std::optional<media_api_samples::MuxedSegmentFormat>>
+      muxed_format = media_api_samples::CreateMuxedSegmentFormatFromFlags();
+  if (!muxed_format.ok()) {
+    LOG(ERROR) << "Failed to create muxed segment format: "
+               << muxed_format.status();
+    return EXIT_FAILURE;
+  }
+
+  std::shared_ptr<media_api_samples::FrameConversionPool> conversion_pool;
+  if (int threads = absl::GetFlag(FLAGS_video_conversion_threads);
+      threads > 0) {
+    absl::StatusOr<std::shared_ptr<media_api_samples::FrameConversionPool>>
+        pool = media_api_samples::FrameConversionPool::Create(
+            {.thread_count = threads,
+             .max_pooled_buffers =
+                 absl::GetFlag(FLAGS_max_pooled_video_buffers)});
+    if (!pool.ok()) {
+      LOG(ERROR) << "Failed to create frame conversion pool: "
+                 << pool.status();
+      return EXIT_FAILURE;
+    }
+    conversion_pool = *std::move(pool);
+  }
+
+  media_api_samples::MultiUserMediaCollector::Options collector_options = {
+      .output_writer_provider = std::move(monitored_files.provider),
+      .segment_renamer = std::move(monitored_files.renamer),
+      .segment_remover = std::move(monitored_files.remover),
+      .muxed_format = *std::move(muxed_format),
+      .chunk_log = absl::GetFlag(FLAGS_chunk_log),
+      .segment_gap_threshold = absl::GetFlag(FLAGS_segment_gap_threshold),
+      .rotation = rotation,
+      .storage_monitor = *storage_monitor,
+      .event_log_format = event_log_format,
+      .conversion_pool = conversion_pool};
+  if (collector_options.chunk_log &&
+      collector_options.muxed_format.has_value()) {
+    LOG(ERROR) << "A chunk log cannot be combined with a muxed format";
+    return EXIT_FAILURE;
+  }
+  if (!collector_options.chunk_log &&
+      !collector_options.muxed_format.has_value()) {
+    absl::StatusOr<media_api_samples::VideoSegmentFormat> video_format =
+        media_api_samples::CreateVideoSegmentFormatFromFlags();
+    if (!video_format.ok()) {
+      LOG(ERROR) << "Failed to create video segment format: "
+                 << video_format.status();
+      return EXIT_FAILURE;
+    }
+    collector_options.video_format = *std::move(video_format);
+
+    absl::StatusOr<media_api_samples::AudioSegmentFormat> audio_format =
+        media_api_samples::CreateAudioSegmentFormatFromFlags();
+    if (!audio_format.ok()) {
+      LOG(ERROR) << "Failed to create audio segment format: "
+                 << audio_format.status();
+      return EXIT_FAILURE;
+    }
+    collector_options.audio_format = *std::move(audio_format);
+  }
   auto media_collector =
       webrtc::make_ref_counted<media_api_samples::MultiUserMediaCollector>(
-          output_file_prefix, absl::GetFlag(FLAGS_segment_gap_threshold),
+          output_file_prefix, std::move(collector_options),
           std::move(collector_thread));
+  absl::StatusOr<webrtc::scoped_refptr<meet::MediaApiClientObserverInterface>>
+      observer = media_api_samples::CreateSharedMemoryPublisherFromFlags(
+          media_collector);
+  if (!observer.ok()) {
+    LOG(ERROR) << "Failed to create shared memory publisher: "
+               << observer.status();
+    return EXIT_FAILURE;
+  }
   meet::MediaApiClientConfiguration config = {
       .receiving_video_stream_count = 3,
       .enable_audio_streams = true,
+      .max_pooled_video_buffers = absl::GetFlag(FLAGS_max_pooled_video_buffers),
   };
+  if (int max_framerate = absl::GetFlag(FLAGS_max_video_framerate);
+      max_framerate > 0) {
+    config.receiving_video_stream_options.assign(
+        config.receiving_video_stream_count,
+        {.max_framerate = max_framerate});
+  }
   absl::StatusOr<std::unique_ptr<meet::MediaApiClientInterface>> client_status =
       meet::MediaApiClientFactory().CreateMediaApiClient(std::move(config),
-                                                         media_collector);
+                                                         *std::move(observer));
   if (!client_status.ok()) {
     LOG(ERROR) << "Failed to create MediaApiClient: " << client_status.status();
     return EXIT_FAILURE;
@@ -214,5 +447,11 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
   LOG(INFO) << "Disconnected from conference";
+  meet::VideoBufferPoolStats buffer_pool_stats =
+      client->GetVideoBufferPoolStats();
+  LOG(INFO) << "Client video buffers: " << buffer_pool_stats.hits
+            << " reused, " << buffer_pool_stats.misses << " allocated, "
+            << buffer_pool_stats.dropped_frames
+            << " frames dropped before scaling";
   return EXIT_SUCCESS;
 }
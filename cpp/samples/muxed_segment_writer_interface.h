@@ -0,0 +1,92 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_MUXED_SEGMENT_WRITER_INTERFACE_H_
+#define CPP_SAMPLES_MUXED_SEGMENT_WRITER_INTERFACE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Interface for writing a participant's audio and video interleaved in a
+// single segment.
+class MuxedSegmentWriterInterface {
+ public:
+  virtual ~MuxedSegmentWriterInterface() = default;
+
+  // Returns false, without writing the frame, if the segment cannot hold
+  // frames of this resolution. The caller should then close the segment and
+  // write the frame to a new one.
+  virtual bool WriteVideoFrame(
+      webrtc::scoped_refptr<webrtc::I420BufferInterface> frame,
+      absl::Time received_time) = 0;
+  virtual void WriteAudioSamples(std::vector<int16_t> pcm16,
+                                 absl::Time received_time) = 0;
+  // Finishes the segment and closes its output. Once this returns, the output
+  // file may be renamed.
+  virtual void Close() = 0;
+
+  // Closes `writer` like `Close`, destroys it, then calls `on_closed`, after
+  // which the output file may be renamed. Writers that finish segments on
+  // other threads return first, and do the rest on those threads.
+  static void CloseAsync(std::unique_ptr<MuxedSegmentWriterInterface> writer,
+                         absl::AnyInvocable<void() &&> on_closed) {
+    MuxedSegmentWriterInterface& closing = *writer;
+    closing.StartClose(std::move(writer), std::move(on_closed));
+  }
+
+ protected:
+  // Implements `CloseAsync` for this writer, which `self` owns. By default,
+  // closes it on the calling thread.
+  virtual void StartClose(std::unique_ptr<MuxedSegmentWriterInterface> self,
+                          absl::AnyInvocable<void() &&> on_closed) {
+    Close();
+    self.reset();
+    std::move(on_closed)();
+  }
+};
+
+// Describes how muxed segments are stored.
+struct MuxedSegmentFormat {
+  using WriterFactory =
+      absl::AnyInvocable<std::unique_ptr<MuxedSegmentWriterInterface>(
+          std::unique_ptr<OutputWriterInterface> output,
+          absl::Time start_time)>;
+
+  // Extension of segment files, without the leading dot.
+  std::string file_extension;
+  // Creates a writer for a segment that starts at `start_time` and writes to
+  // `output`.
+  WriterFactory create_writer;
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_MUXED_SEGMENT_WRITER_INTERFACE_H_
@@ -0,0 +1,426 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/ogg_opus_segment_writer.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "api/array_view.h"
+#include "api/audio_codecs/audio_encoder.h"
+#include "api/audio_codecs/audio_format.h"
+#include "api/audio_codecs/builtin_audio_encoder_factory.h"
+#include "api/environment/environment_factory.h"
+#include "rtc_base/buffer.h"
+#include "rtc_base/thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+// The encoder consumes 10 ms blocks.
+constexpr int kBlockSamples = kOpusSampleRate / 100;
+// Opus packets are 20 ms by default, so pages hold up to one second of audio.
+constexpr int kMaxPacketsPerPage = 50;
+constexpr int kMaxSegmentsPerPage = 255;
+constexpr int kOggPageHeaderSize = 27;
+constexpr uint8_t kBeginningOfStream = 0x02;
+constexpr uint8_t kEndOfStream = 0x04;
+// Each file holds a single logical stream, so any serial number is unique.
+constexpr uint32_t kSerialNumber = 1;
+constexpr int kOpusPayloadType = 111;
+constexpr char kVendor[] = "meet_media_api_samples";
+
+void PutLittleEndian(uint64_t value, int size, char* destination) {
+  for (int i = 0; i < size; ++i) {
+    destination[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+// Ogg uses the unreflected CRC-32 with polynomial 0x04c11db7, a zero initial
+// value, and no final XOR.
+constexpr std::array<uint32_t, 256> MakeOggCrcTable() {
+  std::array<uint32_t, 256> table = {};
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t remainder = i << 24;
+    for (int bit = 0; bit < 8; ++bit) {
+      remainder = (remainder & 0x80000000) ? (remainder << 1) ^ 0x04c11db7
+                                           : remainder << 1;
+    }
+    table[i] = remainder;
+  }
+  return table;
+}
+
+constexpr std::array<uint32_t, 256> kOggCrcTable = MakeOggCrcTable();
+
+uint32_t UpdateOggCrc(uint32_t crc, absl::Span<const char> data) {
+  for (char byte : data) {
+    crc = (crc << 8) ^
+          kOggCrcTable[((crc >> 24) ^ static_cast<uint8_t>(byte)) & 0xff];
+  }
+  return crc;
+}
+
+// Writes packets to an Ogg Opus file, as specified by RFC 7845.
+//
+// Packets are grouped into pages of up to one second, so a crash loses at most
+// the last second of a segment.
+class OggOpusSink : public OpusPacketSinkInterface {
+ public:
+  explicit OggOpusSink(std::unique_ptr<OutputWriterInterface> output)
+      : output_(std::move(output)) {}
+
+  void WritePacket(absl::Span<const uint8_t> packet,
+                   int64_t end_sample) override {
+    WriteHeadersIfNeeded();
+    // A full page is held until the next packet, so that the last page always
+    // carries the last packet, with the end of stream flag and the final
+    // granule position that trims the padding.
+    if (page_packet_count_ >= kMaxPacketsPerPage) {
+      WritePage(/*header_type=*/0, page_granule_position_);
+    }
+    AddPacket(packet);
+    page_granule_position_ = end_sample;
+  }
+
+  void Close(int64_t end_sample) override {
+    WriteHeadersIfNeeded();
+    WritePage(kEndOfStream, end_sample);
+    output_->Close();
+  }
+
+ private:
+  void WriteHeadersIfNeeded() {
+    if (page_sequence_number_ > 0) {
+      return;
+    }
+    AddPacket(CreateOpusHead());
+    WritePage(kBeginningOfStream, /*granule_position=*/0);
+
+    // Comment header, with no user comments.
+    std::vector<char> opus_tags = {'O', 'p', 'u', 's', 'T', 'a', 'g', 's'};
+    size_t vendor_length = sizeof(kVendor) - 1;
+    opus_tags.resize(8 + 4 + vendor_length + 4);
+    PutLittleEndian(vendor_length, 4, &opus_tags[8]);
+    std::memcpy(&opus_tags[12], kVendor, vendor_length);
+    AddPacket(absl::Span<const uint8_t>(
+        reinterpret_cast<const uint8_t*>(opus_tags.data()), opus_tags.size()));
+    WritePage(/*header_type=*/0, /*granule_position=*/0);
+  }
+
+  void AddPacket(absl::Span<const uint8_t> packet) {
+    // A packet of N bytes takes N / 255 lacing values of 255, terminated by a
+    // value below 255.
+    size_t lacing_values = packet.size() / 255 + 1;
+    if (segment_table_.size() + lacing_values > kMaxSegmentsPerPage) {
+      WritePage(/*header_type=*/0, page_granule_position_);
+    }
+    segment_table_.insert(segment_table_.end(), lacing_values - 1, 255);
+    segment_table_.push_back(packet.size() % 255);
+    page_body_.insert(page_body_.end(), packet.begin(), packet.end());
+    page_packet_count_++;
+  }
+
+  // Writes the buffered packets as a page. `granule_position` is the position
+  // of the last sample that may be played once the page's packets are decoded.
+  void WritePage(uint8_t header_type, int64_t granule_position) {
+    std::vector<char> header(kOggPageHeaderSize + segment_table_.size());
+    std::memcpy(header.data(), "OggS", 4);
+    header[4] = 0;  // Version.
+    header[5] = static_cast<char>(header_type);
+    PutLittleEndian(granule_position, 8, &header[6]);
+    PutLittleEndian(kSerialNumber, 4, &header[14]);
+    PutLittleEndian(page_sequence_number_++, 4, &header[18]);
+    // The checksum (bytes 22 to 25) is computed with the field set to zero.
+    header[26] = static_cast<char>(segment_table_.size());
+    std::memcpy(&header[kOggPageHeaderSize], segment_table_.data(),
+                segment_table_.size());
+    uint32_t crc = UpdateOggCrc(0, header);
+    crc = UpdateOggCrc(crc, page_body_);
+    PutLittleEndian(crc, 4, &header[22]);
+
+    absl::Span<const char> chunks[] = {header, page_body_};
+    output_->WriteChunks(chunks);
+    segment_table_.clear();
+    page_body_.clear();
+    page_packet_count_ = 0;
+  }
+
+  std::unique_ptr<OutputWriterInterface> output_;
+  uint32_t page_sequence_number_ = 0;
+  // Lacing values and payload of the page being built.
+  std::vector<uint8_t> segment_table_;
+  std::vector<char> page_body_;
+  int page_packet_count_ = 0;
+  // Granule position of the last packet added to the page being built.
+  int64_t page_granule_position_ = 0;
+};
+
+}  // namespace
+
+std::vector<uint8_t> CreateOpusHead() {
+  char opus_head[19] = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd'};
+  opus_head[8] = 1;  // Version.
+  opus_head[9] = 1;  // Channel count.
+  PutLittleEndian(kOpusPreSkip, 2, &opus_head[10]);
+  PutLittleEndian(kOpusSampleRate, 4, &opus_head[12]);
+  // Output gain (bytes 16 and 17) and channel mapping family (byte 18) are
+  // zero.
+  return std::vector<uint8_t>(opus_head, opus_head + sizeof(opus_head));
+}
+
+double AudioEncoderPool::Stats::CompressionRatio() const {
+  return encoded_bytes > 0
+             ? static_cast<double>(input_samples * sizeof(int16_t)) /
+                   encoded_bytes
+             : 0;
+}
+
+absl::StatusOr<std::shared_ptr<AudioEncoderPool>> AudioEncoderPool::Create(
+    Options options) {
+  if (options.target_bitrate_kbps <= 0 || options.encoder_thread_count <= 0) {
+    return absl::InvalidArgumentError(
+        "Audio encoder options must all be positive");
+  }
+
+  std::vector<std::unique_ptr<webrtc::Thread>> threads;
+  for (int i = 0; i < options.encoder_thread_count; ++i) {
+    std::unique_ptr<webrtc::Thread> thread = webrtc::Thread::Create();
+    thread->SetName("audio_encoder_thread", nullptr);
+    if (!thread->Start()) {
+      return absl::InternalError("Failed to start audio encoder thread");
+    }
+    threads.push_back(std::move(thread));
+  }
+  return absl::WrapUnique(
+      new AudioEncoderPool(std::move(options), std::move(threads)));
+}
+
+AudioEncoderPool::AudioEncoderPool(
+    Options options, std::vector<std::unique_ptr<webrtc::Thread>> threads)
+    : options_(std::move(options)),
+      env_(webrtc::CreateEnvironment()),
+      encoder_factory_(webrtc::CreateBuiltinAudioEncoderFactory()),
+      encoder_threads_(std::move(threads)) {}
+
+AudioEncoderPool::~AudioEncoderPool() {
+  Stats stats = GetStats();
+  LOG(INFO) << "Encoded " << stats.input_samples << " audio samples into "
+            << stats.encoded_bytes << " bytes in " << stats.encode_time
+            << "; compression ratio " << stats.CompressionRatio();
+}
+
+std::unique_ptr<AudioSegmentWriterInterface> AudioEncoderPool::CreateWriter(
+    std::unique_ptr<OutputWriterInterface> output) {
+  return CreateWriter(std::make_unique<OggOpusSink>(std::move(output)));
+}
+
+std::unique_ptr<AudioSegmentWriterInterface> AudioEncoderPool::CreateWriter(
+    std::unique_ptr<OpusPacketSinkInterface> sink) {
+  webrtc::Thread* thread;
+  {
+    absl::MutexLock lock(&mutex_);
+    thread = encoder_threads_[next_thread_].get();
+    next_thread_ = (next_thread_ + 1) % encoder_threads_.size();
+  }
+  return std::make_unique<OpusSegmentWriter>(shared_from_this(), *thread,
+                                             std::move(sink));
+}
+
+AudioEncoderPool::Stats AudioEncoderPool::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void AudioEncoderPool::RecordEncodedSamples(int64_t samples,
+                                            absl::Duration encode_time) {
+  absl::MutexLock lock(&mutex_);
+  stats_.input_samples += samples;
+  stats_.encode_time += encode_time;
+}
+
+void AudioEncoderPool::RecordEncodedBytes(int64_t size) {
+  absl::MutexLock lock(&mutex_);
+  stats_.encoded_bytes += size;
+}
+
+OpusSegmentWriter::OpusSegmentWriter(
+    std::shared_ptr<AudioEncoderPool> pool, webrtc::Thread& encoder_thread,
+    std::unique_ptr<OpusPacketSinkInterface> sink)
+    : pool_(std::move(pool)),
+      encoder_thread_(encoder_thread),
+      sink_(std::move(sink)) {
+  encoder_thread_.PostTask([this] { InitEncoder(); });
+}
+
+OpusSegmentWriter::~OpusSegmentWriter() {
+  if (!closed_) {
+    Close();
+  }
+}
+
+void OpusSegmentWriter::WriteSamples(std::vector<int16_t> pcm16) {
+  DCHECK(!closed_);
+  encoder_thread_.PostTask([this, pcm16 = std::move(pcm16)]() mutable {
+    EncodeSamples(std::move(pcm16));
+  });
+}
+
+void OpusSegmentWriter::Close() {
+  DCHECK(!closed_);
+  closed_ = true;
+  // Blocking here guarantees that all tasks referencing this writer have run,
+  // and that the output is closed before the segment is renamed.
+  encoder_thread_.BlockingCall([this] { ReleaseEncoder(); });
+}
+
+void OpusSegmentWriter::StartClose(
+    std::unique_ptr<AudioSegmentWriterInterface> self,
+    absl::AnyInvocable<void() &&> on_closed) {
+  DCHECK_EQ(self.get(), this);
+  DCHECK(!closed_);
+  closed_ = true;
+  // Tasks run in order, so this runs after every queued sample is encoded.
+  // The task owns the writer until then.
+  encoder_thread_.PostTask([this, self = std::move(self),
+                            on_closed = std::move(on_closed)]() mutable {
+    ReleaseEncoder();
+    self.reset();
+    std::move(on_closed)();
+  });
+}
+
+void OpusSegmentWriter::InitEncoder() {
+  DCHECK(encoder_thread_.IsCurrent());
+
+  // Opus is always signaled as two channels; mono encoding is the default
+  // when "stereo" is not set.
+  webrtc::SdpAudioFormat format(
+      "opus", kOpusSampleRate, /*num_channels=*/2,
+      {{"maxaveragebitrate",
+        absl::StrCat(pool_->options().target_bitrate_kbps * 1000)}});
+  encoder_ = pool_->encoder_factory_->Create(
+      pool_->env_, format, {.payload_type = kOpusPayloadType});
+  if (encoder_ == nullptr) {
+    LOG(ERROR) << "Failed to create Opus encoder";
+    return;
+  }
+  DCHECK_EQ(encoder_->SampleRateHz(), kOpusSampleRate);
+  DCHECK_EQ(encoder_->NumChannels(), 1u);
+}
+
+void OpusSegmentWriter::EncodeSamples(std::vector<int16_t> pcm16) {
+  DCHECK(encoder_thread_.IsCurrent());
+
+  int64_t sample_count = pcm16.size();
+  received_samples_ += sample_count;
+  if (encoder_ == nullptr) {
+    return;
+  }
+
+  absl::Time start = absl::Now();
+  if (pending_samples_.empty()) {
+    pending_samples_ = std::move(pcm16);
+  } else {
+    pending_samples_.insert(pending_samples_.end(), pcm16.begin(),
+                            pcm16.end());
+  }
+  size_t offset = 0;
+  for (; offset + kBlockSamples <= pending_samples_.size();
+       offset += kBlockSamples) {
+    EncodeBlock(webrtc::ArrayView<const int16_t>(&pending_samples_[offset],
+                                                 kBlockSamples));
+  }
+  pending_samples_.erase(pending_samples_.begin(),
+                         pending_samples_.begin() + offset);
+  absl::Duration encode_time = absl::Now() - start;
+  encode_time_ += encode_time;
+  pool_->RecordEncodedSamples(sample_count, encode_time);
+}
+
+void OpusSegmentWriter::EncodeBlock(
+    webrtc::ArrayView<const int16_t> block) {
+  encoded_.Clear();
+  webrtc::AudioEncoder::EncodedInfo info = encoder_->Encode(
+      static_cast<uint32_t>(encoded_samples_), block, &encoded_);
+  encoded_samples_ += kBlockSamples;
+  if (info.encoded_bytes == 0) {
+    // The encoder buffers blocks until it has a full packet.
+    return;
+  }
+  // A packet covers every block given to the encoder since the last packet.
+  packetized_samples_ = encoded_samples_;
+  sink_->WritePacket(absl::MakeConstSpan(encoded_.data(), encoded_.size()),
+                     packetized_samples_);
+  pool_->RecordEncodedBytes(info.encoded_bytes);
+}
+
+void OpusSegmentWriter::ReleaseEncoder() {
+  DCHECK(encoder_thread_.IsCurrent());
+
+  // Pad with silence until the encoder has flushed its delay and every
+  // received sample is in a packet. The final position trims the padding on
+  // playback.
+  int64_t end_position = received_samples_ + kOpusPreSkip;
+  if (encoder_ != nullptr) {
+    if (!pending_samples_.empty()) {
+      pending_samples_.resize(kBlockSamples, 0);
+      EncodeBlock(pending_samples_);
+    }
+    std::vector<int16_t> silence(kBlockSamples, 0);
+    while (packetized_samples_ < end_position &&
+           encoded_samples_ < end_position + kOpusSampleRate) {
+      EncodeBlock(silence);
+    }
+    encoder_.reset();
+  }
+  sink_->Close(end_position);
+
+  LOG(INFO) << "Closed audio segment with " << received_samples_
+            << " samples; encoded in " << encode_time_;
+}
+
+AudioSegmentFormat CreateOggOpusSegmentFormat(
+    std::shared_ptr<AudioEncoderPool> pool) {
+  return {.file_extension = "opus",
+          .create_writer = [pool = std::move(pool)](
+                               std::unique_ptr<OutputWriterInterface> output) {
+            return pool->CreateWriter(std::move(output));
+          }};
+}
+
+}  // namespace media_api_samples
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_OGG_OPUS_SEGMENT_WRITER_H_
+#define CPP_SAMPLES_OGG_OPUS_SEGMENT_WRITER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "api/array_view.h"
+#include "api/audio_codecs/audio_encoder.h"
+#include "api/audio_codecs/audio_encoder_factory.h"
+#include "api/environment/environment.h"
+#include "api/scoped_refptr.h"
+#include "rtc_base/buffer.h"
+#include "rtc_base/thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Opus timestamps always use a 48 kHz clock, which matches the client's audio.
+inline constexpr int kOpusSampleRate = 48000;
+// Number of samples of encoder delay that players discard, matching libopus'
+// lookahead at 48 kHz.
+inline constexpr int kOpusPreSkip = 312;
+
+// Returns the Opus identification header of RFC 7845 for the mono streams
+// written by `OpusSegmentWriter`. Ogg stores it as the first packet and
+// Matroska as the track's codec private data.
+std::vector<uint8_t> CreateOpusHead();
+
+// Stores the packets compressed by an `OpusSegmentWriter` in a container.
+//
+// Methods are called on the segment's encoder thread.
+class OpusPacketSinkInterface {
+ public:
+  virtual ~OpusPacketSinkInterface() = default;
+
+  // `end_sample` is the number of 48 kHz samples, including the pre-skip,
+  // that have been decoded once `packet` is.
+  virtual void WritePacket(absl::Span<const uint8_t> packet,
+                           int64_t end_sample) = 0;
+  // Called once, after the last packet. Decoded samples after `end_sample` are
+  // padding that players should trim.
+  virtual void Close(int64_t end_sample) = 0;
+};
+
+// A set of encoder threads that compress audio segments with Opus.
+//
+// Each segment is pinned to one encoder thread, so that its samples are
+// encoded in order without blocking the collector thread. Segments are
+// assigned to threads round-robin.
+//
+// This class is thread-safe.
+class AudioEncoderPool : public std::enable_shared_from_this<AudioEncoderPool> {
+ public:
+  struct Options {
+    int target_bitrate_kbps = 32;
+    int encoder_thread_count = 1;
+  };
+
+  struct Stats {
+    // Number of 48 kHz samples given to the encoders.
+    int64_t input_samples = 0;
+    int64_t encoded_bytes = 0;
+    // Time spent in the encoder, summed over all segments.
+    absl::Duration encode_time;
+
+    // Returns the size of the pcm16 input divided by the size of the encoded
+    // output.
+    double CompressionRatio() const;
+  };
+
+  static absl::StatusOr<std::shared_ptr<AudioEncoderPool>> Create(
+      Options options);
+
+  // Logs the pool's stats.
+  ~AudioEncoderPool();
+
+  // Returns a writer that encodes samples into an Ogg Opus file written to
+  // `output`.
+  std::unique_ptr<AudioSegmentWriterInterface> CreateWriter(
+      std::unique_ptr<OutputWriterInterface> output);
+  // Returns a writer that encodes samples and hands the packets to `sink`, for
+  // containers other than Ogg.
+  std::unique_ptr<AudioSegmentWriterInterface> CreateWriter(
+      std::unique_ptr<OpusPacketSinkInterface> sink);
+
+  const Options& options() const { return options_; }
+  Stats GetStats() const;
+
+ private:
+  friend class OpusSegmentWriter;
+
+  AudioEncoderPool(Options options,
+                   std::vector<std::unique_ptr<webrtc::Thread>> threads);
+
+  void RecordEncodedSamples(int64_t samples, absl::Duration encode_time);
+  void RecordEncodedBytes(int64_t size);
+
+  const Options options_;
+  const webrtc::Environment env_;
+  const webrtc::scoped_refptr<webrtc::AudioEncoderFactory> encoder_factory_;
+  std::vector<std::unique_ptr<webrtc::Thread>> encoder_threads_;
+
+  mutable absl::Mutex mutex_;
+  int next_thread_ ABSL_GUARDED_BY(mutex_) = 0;
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+// An audio segment writer that encodes samples on one of an
+// `AudioEncoderPool`'s threads and hands the packets to a sink.
+//
+// This class is not thread-safe.
+class OpusSegmentWriter : public AudioSegmentWriterInterface {
+ public:
+  OpusSegmentWriter(std::shared_ptr<AudioEncoderPool> pool,
+                    webrtc::Thread& encoder_thread,
+                    std::unique_ptr<OpusPacketSinkInterface> sink);
+  ~OpusSegmentWriter() override;
+
+  void WriteSamples(std::vector<int16_t> pcm16) override;
+  // Waits for queued samples to be encoded, pads the final packet with
+  // silence, then closes the sink. Prefer `CloseAsync`, which does so without
+  // blocking the caller.
+  void Close() override;
+
+ protected:
+  // Closes the sink on the encoder thread once queued samples are encoded.
+  void StartClose(std::unique_ptr<AudioSegmentWriterInterface> self,
+                  absl::AnyInvocable<void() &&> on_closed) override;
+
+ private:
+  // The following methods are called on the encoder thread.
+  void InitEncoder();
+  void EncodeSamples(std::vector<int16_t> pcm16);
+  // Encodes one 10 ms block, and hands the resulting packet to the sink if the
+  // encoder produced one.
+  void EncodeBlock(webrtc::ArrayView<const int16_t> block);
+  void ReleaseEncoder();
+
+  std::shared_ptr<AudioEncoderPool> pool_;
+  webrtc::Thread& encoder_thread_;
+  bool closed_ = false;
+
+  // The following fields are only accessed on the encoder thread.
+  std::unique_ptr<OpusPacketSinkInterface> sink_;
+  /*absl_nullable*/ std::unique_ptr<webrtc::AudioEncoder> encoder_;
+  // Samples received but not yet encoded, since the encoder consumes 10 ms
+  // blocks.
+  std::vector<int16_t> pending_samples_;
+  // Number of samples received from the collector.
+  int64_t received_samples_ = 0;
+  // Number of samples, including padding, that the encoder has emitted
+  // packets for.
+  int64_t packetized_samples_ = 0;
+  // Number of samples, including padding, given to the encoder.
+  int64_t encoded_samples_ = 0;
+  webrtc::Buffer encoded_;
+  absl::Duration encode_time_;
+};
+
+// Returns a format that writes `.opus` segments encoded by `pool`.
+AudioSegmentFormat CreateOggOpusSegmentFormat(
+    std::shared_ptr<AudioEncoderPool> pool);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_OGG_OPUS_SEGMENT_WRITER_H_
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/ogg_opus_segment_writer.h"
+
+#include <cmath>
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/notification.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/testing/string_output_writer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+constexpr int kPreSkip = 312;
+// Client audio frames hold 10 ms of 48 kHz mono audio.
+constexpr int kFrameSamples = 480;
+
+uint64_t ReadLittleEndian(const std::string& data, size_t offset, int size) {
+  uint64_t value = 0;
+  for (int i = 0; i < size; ++i) {
+    value |= static_cast<uint64_t>(static_cast<uint8_t>(data[offset + i]))
+             << (8 * i);
+  }
+  return value;
+}
+
+// Bitwise Ogg CRC, computed independently of the writer's table.
+uint32_t OggCrc(const std::string& data) {
+  uint32_t crc = 0;
+  for (char byte : data) {
+    crc ^= static_cast<uint32_t>(static_cast<uint8_t>(byte)) << 24;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+struct OggPage {
+  uint8_t header_type;
+  int64_t granule_position;
+  uint32_t sequence_number;
+  std::vector<std::string> packets;
+};
+
+// Parses `data` into pages, failing the test if any page is malformed.
+std::vector<OggPage> ParsePages(const std::string& data) {
+  std::vector<OggPage> pages;
+  size_t offset = 0;
+  while (offset < data.size()) {
+    EXPECT_EQ(data.substr(offset, 4), "OggS");
+    int segment_count = static_cast<uint8_t>(data[offset + 26]);
+    size_t body_offset = offset + 27 + segment_count;
+    size_t body_size = 0;
+    OggPage page = {
+        .header_type = static_cast<uint8_t>(data[offset + 5]),
+        .granule_position =
+            static_cast<int64_t>(ReadLittleEndian(data, offset + 6, 8)),
+        .sequence_number =
+            static_cast<uint32_t>(ReadLittleEndian(data, offset + 18, 4))};
+    std::string packet;
+    for (int i = 0; i < segment_count; ++i) {
+      int lacing_value = static_cast<uint8_t>(data[offset + 27 + i]);
+      packet.append(data, body_offset + body_size, lacing_value);
+      body_size += lacing_value;
+      if (lacing_value < 255) {
+        page.packets.push_back(std::move(packet));
+        packet.clear();
+      }
+    }
+    std::string page_data =
+        data.substr(offset, body_offset + body_size - offset);
+    uint32_t crc = ReadLittleEndian(page_data, 22, 4);
+    page_data.replace(22, 4, 4, '\0');
+    EXPECT_EQ(OggCrc(page_data), crc);
+    offset = body_offset + body_size;
+    pages.push_back(std::move(page));
+  }
+  return pages;
+}
+
+std::vector<int16_t> CreateTone(int sample_count, int start) {
+  std::vector<int16_t> samples(sample_count);
+  for (int i = 0; i < sample_count; ++i) {
+    samples[i] = static_cast<int16_t>(
+        8000 * std::sin(2 * M_PI * 440 * (start + i) / 48000.0));
+  }
+  return samples;
+}
+
+TEST(OggOpusSegmentWriterTest, WritesOggOpusFileWithEverySample) {
+  constexpr int kFrameCount = 150;
+  absl::StatusOr<std::shared_ptr<AudioEncoderPool>> pool =
+      AudioEncoderPool::Create({});
+  ASSERT_TRUE(pool.ok());
+  std::string output;
+  bool closed = false;
+  std::unique_ptr<AudioSegmentWriterInterface> writer = (*pool)->CreateWriter(
+      std::make_unique<StringOutputWriter>(output, closed));
+
+  for (int i = 0; i < kFrameCount; ++i) {
+    writer->WriteSamples(CreateTone(kFrameSamples, i * kFrameSamples));
+  }
+  writer->Close();
+
+  EXPECT_TRUE(closed);
+  std::vector<OggPage> pages = ParsePages(output);
+  ASSERT_GE(pages.size(), 3);
+  // Identification header.
+  EXPECT_EQ(pages[0].header_type, 0x02);
+  ASSERT_EQ(pages[0].packets.size(), 1);
+  const std::string& opus_head = pages[0].packets[0];
+  EXPECT_EQ(opus_head.substr(0, 8), "OpusHead");
+  EXPECT_EQ(opus_head[9], 1);
+  EXPECT_EQ(ReadLittleEndian(opus_head, 10, 2), kPreSkip);
+  EXPECT_EQ(ReadLittleEndian(opus_head, 12, 4), 48000);
+  // Comment header.
+  ASSERT_EQ(pages[1].packets.size(), 1);
+  EXPECT_EQ(pages[1].packets[0].substr(0, 8), "OpusTags");
+  // Audio pages.
+  int packet_count = 0;
+  for (int i = 0; i < pages.size(); ++i) {
+    EXPECT_EQ(pages[i].sequence_number, i);
+    if (i >= 2) {
+      packet_count += pages[i].packets.size();
+      EXPECT_GT(pages[i].granule_position, pages[i - 1].granule_position);
+    }
+  }
+  EXPECT_EQ(pages.back().header_type, 0x04);
+  EXPECT_EQ(pages.back().granule_position,
+            kFrameCount * kFrameSamples + kPreSkip);
+  // 20 ms packets must cover the input and the encoder delay.
+  EXPECT_GE(packet_count * 2 * kFrameSamples,
+            kFrameCount * kFrameSamples + kPreSkip);
+}
+
+TEST(OggOpusSegmentWriterTest, CompressesAndRecordsStats) {
+  constexpr int kFrameCount = 100;
+  absl::StatusOr<std::shared_ptr<AudioEncoderPool>> pool =
+      AudioEncoderPool::Create({.target_bitrate_kbps = 32});
+  ASSERT_TRUE(pool.ok());
+  std::string output;
+  bool closed = false;
+  std::unique_ptr<AudioSegmentWriterInterface> writer = (*pool)->CreateWriter(
+      std::make_unique<StringOutputWriter>(output, closed));
+
+  for (int i = 0; i < kFrameCount; ++i) {
+    writer->WriteSamples(CreateTone(kFrameSamples, i * kFrameSamples));
+  }
+  writer->Close();
+
+  AudioEncoderPool::Stats stats = (*pool)->GetStats();
+  EXPECT_EQ(stats.input_samples, kFrameCount * kFrameSamples);
+  EXPECT_GT(stats.encoded_bytes, 0);
+  // 768 kbps of pcm16 encoded at 32 kbps.
+  EXPECT_GT(stats.CompressionRatio(), 10);
+  EXPECT_LT(output.size(), kFrameCount * kFrameSamples * sizeof(int16_t) / 10);
+}
+
+TEST(OggOpusSegmentWriterTest, HandlesPartialFrames) {
+  absl::StatusOr<std::shared_ptr<AudioEncoderPool>> pool =
+      AudioEncoderPool::Create({});
+  ASSERT_TRUE(pool.ok());
+  std::string output;
+  bool closed = false;
+  std::unique_ptr<AudioSegmentWriterInterface> writer = (*pool)->CreateWriter(
+      std::make_unique<StringOutputWriter>(output, closed));
+
+  writer->WriteSamples(CreateTone(100, 0));
+  writer->WriteSamples(CreateTone(1000, 100));
+  writer->Close();
+
+  std::vector<OggPage> pages = ParsePages(output);
+  ASSERT_FALSE(pages.empty());
+  EXPECT_EQ(pages.back().header_type, 0x04);
+  EXPECT_EQ(pages.back().granule_position, 1100 + kPreSkip);
+}
+
+TEST(OggOpusSegmentWriterTest, EndsWithLastPacketWhenPageFills) {
+  // With the encoder delay, the padding packet written on close is the 50th
+  // 20 ms packet, which fills the first audio page.
+  constexpr int kFrameCount = 98;
+  absl::StatusOr<std::shared_ptr<AudioEncoderPool>> pool =
+      AudioEncoderPool::Create({});
+  ASSERT_TRUE(pool.ok());
+  std::string output;
+  bool closed = false;
+  std::unique_ptr<AudioSegmentWriterInterface> writer = (*pool)->CreateWriter(
+      std::make_unique<StringOutputWriter>(output, closed));
+
+  for (int i = 0; i < kFrameCount; ++i) {
+    writer->WriteSamples(CreateTone(kFrameSamples, i * kFrameSamples));
+  }
+  writer->Close();
+
+  std::vector<OggPage> pages = ParsePages(output);
+  ASSERT_EQ(pages.size(), 3);
+  EXPECT_EQ(pages.back().header_type, 0x04);
+  EXPECT_EQ(pages.back().packets.size(), 50);
+  EXPECT_EQ(pages.back().granule_position,
+            kFrameCount * kFrameSamples + kPreSkip);
+}
+
+TEST(OggOpusSegmentWriterTest, ClosesAsynchronously) {
+  absl::StatusOr<std::shared_ptr<AudioEncoderPool>> pool =
+      AudioEncoderPool::Create({});
+  ASSERT_TRUE(pool.ok());
+  std::string output;
+  bool closed = false;
+  std::unique_ptr<AudioSegmentWriterInterface> writer = (*pool)->CreateWriter(
+      std::make_unique<StringOutputWriter>(output, closed));
+  writer->WriteSamples(CreateTone(1000, 0));
+
+  absl::Notification on_closed;
+  AudioSegmentWriterInterface::CloseAsync(std::move(writer),
+                                          [&on_closed] { on_closed.Notify(); });
+  on_closed.WaitForNotification();
+
+  EXPECT_TRUE(closed);
+  std::vector<OggPage> pages = ParsePages(output);
+  ASSERT_FALSE(pages.empty());
+  EXPECT_EQ(pages.back().granule_position, 1000 + kPreSkip);
+}
+
+TEST(OggOpusSegmentWriterTest, ClosesOutputOnDestruction) {
+  absl::StatusOr<std::shared_ptr<AudioEncoderPool>> pool =
+      AudioEncoderPool::Create({});
+  ASSERT_TRUE(pool.ok());
+  std::string output;
+  bool closed = false;
+  {
+    std::unique_ptr<AudioSegmentWriterInterface> writer = (*pool)->CreateWriter(
+        std::make_unique<StringOutputWriter>(output, closed));
+    writer->WriteSamples(CreateTone(kFrameSamples, 0));
+  }
+
+  EXPECT_TRUE(closed);
+  EXPECT_FALSE(output.empty());
+}
+
+TEST(AudioEncoderPoolTest, RejectsNonPositiveOptions) {
+  EXPECT_FALSE(AudioEncoderPool::Create({.target_bitrate_kbps = 0}).ok());
+  EXPECT_FALSE(AudioEncoderPool::Create({.encoder_thread_count = 0}).ok());
+}
+
+}  // namespace
+}  // namespace media_api_samples
@@ -16,9 +16,20 @@
 
 #include "meet_clients/samples/output_file.h"
 
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <ios>
+#include <memory>
+#include <string>
+#include <utility>
 
 #include "absl/base/nullability.h"
+#include "absl/log/log.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
 
 ABSL_POINTERS_DEFAULT_NONNULL
 
@@ -28,6 +39,51 @@ void OutputFile::Write(const char* content, std::streamsize size) {
   file_.write(content, size);
 }
 
+void OutputFile::WriteChunks(absl::Span<const absl::Span<const char>> chunks) {
+  // `std::ofstream` buffers internally, so chunks are appended to the stream
+  // buffer directly instead of being dispatched through `Write` one by one.
+  for (absl::Span<const char> chunk : chunks) {
+    file_.write(chunk.data(), chunk.size());
+  }
+}
+
+void OutputFile::Flush() { file_.flush(); }
+
 void OutputFile::Close() { file_.close(); }
 
+OutputWriterProvider CreateOutputFileProvider() {
+  return [](absl::string_view file_name) {
+    std::ofstream file(std::string(file_name),
+                       std::ios::binary | std::ios::out | std::ios::trunc);
+    if (file.is_open()) {
+      LOG(INFO) << "Opened file: " << file_name;
+    } else {
+      // Files should normally open successfully.
+      //
+      // Potential causes for failure include:
+      // - The parent directory does not exist.
+      // - The system is out of disk space.
+      //
+      // If a file cannot be opened, the sample will still run, but written
+      // data will be lost.
+      LOG(ERROR) << "Failed to open file: " << file_name;
+    }
+    return std::make_unique<OutputFile>(std::move(file));
+  };
+}
+
+void RenameOutputFile(absl::string_view from, absl::string_view to) {
+  if (std::rename(std::string(from).c_str(), std::string(to).c_str()) != 0) {
+    LOG(ERROR) << "Failed to rename file " << from << " to " << to << ": "
+               << strerror(errno);
+  }
+}
+
+void RemoveOutputFile(absl::string_view file_name) {
+  if (std::remove(std::string(file_name).c_str()) != 0) {
+    LOG(ERROR) << "Failed to remove file " << file_name << ": "
+               << strerror(errno);
+  }
+}
+
 }  // namespace media_api_samples
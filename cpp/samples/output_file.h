@@ -22,6 +22,8 @@
 #include <utility>
 
 #include "absl/base/nullability.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "meet_clients/samples/output_writer_interface.h"
 
 ABSL_POINTERS_DEFAULT_NONNULL
@@ -33,12 +35,24 @@ class OutputFile : public OutputWriterInterface {
  public:
   explicit OutputFile(std::ofstream file) : file_(std::move(file)) {}
   void Write(const char* content, std::streamsize size) override;
+  void WriteChunks(absl::Span<const absl::Span<const char>> chunks) override;
+  void Flush() override;
   void Close() override;
 
  private:
   std::ofstream file_;
 };
 
+// Returns a provider that creates `OutputFile`s, truncating any existing file
+// with the same name.
+OutputWriterProvider CreateOutputFileProvider();
+
+// Renames a local file, logging if it cannot be renamed.
+void RenameOutputFile(absl::string_view from, absl::string_view to);
+
+// Removes a local file, logging if it cannot be removed.
+void RemoveOutputFile(absl::string_view file_name);
+
 }  // namespace media_api_samples
 
 #endif  // CPP_SAMPLES_OUTPUT_FILE_H_
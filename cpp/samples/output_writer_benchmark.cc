@@ -0,0 +1,110 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks for writing concurrent video streams with different output
+// writers.
+//
+// Each iteration writes one 400x400 I420 frame (the maximum resolution the
+// multi-user sample requests) to every stream, in the same interleaved order
+// in which the collector thread handles them. Files are rotated periodically,
+// outside of the timed region, to keep disk usage bounded.
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/base/nullability.h"
+#include "absl/strings/str_cat.h"
+#include "meet_clients/samples/mapped_output_file.h"
+#include "meet_clients/samples/media_writing.h"
+#include "meet_clients/samples/output_file.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+constexpr int kFrameWidth = 400;
+constexpr int kFrameHeight = 400;
+// Ten seconds of 30 fps video per file.
+constexpr int kFramesPerFile = 300;
+
+std::string StreamFileName(int stream) {
+  return absl::StrCat("/tmp/output_writer_benchmark_", stream, ".yuv");
+}
+
+void BM_WriteVideoStreams(benchmark::State& state,
+                          OutputWriterProvider provider) {
+  int stream_count = state.range(0);
+  webrtc::scoped_refptr<webrtc::I420Buffer> frame =
+      webrtc::I420Buffer::Create(kFrameWidth, kFrameHeight);
+  webrtc::I420Buffer::SetBlack(frame.get());
+
+  std::vector<std::unique_ptr<OutputWriterInterface>> writers;
+  auto open_writers = [&] {
+    for (std::unique_ptr<OutputWriterInterface>& writer : writers) {
+      writer->Close();
+    }
+    writers.clear();
+    for (int i = 0; i < stream_count; ++i) {
+      writers.push_back(provider(StreamFileName(i)));
+    }
+  };
+
+  open_writers();
+  int frames_in_file = 0;
+  for (auto _ : state) {
+    for (std::unique_ptr<OutputWriterInterface>& writer : writers) {
+      WriteYuv420(*frame, *writer);
+    }
+    if (++frames_in_file == kFramesPerFile) {
+      state.PauseTiming();
+      open_writers();
+      frames_in_file = 0;
+      state.ResumeTiming();
+    }
+  }
+  for (std::unique_ptr<OutputWriterInterface>& writer : writers) {
+    writer->Close();
+  }
+  for (int i = 0; i < stream_count; ++i) {
+    std::remove(StreamFileName(i).c_str());
+  }
+
+  int64_t frame_size = kFrameWidth * kFrameHeight +
+                       2 * ((kFrameWidth + 1) / 2) * ((kFrameHeight + 1) / 2);
+  state.SetItemsProcessed(state.iterations() * stream_count);
+  state.SetBytesProcessed(state.iterations() * stream_count * frame_size);
+}
+
+void BM_OutputFile(benchmark::State& state) {
+  BM_WriteVideoStreams(state, CreateOutputFileProvider());
+}
+
+void BM_MappedOutputFile(benchmark::State& state) {
+  BM_WriteVideoStreams(state, CreateMappedOutputFileProvider({}));
+}
+
+BENCHMARK(BM_OutputFile)->Arg(1)->Arg(3)->Arg(12);
+BENCHMARK(BM_MappedOutputFile)->Arg(1)->Arg(3)->Arg(12);
+
+}  // namespace
+}  // namespace media_api_samples
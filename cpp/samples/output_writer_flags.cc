@@ -0,0 +1,294 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/output_writer_flags.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/flags/flag.h"
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "meet_clients/api/media_api_client_interface.h"
+#include "meet_clients/samples/async_output_file.h"
+#include "meet_clients/samples/buffered_output_file.h"
+#include "meet_clients/samples/durable_output_file.h"
+#include "meet_clients/samples/linked_output_file.h"
+#include "meet_clients/samples/mapped_output_file.h"
+#include "meet_clients/samples/output_file.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/sharded_output_writer.h"
+#include "meet_clients/samples/shared_memory_media_publisher.h"
+#include "meet_clients/samples/shared_memory_ring_writer.h"
+#include "meet_clients/samples/socket_output_writer.h"
+#include "api/make_ref_counted.h"
+#include "api/scoped_refptr.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+ABSL_FLAG(std::string, output_writer, "file",
+          "How output files are written. One of:\n"
+          "  file: blocking writes through std::ofstream.\n"
+          "  async: asynchronous writes through io_uring, falling back to a "
+          "pool of threads issuing pwrite calls. Writes only block the "
+          "collector thread once all async buffers are waiting on storage; "
+          "opening each file still blocks it.\n"
+          "  buffered: blocking writes of large page-aligned buffers, "
+          "optionally bypassing or dropping from the page cache.\n"
+          "  mmap: copies data into memory-mapped extents of each file, "
+          "avoiding a system call per write.\n"
+          "  socket: streams each segment to a local aggregator over a Unix "
+          "domain socket, dropping frames if the aggregator falls behind.");
+
+ABSL_FLAG(int, async_writer_buffer_count, 32,
+          "Number of buffers shared by all files when --output_writer=async.");
+
+ABSL_FLAG(int, async_writer_buffer_size_kib, 1024,
+          "Size of each buffer, in KiB, when --output_writer=async.");
+
+ABSL_FLAG(int, buffered_writer_buffer_size_kib, 4096,
+          "Size of each file's buffer, in KiB, when --output_writer=buffered. "
+          "Rounded up to a multiple of the page size.");
+
+ABSL_FLAG(bool, buffered_writer_direct_io, false,
+          "Whether to bypass the page cache with O_DIRECT when "
+          "--output_writer=buffered.");
+
+ABSL_FLAG(bool, buffered_writer_drop_page_cache, true,
+          "Whether to drop written data from the page cache when "
+          "--output_writer=buffered. Keeps long recordings from evicting "
+          "other data on the host.");
+
+ABSL_FLAG(int, mmap_writer_extent_size_mib, 64,
+          "Size of the extents by which files grow, in MiB, when "
+          "--output_writer=mmap.");
+
+ABSL_FLAG(std::string, socket_writer_path, "",
+          "Path of the aggregator's Unix domain socket when "
+          "--output_writer=socket.");
+
+ABSL_FLAG(int, socket_writer_send_buffer_kib, 4096,
+          "Size of each connection's send buffer, in KiB, when "
+          "--output_writer=socket. Capped by net.core.wmem_max.");
+
+ABSL_FLAG(bool, group_commit, false,
+          "Whether to make output files durable with group commits: a "
+          "background thread syncs all files with unsynced data at once, "
+          "every --group_commit_interval or after --group_commit_mib have "
+          "been written, bounding how much a crash can lose. Not supported "
+          "with --output_writer=socket.");
+
+ABSL_FLAG(absl::Duration, group_commit_interval, absl::Seconds(1),
+          "Longest time between group commits when --group_commit is set.");
+
+ABSL_FLAG(int, group_commit_mib, 32,
+          "Data written across all files, in MiB, that triggers a group commit "
+          "before --group_commit_interval has passed.");
+
+ABSL_FLAG(bool, link_on_finalize, false,
+          "Whether to write segments as anonymous O_TMPFILE files that are "
+          "linked under their final name when they close, instead of "
+          "creating temporary files and renaming them. Halves the directory "
+          "operations per segment, but segments are not visible while they "
+          "are written, and are lost if the process crashes. Falls back to "
+          "renames where unsupported. Not supported with "
+          "--output_writer=socket.");
+
+ABSL_FLAG(std::vector<std::string>, output_directories, {},
+          "Comma-separated directories, ideally on separate storage devices, "
+          "to spread output files across. Each directory gets its own I/O "
+          "thread, and files are placed by hashing their names, moving to "
+          "another directory when the preferred one falls behind. Replaces "
+          "the directory of --output_file_prefix, keeping its file name "
+          "prefix.");
+
+ABSL_FLAG(int, output_directory_max_queued_mib, 64,
+          "Data queued for each of --output_directories, in MiB, before "
+          "writers to it block.");
+
+ABSL_FLAG(int, shared_memory_ring_mib, 0,
+          "If positive, decoded frames are also published to a shared memory "
+          "ring of this size, in MiB, for consumers in other processes. The "
+          "path of the ring is logged at startup.");
+
+namespace media_api_samples {
+namespace {
+
+// Creates the provider selected by `--output_writer`, before any durability.
+absl::StatusOr<OutputWriterProvider> CreateBaseOutputWriterProviderFromFlags() {
+  std::string output_writer = absl::GetFlag(FLAGS_output_writer);
+  if (output_writer == "file") {
+    return CreateOutputFileProvider();
+  }
+  if (output_writer == "async") {
+    int buffer_count = absl::GetFlag(FLAGS_async_writer_buffer_count);
+    int buffer_size_kib = absl::GetFlag(FLAGS_async_writer_buffer_size_kib);
+    if (buffer_count <= 0 || buffer_size_kib <= 0) {
+      return absl::InvalidArgumentError(
+          "Async writer buffer count and size must be positive");
+    }
+    return CreateAsyncOutputFileProvider(AsyncOutputWriterPool::Create(
+        {.buffer_size = static_cast<size_t>(buffer_size_kib) * 1024,
+         .buffer_count = buffer_count}));
+  }
+  if (output_writer == "buffered") {
+    int buffer_size_kib = absl::GetFlag(FLAGS_buffered_writer_buffer_size_kib);
+    if (buffer_size_kib <= 0) {
+      return absl::InvalidArgumentError(
+          "Buffered writer buffer size must be positive");
+    }
+    return CreateBufferedOutputFileProvider(
+        {.buffer_size = static_cast<size_t>(buffer_size_kib) * 1024,
+         .direct_io = absl::GetFlag(FLAGS_buffered_writer_direct_io),
+         .drop_written_pages =
+             absl::GetFlag(FLAGS_buffered_writer_drop_page_cache)});
+  }
+  if (output_writer == "mmap") {
+    int extent_size_mib = absl::GetFlag(FLAGS_mmap_writer_extent_size_mib);
+    if (extent_size_mib <= 0) {
+      return absl::InvalidArgumentError(
+          "Mmap writer extent size must be positive");
+    }
+    return CreateMappedOutputFileProvider(
+        {.extent_size = static_cast<size_t>(extent_size_mib) << 20});
+  }
+  if (output_writer == "socket") {
+    std::string socket_path = absl::GetFlag(FLAGS_socket_writer_path);
+    int send_buffer_size_kib =
+        absl::GetFlag(FLAGS_socket_writer_send_buffer_kib);
+    if (socket_path.empty()) {
+      return absl::InvalidArgumentError("Socket writer path is empty");
+    }
+    if (send_buffer_size_kib < 0) {
+      return absl::InvalidArgumentError(
+          "Socket writer send buffer size must not be negative");
+    }
+    return CreateSocketOutputWriterProvider(SocketOutputWriterPool::Create(
+        {.socket_path = std::move(socket_path),
+         .send_buffer_size = send_buffer_size_kib * 1024}));
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("Unknown output writer: ", output_writer));
+}
+
+}  // namespace
+
+absl::StatusOr<OutputWriterProvider> CreateOutputWriterProviderFromFlags() {
+  absl::StatusOr<OutputWriterProvider> provider =
+      CreateBaseOutputWriterProviderFromFlags();
+  if (!provider.ok() || !absl::GetFlag(FLAGS_group_commit)) {
+    return provider;
+  }
+  if (absl::GetFlag(FLAGS_output_writer) == "socket") {
+    return absl::InvalidArgumentError(
+        "Group commits are not supported with the socket writer");
+  }
+  int commit_mib = absl::GetFlag(FLAGS_group_commit_mib);
+  if (commit_mib <= 0) {
+    return absl::InvalidArgumentError("Group commit size must be positive");
+  }
+  absl::StatusOr<std::shared_ptr<DurableOutputWriterPool>> pool =
+      DurableOutputWriterPool::Create(
+          {.commit_interval = absl::GetFlag(FLAGS_group_commit_interval),
+           .commit_bytes = int64_t{commit_mib} << 20},
+          *std::move(provider));
+  if (!pool.ok()) {
+    return pool.status();
+  }
+  return CreateDurableOutputFileProvider(*std::move(pool));
+}
+
+absl::StatusOr<OutputFiles> CreateOutputFilesFromFlags() {
+  absl::StatusOr<OutputWriterProvider> provider =
+      CreateOutputWriterProviderFromFlags();
+  if (!provider.ok()) {
+    return provider.status();
+  }
+  OutputFiles files = {.provider = *std::move(provider),
+                       .renamer = RenameOutputFile,
+                       .remover = RemoveOutputFile};
+  if (absl::GetFlag(FLAGS_output_writer) == "socket") {
+    // Streams are not files, so they keep the names they were created with,
+    // and there is nothing to remove.
+    files.renamer = [](absl::string_view from, absl::string_view to) {};
+    files.remover = [](absl::string_view file_name) {};
+  }
+  if (absl::GetFlag(FLAGS_link_on_finalize)) {
+    if (absl::GetFlag(FLAGS_output_writer) == "socket") {
+      return absl::InvalidArgumentError(
+          "Linking on finalize is not supported with the socket writer");
+    }
+    auto pool =
+        std::make_shared<LinkedOutputWriterPool>(std::move(files.provider));
+    files = {.provider = CreateLinkedOutputFileProvider(pool),
+             .renamer = CreateLinkedOutputFileRenamer(pool),
+             .remover = CreateLinkedOutputFileRemover(pool)};
+  }
+  std::vector<std::string> directories =
+      absl::GetFlag(FLAGS_output_directories);
+  if (directories.empty()) {
+    return files;
+  }
+  int max_queued_mib = absl::GetFlag(FLAGS_output_directory_max_queued_mib);
+  if (max_queued_mib <= 0) {
+    return absl::InvalidArgumentError(
+        "Output directory max queued size must be positive");
+  }
+  absl::StatusOr<std::shared_ptr<ShardedOutputWriterPool>> pool =
+      ShardedOutputWriterPool::Create(
+          {.directories = std::move(directories),
+           .max_queued_bytes = static_cast<size_t>(max_queued_mib) << 20},
+          std::move(files.provider), std::move(files.renamer),
+          std::move(files.remover));
+  if (!pool.ok()) {
+    return pool.status();
+  }
+  return OutputFiles{.provider = CreateShardedOutputWriterProvider(*pool),
+                     .renamer = CreateShardedOutputFileRenamer(*pool),
+                     .remover = CreateShardedOutputFileRemover(*pool)};
+}
+
+absl::StatusOr<webrtc::scoped_refptr<meet::MediaApiClientObserverInterface>>
+CreateSharedMemoryPublisherFromFlags(
+    webrtc::scoped_refptr<meet::MediaApiClientObserverInterface> observer) {
+  int ring_size_mib = absl::GetFlag(FLAGS_shared_memory_ring_mib);
+  if (ring_size_mib < 0) {
+    return absl::InvalidArgumentError(
+        "Shared memory ring size must not be negative");
+  }
+  if (ring_size_mib == 0) {
+    return observer;
+  }
+  absl::StatusOr<std::unique_ptr<SharedMemoryRingWriter>> ring =
+      SharedMemoryRingWriter::Create(
+          {.capacity = static_cast<size_t>(ring_size_mib) << 20});
+  if (!ring.ok()) {
+    return ring.status();
+  }
+  LOG(INFO) << "Publishing frames to shared memory ring: " << (*ring)->path();
+  return webrtc::make_ref_counted<SharedMemoryMediaPublisher>(
+      *std::move(ring), std::move(observer));
+}
+
+}  // namespace media_api_samples
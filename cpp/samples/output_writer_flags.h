@@ -0,0 +1,57 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_OUTPUT_WRITER_FLAGS_H_
+#define CPP_SAMPLES_OUTPUT_WRITER_FLAGS_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/flags/declare.h"
+#include "absl/status/statusor.h"
+#include "meet_clients/api/media_api_client_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "api/scoped_refptr.h"
+
+ABSL_DECLARE_FLAG(std::vector<std::string>, output_directories);
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Creates the output writer provider selected by the `--output_writer` flag and
+// its related flags. If the `--group_commit` flag is set, its files are made
+// durable by a `DurableOutputWriterPool`.
+absl::StatusOr<OutputWriterProvider> CreateOutputWriterProviderFromFlags();
+
+// Creates the output writers selected by `CreateOutputWriterProviderFromFlags`.
+// If the `--link_on_finalize` flag is set, files are only linked into their
+// directory when renamed. If the `--output_directories` flag is set, files are
+// spread across its directories. Either way, files must be renamed and removed
+// with the returned functions.
+absl::StatusOr<OutputFiles> CreateOutputFilesFromFlags();
+
+// Wraps `observer` in a `SharedMemoryMediaPublisher` if the
+// `--shared_memory_ring_mib` flag is positive, and otherwise returns
+// `observer` unchanged.
+absl::StatusOr<webrtc::scoped_refptr<meet::MediaApiClientObserverInterface>>
+CreateSharedMemoryPublisherFromFlags(
+    webrtc::scoped_refptr<meet::MediaApiClientObserverInterface> observer);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_OUTPUT_WRITER_FLAGS_H_
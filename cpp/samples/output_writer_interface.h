@@ -23,6 +23,7 @@
 #include "absl/base/nullability.h"
 #include "absl/functional/any_invocable.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 ABSL_POINTERS_DEFAULT_NONNULL
 
@@ -33,6 +34,20 @@ class OutputWriterInterface {
  public:
   virtual ~OutputWriterInterface() = default;
   virtual void Write(const char* content, std::streamsize size) = 0;
+  // Writes each chunk in order, as if each were passed to `Write`.
+  //
+  // This allows callers to hand over a whole frame (or a set of plane rows) in
+  // a single call. Implementations that can submit several buffers at once
+  // should override this; the default forwards each chunk to `Write`.
+  virtual void WriteChunks(absl::Span<const absl::Span<const char>> chunks) {
+    for (absl::Span<const char> chunk : chunks) {
+      Write(chunk.data(), chunk.size());
+    }
+  }
+  // Passes data buffered by the writer on to the underlying file or stream, so
+  // that it survives a crash of the process. Writers that do not buffer, or
+  // that hand data to a background thread, may ignore this.
+  virtual void Flush() {}
   virtual void Close() = 0;
 };
 
@@ -41,6 +56,22 @@ using OutputWriterProvider =
     absl::AnyInvocable<std::unique_ptr<OutputWriterInterface>(
         absl::string_view file_name)>;
 
+// Interface for renaming files created by an `OutputWriterProvider`, once
+// their writers are closed.
+using OutputFileRenamer =
+    absl::AnyInvocable<void(absl::string_view from, absl::string_view to)>;
+
+// Interface for removing files created by an `OutputWriterProvider`, once
+// their writers are closed.
+using OutputFileRemover = absl::AnyInvocable<void(absl::string_view file_name)>;
+
+// Output writers for a sample's files, and the operations on files they wrote.
+struct OutputFiles {
+  OutputWriterProvider provider;
+  OutputFileRenamer renamer;
+  OutputFileRemover remover;
+};
+
 }  // namespace media_api_samples
 
 #endif  // CPP_SAMPLES_OUTPUT_WRITER_INTERFACE_H_
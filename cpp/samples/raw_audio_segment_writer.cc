@@ -0,0 +1,48 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/raw_audio_segment_writer.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
+#include "meet_clients/samples/media_writing.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+void RawAudioSegmentWriter::WriteSamples(std::vector<int16_t> pcm16) {
+  WritePcm16(pcm16, *output_);
+}
+
+void RawAudioSegmentWriter::Close() { output_->Close(); }
+
+AudioSegmentFormat CreateRawAudioSegmentFormat() {
+  return {.file_extension = "pcm",
+          .create_writer = [](std::unique_ptr<OutputWriterInterface> output)
+              -> std::unique_ptr<AudioSegmentWriterInterface> {
+            return std::make_unique<RawAudioSegmentWriter>(std::move(output));
+          }};
+}
+
+}  // namespace media_api_samples
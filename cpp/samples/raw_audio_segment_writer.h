@@ -0,0 +1,50 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_RAW_AUDIO_SEGMENT_WRITER_H_
+#define CPP_SAMPLES_RAW_AUDIO_SEGMENT_WRITER_H_
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+class RawAudioSegmentWriter : public AudioSegmentWriterInterface {
+ public:
+  explicit RawAudioSegmentWriter(std::unique_ptr<OutputWriterInterface> output)
+      : output_(std::move(output)) {}
+
+  void WriteSamples(std::vector<int16_t> pcm16) override;
+  void Close() override;
+
+ private:
+  std::unique_ptr<OutputWriterInterface> output_;
+};
+
+AudioSegmentFormat CreateRawAudioSegmentFormat();
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_RAW_AUDIO_SEGMENT_WRITER_H_
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/raw_video_segment_writer.h"
+
+#include <memory>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/media_writing.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/video_segment_writer_interface.h"
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+void RawVideoSegmentWriter::WriteFrame(
+    webrtc::scoped_refptr<webrtc::I420BufferInterface> frame,
+    absl::Time received_time) {
+  WriteYuv420(*frame, *output_, scratch_);
+}
+
+void RawVideoSegmentWriter::Close() { output_->Close(); }
+
+VideoSegmentFormat CreateRawVideoSegmentFormat() {
+  return {.file_extension = "yuv",
+          .create_writer = [](std::unique_ptr<OutputWriterInterface> output,
+                              int width, int height)
+              -> std::unique_ptr<VideoSegmentWriterInterface> {
+            return std::make_unique<RawVideoSegmentWriter>(std::move(output));
+          }};
+}
+
+}  // namespace media_api_samples
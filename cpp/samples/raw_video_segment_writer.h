@@ -0,0 +1,57 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_RAW_VIDEO_SEGMENT_WRITER_H_
+#define CPP_SAMPLES_RAW_VIDEO_SEGMENT_WRITER_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/video_segment_writer_interface.h"
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// A video segment writer that writes uncompressed YUV420p frames back to back.
+class RawVideoSegmentWriter : public VideoSegmentWriterInterface {
+ public:
+  explicit RawVideoSegmentWriter(std::unique_ptr<OutputWriterInterface> output)
+      : output_(std::move(output)) {}
+
+  void WriteFrame(webrtc::scoped_refptr<webrtc::I420BufferInterface> frame,
+                  absl::Time received_time) override;
+  void Close() override;
+
+ private:
+  std::unique_ptr<OutputWriterInterface> output_;
+  // Reused to pack frames whose planes have row padding.
+  std::vector<char> scratch_;
+};
+
+// Returns the format that writes `.yuv` segments with `RawVideoSegmentWriter`.
+VideoSegmentFormat CreateRawVideoSegmentFormat();
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_RAW_VIDEO_SEGMENT_WRITER_H_
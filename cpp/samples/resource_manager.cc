@@ -29,50 +29,41 @@
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
-#include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "meet_clients/api/media_entries_resource.h"
 #include "meet_clients/api/participants_resource.h"
+#include "meet_clients/samples/binary_event_log.h"
+#include "meet_clients/samples/csv_event_log_writer.h"
+#include "meet_clients/samples/event_log_writer_interface.h"
+#include "meet_clients/samples/output_writer_interface.h"
 
 ABSL_POINTERS_DEFAULT_NONNULL
 namespace media_api_samples {
 namespace {
 
-constexpr absl::string_view kParticipantResourceUpdateFormat =
-    "time=%s,"
-    "event=updated participant resource,"
-    "display_name=%s,"
-    "participant_key=%s,"
-    "participant_id=%d\n";
-constexpr absl::string_view kParticipantResourceDeleteFormat =
-    "time=%s,"
-    "event=deleted participant resource,"
-    "participant_id=%d\n";
-constexpr absl::string_view kMediaEntryResourceUpdateFormat =
-    "time=%s,"
-    "event=updated media entry resource,"
-    "participant_session_name=%s,"
-    "participant_key=%s,"
-    "media_entry_id=%d,"
-    "audio_csrc=%d,"
-    // Because there may be multiple video contributing sources, they will be
-    // concatenated using `|` as a delimiter.
-    "video_csrcs=%s,"
-    "audio_muted=%d,"
-    "video_muted=%d\n";
-constexpr absl::string_view kMediaEntryResourceDeleteFormat =
-    "time=%s,"
-    "event=deleted media entry resource,"
-    "media_entry_id=%d\n";
-
 // The output file identifier is formatted as:
 //   <display_name>_<participant_key>_<participant_session_name>
 constexpr absl::string_view kOutputFileIdentifierFormat = "%s_%s_%s";
 
+std::unique_ptr<EventLogWriterInterface> CreateEventLogWriter(
+    std::unique_ptr<OutputWriterInterface> event_log_file,
+    EventLogFormat event_log_format) {
+  if (event_log_format == EventLogFormat::kBinary) {
+    return std::make_unique<BinaryEventLogWriter>(std::move(event_log_file));
+  }
+  return std::make_unique<CsvEventLogWriter>(std::move(event_log_file));
+}
+
 }  // namespace
 
+ResourceManager::ResourceManager(
+    std::unique_ptr<OutputWriterInterface> event_log_file,
+    EventLogFormat event_log_format)
+    : ResourceManager(
+          CreateEventLogWriter(std::move(event_log_file), event_log_format)) {}
+
 void ResourceManager::OnParticipantResourceUpdate(
     const meet::ParticipantsChannelToClient& update, absl::Time received_time) {
   for (const meet::ParticipantResourceSnapshot& resource : update.resources) {
@@ -109,11 +100,11 @@ void ResourceManager::OnParticipantResourceUpdate(
     auto participant = std::make_unique<Participant>(std::move(participant_key),
                                                      resource.id, display_name);
 
-    std::string event_log_message = absl::StrFormat(
-        kParticipantResourceUpdateFormat, absl::FormatTime(received_time),
-        participant->display_name, participant->participant_key,
-        participant->participant_id);
-    event_log_file_->Write(event_log_message.data(), event_log_message.size());
+    event_log_->Write({.type = EventLogEventType::kParticipantUpdated,
+                       .time = received_time,
+                       .resource_id = participant->participant_id,
+                       .display_name = participant->display_name,
+                       .participant_key = participant->participant_key});
 
     // Since these are resource "snapshots", they are intended to be complete
     // representations of the data. Therefore, existing data can be entirely
@@ -124,10 +115,9 @@ void ResourceManager::OnParticipantResourceUpdate(
 
   for (const meet::ParticipantDeletedResource& resource :
        update.deleted_resources) {
-    std::string event_log_message =
-        absl::StrFormat(kParticipantResourceDeleteFormat,
-                        absl::FormatTime(received_time), resource.id);
-    event_log_file_->Write(event_log_message.data(), event_log_message.size());
+    event_log_->Write({.type = EventLogEventType::kParticipantDeleted,
+                       .time = received_time,
+                       .resource_id = resource.id});
 
     auto node = participants_by_id_.extract(resource.id);
     if (node.empty()) {
@@ -142,6 +132,10 @@ void ResourceManager::OnParticipantResourceUpdate(
     // erased after the participant is removed from the other map.
     participants_by_key_.erase(removed_participant->participant_key);
   }
+
+  // Updates are rare, so their events are flushed at the end of each, and a
+  // crash only loses the events of the update in progress.
+  event_log_->Flush();
 }
 
 void ResourceManager::OnMediaEntriesResourceUpdate(
@@ -179,13 +173,16 @@ void ResourceManager::OnMediaEntriesResourceUpdate(
         resource.id, resource_media_entry.audio_csrc,
         std::move(resource_media_entry.video_csrcs));
 
-    std::string event_log_message = absl::StrFormat(
-        kMediaEntryResourceUpdateFormat, absl::FormatTime(received_time),
-        media_entry->participant_session_name, media_entry->participant_key,
-        media_entry->media_entry_id, media_entry->audio_csrc,
-        absl::StrJoin(media_entry->video_csrcs, "|"),
-        resource_media_entry.audio_muted, resource_media_entry.video_muted);
-    event_log_file_->Write(event_log_message.data(), event_log_message.size());
+    event_log_->Write(
+        {.type = EventLogEventType::kMediaEntryUpdated,
+         .time = received_time,
+         .resource_id = media_entry->media_entry_id,
+         .participant_key = media_entry->participant_key,
+         .participant_session_name = media_entry->participant_session_name,
+         .audio_csrc = media_entry->audio_csrc,
+         .video_csrcs = media_entry->video_csrcs,
+         .audio_muted = resource_media_entry.audio_muted,
+         .video_muted = resource_media_entry.video_muted});
 
     // Since these are resource "snapshots", they are intended to be complete
     // representations of the data. Therefore, existing data can be entirely
@@ -200,10 +197,9 @@ void ResourceManager::OnMediaEntriesResourceUpdate(
   }
 
   for (meet::MediaEntriesDeletedResource resource : update.deleted_resources) {
-    std::string event_log_message =
-        absl::StrFormat(kMediaEntryResourceDeleteFormat,
-                        absl::FormatTime(received_time), resource.id);
-    event_log_file_->Write(event_log_message.data(), event_log_message.size());
+    event_log_->Write({.type = EventLogEventType::kMediaEntryDeleted,
+                       .time = received_time,
+                       .resource_id = resource.id});
 
     auto node = media_entries_by_id_.extract(resource.id);
     if (node.empty()) {
@@ -223,6 +219,8 @@ void ResourceManager::OnMediaEntriesResourceUpdate(
     media_entries_by_session_name_.erase(
         removed_media_entry->participant_session_name);
   }
+
+  event_log_->Flush();
 }
 
 absl::StatusOr<std::string> ResourceManager::GetOutputFileIdentifier(
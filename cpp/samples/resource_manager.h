@@ -31,6 +31,7 @@
 #include "absl/time/time.h"
 #include "meet_clients/api/media_entries_resource.h"
 #include "meet_clients/api/participants_resource.h"
+#include "meet_clients/samples/event_log_writer_interface.h"
 #include "meet_clients/samples/output_writer_interface.h"
 #include "meet_clients/samples/resource_manager_interface.h"
 
@@ -46,9 +47,12 @@ namespace media_api_samples {
 // This class is not thread-safe.
 class ResourceManager : public ResourceManagerInterface {
  public:
+  // Writes events to `event_log_file`, encoded in `event_log_format`.
   explicit ResourceManager(
-      std::unique_ptr<OutputWriterInterface> event_log_file)
-      : event_log_file_(std::move(event_log_file)),
+      std::unique_ptr<OutputWriterInterface> event_log_file,
+      EventLogFormat event_log_format = EventLogFormat::kCsv);
+  explicit ResourceManager(std::unique_ptr<EventLogWriterInterface> event_log)
+      : event_log_(std::move(event_log)),
         participants_by_key_(),
         media_entries_by_session_name_(),
         media_entries_by_csrc_(),
@@ -116,7 +120,7 @@ class ResourceManager : public ResourceManagerInterface {
   absl::StatusOr<std::string> ParseParticipantSessionName(
       const std::optional<std::string>& participant_session_name) const;
 
-  std::unique_ptr<OutputWriterInterface> event_log_file_;
+  std::unique_ptr<EventLogWriterInterface> event_log_;
 
   // Participants and media entries are keyed by their unique identifiers.
   //
@@ -34,6 +34,8 @@
 #include "absl/time/time.h"
 #include "meet_clients/api/media_entries_resource.h"
 #include "meet_clients/api/participants_resource.h"
+#include "meet_clients/samples/binary_event_log.h"
+#include "meet_clients/samples/event_log_writer_interface.h"
 #include "meet_clients/samples/testing/mock_output_writer.h"
 
 ABSL_POINTERS_DEFAULT_NONNULL
@@ -933,5 +935,47 @@ TEST(ResourceManagerTest,
                        "Participant not found for CSRC: 111"));
 }
 
+TEST(ResourceManagerTest, BinaryEventLogHasEventsOfEachUpdateBeforeClose) {
+  auto event_writer = std::make_unique<MockOutputWriter>();
+  std::string log;
+  EXPECT_CALL(*event_writer, Write(_, _))
+      .WillRepeatedly([&](const char* data, size_t size) {
+        log.append(data, size);
+      });
+  ResourceManager resource_manager(std::move(event_writer),
+                                   EventLogFormat::kBinary);
+
+  resource_manager.OnParticipantResourceUpdate(
+      meet::ParticipantsChannelToClient{
+          .resources = {},
+          .deleted_resources = {meet::ParticipantDeletedResource{
+              .id = 123, .participant = true}},
+      },
+      absl::FromUnixSeconds(100));
+  resource_manager.OnMediaEntriesResourceUpdate(
+      meet::MediaEntriesChannelToClient{
+          .resources = {},
+          .deleted_resources = {meet::MediaEntriesDeletedResource{
+              .id = 234, .media_entry = true}},
+      },
+      absl::FromUnixSeconds(200));
+
+  // The log is read as if the sample had crashed in the middle of the
+  // conference, before the resource manager was destroyed.
+  absl::StatusOr<std::unique_ptr<BinaryEventLogReader>> reader =
+      BinaryEventLogReader::Create(log);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  EXPECT_FALSE((*reader)->complete());
+  EventLogEvent event;
+  ASSERT_TRUE((*reader)->Next(event));
+  EXPECT_EQ(event.type, EventLogEventType::kParticipantDeleted);
+  EXPECT_EQ(event.resource_id, 123);
+  ASSERT_TRUE((*reader)->Next(event));
+  EXPECT_EQ(event.type, EventLogEventType::kMediaEntryDeleted);
+  EXPECT_EQ(event.time, absl::FromUnixSeconds(200));
+  EXPECT_FALSE((*reader)->Next(event));
+  EXPECT_TRUE((*reader)->status().ok()) << (*reader)->status();
+}
+
 }  // namespace
 }  // namespace media_api_samples
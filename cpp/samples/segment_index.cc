@@ -0,0 +1,137 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/segment_index.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+constexpr absl::string_view kHeader("MSIX\x01\0\0\0", 8);
+constexpr int64_t kRecordSize = 32;
+
+void StoreLittleEndian(uint64_t value, int size, char* output) {
+  for (int i = 0; i < size; ++i) {
+    output[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+uint64_t LoadLittleEndian(const char* input, int size) {
+  uint64_t value = 0;
+  for (int i = 0; i < size; ++i) {
+    value |= uint64_t{static_cast<uint8_t>(input[i])} << (8 * i);
+  }
+  return value;
+}
+
+}  // namespace
+
+SegmentIndexWriter::SegmentIndexWriter(
+    std::unique_ptr<OutputWriterInterface> output)
+    : output_(std::move(output)) {
+  output_->Write(kHeader.data(), kHeader.size());
+}
+
+SegmentIndexWriter::~SegmentIndexWriter() { Close(); }
+
+void SegmentIndexWriter::AddFrame(int64_t size, absl::Time received_time,
+                                  uint32_t rtp_timestamp,
+                                  uint32_t contributing_source) {
+  if (output_ == nullptr) return;
+
+  std::array<char, kRecordSize> record;
+  StoreLittleEndian(next_byte_offset_, 8, &record[0]);
+  StoreLittleEndian(absl::ToUnixMicros(received_time), 8, &record[8]);
+  StoreLittleEndian(size, 4, &record[16]);
+  StoreLittleEndian(rtp_timestamp, 4, &record[20]);
+  StoreLittleEndian(contributing_source, 4, &record[24]);
+  StoreLittleEndian(frame_count_, 4, &record[28]);
+  output_->Write(record.data(), record.size());
+
+  ++frame_count_;
+  next_byte_offset_ += size;
+}
+
+void SegmentIndexWriter::Close() {
+  if (output_ == nullptr) return;
+  output_->Close();
+  output_ = nullptr;
+}
+
+absl::StatusOr<SegmentIndexReader> SegmentIndexReader::Create(
+    absl::string_view contents) {
+  if (!absl::ConsumePrefix(&contents, kHeader)) {
+    return absl::InvalidArgumentError("Not a segment index");
+  }
+  return SegmentIndexReader(contents);
+}
+
+int64_t SegmentIndexReader::frame_count() const {
+  return records_.size() / kRecordSize;
+}
+
+SegmentIndexEntry SegmentIndexReader::GetEntry(int64_t frame_number) const {
+  const char* record = records_.data() + frame_number * kRecordSize;
+  return {
+      .frame_number = static_cast<int64_t>(LoadLittleEndian(record + 28, 4)),
+      .byte_offset = static_cast<int64_t>(LoadLittleEndian(record, 8)),
+      .size = static_cast<int64_t>(LoadLittleEndian(record + 16, 4)),
+      .received_time = absl::FromUnixMicros(
+          static_cast<int64_t>(LoadLittleEndian(record + 8, 8))),
+      .rtp_timestamp = static_cast<uint32_t>(LoadLittleEndian(record + 20, 4)),
+      .contributing_source =
+          static_cast<uint32_t>(LoadLittleEndian(record + 24, 4))};
+}
+
+int64_t SegmentIndexReader::FindFrame(absl::Time time) const {
+  int64_t time_us = absl::ToUnixMicros(time);
+  int64_t low = 0;
+  int64_t high = frame_count();
+  while (low < high) {
+    int64_t middle = low + (high - low) / 2;
+    int64_t received_time_us = static_cast<int64_t>(LoadLittleEndian(
+        records_.data() + middle * kRecordSize + 8, 8));
+    if (received_time_us < time_us) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+std::string SegmentIndexFileName(absl::string_view segment_file_name) {
+  return absl::StrCat(segment_file_name, ".idx");
+}
+
+}  // namespace media_api_samples
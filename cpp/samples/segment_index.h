@@ -0,0 +1,108 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_SEGMENT_INDEX_H_
+#define CPP_SAMPLES_SEGMENT_INDEX_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/base/nullability.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// A sidecar index of the frames of a raw media segment, so that tools can seek
+// to a wall-clock time in O(log n) and extract clips without scanning the
+// segment, even when frames were dropped.
+//
+// The index is an 8-byte header, "MSIX" followed by a version byte and three
+// zero bytes, and one 32-byte little-endian record per frame, in frame order:
+//
+//   byte_offset:u64 received_time_us:i64 size:u32 rtp_timestamp:u32
+//   contributing_source:u32 frame_number:u32
+//
+// Since records have a fixed size, frame `n` is at offset `8 + 32 * n`, and a
+// record cut short by a crash is simply ignored.
+
+// The index record of a frame.
+struct SegmentIndexEntry {
+  int64_t frame_number = 0;
+  // Offset of the frame from the start of the segment file, and its size.
+  int64_t byte_offset = 0;
+  int64_t size = 0;
+  absl::Time received_time;
+  // The RTP timestamp of video frames. Audio frames are delivered without
+  // one, so this is zero for them.
+  uint32_t rtp_timestamp = 0;
+  uint32_t contributing_source = 0;
+};
+
+// Writes the index of a segment, as its frames are written.
+//
+// This class is not thread-safe.
+class SegmentIndexWriter {
+ public:
+  // Writes the index to `output`.
+  explicit SegmentIndexWriter(std::unique_ptr<OutputWriterInterface> output);
+  ~SegmentIndexWriter();
+
+  // Records a frame of `size` bytes, stored right after the previous frame.
+  void AddFrame(int64_t size, absl::Time received_time, uint32_t rtp_timestamp,
+                uint32_t contributing_source);
+  void Close();
+
+ private:
+  /*absl_nullable*/ std::unique_ptr<OutputWriterInterface> output_;
+  int64_t frame_count_ = 0;
+  int64_t next_byte_offset_ = 0;
+};
+
+// Reads the index of a segment without parsing it up front.
+class SegmentIndexReader {
+ public:
+  // Returns a reader of `contents`, which must outlive the reader. Fails if
+  // `contents` is not a segment index.
+  static absl::StatusOr<SegmentIndexReader> Create(absl::string_view contents);
+
+  int64_t frame_count() const;
+  // Returns the record of `frame_number`, which must be less than
+  // `frame_count()`.
+  SegmentIndexEntry GetEntry(int64_t frame_number) const;
+  // Returns the number of the first frame received at or after `time`, or
+  // `frame_count()` if there is none. Frames are received in order, so this is
+  // a binary search.
+  int64_t FindFrame(absl::Time time) const;
+
+ private:
+  explicit SegmentIndexReader(absl::string_view records) : records_(records) {}
+
+  absl::string_view records_;
+};
+
+// Returns the name of the index of the segment file `segment_file_name`.
+std::string SegmentIndexFileName(absl::string_view segment_file_name);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_SEGMENT_INDEX_H_
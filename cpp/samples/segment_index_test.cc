@@ -0,0 +1,108 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/segment_index.h"
+
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/testing/mock_output_writer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+using ::testing::_;
+
+std::unique_ptr<MockOutputWriter> CreateCapturingWriter(std::string& output) {
+  auto writer = std::make_unique<MockOutputWriter>();
+  EXPECT_CALL(*writer, Write(_, _))
+      .WillRepeatedly([&output](const char* content, std::streamsize size) {
+        output.append(content, size);
+      });
+  return writer;
+}
+
+// Writes an index of frames received every 100 ms, except that the frames at
+// 300 and 400 ms were dropped.
+std::string CreateTestIndex(absl::Time start) {
+  std::string index;
+  auto output = CreateCapturingWriter(index);
+  EXPECT_CALL(*output, Close());
+  SegmentIndexWriter writer(std::move(output));
+  for (int i : {0, 1, 2, 5, 6}) {
+    writer.AddFrame(/*size=*/240000, start + absl::Milliseconds(100 * i),
+                    /*rtp_timestamp=*/9000 * i, /*contributing_source=*/42);
+  }
+  writer.Close();
+  return index;
+}
+
+TEST(SegmentIndexTest, RecordsFrameOffsets) {
+  absl::Time start = absl::FromUnixMillis(1700000000123);
+  std::string index = CreateTestIndex(start);
+
+  absl::StatusOr<SegmentIndexReader> reader = SegmentIndexReader::Create(index);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  ASSERT_EQ(reader->frame_count(), 5);
+  SegmentIndexEntry entry = reader->GetEntry(3);
+  EXPECT_EQ(entry.frame_number, 3);
+  EXPECT_EQ(entry.byte_offset, 3 * 240000);
+  EXPECT_EQ(entry.size, 240000);
+  EXPECT_EQ(entry.received_time, start + absl::Milliseconds(500));
+  EXPECT_EQ(entry.rtp_timestamp, 45000);
+  EXPECT_EQ(entry.contributing_source, 42);
+}
+
+TEST(SegmentIndexTest, FindsFirstFrameAtOrAfterTime) {
+  absl::Time start = absl::FromUnixMillis(1700000000123);
+  std::string index = CreateTestIndex(start);
+
+  absl::StatusOr<SegmentIndexReader> reader = SegmentIndexReader::Create(index);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  EXPECT_EQ(reader->FindFrame(start - absl::Seconds(1)), 0);
+  EXPECT_EQ(reader->FindFrame(start + absl::Milliseconds(100)), 1);
+  // Seeking into the gap of dropped frames lands on the next frame.
+  EXPECT_EQ(reader->FindFrame(start + absl::Milliseconds(350)), 3);
+  EXPECT_EQ(reader->FindFrame(start + absl::Milliseconds(601)), 5);
+}
+
+TEST(SegmentIndexTest, IgnoresPartialRecord) {
+  std::string index = CreateTestIndex(absl::UnixEpoch());
+  index.resize(index.size() - 5);
+
+  absl::StatusOr<SegmentIndexReader> reader = SegmentIndexReader::Create(index);
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  EXPECT_EQ(reader->frame_count(), 4);
+}
+
+TEST(SegmentIndexTest, RejectsOtherFiles) {
+  EXPECT_EQ(SegmentIndexReader::Create("not an index").status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace media_api_samples
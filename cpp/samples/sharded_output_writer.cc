@@ -0,0 +1,396 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/sharded_output_writer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "rtc_base/thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+// Weight of the latest write in each device's throughput average.
+constexpr double kThroughputSmoothing = 0.2;
+// Throughput assumed for devices that have not completed a write yet, in bytes
+// per second.
+constexpr double kUnmeasuredThroughput = 100e6;
+
+// A hash that is stable across processes, so that files are placed on the same
+// devices when the sample is restarted.
+uint64_t StableHash(absl::string_view data) {
+  // FNV-1a.
+  uint64_t hash = 0xcbf29ce484222325;
+  for (char c : data) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3;
+  }
+  // FNV-1a mixes its last bytes poorly, and ring points only differ in their
+  // last bytes, so finish with the MurmurHash3 finalizer.
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccd;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+absl::string_view BaseName(absl::string_view file_name) {
+  size_t slash = file_name.rfind('/');
+  return slash == absl::string_view::npos ? file_name
+                                          : file_name.substr(slash + 1);
+}
+
+// Returns the identifier of the stream in a segment file's base name, i.e.
+// what is between the media type and the `_tmp` token, or the whole base name
+// if it is not named like a segment file.
+absl::string_view PlacementKey(absl::string_view base_name) {
+  size_t tmp = base_name.rfind("_tmp");
+  if (tmp == absl::string_view::npos) return base_name;
+  absl::string_view key = base_name.substr(0, tmp);
+  // The earliest media type ends the prefix, since the identifier may contain
+  // any text.
+  size_t media_type_start = absl::string_view::npos;
+  size_t media_type_size = 0;
+  for (absl::string_view media_type : {"audio_", "video_", "media_"}) {
+    size_t pos = key.find(media_type);
+    if (pos < media_type_start) {
+      media_type_start = pos;
+      media_type_size = media_type.size();
+    }
+  }
+  if (media_type_start == absl::string_view::npos) return base_name;
+  return key.substr(media_type_start + media_type_size);
+}
+
+}  // namespace
+
+absl::StatusOr<std::shared_ptr<ShardedOutputWriterPool>>
+ShardedOutputWriterPool::Create(Options options,
+                                OutputWriterProvider provider,
+                                OutputFileRenamer renamer,
+                                OutputFileRemover remover) {
+  if (options.directories.empty()) {
+    return absl::InvalidArgumentError("No output directories");
+  }
+  if (options.virtual_nodes <= 0 || options.max_queued_bytes == 0 ||
+      options.chunk_size == 0) {
+    return absl::InvalidArgumentError(
+        "Virtual nodes, max queued bytes, and chunk size must be positive");
+  }
+
+  std::vector<Device> devices;
+  for (size_t i = 0; i < options.directories.size(); ++i) {
+    std::unique_ptr<webrtc::Thread> thread = webrtc::Thread::Create();
+    thread->SetName(absl::StrCat("output_device_thread_", i), nullptr);
+    if (!thread->Start()) {
+      return absl::InternalError("Failed to start output device thread");
+    }
+    devices.push_back(
+        {.directory = std::string(
+             absl::StripSuffix(options.directories[i], "/")),
+         .thread = std::move(thread)});
+  }
+  return absl::WrapUnique(new ShardedOutputWriterPool(
+      std::move(options), std::move(provider), std::move(renamer),
+      std::move(remover), std::move(devices)));
+}
+
+ShardedOutputWriterPool::ShardedOutputWriterPool(Options options,
+                                                 OutputWriterProvider provider,
+                                                 OutputFileRenamer renamer,
+                                                 OutputFileRemover remover,
+                                                 std::vector<Device> devices)
+    : options_(std::move(options)),
+      devices_(std::move(devices)),
+      provider_(std::move(provider)),
+      renamer_(std::move(renamer)),
+      remover_(std::move(remover)) {
+  for (size_t device = 0; device < devices_.size(); ++device) {
+    for (int i = 0; i < options_.virtual_nodes; ++i) {
+      ring_.emplace_back(
+          StableHash(absl::StrCat(devices_[device].directory, "#", i)),
+          static_cast<int>(device));
+    }
+    stats_.push_back({.directory = devices_[device].directory});
+  }
+  std::sort(ring_.begin(), ring_.end());
+}
+
+ShardedOutputWriterPool::~ShardedOutputWriterPool() {
+  for (Device& device : devices_) {
+    // Let the thread finish its queued writes and renames before stopping it.
+    device.thread->BlockingCall([] {});
+    device.thread->Stop();
+  }
+  for (const DeviceStats& stats : GetStats()) {
+    LOG(INFO) << "Wrote " << stats.written_bytes << " bytes in "
+              << stats.opened_files << " files to " << stats.directory
+              << " in " << stats.write_time << "; recent throughput "
+              << stats.throughput / 1e6 << " MB/s; waited for the device "
+              << stats.queue_waits << " times";
+  }
+}
+
+std::unique_ptr<OutputWriterInterface> ShardedOutputWriterPool::CreateWriter(
+    absl::string_view file_name) {
+  int device = PlaceFile(PlacementKey(BaseName(file_name)));
+  {
+    absl::MutexLock lock(&mutex_);
+    file_devices_[std::string(file_name)] = device;
+    stats_[device].opened_files++;
+  }
+  auto file = std::make_shared<DeviceFile>();
+  devices_[device].thread->PostTask(
+      [this, file, path = DevicePath(device, file_name)] {
+        absl::MutexLock lock(&provider_mutex_);
+        file->output = provider_(path);
+      });
+  return std::make_unique<ShardedOutputWriter>(shared_from_this(), device,
+                                               std::move(file));
+}
+
+void ShardedOutputWriterPool::Rename(absl::string_view from,
+                                     absl::string_view to) {
+  int device = ForgetFile(from);
+  if (device < 0) {
+    absl::MutexLock lock(&provider_mutex_);
+    renamer_(from, to);
+    return;
+  }
+  // The file's writes and close are queued on the same thread, so the rename
+  // runs once they are done.
+  devices_[device].thread->PostTask(
+      [this, from = DevicePath(device, from), to = DevicePath(device, to)] {
+        absl::MutexLock lock(&provider_mutex_);
+        renamer_(from, to);
+      });
+}
+
+void ShardedOutputWriterPool::Remove(absl::string_view file_name) {
+  int device = ForgetFile(file_name);
+  if (device < 0) {
+    absl::MutexLock lock(&provider_mutex_);
+    remover_(file_name);
+    return;
+  }
+  devices_[device].thread->PostTask(
+      [this, path = DevicePath(device, file_name)] {
+        absl::MutexLock lock(&provider_mutex_);
+        remover_(path);
+      });
+}
+
+std::vector<ShardedOutputWriterPool::DeviceStats>
+ShardedOutputWriterPool::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+int ShardedOutputWriterPool::PlaceFile(absl::string_view key) {
+  // Devices in the order in which they follow the file on the ring.
+  std::vector<int> candidates;
+  std::vector<bool> is_candidate(devices_.size(), false);
+  size_t start =
+      std::lower_bound(ring_.begin(), ring_.end(),
+                       std::make_pair(StableHash(key), 0)) -
+      ring_.begin();
+  for (size_t i = 0;
+       i < ring_.size() && candidates.size() < devices_.size(); ++i) {
+    int device = ring_[(start + i) % ring_.size()].second;
+    if (!is_candidate[device]) {
+      is_candidate[device] = true;
+      candidates.push_back(device);
+    }
+  }
+
+  absl::MutexLock lock(&mutex_);
+  std::vector<absl::Duration> backlogs;
+  for (const DeviceStats& stats : stats_) {
+    double throughput =
+        stats.throughput > 0 ? stats.throughput : kUnmeasuredThroughput;
+    backlogs.push_back(absl::Seconds(stats.queued_bytes / throughput));
+  }
+  absl::Duration min_backlog =
+      *std::min_element(backlogs.begin(), backlogs.end());
+  for (int device : candidates) {
+    if (backlogs[device] <= min_backlog + options_.max_backlog_imbalance) {
+      return device;
+    }
+  }
+  // Unreachable, since the least loaded device is always a candidate.
+  return candidates.front();
+}
+
+std::string ShardedOutputWriterPool::DevicePath(
+    int device, absl::string_view file_name) const {
+  return absl::StrCat(devices_[device].directory, "/", BaseName(file_name));
+}
+
+void ShardedOutputWriterPool::QueueWrite(int device,
+                                         std::shared_ptr<DeviceFile> file,
+                                         std::vector<char> data) {
+  int64_t size = data.size();
+  {
+    absl::MutexLock lock(&mutex_);
+    DeviceStats& stats = stats_[device];
+    // A chunk larger than the limit is let through once the queue is empty.
+    auto has_room = [&stats, size, this] {
+      return stats.queued_bytes == 0 ||
+             static_cast<size_t>(stats.queued_bytes + size) <=
+                 options_.max_queued_bytes;
+    };
+    if (!has_room()) {
+      stats.queue_waits++;
+      mutex_.Await(absl::Condition(&has_room));
+    }
+    stats.queued_bytes += size;
+  }
+  devices_[device].thread->PostTask(
+      [this, device, file = std::move(file), data = std::move(data)] {
+        absl::Time start = absl::Now();
+        file->output->Write(data.data(), data.size());
+        RecordWrite(device, data.size(), absl::Now() - start);
+      });
+}
+
+void ShardedOutputWriterPool::CloseFile(int device,
+                                        std::shared_ptr<DeviceFile> file) {
+  devices_[device].thread->PostTask([file = std::move(file)] {
+    file->output->Close();
+    file->output = nullptr;
+  });
+}
+
+void ShardedOutputWriterPool::RecordWrite(int device, int64_t size,
+                                          absl::Duration write_time) {
+  absl::MutexLock lock(&mutex_);
+  DeviceStats& stats = stats_[device];
+  stats.queued_bytes -= size;
+  stats.written_bytes += size;
+  stats.write_time += write_time;
+  if (write_time <= absl::ZeroDuration()) {
+    return;
+  }
+  double throughput = size / absl::ToDoubleSeconds(write_time);
+  stats.throughput =
+      stats.throughput == 0
+          ? throughput
+          : stats.throughput +
+                kThroughputSmoothing * (throughput - stats.throughput);
+}
+
+int ShardedOutputWriterPool::ForgetFile(absl::string_view file_name) {
+  absl::MutexLock lock(&mutex_);
+  auto it = file_devices_.find(file_name);
+  if (it == file_devices_.end()) {
+    return -1;
+  }
+  int device = it->second;
+  file_devices_.erase(it);
+  return device;
+}
+
+ShardedOutputWriter::~ShardedOutputWriter() { Close(); }
+
+void ShardedOutputWriter::Write(const char* content, std::streamsize size) {
+  if (file_ == nullptr) {
+    return;
+  }
+  chunk_.insert(chunk_.end(), content, content + size);
+  if (chunk_.size() >= pool_->options_.chunk_size) {
+    SubmitChunk();
+  }
+}
+
+void ShardedOutputWriter::WriteChunks(
+    absl::Span<const absl::Span<const char>> chunks) {
+  if (file_ == nullptr) {
+    return;
+  }
+  for (absl::Span<const char> chunk : chunks) {
+    chunk_.insert(chunk_.end(), chunk.begin(), chunk.end());
+  }
+  if (chunk_.size() >= pool_->options_.chunk_size) {
+    SubmitChunk();
+  }
+}
+
+void ShardedOutputWriter::Close() {
+  if (file_ == nullptr) {
+    return;
+  }
+  SubmitChunk();
+  pool_->CloseFile(device_, std::move(file_));
+  file_ = nullptr;
+}
+
+void ShardedOutputWriter::SubmitChunk() {
+  if (chunk_.empty()) {
+    return;
+  }
+  std::vector<char> data;
+  data.reserve(pool_->options_.chunk_size);
+  data.swap(chunk_);
+  pool_->QueueWrite(device_, file_, std::move(data));
+}
+
+OutputWriterProvider CreateShardedOutputWriterProvider(
+    std::shared_ptr<ShardedOutputWriterPool> pool) {
+  return [pool = std::move(pool)](absl::string_view file_name) {
+    return pool->CreateWriter(file_name);
+  };
+}
+
+OutputFileRenamer CreateShardedOutputFileRenamer(
+    std::shared_ptr<ShardedOutputWriterPool> pool) {
+  return [pool = std::move(pool)](absl::string_view from,
+                                  absl::string_view to) {
+    pool->Rename(from, to);
+  };
+}
+
+OutputFileRemover CreateShardedOutputFileRemover(
+    std::shared_ptr<ShardedOutputWriterPool> pool) {
+  return [pool = std::move(pool)](absl::string_view file_name) {
+    pool->Remove(file_name);
+  };
+}
+
+}  // namespace media_api_samples
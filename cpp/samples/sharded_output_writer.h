@@ -0,0 +1,220 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_SHARDED_OUTPUT_WRITER_H_
+#define CPP_SAMPLES_SHARDED_OUTPUT_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_file.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "rtc_base/thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Spreads output files across several directories, typically each on its own
+// storage device, with one I/O thread per directory.
+//
+// Files are placed by consistent hashing of their stream's identifier, so a
+// participant's segments keep landing on the same device and adding a device
+// only moves a share of them. For segment files named like the collectors'
+// `<prefix><media type>_<identifier>_tmp<suffix>`, this is `<identifier>`,
+// which the audio, video, and rotated parts of a stream share. Other files are
+// placed by their whole base name. If the preferred device has fallen behind,
+// i.e.
+// its queued data would take `max_backlog_imbalance` longer to write than the
+// least loaded device's at the throughput each has recently achieved, the file
+// goes to the next device on the hash ring instead.
+//
+// A file named `<anything>/<base name>` is written to
+// `<directory>/<base name>`. Since placement depends on load, files must be
+// renamed through `Rename`, which knows where each file went.
+//
+// Writers copy data and hand it to their device's I/O thread, which writes it
+// through the writer that the wrapped provider creates for the file. Writers
+// only block once `max_queued_bytes` are waiting on their device.
+//
+// This class is thread-safe.
+class ShardedOutputWriterPool
+    : public std::enable_shared_from_this<ShardedOutputWriterPool> {
+ public:
+  struct Options {
+    std::vector<std::string> directories;
+    // Points per directory on the hash ring. More points even out the share
+    // of files each directory receives.
+    int virtual_nodes = 64;
+    // How much longer the preferred device may take to write its queued data
+    // than the least loaded device before files are placed elsewhere.
+    absl::Duration max_backlog_imbalance = absl::Milliseconds(250);
+    // Bytes queued for a single device before its writers block.
+    size_t max_queued_bytes = 64 << 20;
+    // Writes are collected into chunks of this size before being handed to
+    // the I/O thread.
+    size_t chunk_size = 256 << 10;
+  };
+
+  struct DeviceStats {
+    std::string directory;
+    int64_t opened_files = 0;
+    int64_t written_bytes = 0;
+    // Time the device's I/O thread spent writing.
+    absl::Duration write_time;
+    // Moving average of write throughput, in bytes per second. Zero until the
+    // first write has been timed.
+    double throughput = 0;
+    // Bytes handed to the I/O thread but not written yet.
+    int64_t queued_bytes = 0;
+    // Number of times a writer waited for the device to catch up.
+    int64_t queue_waits = 0;
+  };
+
+  // Creates a pool writing through the writers that `provider` creates, and
+  // finalizing their files with `renamer` and `remover`.
+  static absl::StatusOr<std::shared_ptr<ShardedOutputWriterPool>> Create(
+      Options options, OutputWriterProvider provider,
+      OutputFileRenamer renamer = RenameOutputFile,
+      OutputFileRemover remover = RemoveOutputFile);
+
+  // Waits for all queued writes and renames to complete.
+  ~ShardedOutputWriterPool();
+
+  // Places `file_name` on a device and returns a writer for it. The file is
+  // opened on the device's I/O thread.
+  std::unique_ptr<OutputWriterInterface> CreateWriter(
+      absl::string_view file_name);
+
+  // Renames a file created by this pool on the device holding it, once all of
+  // its queued writes are done. `to` must share `from`'s directory. Files that
+  // were not created by the pool are renamed in place.
+  void Rename(absl::string_view from, absl::string_view to);
+  // Removes a file created by this pool once all of its queued writes are
+  // done. Files that were not created by the pool are removed in place.
+  void Remove(absl::string_view file_name);
+
+  // Returns the stats of each device, in the order of `Options::directories`.
+  std::vector<DeviceStats> GetStats() const;
+
+ private:
+  friend class ShardedOutputWriter;
+
+  struct Device {
+    std::string directory;
+    std::unique_ptr<webrtc::Thread> thread;
+  };
+
+  // State of an open file, only accessed on its device's I/O thread.
+  struct DeviceFile {
+    /*absl_nullable*/ std::unique_ptr<OutputWriterInterface> output;
+  };
+
+  ShardedOutputWriterPool(Options options, OutputWriterProvider provider,
+                          OutputFileRenamer renamer, OutputFileRemover remover,
+                          std::vector<Device> devices);
+
+  // Returns the device that files with the placement key `key` should be
+  // written to.
+  int PlaceFile(absl::string_view key);
+  // Returns the path of `file_name` on `device`.
+  std::string DevicePath(int device, absl::string_view file_name) const;
+  // Hands `data` to `device`'s I/O thread, waiting for its queue to drain if
+  // necessary.
+  void QueueWrite(int device, std::shared_ptr<DeviceFile> file,
+                  std::vector<char> data);
+  void CloseFile(int device, std::shared_ptr<DeviceFile> file);
+  void RecordWrite(int device, int64_t size, absl::Duration write_time);
+  // Removes `file_name` from `file_devices_`, returning its device or -1 if
+  // the pool did not create it.
+  int ForgetFile(absl::string_view file_name);
+
+  const Options options_;
+  std::vector<Device> devices_;
+  // Hash ring of (point, device index), sorted by point.
+  std::vector<std::pair<uint64_t, int>> ring_;
+
+  // Providers, renamers, and removers are not required to be thread-safe, and
+  // are called from every I/O thread.
+  absl::Mutex provider_mutex_;
+  OutputWriterProvider provider_ ABSL_GUARDED_BY(provider_mutex_);
+  OutputFileRenamer renamer_ ABSL_GUARDED_BY(provider_mutex_);
+  OutputFileRemover remover_ ABSL_GUARDED_BY(provider_mutex_);
+
+  mutable absl::Mutex mutex_;
+  std::vector<DeviceStats> stats_ ABSL_GUARDED_BY(mutex_);
+  // The device that each file created by the pool, and not renamed yet, was
+  // placed on.
+  absl::flat_hash_map<std::string, int> file_devices_ ABSL_GUARDED_BY(mutex_);
+};
+
+// An output writer that collects data into chunks and hands them to a device
+// thread of a `ShardedOutputWriterPool`.
+//
+// This class is not thread-safe.
+class ShardedOutputWriter : public OutputWriterInterface {
+ public:
+  ShardedOutputWriter(std::shared_ptr<ShardedOutputWriterPool> pool,
+                      int device,
+                      std::shared_ptr<ShardedOutputWriterPool::DeviceFile> file)
+      : pool_(std::move(pool)), device_(device), file_(std::move(file)) {}
+  ~ShardedOutputWriter() override;
+
+  void Write(const char* content, std::streamsize size) override;
+  void WriteChunks(absl::Span<const absl::Span<const char>> chunks) override;
+  // Hands any collected data to the device thread. This does not wait for the
+  // data to be written; the file may be renamed through the pool immediately
+  // afterwards.
+  void Close() override;
+
+ private:
+  void SubmitChunk();
+
+  std::shared_ptr<ShardedOutputWriterPool> pool_;
+  const int device_;
+  /*absl_nullable*/ std::shared_ptr<ShardedOutputWriterPool::DeviceFile> file_;
+  std::vector<char> chunk_;
+};
+
+// Returns a provider that creates writers from `pool`.
+OutputWriterProvider CreateShardedOutputWriterProvider(
+    std::shared_ptr<ShardedOutputWriterPool> pool);
+
+// Returns a renamer for files created by `pool`.
+OutputFileRenamer CreateShardedOutputFileRenamer(
+    std::shared_ptr<ShardedOutputWriterPool> pool);
+
+// Returns a remover for files created by `pool`.
+OutputFileRemover CreateShardedOutputFileRemover(
+    std::shared_ptr<ShardedOutputWriterPool> pool);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_SHARDED_OUTPUT_WRITER_H_
@@ -0,0 +1,313 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/sharded_output_writer.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_file.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::UnorderedElementsAre;
+
+std::string ReadFile(const std::string& file_name) {
+  std::ifstream file(file_name, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+bool FileExists(const std::string& file_name) {
+  return access(file_name.c_str(), F_OK) == 0;
+}
+
+// Creates `count` empty directories for the test.
+std::vector<std::string> CreateDirectories(absl::string_view name, int count) {
+  std::vector<std::string> directories;
+  for (int i = 0; i < count; ++i) {
+    std::string directory =
+        absl::StrCat(::testing::TempDir(), "sharded_", name, "_", i);
+    mkdir(directory.c_str(), 0755);
+    directories.push_back(std::move(directory));
+  }
+  return directories;
+}
+
+// Returns the directories among `directories` that contain `base_name`.
+std::vector<std::string> FindFile(const std::vector<std::string>& directories,
+                                  absl::string_view base_name) {
+  std::vector<std::string> found;
+  for (const std::string& directory : directories) {
+    if (FileExists(absl::StrCat(directory, "/", base_name))) {
+      found.push_back(directory);
+    }
+  }
+  return found;
+}
+
+// Writer that can be held up until `Release` is called, to simulate a slow
+// device.
+class FakeOutputWriter : public OutputWriterInterface {
+ public:
+  explicit FakeOutputWriter(absl::Notification* /*absl_nullable*/ release)
+      : release_(release) {}
+
+  void Write(const char* content, std::streamsize size) override {
+    if (release_ != nullptr) {
+      release_->WaitForNotification();
+    }
+  }
+  void Close() override {}
+
+ private:
+  absl::Notification* /*absl_nullable*/ release_;
+};
+
+// Provider that records the paths it opens. Writers block until `release` is
+// notified while `hold_writes` is set.
+struct FakeProvider {
+  OutputWriterProvider Get() {
+    return [this](absl::string_view file_name) {
+      absl::MutexLock lock(&mutex);
+      opened_paths.push_back(std::string(file_name));
+      return std::make_unique<FakeOutputWriter>(hold_writes ? &release
+                                                            : nullptr);
+    };
+  }
+
+  std::vector<std::string> GetOpenedPaths() {
+    absl::MutexLock lock(&mutex);
+    return opened_paths;
+  }
+
+  absl::Mutex mutex;
+  std::vector<std::string> opened_paths ABSL_GUARDED_BY(mutex);
+  bool hold_writes ABSL_GUARDED_BY(mutex) = false;
+  absl::Notification release;
+};
+
+TEST(ShardedOutputWriterTest, SpreadsFilesAcrossDirectories) {
+  std::vector<std::string> directories = CreateDirectories("spread", 3);
+  absl::StatusOr<std::shared_ptr<ShardedOutputWriterPool>> pool =
+      ShardedOutputWriterPool::Create({.directories = directories},
+                                      CreateOutputFileProvider());
+  ASSERT_TRUE(pool.ok());
+
+  for (int i = 0; i < 30; ++i) {
+    std::unique_ptr<OutputWriterInterface> writer = (*pool)->CreateWriter(
+        absl::StrCat("/unused/prefix_audio_", i, "_tmp.pcm"));
+    std::string data = absl::StrCat("segment ", i);
+    writer->Write(data.data(), data.size());
+    writer->Close();
+  }
+  std::vector<ShardedOutputWriterPool::DeviceStats> stats =
+      (*pool)->GetStats();
+  pool->reset();
+
+  for (int i = 0; i < 30; ++i) {
+    std::string base_name = absl::StrCat("prefix_audio_", i, "_tmp.pcm");
+    std::vector<std::string> found = FindFile(directories, base_name);
+    ASSERT_EQ(found.size(), 1) << base_name;
+    EXPECT_EQ(ReadFile(absl::StrCat(found[0], "/", base_name)),
+              absl::StrCat("segment ", i));
+  }
+  int64_t opened_files = 0;
+  for (const ShardedOutputWriterPool::DeviceStats& device_stats : stats) {
+    EXPECT_GT(device_stats.opened_files, 0) << device_stats.directory;
+    opened_files += device_stats.opened_files;
+  }
+  EXPECT_EQ(opened_files, 30);
+}
+
+TEST(ShardedOutputWriterTest, PlacesFilesConsistentlyWhenIdle) {
+  std::vector<std::string> directories = {"/device0", "/device1", "/device2"};
+  FakeProvider first_provider;
+  FakeProvider second_provider;
+  {
+    absl::StatusOr<std::shared_ptr<ShardedOutputWriterPool>> first_pool =
+        ShardedOutputWriterPool::Create({.directories = directories},
+                                        first_provider.Get());
+    absl::StatusOr<std::shared_ptr<ShardedOutputWriterPool>> second_pool =
+        ShardedOutputWriterPool::Create({.directories = directories},
+                                        second_provider.Get());
+    ASSERT_TRUE(first_pool.ok());
+    ASSERT_TRUE(second_pool.ok());
+    for (int i = 0; i < 10; ++i) {
+      std::string file_name = absl::StrCat("/out/video_", i, "_tmp.yuv");
+      (*first_pool)->CreateWriter(file_name)->Close();
+      (*second_pool)->CreateWriter(file_name)->Close();
+    }
+  }
+
+  // Each pool opens files in order on each device, but devices' threads run
+  // independently, so compare the set of paths.
+  std::vector<std::string> first_paths = first_provider.GetOpenedPaths();
+  std::vector<std::string> second_paths = second_provider.GetOpenedPaths();
+  std::sort(first_paths.begin(), first_paths.end());
+  std::sort(second_paths.begin(), second_paths.end());
+  EXPECT_EQ(first_paths, second_paths);
+}
+
+TEST(ShardedOutputWriterTest, PlacesFilesOfStreamTogetherWhenIdle) {
+  std::vector<std::string> directories = {"/device0", "/device1", "/device2"};
+  FakeProvider provider;
+  {
+    absl::StatusOr<std::shared_ptr<ShardedOutputWriterPool>> pool =
+        ShardedOutputWriterPool::Create({.directories = directories},
+                                        provider.Get());
+    ASSERT_TRUE(pool.ok());
+    for (int i = 0; i < 10; ++i) {
+      std::string identifier = absl::StrCat("Name ", i, "_key_session");
+      for (std::string file_name :
+           {absl::StrCat("/out/prefix_audio_", identifier, "_tmp.pcm"),
+            absl::StrCat("/out/prefix_video_", identifier, "_tmp_640x360.yuv"),
+            absl::StrCat("/out/prefix_video_", identifier, "_tmp1_320x180.yuv"),
+            absl::StrCat("/out/prefix_media_", identifier, "_tmp2.webm")}) {
+        (*pool)->CreateWriter(file_name)->Close();
+      }
+    }
+  }
+
+  std::vector<std::string> paths = provider.GetOpenedPaths();
+  ASSERT_EQ(paths.size(), 40);
+  std::vector<std::string> used_directories;
+  for (int i = 0; i < 10; ++i) {
+    std::string identifier = absl::StrCat("_Name ", i, "_key_session_tmp");
+    std::vector<std::string> stream_directories;
+    for (const std::string& path : paths) {
+      if (absl::StrContains(path, identifier)) {
+        stream_directories.push_back(path.substr(0, path.find('/', 1)));
+      }
+    }
+    ASSERT_EQ(stream_directories.size(), 4) << identifier;
+    EXPECT_THAT(stream_directories,
+                ::testing::Each(stream_directories.front()))
+        << identifier;
+    used_directories.push_back(stream_directories.front());
+  }
+  // Streams are still spread across devices.
+  std::sort(used_directories.begin(), used_directories.end());
+  EXPECT_GT(std::unique(used_directories.begin(), used_directories.end()) -
+                used_directories.begin(),
+            1);
+}
+
+TEST(ShardedOutputWriterTest, RenamesOnDeviceHoldingFile) {
+  std::vector<std::string> directories = CreateDirectories("rename", 2);
+  absl::StatusOr<std::shared_ptr<ShardedOutputWriterPool>> pool =
+      ShardedOutputWriterPool::Create({.directories = directories},
+                                      CreateOutputFileProvider());
+  ASSERT_TRUE(pool.ok());
+  OutputFileRenamer renamer = CreateShardedOutputFileRenamer(*pool);
+
+  std::unique_ptr<OutputWriterInterface> writer =
+      (*pool)->CreateWriter("/unused/audio_1_tmp.pcm");
+  writer->Write("data", 4);
+  // The rename is queued behind the writer's data, so it may be issued
+  // immediately after closing.
+  writer->Close();
+  renamer("/unused/audio_1_tmp.pcm", "/unused/audio_1_start_end.pcm");
+  writer.reset();
+  pool->reset();
+  renamer = nullptr;
+
+  EXPECT_THAT(FindFile(directories, "audio_1_tmp.pcm"), ElementsAre());
+  std::vector<std::string> found =
+      FindFile(directories, "audio_1_start_end.pcm");
+  ASSERT_EQ(found.size(), 1);
+  EXPECT_EQ(ReadFile(absl::StrCat(found[0], "/audio_1_start_end.pcm")),
+            "data");
+}
+
+TEST(ShardedOutputWriterTest, AvoidsDeviceThatFellBehind) {
+  FakeProvider provider;
+  absl::StatusOr<std::shared_ptr<ShardedOutputWriterPool>> pool =
+      ShardedOutputWriterPool::Create(
+          {.directories = {"/device0", "/device1"},
+           .max_backlog_imbalance = absl::ZeroDuration(),
+           .chunk_size = 1},
+          provider.Get());
+  ASSERT_TRUE(pool.ok());
+
+  // Find the preferred device, then stall it.
+  (*pool)->CreateWriter("/out/media_1_tmp.webm")->Close();
+  int preferred_device =
+      (*pool)->GetStats()[0].opened_files == 1 ? 0 : 1;
+  {
+    absl::MutexLock lock(&provider.mutex);
+    provider.hold_writes = true;
+  }
+  std::unique_ptr<OutputWriterInterface> stalled_writer =
+      (*pool)->CreateWriter("/out/media_1_tmp.webm");
+  stalled_writer->Write("data", 4);
+
+  // The same name now goes to the other device.
+  (*pool)->CreateWriter("/out/media_1_tmp.webm")->Close();
+  std::vector<ShardedOutputWriterPool::DeviceStats> stats =
+      (*pool)->GetStats();
+  EXPECT_EQ(stats[preferred_device].opened_files, 2);
+  EXPECT_EQ(stats[1 - preferred_device].opened_files, 1);
+  EXPECT_EQ(stats[preferred_device].queued_bytes, 4);
+
+  provider.release.Notify();
+  stalled_writer.reset();
+  pool->reset();
+  std::string preferred_path =
+      absl::StrCat("/device", preferred_device, "/media_1_tmp.webm");
+  std::string other_path =
+      absl::StrCat("/device", 1 - preferred_device, "/media_1_tmp.webm");
+  EXPECT_THAT(provider.GetOpenedPaths(),
+              UnorderedElementsAre(preferred_path, preferred_path, other_path));
+}
+
+TEST(ShardedOutputWriterTest, FailsWithoutDirectories) {
+  EXPECT_EQ(ShardedOutputWriterPool::Create({}, CreateOutputFileProvider())
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace media_api_samples
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/shared_memory_media_publisher.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/api/media_api_client_interface.h"
+#include "meet_clients/samples/shared_memory_ring_layout.h"
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+// Appends a span for each row of a plane to `chunks`, or a single span if the
+// plane has no row padding.
+void AppendPlane(const uint8_t* plane, int stride, int width, int height,
+                 std::vector<absl::Span<const uint8_t>>& chunks) {
+  if (stride == width) {
+    chunks.push_back(absl::MakeConstSpan(plane, width * height));
+    return;
+  }
+  for (int i = 0; i < height; ++i) {
+    chunks.push_back(absl::MakeConstSpan(plane + i * stride, width));
+  }
+}
+
+}  // namespace
+
+void SharedMemoryMediaPublisher::OnAudioFrame(meet::AudioFrame frame) {
+  absl::Span<const uint8_t> chunks[] = {absl::MakeConstSpan(
+      reinterpret_cast<const uint8_t*>(frame.pcm16.data()),
+      frame.pcm16.size() * sizeof(int16_t))};
+  ring_->Write(
+      {.type = SharedMemoryFrameType::kAudio,
+       .received_time_us = absl::ToUnixMicros(absl::Now()),
+       .contributing_source = frame.contributing_source,
+       .sample_rate = static_cast<uint32_t>(frame.sample_rate),
+       .number_of_channels = static_cast<uint32_t>(frame.number_of_channels)},
+      chunks);
+  observer_->OnAudioFrame(std::move(frame));
+}
+
+void SharedMemoryMediaPublisher::OnVideoFrame(meet::VideoFrame frame) {
+  int64_t received_time_us = absl::ToUnixMicros(absl::Now());
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> i420 =
+      frame.frame.video_frame_buffer()->ToI420();
+
+  std::vector<absl::Span<const uint8_t>> chunks;
+  chunks.reserve(i420->height() + 2 * i420->ChromaHeight());
+  AppendPlane(i420->DataY(), i420->StrideY(), i420->width(), i420->height(),
+              chunks);
+  AppendPlane(i420->DataU(), i420->StrideU(), i420->ChromaWidth(),
+              i420->ChromaHeight(), chunks);
+  AppendPlane(i420->DataV(), i420->StrideV(), i420->ChromaWidth(),
+              i420->ChromaHeight(), chunks);
+  ring_->Write({.type = SharedMemoryFrameType::kVideo,
+                .received_time_us = received_time_us,
+                .rtp_timestamp = frame.frame.rtp_timestamp(),
+                .contributing_source = frame.contributing_source,
+                .width = static_cast<uint32_t>(i420->width()),
+                .height = static_cast<uint32_t>(i420->height())},
+               chunks);
+  observer_->OnVideoFrame(std::move(frame));
+}
+
+}  // namespace media_api_samples
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_SHARED_MEMORY_MEDIA_PUBLISHER_H_
+#define CPP_SAMPLES_SHARED_MEMORY_MEDIA_PUBLISHER_H_
+
+#include <memory>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/status/status.h"
+#include "meet_clients/api/media_api_client_interface.h"
+#include "meet_clients/samples/shared_memory_ring_writer.h"
+#include "api/scoped_refptr.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Publishes decoded audio and video frames to a shared memory ring, so that
+// consumers in other processes can read them with `SharedMemoryRingReader`
+// instead of re-reading the files written by a collector.
+//
+// Every callback is forwarded to `observer`, such as one of the media
+// collectors. Frames are copied into the ring on the thread that delivers
+// them, before they are forwarded; since the ring never waits for readers,
+// this only costs a copy of the frame.
+class SharedMemoryMediaPublisher : public meet::MediaApiClientObserverInterface {
+ public:
+  SharedMemoryMediaPublisher(
+      std::unique_ptr<SharedMemoryRingWriter> ring,
+      webrtc::scoped_refptr<meet::MediaApiClientObserverInterface> observer)
+      : ring_(std::move(ring)), observer_(std::move(observer)) {}
+
+  void OnJoined() override { observer_->OnJoined(); }
+  void OnDisconnected(absl::Status status) override {
+    observer_->OnDisconnected(std::move(status));
+  }
+  void OnMessageFromServer(meet::MessageFromServer update) override {
+    observer_->OnMessageFromServer(std::move(update));
+  }
+  void OnAudioFrame(meet::AudioFrame frame) override;
+  void OnVideoFrame(meet::VideoFrame frame) override;
+  void OnEncodedFrame(meet::EncodedFrame frame) override {
+    observer_->OnEncodedFrame(frame);
+  }
+
+  const SharedMemoryRingWriter& ring() const { return *ring_; }
+
+ private:
+  std::unique_ptr<SharedMemoryRingWriter> ring_;
+  webrtc::scoped_refptr<meet::MediaApiClientObserverInterface> observer_;
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_SHARED_MEMORY_MEDIA_PUBLISHER_H_
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/shared_memory_media_publisher.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "meet_clients/api/media_api_client_interface.h"
+#include "meet_clients/internal/testing/mock_media_api_client_observer.h"
+#include "meet_clients/samples/shared_memory_ring_layout.h"
+#include "meet_clients/samples/shared_memory_ring_reader.h"
+#include "meet_clients/samples/shared_memory_ring_writer.h"
+#include "meet_clients/samples/testing/media_data.h"
+#include "api/make_ref_counted.h"
+#include "api/scoped_refptr.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+using ::testing::_;
+
+struct PublisherAndReader {
+  webrtc::scoped_refptr<SharedMemoryMediaPublisher> publisher;
+  std::unique_ptr<SharedMemoryRingReader> reader;
+};
+
+PublisherAndReader CreatePublisherAndReader(
+    webrtc::scoped_refptr<meet::MockMediaApiClientObserver> observer) {
+  absl::StatusOr<std::unique_ptr<SharedMemoryRingWriter>> ring =
+      SharedMemoryRingWriter::Create({.capacity = 1 << 20});
+  EXPECT_TRUE(ring.ok()) << ring.status();
+  absl::StatusOr<std::unique_ptr<SharedMemoryRingReader>> reader =
+      SharedMemoryRingReader::Open((*ring)->path());
+  EXPECT_TRUE(reader.ok()) << reader.status();
+  return {.publisher = webrtc::make_ref_counted<SharedMemoryMediaPublisher>(
+              *std::move(ring), std::move(observer)),
+          .reader = *std::move(reader)};
+}
+
+TEST(SharedMemoryMediaPublisherTest, PublishesAndForwardsAudioFrames) {
+  auto observer = webrtc::make_ref_counted<meet::MockMediaApiClientObserver>();
+  EXPECT_CALL(*observer, OnAudioFrame(_)).Times(1);
+  PublisherAndReader publisher_and_reader = CreatePublisherAndReader(observer);
+  AudioTestData audio_data = CreateAudioTestData(480);
+  audio_data.frame.contributing_source = 123;
+
+  publisher_and_reader.publisher->OnAudioFrame(audio_data.frame);
+
+  std::optional<SharedMemoryFrame> frame =
+      publisher_and_reader.reader->Next();
+  ASSERT_TRUE(frame.has_value());
+  EXPECT_EQ(frame->header.type, SharedMemoryFrameType::kAudio);
+  EXPECT_EQ(frame->header.contributing_source, 123);
+  EXPECT_EQ(frame->header.sample_rate, 48000);
+  EXPECT_EQ(frame->header.number_of_channels, 1);
+  EXPECT_GT(frame->header.received_time_us, 0);
+  std::vector<int16_t> pcm16(frame->payload.size() / sizeof(int16_t));
+  memcpy(pcm16.data(), frame->payload.data(), frame->payload.size());
+  EXPECT_EQ(pcm16, audio_data.pcm16);
+}
+
+TEST(SharedMemoryMediaPublisherTest, PublishesAndForwardsVideoFrames) {
+  auto observer = webrtc::make_ref_counted<meet::MockMediaApiClientObserver>();
+  EXPECT_CALL(*observer, OnVideoFrame(_)).Times(1);
+  PublisherAndReader publisher_and_reader = CreatePublisherAndReader(observer);
+  // Odd dimensions, so that the chroma planes are rounded up.
+  VideoTestData video_data = CreateVideoTestData(/*width=*/5, /*height=*/3);
+  video_data.meet_frame.contributing_source = 456;
+
+  publisher_and_reader.publisher->OnVideoFrame(video_data.meet_frame);
+
+  std::optional<SharedMemoryFrame> frame =
+      publisher_and_reader.reader->Next();
+  ASSERT_TRUE(frame.has_value());
+  EXPECT_EQ(frame->header.type, SharedMemoryFrameType::kVideo);
+  EXPECT_EQ(frame->header.contributing_source, 456);
+  EXPECT_EQ(frame->header.width, 5);
+  EXPECT_EQ(frame->header.height, 3);
+  EXPECT_EQ(std::vector<char>(frame->payload.begin(), frame->payload.end()),
+            video_data.yuv_data);
+}
+
+TEST(SharedMemoryMediaPublisherTest, ForwardsOtherCallbacks) {
+  auto observer = webrtc::make_ref_counted<meet::MockMediaApiClientObserver>();
+  EXPECT_CALL(*observer, OnJoined()).Times(1);
+  EXPECT_CALL(*observer, OnDisconnected(_)).Times(1);
+  PublisherAndReader publisher_and_reader = CreatePublisherAndReader(observer);
+
+  publisher_and_reader.publisher->OnJoined();
+  publisher_and_reader.publisher->OnDisconnected(absl::OkStatus());
+
+  EXPECT_FALSE(publisher_and_reader.reader->Next().has_value());
+}
+
+}  // namespace
+}  // namespace media_api_samples
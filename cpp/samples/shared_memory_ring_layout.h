@@ -0,0 +1,117 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_SHARED_MEMORY_RING_LAYOUT_H_
+#define CPP_SAMPLES_SHARED_MEMORY_RING_LAYOUT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/nullability.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Layout of the shared memory ring written by `SharedMemoryRingWriter` and
+// read by `SharedMemoryRingReader`, possibly in different processes.
+//
+// The mapping starts with a `SharedMemoryRingHeader`, followed by the data
+// region at `data_offset`. Frames are appended to the data region as records:
+// a `SharedMemoryFrameHeader` followed by the payload, padded to a multiple of
+// `kSharedMemoryRecordAlignment`. Positions are byte counts since the ring was
+// created, so the record at position `p` starts at offset `p % capacity` of
+// the data region. Records never wrap around the end of the data region;
+// instead, the remainder is filled with a padding record.
+//
+// There is a single writer, and it never waits for readers. Before it
+// overwrites any byte, it advances `reserved_position` past that byte, and
+// `oldest_position` past any record that the byte belonged to. Once a record
+// is complete, it advances `committed_position` past the record. A reader
+// therefore knows which records are complete, can tell afterwards whether the
+// bytes it read might have been overwritten while it read them, and knows
+// where to resume if they were.
+
+inline constexpr uint32_t kSharedMemoryRingMagic = 0x474e524d;  // "MRNG"
+inline constexpr uint32_t kSharedMemoryRingVersion = 1;
+inline constexpr size_t kSharedMemoryRecordAlignment = 64;
+
+struct SharedMemoryRingHeader {
+  uint32_t magic;
+  uint32_t version;
+  // Offset of the data region from the start of the mapping.
+  uint64_t data_offset;
+  // Size of the data region, in bytes. A multiple of
+  // `kSharedMemoryRecordAlignment`.
+  uint64_t capacity;
+
+  // Position up to which the writer may have overwritten the data region.
+  // Never less than `committed_position`.
+  alignas(64) std::atomic<uint64_t> reserved_position;
+  // Position up to which records are complete.
+  std::atomic<uint64_t> committed_position;
+  // Position of the oldest record that has not been overwritten.
+  std::atomic<uint64_t> oldest_position;
+};
+
+// The positions are shared between processes, so they must not rely on a lock
+// that lives in either process.
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+enum class SharedMemoryFrameType : uint32_t {
+  // Fills the end of the data region when the next record does not fit.
+  kPadding = 0,
+  // The payload is interleaved pcm16 samples.
+  kAudio = 1,
+  // The payload is an I420 image: the Y, U, and V planes, each without row
+  // padding.
+  kVideo = 2,
+};
+
+struct SharedMemoryFrameHeader {
+  // Size of the record, including this header and any padding.
+  uint32_t record_size;
+  SharedMemoryFrameType type;
+  // Sequence number of the frame, starting from 0 for the first frame written
+  // to the ring. Padding records do not have sequence numbers, so a gap in the
+  // sequence numbers seen by a reader means frames were overwritten before
+  // they were read.
+  uint64_t sequence_number;
+  // Time the frame was received by the client, in microseconds since the Unix
+  // epoch.
+  int64_t received_time_us;
+  // RTP timestamp of video frames, using a 90 kHz clock. Zero for audio
+  // frames.
+  uint32_t rtp_timestamp;
+  // Contributing source (CSRC) of the participant that generated the frame.
+  uint32_t contributing_source;
+  // Size of the payload, in bytes.
+  uint32_t payload_size;
+  // Dimensions of video frames. Zero for audio frames.
+  uint32_t width;
+  uint32_t height;
+  // Format of audio frames. Zero for video frames.
+  uint32_t sample_rate;
+  uint32_t number_of_channels;
+  uint32_t reserved[3];
+};
+
+static_assert(sizeof(SharedMemoryFrameHeader) == kSharedMemoryRecordAlignment);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_SHARED_MEMORY_RING_LAYOUT_H_
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/shared_memory_ring_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "absl/base/nullability.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/shared_memory_ring_layout.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+absl::StatusOr<std::unique_ptr<SharedMemoryRingReader>>
+SharedMemoryRingReader::Open(absl::string_view path) {
+  int fd = open(std::string(path).c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return absl::NotFoundError(
+        absl::StrCat("Failed to open ", path, ": ", strerror(errno)));
+  }
+  absl::StatusOr<std::unique_ptr<SharedMemoryRingReader>> reader = FromFd(fd);
+  // The mapping keeps the memfd alive.
+  close(fd);
+  return reader;
+}
+
+absl::StatusOr<std::unique_ptr<SharedMemoryRingReader>>
+SharedMemoryRingReader::FromFd(int fd) {
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    return absl::UnavailableError(
+        absl::StrCat("fstat failed: ", strerror(errno)));
+  }
+  size_t mapping_size = static_cast<size_t>(file_stat.st_size);
+  if (mapping_size < sizeof(SharedMemoryRingHeader)) {
+    return absl::InvalidArgumentError("File is too small to be a ring");
+  }
+  // Readers never write to the ring, so that a misbehaving reader cannot
+  // corrupt it for others.
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    return absl::UnavailableError(
+        absl::StrCat("mmap failed: ", strerror(errno)));
+  }
+
+  const auto& header = *static_cast<const SharedMemoryRingHeader*>(mapping);
+  absl::Status status;
+  if (header.magic != kSharedMemoryRingMagic) {
+    status = absl::InvalidArgumentError("File is not a shared memory ring");
+  } else if (header.version != kSharedMemoryRingVersion) {
+    status = absl::FailedPreconditionError(
+        absl::StrCat("Unsupported ring version: ", header.version));
+  } else if (header.data_offset < sizeof(SharedMemoryRingHeader) ||
+             header.capacity == 0 ||
+             header.capacity % kSharedMemoryRecordAlignment != 0 ||
+             header.data_offset + header.capacity > mapping_size) {
+    status = absl::InvalidArgumentError("Ring header is inconsistent");
+  }
+  if (!status.ok()) {
+    munmap(mapping, mapping_size);
+    return status;
+  }
+  return absl::WrapUnique(new SharedMemoryRingReader(mapping, mapping_size));
+}
+
+SharedMemoryRingReader::SharedMemoryRingReader(const void* mapping,
+                                               size_t mapping_size)
+    : mapping_(mapping),
+      mapping_size_(mapping_size),
+      data_(static_cast<const uint8_t*>(mapping) + header().data_offset),
+      capacity_(header().capacity),
+      position_(
+          header().committed_position.load(std::memory_order_acquire)) {}
+
+SharedMemoryRingReader::~SharedMemoryRingReader() {
+  munmap(const_cast<void*>(mapping_), mapping_size_);
+}
+
+std::optional<SharedMemoryFrame> SharedMemoryRingReader::Next() {
+  while (true) {
+    uint64_t committed =
+        header().committed_position.load(std::memory_order_acquire);
+    if (position_ == committed) return std::nullopt;
+
+    uint64_t offset = position_ % capacity_;
+    SharedMemoryFrameHeader frame_header;
+    memcpy(&frame_header, data_ + offset, sizeof(frame_header));
+    if (!IsIntact(position_)) {
+      SkipToOldest();
+      continue;
+    }
+    // The header was intact, so it was written by the writer in full. Check
+    // it anyway, so that a corrupt ring cannot send the reader out of bounds.
+    if (frame_header.record_size < sizeof(frame_header) ||
+        frame_header.record_size % kSharedMemoryRecordAlignment != 0 ||
+        frame_header.record_size > capacity_ - offset ||
+        frame_header.payload_size >
+            frame_header.record_size - sizeof(frame_header)) {
+      SkipToOldest();
+      continue;
+    }
+
+    uint64_t position = position_;
+    position_ += frame_header.record_size;
+    if (frame_header.type == SharedMemoryFrameType::kPadding) continue;
+
+    if (next_sequence_number_.has_value() &&
+        frame_header.sequence_number > *next_sequence_number_) {
+      dropped_frames_ += frame_header.sequence_number - *next_sequence_number_;
+    }
+    next_sequence_number_ = frame_header.sequence_number + 1;
+    return SharedMemoryFrame{
+        .header = frame_header,
+        .payload = absl::MakeConstSpan(data_ + offset + sizeof(frame_header),
+                                       frame_header.payload_size),
+        .position = position,
+    };
+  }
+}
+
+bool SharedMemoryRingReader::IsIntact(uint64_t position) const {
+  // Pairs with the release fence in `SharedMemoryRingWriter::Reserve`: if any
+  // byte read before this fence had been overwritten, the reserved position
+  // covering it is visible here.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t reserved =
+      header().reserved_position.load(std::memory_order_relaxed);
+  // The record at `position` is overwritten once the writer reserves past the
+  // same offset one lap later.
+  return reserved - position <= capacity_;
+}
+
+void SharedMemoryRingReader::SkipToOldest() {
+  // If the writer overwrites this record too before it is read, the reader
+  // simply skips again.
+  position_ = header().oldest_position.load(std::memory_order_acquire);
+}
+
+}  // namespace media_api_samples
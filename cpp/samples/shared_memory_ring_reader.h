@@ -0,0 +1,110 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_SHARED_MEMORY_RING_READER_H_
+#define CPP_SAMPLES_SHARED_MEMORY_RING_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "absl/base/nullability.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/shared_memory_ring_layout.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// A frame read from a shared memory ring.
+struct SharedMemoryFrame {
+  SharedMemoryFrameHeader header;
+  // Points directly into the ring. The writer may overwrite it at any time, so
+  // `SharedMemoryRingReader::IsIntact` must be checked after reading it.
+  absl::Span<const uint8_t> payload;
+  // Position of the frame's record in the ring.
+  uint64_t position;
+};
+
+// Reads frames published by a `SharedMemoryRingWriter`, possibly in another
+// process.
+//
+// Frames are read in place, without copying. Since the writer never waits for
+// readers, a frame may be overwritten while it is being read; consumers must
+// call `IsIntact` once they are done with a frame's payload, and discard
+// whatever they computed from it if it returns false. Readers that fall behind
+// by more than the size of the ring skip ahead to the oldest frame that is
+// left; `dropped_frames` counts the frames skipped this way.
+//
+// Readers are independent of each other and of the writer. This class is not
+// thread-safe; each consumer thread should open its own reader.
+class SharedMemoryRingReader {
+ public:
+  // Maps the ring at `path`, such as the `SharedMemoryRingWriter::path` of a
+  // writer in another process.
+  static absl::StatusOr<std::unique_ptr<SharedMemoryRingReader>> Open(
+      absl::string_view path);
+  // Maps the ring backed by `fd`, which may have been received over a Unix
+  // domain socket. Does not take ownership of `fd`.
+  static absl::StatusOr<std::unique_ptr<SharedMemoryRingReader>> FromFd(
+      int fd);
+
+  ~SharedMemoryRingReader();
+
+  SharedMemoryRingReader(const SharedMemoryRingReader&) = delete;
+  SharedMemoryRingReader& operator=(const SharedMemoryRingReader&) = delete;
+
+  // Returns the next frame, or nullopt if the reader has caught up with the
+  // writer. The first call returns the first frame written after the reader
+  // was created.
+  std::optional<SharedMemoryFrame> Next();
+
+  // Returns whether `frame` is still intact, i.e. its payload has not been
+  // overwritten since it was returned by `Next`.
+  bool IsIntact(const SharedMemoryFrame& frame) const {
+    return IsIntact(frame.position);
+  }
+
+  // Number of frames that were overwritten before this reader could read
+  // them.
+  int64_t dropped_frames() const { return dropped_frames_; }
+
+ private:
+  SharedMemoryRingReader(const void* mapping, size_t mapping_size);
+
+  const SharedMemoryRingHeader& header() const {
+    return *static_cast<const SharedMemoryRingHeader*>(mapping_);
+  }
+  bool IsIntact(uint64_t position) const;
+  // Skips to the oldest record that is left after falling behind the writer.
+  void SkipToOldest();
+
+  const void* const mapping_;
+  const size_t mapping_size_;
+  const uint8_t* const data_;
+  const uint64_t capacity_;
+
+  uint64_t position_;
+  std::optional<uint64_t> next_sequence_number_;
+  int64_t dropped_frames_ = 0;
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_SHARED_MEMORY_RING_READER_H_
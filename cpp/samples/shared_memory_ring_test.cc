@@ -0,0 +1,190 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/shared_memory_ring_layout.h"
+#include "meet_clients/samples/shared_memory_ring_reader.h"
+#include "meet_clients/samples/shared_memory_ring_writer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+std::vector<uint8_t> CreatePayload(int size, uint8_t seed) {
+  std::vector<uint8_t> payload(size);
+  for (int i = 0; i < size; ++i) {
+    payload[i] = static_cast<uint8_t>(seed + i);
+  }
+  return payload;
+}
+
+std::unique_ptr<SharedMemoryRingWriter> CreateWriter(size_t capacity) {
+  absl::StatusOr<std::unique_ptr<SharedMemoryRingWriter>> writer =
+      SharedMemoryRingWriter::Create({.capacity = capacity});
+  EXPECT_TRUE(writer.ok()) << writer.status();
+  return *std::move(writer);
+}
+
+std::unique_ptr<SharedMemoryRingReader> CreateReader(
+    const SharedMemoryRingWriter& writer) {
+  absl::StatusOr<std::unique_ptr<SharedMemoryRingReader>> reader =
+      SharedMemoryRingReader::Open(writer.path());
+  EXPECT_TRUE(reader.ok()) << reader.status();
+  return *std::move(reader);
+}
+
+bool WriteFrame(SharedMemoryRingWriter& writer, uint32_t contributing_source,
+                const std::vector<uint8_t>& payload) {
+  absl::Span<const uint8_t> chunks[] = {payload};
+  return writer.Write({.type = SharedMemoryFrameType::kAudio,
+                       .contributing_source = contributing_source},
+                      chunks);
+}
+
+TEST(SharedMemoryRingTest, ReadsFramesWrittenAfterOpening) {
+  std::unique_ptr<SharedMemoryRingWriter> writer = CreateWriter(4096);
+  std::vector<uint8_t> payload = CreatePayload(100, 0);
+  ASSERT_TRUE(WriteFrame(*writer, 1, payload));
+  std::unique_ptr<SharedMemoryRingReader> reader = CreateReader(*writer);
+
+  std::vector<uint8_t> first = CreatePayload(20, 1);
+  std::vector<uint8_t> second = CreatePayload(30, 2);
+  absl::Span<const uint8_t> video_chunks[] = {
+      absl::MakeConstSpan(second).first(10),
+      absl::MakeConstSpan(second).subspan(10)};
+  ASSERT_TRUE(writer->Write({.type = SharedMemoryFrameType::kVideo,
+                             .received_time_us = 123456,
+                             .rtp_timestamp = 9000,
+                             .contributing_source = 2,
+                             .width = 4,
+                             .height = 5},
+                            video_chunks));
+  ASSERT_TRUE(WriteFrame(*writer, 3, first));
+
+  std::optional<SharedMemoryFrame> frame = reader->Next();
+  ASSERT_TRUE(frame.has_value());
+  EXPECT_EQ(frame->header.type, SharedMemoryFrameType::kVideo);
+  EXPECT_EQ(frame->header.sequence_number, 1);
+  EXPECT_EQ(frame->header.received_time_us, 123456);
+  EXPECT_EQ(frame->header.rtp_timestamp, 9000);
+  EXPECT_EQ(frame->header.contributing_source, 2);
+  EXPECT_EQ(frame->header.width, 4);
+  EXPECT_EQ(frame->header.height, 5);
+  EXPECT_EQ(std::vector<uint8_t>(frame->payload.begin(), frame->payload.end()),
+            second);
+  EXPECT_TRUE(reader->IsIntact(*frame));
+
+  frame = reader->Next();
+  ASSERT_TRUE(frame.has_value());
+  EXPECT_EQ(frame->header.type, SharedMemoryFrameType::kAudio);
+  EXPECT_EQ(frame->header.sequence_number, 2);
+  EXPECT_EQ(frame->header.contributing_source, 3);
+  EXPECT_EQ(std::vector<uint8_t>(frame->payload.begin(), frame->payload.end()),
+            first);
+  EXPECT_FALSE(reader->Next().has_value());
+  EXPECT_EQ(reader->dropped_frames(), 0);
+}
+
+TEST(SharedMemoryRingTest, WrapsAroundWithoutDroppingFramesForFastReader) {
+  std::unique_ptr<SharedMemoryRingWriter> writer = CreateWriter(1024);
+  std::unique_ptr<SharedMemoryRingReader> reader = CreateReader(*writer);
+
+  // Varying sizes so that records end at different offsets, and some do not
+  // fit before the end of the ring.
+  for (int i = 0; i < 100; ++i) {
+    std::vector<uint8_t> payload = CreatePayload(i * 37 % 400, i);
+    ASSERT_TRUE(WriteFrame(*writer, i, payload));
+
+    std::optional<SharedMemoryFrame> frame = reader->Next();
+    ASSERT_TRUE(frame.has_value());
+    EXPECT_EQ(frame->header.sequence_number, i);
+    EXPECT_EQ(
+        std::vector<uint8_t>(frame->payload.begin(), frame->payload.end()),
+        payload);
+    EXPECT_TRUE(reader->IsIntact(*frame));
+    EXPECT_FALSE(reader->Next().has_value());
+  }
+  EXPECT_EQ(reader->dropped_frames(), 0);
+}
+
+TEST(SharedMemoryRingTest, SlowReaderSkipsAheadAndCountsDroppedFrames) {
+  std::unique_ptr<SharedMemoryRingWriter> writer = CreateWriter(1024);
+  std::unique_ptr<SharedMemoryRingReader> reader = CreateReader(*writer);
+  std::vector<uint8_t> payload = CreatePayload(100, 0);
+  ASSERT_TRUE(WriteFrame(*writer, 1, payload));
+  std::optional<SharedMemoryFrame> frame = reader->Next();
+  ASSERT_TRUE(frame.has_value());
+
+  // The writer does not wait for the reader, and overwrites the frame that
+  // was being read.
+  for (int i = 0; i < 50; ++i) {
+    ASSERT_TRUE(WriteFrame(*writer, 1, payload));
+  }
+  EXPECT_FALSE(reader->IsIntact(*frame));
+
+  // The reader skips to the oldest frames left in the ring, and then reads
+  // the rest of them in order.
+  frame = reader->Next();
+  ASSERT_TRUE(frame.has_value());
+  uint64_t oldest_sequence_number = frame->header.sequence_number;
+  EXPECT_GT(oldest_sequence_number, 1);
+  EXPECT_EQ(reader->dropped_frames(), oldest_sequence_number - 1);
+  for (uint64_t i = oldest_sequence_number + 1; i <= 50; ++i) {
+    frame = reader->Next();
+    ASSERT_TRUE(frame.has_value());
+    EXPECT_EQ(frame->header.sequence_number, i);
+    EXPECT_TRUE(reader->IsIntact(*frame));
+  }
+  EXPECT_FALSE(reader->Next().has_value());
+  EXPECT_EQ(reader->dropped_frames(), oldest_sequence_number - 1);
+}
+
+TEST(SharedMemoryRingTest, DropsFramesLargerThanRing) {
+  std::unique_ptr<SharedMemoryRingWriter> writer = CreateWriter(1024);
+  std::unique_ptr<SharedMemoryRingReader> reader = CreateReader(*writer);
+
+  EXPECT_FALSE(WriteFrame(*writer, 1, CreatePayload(1024, 0)));
+  EXPECT_FALSE(reader->Next().has_value());
+  SharedMemoryRingWriter::Stats stats = writer->GetStats();
+  EXPECT_EQ(stats.frames_written, 0);
+  EXPECT_EQ(stats.frames_dropped, 1);
+}
+
+TEST(SharedMemoryRingTest, ReaderRejectsFileThatIsNotRing) {
+  int fd = memfd_create("not_a_ring", MFD_CLOEXEC);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(ftruncate(fd, 4096), 0);
+
+  EXPECT_EQ(SharedMemoryRingReader::FromFd(fd).status().code(),
+            absl::StatusCode::kInvalidArgument);
+  close(fd);
+}
+
+}  // namespace
+}  // namespace media_api_samples
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/shared_memory_ring_writer.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "absl/base/nullability.h"
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/shared_memory_ring_layout.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+uint64_t RoundUpToRecordAlignment(uint64_t size) {
+  return (size + kSharedMemoryRecordAlignment - 1) /
+         kSharedMemoryRecordAlignment * kSharedMemoryRecordAlignment;
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<SharedMemoryRingWriter>>
+SharedMemoryRingWriter::Create(const Options& options) {
+  uint64_t capacity = RoundUpToRecordAlignment(options.capacity);
+  if (capacity == 0) {
+    return absl::InvalidArgumentError("Ring capacity must be positive");
+  }
+  uint64_t data_offset = RoundUpToRecordAlignment(sizeof(SharedMemoryRingHeader));
+  size_t mapping_size = data_offset + capacity;
+
+  int fd = memfd_create(options.name.c_str(), MFD_CLOEXEC);
+  if (fd < 0) {
+    return absl::UnavailableError(
+        absl::StrCat("memfd_create failed: ", strerror(errno)));
+  }
+  // The memfd is sparse, so pages of the data region are only allocated once
+  // they are first written.
+  if (ftruncate(fd, mapping_size) != 0) {
+    absl::Status status = absl::UnavailableError(
+        absl::StrCat("ftruncate failed: ", strerror(errno)));
+    close(fd);
+    return status;
+  }
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    absl::Status status =
+        absl::UnavailableError(absl::StrCat("mmap failed: ", strerror(errno)));
+    close(fd);
+    return status;
+  }
+
+  auto* header = new (mapping) SharedMemoryRingHeader{
+      .magic = kSharedMemoryRingMagic,
+      .version = kSharedMemoryRingVersion,
+      .data_offset = data_offset,
+      .capacity = capacity,
+  };
+  header->reserved_position.store(0, std::memory_order_relaxed);
+  header->committed_position.store(0, std::memory_order_relaxed);
+  header->oldest_position.store(0, std::memory_order_release);
+  return absl::WrapUnique(
+      new SharedMemoryRingWriter(fd, mapping, mapping_size));
+}
+
+SharedMemoryRingWriter::SharedMemoryRingWriter(int fd, void* mapping,
+                                               size_t mapping_size)
+    : fd_(fd),
+      mapping_(mapping),
+      mapping_size_(mapping_size),
+      capacity_(header().capacity) {}
+
+SharedMemoryRingWriter::~SharedMemoryRingWriter() {
+  Stats stats = GetStats();
+  LOG(INFO) << "Shared memory ring wrote " << stats.frames_written
+            << " frames (" << stats.bytes_written << " bytes) and dropped "
+            << stats.frames_dropped << " frames";
+  munmap(mapping_, mapping_size_);
+  close(fd_);
+}
+
+std::string SharedMemoryRingWriter::path() const {
+  return absl::StrCat("/proc/", getpid(), "/fd/", fd_);
+}
+
+bool SharedMemoryRingWriter::Write(
+    SharedMemoryFrameHeader metadata,
+    absl::Span<const absl::Span<const uint8_t>> payload) {
+  size_t payload_size = 0;
+  for (absl::Span<const uint8_t> chunk : payload) {
+    payload_size += chunk.size();
+  }
+  uint64_t record_size =
+      RoundUpToRecordAlignment(sizeof(SharedMemoryFrameHeader) + payload_size);
+
+  absl::MutexLock lock(&mutex_);
+  if (record_size > capacity_) {
+    ++stats_.frames_dropped;
+    return false;
+  }
+
+  uint64_t offset = position_ % capacity_;
+  if (offset + record_size > capacity_) {
+    // Records are aligned, so there is always room for the padding header.
+    uint64_t padding_size = capacity_ - offset;
+    Reserve(position_ + padding_size + record_size);
+    SharedMemoryFrameHeader padding = {
+        .record_size = static_cast<uint32_t>(padding_size),
+        .type = SharedMemoryFrameType::kPadding,
+    };
+    memcpy(data() + offset, &padding, sizeof(padding));
+    position_ += padding_size;
+    offset = 0;
+  } else {
+    Reserve(position_ + record_size);
+  }
+
+  metadata.record_size = static_cast<uint32_t>(record_size);
+  metadata.sequence_number = stats_.frames_written;
+  metadata.payload_size = static_cast<uint32_t>(payload_size);
+  uint8_t* destination = data() + offset;
+  memcpy(destination, &metadata, sizeof(metadata));
+  destination += sizeof(metadata);
+  for (absl::Span<const uint8_t> chunk : payload) {
+    memcpy(destination, chunk.data(), chunk.size());
+    destination += chunk.size();
+  }
+
+  position_ += record_size;
+  header().committed_position.store(position_, std::memory_order_release);
+  ++stats_.frames_written;
+  stats_.bytes_written += payload_size;
+  return true;
+}
+
+SharedMemoryRingWriter::Stats SharedMemoryRingWriter::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void SharedMemoryRingWriter::Reserve(uint64_t position) {
+  // Skip the records that are about to be overwritten, in part or in full.
+  // Their headers are still intact, since only the writer writes to the ring.
+  while (oldest_position_ < position_ &&
+         oldest_position_ + capacity_ < position) {
+    SharedMemoryFrameHeader oldest;
+    memcpy(&oldest, data() + oldest_position_ % capacity_, sizeof(oldest));
+    oldest_position_ += oldest.record_size;
+  }
+  // Pairs with the acquire load in `SharedMemoryRingReader::SkipToOldest`,
+  // so that a reader never sees an oldest position past the committed one.
+  header().oldest_position.store(oldest_position_, std::memory_order_release);
+  // Pairs with the acquire fence in `SharedMemoryRingReader::IsIntact`: a
+  // reader that observes any byte written after this fence also observes the
+  // new reserved position.
+  header().reserved_position.store(position, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+}  // namespace media_api_samples
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_SHARED_MEMORY_RING_WRITER_H_
+#define CPP_SAMPLES_SHARED_MEMORY_RING_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/shared_memory_ring_layout.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Publishes frames into a ring buffer in anonymous shared memory, so that
+// other processes can read them without going through the file system.
+//
+// The ring is backed by a `memfd`, which readers open through `path()` or
+// receive as a file descriptor, and read with `SharedMemoryRingReader`. Any
+// number of readers may read concurrently. Writing never waits for readers:
+// once the ring is full, the oldest frames are overwritten, and readers that
+// fall behind skip ahead to the oldest frame that is left.
+//
+// This class is thread-safe.
+class SharedMemoryRingWriter {
+ public:
+  struct Options {
+    // Size of the data region, in bytes. Rounded up to a multiple of
+    // `kSharedMemoryRecordAlignment`. Frames larger than this are dropped.
+    size_t capacity = 64 << 20;
+    // Name of the memfd, as shown in `/proc/<pid>/fd`. For debugging only.
+    std::string name = "meet_media_ring";
+  };
+
+  struct Stats {
+    int64_t frames_written = 0;
+    int64_t bytes_written = 0;
+    // Frames that were larger than the ring.
+    int64_t frames_dropped = 0;
+  };
+
+  static absl::StatusOr<std::unique_ptr<SharedMemoryRingWriter>> Create(
+      const Options& options);
+
+  // Unmaps and closes the ring. Readers that already mapped it are unaffected.
+  ~SharedMemoryRingWriter();
+
+  SharedMemoryRingWriter(const SharedMemoryRingWriter&) = delete;
+  SharedMemoryRingWriter& operator=(const SharedMemoryRingWriter&) = delete;
+
+  // The memfd backing the ring. Owned by the writer.
+  int fd() const { return fd_; }
+  // A path through which processes of the same user can open the ring, for as
+  // long as this writer is alive.
+  std::string path() const;
+
+  // Appends a frame whose payload is the concatenation of `payload`.
+  // `record_size`, `sequence_number`, and `payload_size` of `metadata` are
+  // filled in by the writer.
+  //
+  // Returns false if the frame is larger than the ring, in which case it is
+  // dropped.
+  bool Write(SharedMemoryFrameHeader metadata,
+             absl::Span<const absl::Span<const uint8_t>> payload);
+
+  Stats GetStats() const;
+
+ private:
+  SharedMemoryRingWriter(int fd, void* mapping, size_t mapping_size);
+
+  SharedMemoryRingHeader& header() {
+    return *static_cast<SharedMemoryRingHeader*>(mapping_);
+  }
+  uint8_t* data() {
+    return static_cast<uint8_t*>(mapping_) + header().data_offset;
+  }
+  // Advances `oldest_position` and `reserved_position` before the data up to
+  // `position` is overwritten.
+  void Reserve(uint64_t position) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const int fd_;
+  void* const mapping_;
+  const size_t mapping_size_;
+  // Cached from the header, which readers may share.
+  const uint64_t capacity_;
+
+  mutable absl::Mutex mutex_;
+  // Position of the next record.
+  uint64_t position_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Position of the oldest record that has not been overwritten.
+  uint64_t oldest_position_ ABSL_GUARDED_BY(mutex_) = 0;
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_SHARED_MEMORY_RING_WRITER_H_
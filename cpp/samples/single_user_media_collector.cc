@@ -26,8 +26,8 @@
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
 #include "meet_clients/api/media_api_client_interface.h"
-#include "meet_clients/samples/media_writing.h"
 #include "api/scoped_refptr.h"
 #include "api/video/video_frame_buffer.h"
 #include "rtc_base/thread.h"
@@ -43,7 +43,7 @@ void SingleUserMediaCollector::OnAudioFrame(meet::AudioFrame frame) {
 
   // Move audio processing to a separate thread since `OnAudioFrame`
   // implementations should move expensive work to a separate thread.
-  collector_thread_->PostTask([this, pcm16 = std::move(pcm16)] {
+  collector_thread_->PostTask([this, pcm16 = std::move(pcm16)]() mutable {
     HandleAudioBuffer(std::move(pcm16));
   });
 }
@@ -61,14 +61,15 @@ void SingleUserMediaCollector::HandleAudioBuffer(std::vector<int16_t> pcm16) {
   DCHECK(collector_thread_->IsCurrent());
 
   if (audio_writer_ == nullptr) {
-    std::string audio_output_file_name =
-        absl::StrCat(output_file_prefix_, "audio.pcm");
+    std::string audio_output_file_name = absl::StrCat(
+        output_file_prefix_, "audio.", audio_format_.file_extension);
 
     LOG(INFO) << "Creating audio file: " << audio_output_file_name;
-    audio_writer_ = output_writer_provider_(audio_output_file_name);
+    audio_writer_ = audio_format_.create_writer(
+        output_writer_provider_(audio_output_file_name));
   }
 
-  WritePcm16(pcm16, *audio_writer_);
+  audio_writer_->WriteSamples(std::move(pcm16));
 }
 
 void SingleUserMediaCollector::HandleVideoBuffer(
@@ -90,15 +91,19 @@ void SingleUserMediaCollector::HandleVideoBuffer(
         video_segment_ == nullptr ? 0 : video_segment_->segment_number + 1;
     std::string video_output_file_name =
         absl::StrCat(output_file_prefix_, "video_", segment_number, "_",
-                     i420->width(), "x", i420->height(), ".yuv");
+                     i420->width(), "x", i420->height(), ".",
+                     video_format_.file_extension);
 
     LOG(INFO) << "Creating video file: " << video_output_file_name;
     video_segment_ = std::make_unique<VideoSegment>(
         segment_number, i420->width(), i420->height(),
-        output_writer_provider_(video_output_file_name));
+        video_format_.create_writer(
+            output_writer_provider_(video_output_file_name), i420->width(),
+            i420->height()));
   }
 
-  WriteYuv420(*i420, *video_segment_->writer);
+  // `ToI420` returns the buffer itself for I420 buffers, so this does not copy.
+  video_segment_->writer->WriteFrame(buffer->ToI420(), absl::Now());
 }
 
 }  // namespace media_api_samples
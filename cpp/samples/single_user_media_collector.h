@@ -18,8 +18,6 @@
 #define CPP_SAMPLES_SINGLE_USER_MEDIA_COLLECTOR_H_
 
 #include <cstdint>
-#include <fstream>
-#include <ios>
 #include <memory>
 #include <optional>
 #include <string>
@@ -34,8 +32,12 @@
 #include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
 #include "meet_clients/api/media_api_client_interface.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
 #include "meet_clients/samples/output_file.h"
 #include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/raw_audio_segment_writer.h"
+#include "meet_clients/samples/raw_video_segment_writer.h"
+#include "meet_clients/samples/video_segment_writer_interface.h"
 #include "api/scoped_refptr.h"
 #include "api/video/video_frame_buffer.h"
 #include "rtc_base/thread.h"
@@ -55,34 +57,32 @@ class SingleUserMediaCollector : public meet::MediaApiClientObserverInterface {
   // Default constructor that writes media to real files.
   SingleUserMediaCollector(absl::string_view output_file_prefix,
                            std::unique_ptr<webrtc::Thread> collector_thread)
-      : output_file_prefix_(output_file_prefix),
-        collector_thread_(std::move(collector_thread)) {
-    output_writer_provider_ = [](absl::string_view file_name) {
-      std::ofstream file(std::string(file_name),
-                         std::ios::binary | std::ios::out | std::ios::trunc);
-      if (file.is_open()) {
-        LOG(INFO) << "Opened file: " << file_name;
-      } else {
-        // Files should normally open successfully.
-        //
-        // Potential causes for failure include:
-        // - The parent directory does not exist.
-        // - The system is out of disk space.
-        //
-        // If a file cannot be opened, the sample will still run, but written
-        // data will be lost.
-        LOG(ERROR) << "Failed to open file: " << file_name;
-      }
-      return std::make_unique<OutputFile>(std::move(file));
-    };
-  }
+      : SingleUserMediaCollector(output_file_prefix,
+                                 std::move(collector_thread),
+                                 CreateOutputFileProvider()) {}
 
-  // Constructor that allows injecting a custom writer provider for testing.
+  // Constructor that allows injecting a custom writer provider, e.g. for
+  // testing or for selecting a different storage backend.
   SingleUserMediaCollector(absl::string_view output_file_prefix,
                            std::unique_ptr<webrtc::Thread> collector_thread,
                            OutputWriterProvider output_writer_provider)
+      : SingleUserMediaCollector(output_file_prefix,
+                                 std::move(collector_thread),
+                                 std::move(output_writer_provider),
+                                 CreateRawVideoSegmentFormat(),
+                                 CreateRawAudioSegmentFormat()) {}
+
+  // Constructor that additionally stores video in `video_format` and audio in
+  // `audio_format`.
+  SingleUserMediaCollector(absl::string_view output_file_prefix,
+                           std::unique_ptr<webrtc::Thread> collector_thread,
+                           OutputWriterProvider output_writer_provider,
+                           VideoSegmentFormat video_format,
+                           AudioSegmentFormat audio_format)
       : output_file_prefix_(output_file_prefix),
         output_writer_provider_(std::move(output_writer_provider)),
+        video_format_(std::move(video_format)),
+        audio_format_(std::move(audio_format)),
         collector_thread_(std::move(collector_thread)) {}
 
   ~SingleUserMediaCollector() override {
@@ -148,7 +148,8 @@ class SingleUserMediaCollector : public meet::MediaApiClientObserverInterface {
     int segment_number ABSL_REQUIRE_EXPLICIT_INIT;
     int width ABSL_REQUIRE_EXPLICIT_INIT;
     int height ABSL_REQUIRE_EXPLICIT_INIT;
-    std::unique_ptr<OutputWriterInterface> writer ABSL_REQUIRE_EXPLICIT_INIT;
+    std::unique_ptr<VideoSegmentWriterInterface> writer
+        ABSL_REQUIRE_EXPLICIT_INIT;
   };
 
   void HandleAudioBuffer(std::vector<int16_t> pcm16);
@@ -157,12 +158,14 @@ class SingleUserMediaCollector : public meet::MediaApiClientObserverInterface {
 
   std::string output_file_prefix_;
   OutputWriterProvider output_writer_provider_;
+  VideoSegmentFormat video_format_;
+  AudioSegmentFormat audio_format_;
   // Audio writer for all audio frames.
   //
   // The audio writer is created when the first audio frame is received. Audio
   // format does not change, so a single writer can be used for all audio
   // frames.
-  /*absl_nullable*/ std::unique_ptr<OutputWriterInterface> audio_writer_;
+  /*absl_nullable*/ std::unique_ptr<AudioSegmentWriterInterface> audio_writer_;
   // The current video segment, or nullptr if no video frames have been received
   // yet.
   //
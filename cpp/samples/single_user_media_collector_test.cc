@@ -117,8 +117,10 @@ TEST(SingleUserMediaCollectorTest, ReceivesAudioFrameAndWritesToAudioFile) {
   absl::Notification write_notification;
   EXPECT_CALL(*mock_output_file, Write(_, _))
       .WillRepeatedly([&](const char* content, std::streamsize size) {
-        EXPECT_EQ(size, sizeof(int16_t));
-        written_pcm16.push_back(reinterpret_cast<const int16_t*>(content)[0]);
+        EXPECT_EQ(size % sizeof(int16_t), 0);
+        const auto* samples = reinterpret_cast<const int16_t*>(content);
+        written_pcm16.insert(written_pcm16.end(), samples,
+                             samples + size / sizeof(int16_t));
         if (written_pcm16.size() == pcm16.size()) {
           write_notification.Notify();
         }
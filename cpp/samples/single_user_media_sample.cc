@@ -33,8 +33,14 @@
 #include "meet_clients/api/media_api_client_interface.h"
 #include "meet_clients/api/video_assignment_resource.h"
 #include "meet_clients/internal/media_api_client_factory.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
 #include "meet_clients/samples/single_user_media_collector.h"
+#include "meet_clients/samples/media_format_flags.h"
+#include "meet_clients/samples/output_writer_flags.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/video_segment_writer_interface.h"
 #include "api/make_ref_counted.h"
+#include "api/scoped_refptr.h"
 #include "rtc_base/thread.h"
 
 ABSL_POINTERS_DEFAULT_NONNULL
@@ -128,9 +134,44 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
+  absl::StatusOr<media_api_samples::OutputWriterProvider>
+      output_writer_provider =
+          media_api_samples::CreateOutputWriterProviderFromFlags();
+  if (!output_writer_provider.ok()) {
+    LOG(ERROR) << "Failed to create output writer provider: "
+               << output_writer_provider.status();
+    return EXIT_FAILURE;
+  }
+
+  absl::StatusOr<media_api_samples::VideoSegmentFormat> video_format =
+      media_api_samples::CreateVideoSegmentFormatFromFlags();
+  if (!video_format.ok()) {
+    LOG(ERROR) << "Failed to create video segment format: "
+               << video_format.status();
+    return EXIT_FAILURE;
+  }
+
+  absl::StatusOr<media_api_samples::AudioSegmentFormat> audio_format =
+      media_api_samples::CreateAudioSegmentFormatFromFlags();
+  if (!audio_format.ok()) {
+    LOG(ERROR) << "Failed to create audio segment format: "
+               << audio_format.status();
+    return EXIT_FAILURE;
+  }
+
   auto media_collector =
       webrtc::make_ref_counted<media_api_samples::SingleUserMediaCollector>(
-          output_file_prefix, std::move(collector_thread));
+          output_file_prefix, std::move(collector_thread),
+          *std::move(output_writer_provider), *std::move(video_format),
+          *std::move(audio_format));
+  absl::StatusOr<webrtc::scoped_refptr<meet::MediaApiClientObserverInterface>>
+      observer = media_api_samples::CreateSharedMemoryPublisherFromFlags(
+          media_collector);
+  if (!observer.ok()) {
+    LOG(ERROR) << "Failed to create shared memory publisher: "
+               << observer.status();
+    return EXIT_FAILURE;
+  }
   // Configure the media collector to receive a single video stream, and enable
   // audio.
   meet::MediaApiClientConfiguration config = {
@@ -139,7 +180,7 @@ int main(int argc, char** argv) {
   };
   absl::StatusOr<std::unique_ptr<meet::MediaApiClientInterface>> client_status =
       meet::MediaApiClientFactory().CreateMediaApiClient(std::move(config),
-                                                         media_collector);
+                                                         *std::move(observer));
   if (!client_status.ok()) {
     LOG(ERROR) << "Failed to create MediaApiClient: " << client_status.status();
     return EXIT_FAILURE;
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/socket_output_writer.h"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/log/log.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+std::shared_ptr<SocketOutputWriterPool> SocketOutputWriterPool::Create(
+    Options options) {
+  return std::shared_ptr<SocketOutputWriterPool>(
+      new SocketOutputWriterPool(std::move(options)));
+}
+
+SocketOutputWriterPool::~SocketOutputWriterPool() {
+  Stats stats = GetStats();
+  LOG(INFO) << "Socket output: " << stats.connections << " connections ("
+            << stats.failed_connections << " failed), sent "
+            << stats.sent_frames << " frames (" << stats.sent_bytes
+            << " bytes), dropped " << stats.dropped_frames << " frames ("
+            << stats.dropped_bytes << " bytes), " << stats.partial_frames
+            << " partial sends, " << stats.lost_streams << " lost streams";
+}
+
+std::unique_ptr<OutputWriterInterface> SocketOutputWriterPool::CreateWriter(
+    absl::string_view file_name) {
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  sockaddr_un address = {.sun_family = AF_UNIX};
+  if (options_.socket_path.size() >= sizeof(address.sun_path)) {
+    LOG(ERROR) << "Socket path is too long: " << options_.socket_path;
+    close(fd);
+    fd = -1;
+  }
+  if (fd >= 0) {
+    memcpy(address.sun_path, options_.socket_path.data(),
+           options_.socket_path.size());
+    if (options_.send_buffer_size > 0 &&
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &options_.send_buffer_size,
+                   sizeof(options_.send_buffer_size)) != 0) {
+      LOG(WARNING) << "Failed to set send buffer size: " << strerror(errno);
+    }
+    // Connecting a non-blocking Unix domain socket completes immediately, or
+    // fails with `EAGAIN` if the aggregator's backlog is full.
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0) {
+      int error = errno;
+      LOG(ERROR) << "Failed to connect to " << options_.socket_path << " for "
+                 << file_name << ": " << strerror(error)
+                 << (error == EAGAIN ? " (the aggregator's backlog is full)"
+                                     : "")
+                 << ". Its data will be dropped.";
+      close(fd);
+      fd = -1;
+    }
+  } else {
+    LOG(ERROR) << "Failed to create socket: " << strerror(errno);
+  }
+
+  auto writer = std::make_unique<SocketOutputWriter>(shared_from_this(), fd);
+  bool lost = !writer->SendFileName(file_name);
+  if (lost && fd >= 0) {
+    LOG(ERROR) << "Failed to send the file name " << file_name
+               << " to the aggregator. Its data will be dropped.";
+  }
+  {
+    absl::MutexLock lock(&mutex_);
+    if (fd >= 0) {
+      ++stats_.connections;
+    } else {
+      ++stats_.failed_connections;
+    }
+    if (lost) {
+      ++stats_.lost_streams;
+    }
+  }
+  return writer;
+}
+
+SocketOutputWriterPool::Stats SocketOutputWriterPool::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void SocketOutputWriterPool::RecordStats(const Stats& stats) {
+  absl::MutexLock lock(&mutex_);
+  stats_.sent_frames += stats.sent_frames;
+  stats_.sent_bytes += stats.sent_bytes;
+  stats_.dropped_frames += stats.dropped_frames;
+  stats_.dropped_bytes += stats.dropped_bytes;
+  stats_.partial_frames += stats.partial_frames;
+}
+
+SocketOutputWriter::~SocketOutputWriter() { Close(); }
+
+void SocketOutputWriter::Write(const char* content, std::streamsize size) {
+  absl::Span<const char> chunks[] = {absl::Span<const char>(content, size)};
+  SendFrame(chunks);
+}
+
+void SocketOutputWriter::WriteChunks(
+    absl::Span<const absl::Span<const char>> chunks) {
+  SendFrame(chunks);
+}
+
+void SocketOutputWriter::Close() {
+  if (closed_) return;
+  closed_ = true;
+
+  if (fd_ >= 0) {
+    if (!FlushPending() && fd_ >= 0) {
+      // The aggregator sees the last frame cut short at the end of the
+      // stream.
+      DropFrame(pending_payload_size_);
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+  pool_->RecordStats(stats_);
+}
+
+bool SocketOutputWriter::SendFileName(absl::string_view file_name) {
+  // The first frame tells the aggregator which segment the stream holds, so
+  // the rest of a stream without it is of no use.
+  absl::Span<const char> chunks[] = {absl::Span<const char>(file_name)};
+  if (SendFrame(chunks)) return true;
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  return false;
+}
+
+bool SocketOutputWriter::FlushPending() {
+  while (pending_offset_ < pending_.size()) {
+    ssize_t sent =
+        send(fd_, pending_.data() + pending_offset_,
+             pending_.size() - pending_offset_, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) Fail("send");
+      return false;
+    }
+    pending_offset_ += sent;
+  }
+  if (!pending_.empty()) {
+    ++stats_.sent_frames;
+    stats_.sent_bytes += pending_payload_size_;
+    pending_.clear();
+    pending_offset_ = 0;
+    pending_payload_size_ = 0;
+  }
+  return true;
+}
+
+bool SocketOutputWriter::SendFrame(
+    absl::Span<const absl::Span<const char>> chunks) {
+  size_t payload_size = 0;
+  for (absl::Span<const char> chunk : chunks) {
+    payload_size += chunk.size();
+  }
+  // A frame can only be sent once the previous one has been sent in full.
+  if (fd_ < 0 || !FlushPending()) {
+    DropFrame(payload_size);
+    return false;
+  }
+
+  uint32_t size = static_cast<uint32_t>(payload_size);
+  uint8_t header[4] = {static_cast<uint8_t>(size),
+                       static_cast<uint8_t>(size >> 8),
+                       static_cast<uint8_t>(size >> 16),
+                       static_cast<uint8_t>(size >> 24)};
+  iovecs_.clear();
+  iovecs_.push_back({.iov_base = header, .iov_len = sizeof(header)});
+  for (absl::Span<const char> chunk : chunks) {
+    if (chunk.empty()) continue;
+    iovecs_.push_back({.iov_base = const_cast<char*>(chunk.data()),
+                       .iov_len = chunk.size()});
+  }
+
+  // Frames are gathered into as few calls as `IOV_MAX` allows. `sendmsg` is
+  // used rather than `writev` so that a closed aggregator raises `EPIPE`
+  // instead of `SIGPIPE`.
+  size_t sent_size = 0;
+  size_t first_unsent = 0;
+  while (first_unsent < iovecs_.size()) {
+    size_t batch_end = std::min<size_t>(iovecs_.size(), first_unsent + IOV_MAX);
+    msghdr message = {.msg_iov = &iovecs_[first_unsent],
+                      .msg_iovlen = batch_end - first_unsent};
+    ssize_t sent = sendmsg(fd_, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      DropFrame(payload_size);
+      Fail("sendmsg");
+      return false;
+    }
+    sent_size += sent;
+    // Skip the iovecs that were sent in full, and trim the one that was sent
+    // in part.
+    while (sent > 0) {
+      iovec& unsent = iovecs_[first_unsent];
+      if (static_cast<size_t>(sent) >= unsent.iov_len) {
+        sent -= unsent.iov_len;
+        ++first_unsent;
+      } else {
+        unsent.iov_base = static_cast<char*>(unsent.iov_base) + sent;
+        unsent.iov_len -= sent;
+        sent = 0;
+      }
+    }
+    // A short send means the send buffer is full.
+    if (first_unsent < batch_end) break;
+  }
+
+  if (first_unsent == iovecs_.size()) {
+    ++stats_.sent_frames;
+    stats_.sent_bytes += payload_size;
+    return true;
+  }
+  if (sent_size == 0) {
+    DropFrame(payload_size);
+    return false;
+  }
+  // Part of the frame is already in the stream, so the rest must follow it.
+  ++stats_.partial_frames;
+  pending_payload_size_ = payload_size;
+  for (size_t i = first_unsent; i < iovecs_.size(); ++i) {
+    const char* data = static_cast<const char*>(iovecs_[i].iov_base);
+    pending_.insert(pending_.end(), data, data + iovecs_[i].iov_len);
+  }
+  return true;
+}
+
+void SocketOutputWriter::DropFrame(size_t payload_size) {
+  ++stats_.dropped_frames;
+  stats_.dropped_bytes += payload_size;
+}
+
+void SocketOutputWriter::Fail(absl::string_view operation) {
+  LOG(ERROR) << operation << " failed: " << strerror(errno)
+             << ". Further data will be dropped.";
+  if (!pending_.empty()) {
+    DropFrame(pending_payload_size_);
+    pending_.clear();
+    pending_offset_ = 0;
+    pending_payload_size_ = 0;
+  }
+  close(fd_);
+  fd_ = -1;
+}
+
+OutputWriterProvider CreateSocketOutputWriterProvider(
+    std::shared_ptr<SocketOutputWriterPool> pool) {
+  return [pool = std::move(pool)](absl::string_view file_name) {
+    return pool->CreateWriter(file_name);
+  };
+}
+
+}  // namespace media_api_samples
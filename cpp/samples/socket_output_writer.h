@@ -0,0 +1,168 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_SOCKET_OUTPUT_WRITER_H_
+#define CPP_SAMPLES_SOCKET_OUTPUT_WRITER_H_
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Streams output to a local aggregator over Unix domain sockets instead of
+// writing files.
+//
+// Each writer opens its own connection to `Options::socket_path`. The stream
+// is a sequence of frames, each a 4-byte little-endian payload size followed
+// by the payload. The first frame holds the file name the writer was created
+// for; each `Write` or `WriteChunks` call then sends one frame, and the
+// connection is closed when the writer is closed. Since nothing is written to
+// disk, segments keep the temporary names that collectors would otherwise
+// rename once they are closed, so collectors should be given renamers and
+// removers that do nothing.
+//
+// Sockets are non-blocking, so that a slow aggregator never stalls the
+// collector thread. A frame that does not fit in the socket's send buffer is
+// dropped as a whole and counted in `Stats`. If the kernel accepts only part
+// of a frame, the rest is kept and sent before any later frame, so the
+// aggregator never sees a frame that is cut short, except at the end of a
+// stream that was closed while its last frame was still pending.
+//
+// This class is thread-safe.
+class SocketOutputWriterPool
+    : public std::enable_shared_from_this<SocketOutputWriterPool> {
+ public:
+  struct Options {
+    std::string socket_path;
+    // Size of each connection's send buffer, in bytes, or 0 to keep the system
+    // default. The kernel caps it at `net.core.wmem_max`.
+    int send_buffer_size = 4 << 20;
+  };
+
+  struct Stats {
+    int64_t connections = 0;
+    int64_t failed_connections = 0;
+    int64_t sent_frames = 0;
+    int64_t sent_bytes = 0;
+    // Frames dropped because the send buffer was full, the connection failed,
+    // or the writer was closed before the frame was sent in full.
+    int64_t dropped_frames = 0;
+    int64_t dropped_bytes = 0;
+    // Frames that the kernel accepted only part of at first.
+    int64_t partial_frames = 0;
+    // Writers whose segment the aggregator does not receive, because the
+    // connection failed or the frame with the file name was dropped. All
+    // their data is dropped.
+    int64_t lost_streams = 0;
+  };
+
+  static std::shared_ptr<SocketOutputWriterPool> Create(Options options);
+
+  // Logs the stats of all writers.
+  ~SocketOutputWriterPool();
+
+  // Connects to the aggregator and returns a writer that streams to it. If the
+  // connection fails or the file name cannot be sent, the returned writer
+  // drops all data.
+  std::unique_ptr<OutputWriterInterface> CreateWriter(
+      absl::string_view file_name);
+
+  Stats GetStats() const;
+
+ private:
+  friend class SocketOutputWriter;
+
+  explicit SocketOutputWriterPool(Options options)
+      : options_(std::move(options)) {}
+
+  // Adds a writer's counters to the totals.
+  void RecordStats(const Stats& stats);
+
+  const Options options_;
+
+  mutable absl::Mutex mutex_;
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+// An output writer that sends each write as a frame over a Unix domain socket.
+// See `SocketOutputWriterPool`.
+//
+// This class is not thread-safe.
+class SocketOutputWriter : public OutputWriterInterface {
+ public:
+  SocketOutputWriter(std::shared_ptr<SocketOutputWriterPool> pool, int fd)
+      : pool_(std::move(pool)), fd_(fd) {}
+  ~SocketOutputWriter() override;
+
+  void Write(const char* content, std::streamsize size) override;
+  void WriteChunks(absl::Span<const absl::Span<const char>> chunks) override;
+  void Close() override;
+
+ private:
+  friend class SocketOutputWriterPool;
+
+  // Sends the frame with the file name that starts the stream. Returns false,
+  // and closes the connection, if the frame is dropped.
+  bool SendFileName(absl::string_view file_name);
+  // Sends the pending remainder of a partially sent frame. Returns true once
+  // nothing is pending.
+  bool FlushPending();
+  // Sends a frame made of `chunks`, or drops it if it cannot be sent without
+  // waiting. Returns false if the frame was dropped.
+  bool SendFrame(absl::Span<const absl::Span<const char>> chunks);
+  // Drops a frame of `payload_size` bytes.
+  void DropFrame(size_t payload_size);
+  // Closes the connection after a failure; further data is dropped.
+  void Fail(absl::string_view operation);
+
+  std::shared_ptr<SocketOutputWriterPool> pool_;
+  // The socket, or -1 if the connection failed or has been closed.
+  int fd_;
+  bool closed_ = false;
+  // The unsent remainder of a partially sent frame.
+  std::vector<char> pending_;
+  size_t pending_offset_ = 0;
+  // Payload size of the partially sent frame.
+  size_t pending_payload_size_ = 0;
+  // Reused across frames.
+  std::vector<iovec> iovecs_;
+  // Counters since the writer was created, added to the pool's on close.
+  SocketOutputWriterPool::Stats stats_;
+};
+
+// Returns a provider that creates `SocketOutputWriter`s from `pool`.
+OutputWriterProvider CreateSocketOutputWriterProvider(
+    std::shared_ptr<SocketOutputWriterPool> pool);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_SOCKET_OUTPUT_WRITER_H_
@@ -0,0 +1,235 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/socket_output_writer.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+using ::testing::ElementsAre;
+
+// A listening socket standing in for the aggregator.
+class Aggregator {
+ public:
+  explicit Aggregator(absl::string_view name)
+      : path_(absl::StrCat(::testing::TempDir(), name)) {
+    unlink(path_.c_str());
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un address = {.sun_family = AF_UNIX};
+    memcpy(address.sun_path, path_.data(), path_.size());
+    EXPECT_EQ(bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address),
+                   sizeof(address)),
+              0);
+    EXPECT_EQ(listen(listen_fd_, 4), 0);
+  }
+  ~Aggregator() {
+    close(listen_fd_);
+    unlink(path_.c_str());
+  }
+
+  const std::string& path() const { return path_; }
+
+  // Accepts the next connection.
+  void Accept() {
+    fd_ = accept(listen_fd_, nullptr, nullptr);
+    EXPECT_GE(fd_, 0);
+  }
+
+  // Reads whatever the writer has sent so far, without waiting for more.
+  void Drain() {
+    char buffer[4096];
+    ssize_t size;
+    while ((size = recv(fd_, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+      stream_.append(buffer, size);
+    }
+  }
+
+  // Reads the connection until the writer closes it, and returns the payloads
+  // of all complete frames.
+  std::vector<std::string> ReadFrames() {
+    if (fd_ < 0) Accept();
+    char buffer[4096];
+    ssize_t size;
+    while ((size = read(fd_, buffer, sizeof(buffer))) > 0) {
+      stream_.append(buffer, size);
+    }
+    close(fd_);
+    fd_ = -1;
+
+    std::vector<std::string> frames;
+    size_t offset = 0;
+    while (stream_.size() - offset >= 4) {
+      const auto* header =
+          reinterpret_cast<const uint8_t*>(stream_.data() + offset);
+      size_t frame_size = header[0] | header[1] << 8 | header[2] << 16 |
+                          static_cast<uint32_t>(header[3]) << 24;
+      if (stream_.size() - offset - 4 < frame_size) break;
+      frames.push_back(stream_.substr(offset + 4, frame_size));
+      offset += 4 + frame_size;
+    }
+    return frames;
+  }
+
+ private:
+  std::string path_;
+  int listen_fd_;
+  int fd_ = -1;
+  std::string stream_;
+};
+
+TEST(SocketOutputWriterTest, StreamsFileNameAndEachWriteAsFrame) {
+  Aggregator aggregator("socket_frames");
+  auto pool = SocketOutputWriterPool::Create(
+      {.socket_path = aggregator.path(), .send_buffer_size = 0});
+  OutputWriterProvider provider = CreateSocketOutputWriterProvider(pool);
+
+  std::unique_ptr<OutputWriterInterface> writer = provider("video_1.yuv");
+  writer->Write("abc", 3);
+  absl::Span<const char> chunks[] = {absl::Span<const char>("de", 2),
+                                     absl::Span<const char>(),
+                                     absl::Span<const char>("f", 1)};
+  writer->WriteChunks(chunks);
+  writer->Close();
+
+  EXPECT_THAT(aggregator.ReadFrames(), ElementsAre("video_1.yuv", "abc", "def"));
+  SocketOutputWriterPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(stats.connections, 1);
+  EXPECT_EQ(stats.sent_frames, 3);
+  EXPECT_EQ(stats.sent_bytes, 17);
+  EXPECT_EQ(stats.dropped_frames, 0);
+}
+
+TEST(SocketOutputWriterTest, SendsFramesWithMoreChunksThanIovMax) {
+  Aggregator aggregator("socket_chunks");
+  auto pool = SocketOutputWriterPool::Create({.socket_path = aggregator.path()});
+  std::string data;
+  for (int i = 0; i < 3000; ++i) {
+    data.push_back('a' + i % 26);
+  }
+  std::vector<absl::Span<const char>> chunks;
+  for (size_t i = 0; i < data.size(); i += 2) {
+    chunks.push_back(absl::Span<const char>(data.data() + i, 2));
+  }
+
+  std::unique_ptr<OutputWriterInterface> writer = pool->CreateWriter("audio");
+  writer->WriteChunks(chunks);
+  writer->Close();
+
+  EXPECT_THAT(aggregator.ReadFrames(), ElementsAre("audio", data));
+}
+
+TEST(SocketOutputWriterTest, DropsWholeFramesWhenAggregatorFallsBehind) {
+  Aggregator aggregator("socket_drops");
+  auto pool = SocketOutputWriterPool::Create(
+      {.socket_path = aggregator.path(), .send_buffer_size = 4096});
+
+  // The aggregator does not read until the writer is closed, so the send
+  // buffer fills up.
+  std::unique_ptr<OutputWriterInterface> writer = pool->CreateWriter("name");
+  std::vector<std::string> written = {"name"};
+  for (int i = 0; i < 200; ++i) {
+    written.push_back(std::string(1000, 'a' + i % 26));
+    writer->Write(written.back().data(), written.back().size());
+  }
+  writer->Close();
+
+  std::vector<std::string> frames = aggregator.ReadFrames();
+  SocketOutputWriterPool::Stats stats = pool->GetStats();
+  EXPECT_GT(stats.dropped_frames, 0);
+  EXPECT_EQ(stats.sent_frames + stats.dropped_frames, 201);
+  // Every frame that was sent arrives intact, in order, and the dropped ones
+  // leave no trace in the stream.
+  ASSERT_EQ(frames.size(), stats.sent_frames);
+  EXPECT_EQ(frames[0], "name");
+  size_t next = 1;
+  for (size_t i = 1; i < frames.size(); ++i) {
+    while (next < written.size() && written[next] != frames[i]) ++next;
+    EXPECT_LT(next, written.size()) << "Frame " << i << " is corrupt";
+    ++next;
+  }
+}
+
+TEST(SocketOutputWriterTest, FinishesPartiallySentFrameBeforeLaterFrames) {
+  Aggregator aggregator("socket_partial");
+  auto pool = SocketOutputWriterPool::Create(
+      {.socket_path = aggregator.path(), .send_buffer_size = 4096});
+  std::unique_ptr<OutputWriterInterface> writer = pool->CreateWriter("name");
+  aggregator.Accept();
+
+  // The frame is larger than the send buffer, so the kernel accepts only part
+  // of it, and the next frame cannot be sent until the rest of it is.
+  std::string large(100000, 'x');
+  writer->Write(large.data(), large.size());
+  writer->Write("dropped", 7);
+  // Each write sends more of the large frame while the aggregator reads. The
+  // small frames are dropped until it has been sent in full.
+  for (int i = 0; i < 100; ++i) {
+    aggregator.Drain();
+    writer->Write("abc", 3);
+  }
+  aggregator.Drain();
+  writer->Write("last", 4);
+  writer->Close();
+
+  std::vector<std::string> frames = aggregator.ReadFrames();
+  ASSERT_GE(frames.size(), 3);
+  EXPECT_EQ(frames[0], "name");
+  EXPECT_EQ(frames[1], large);
+  EXPECT_EQ(frames.back(), "last");
+  SocketOutputWriterPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(stats.partial_frames, 1);
+  EXPECT_EQ(stats.sent_frames, frames.size());
+}
+
+TEST(SocketOutputWriterTest, DropsAllDataIfAggregatorIsNotListening) {
+  auto pool = SocketOutputWriterPool::Create(
+      {.socket_path = absl::StrCat(::testing::TempDir(), "no_aggregator")});
+
+  std::unique_ptr<OutputWriterInterface> writer = pool->CreateWriter("name");
+  writer->Write("abc", 3);
+  writer->Close();
+
+  SocketOutputWriterPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(stats.failed_connections, 1);
+  EXPECT_EQ(stats.lost_streams, 1);
+  EXPECT_EQ(stats.sent_frames, 0);
+  EXPECT_EQ(stats.dropped_frames, 2);
+  EXPECT_EQ(stats.dropped_bytes, 7);
+}
+
+}  // namespace
+}  // namespace media_api_samples
@@ -0,0 +1,346 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/storage_health_monitor.h"
+
+#include <sys/statvfs.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+// Returns the free space of the file system of `directory`, or -1 if it cannot
+// be checked.
+int64_t GetFreeBytes(const std::string& directory) {
+  struct statvfs file_system;
+  if (statvfs(directory.c_str(), &file_system) != 0) {
+    LOG(WARNING) << "Failed to check free space of " << directory << ": "
+                 << strerror(errno);
+    return -1;
+  }
+  return static_cast<int64_t>(file_system.f_bavail) *
+         static_cast<int64_t>(file_system.f_frsize);
+}
+
+}  // namespace
+
+absl::string_view StoragePressureName(StoragePressure pressure) {
+  switch (pressure) {
+    case StoragePressure::kNone:
+      return "none";
+    case StoragePressure::kDownscaleVideo:
+      return "downscale video";
+    case StoragePressure::kSpill:
+      return "spill";
+    case StoragePressure::kDropVideo:
+      return "drop video";
+  }
+  return "unknown";
+}
+
+absl::StatusOr<std::shared_ptr<StorageHealthMonitor>>
+StorageHealthMonitor::Create(Options options, OutputFiles files) {
+  if (options.downscale_queued_bytes <= 0 ||
+      options.drop_video_queued_bytes <= 0 || options.max_queued_bytes <= 0) {
+    return absl::InvalidArgumentError("Queued byte limits must be positive");
+  }
+  if (options.downscale_write_latency <= absl::ZeroDuration() ||
+      options.drop_video_write_latency <= absl::ZeroDuration() ||
+      options.spill_write_latency <= absl::ZeroDuration()) {
+    return absl::InvalidArgumentError("Write latency limits must be positive");
+  }
+  if (options.min_free_bytes < 0) {
+    return absl::InvalidArgumentError("Min free bytes must not be negative");
+  }
+  if (options.latency_weight <= 0 || options.latency_weight > 1) {
+    return absl::InvalidArgumentError("Latency weight must be in (0, 1]");
+  }
+  return std::shared_ptr<StorageHealthMonitor>(
+      new StorageHealthMonitor(std::move(options), std::move(files)));
+}
+
+StorageHealthMonitor::~StorageHealthMonitor() {
+  Stats stats = GetStats();
+  LOG(INFO) << "Storage pressure changed " << stats.pressure_changes
+            << " times (" << stats.spills << " spills); downscaled "
+            << stats.downscaled_video_frames << " and dropped "
+            << stats.dropped_video_frames << " video frames, dropped "
+            << stats.dropped_audio_frames << " audio frames, spilled "
+            << stats.spilled_files << " files; at most "
+            << stats.max_queued_bytes << " bytes queued; writes took "
+            << stats.write_latency << " on average (max "
+            << stats.max_write_latency << ")";
+}
+
+StorageHealthMonitor::FrameAction StorageHealthMonitor::AdmitAudioFrame(
+    int64_t size) {
+  absl::MutexLock lock(&mutex_);
+  UpdatePressure(absl::Now());
+  if (stats_.queued_bytes + size > options_.max_queued_bytes) {
+    stats_.dropped_audio_frames++;
+    return FrameAction::kDrop;
+  }
+  return FrameAction::kWrite;
+}
+
+StorageHealthMonitor::FrameAction StorageHealthMonitor::AdmitVideoFrame(
+    int64_t size) {
+  absl::MutexLock lock(&mutex_);
+  UpdatePressure(absl::Now());
+  if (stats_.queued_bytes + size > options_.max_queued_bytes ||
+      stats_.pressure >= StoragePressure::kDropVideo) {
+    stats_.dropped_video_frames++;
+    return FrameAction::kDrop;
+  }
+  if (stats_.pressure >= StoragePressure::kDownscaleVideo) {
+    stats_.downscaled_video_frames++;
+    return FrameAction::kDownscale;
+  }
+  return FrameAction::kWrite;
+}
+
+void StorageHealthMonitor::RecordQueuedBytes(int64_t delta) {
+  absl::MutexLock lock(&mutex_);
+  stats_.queued_bytes += delta;
+  stats_.max_queued_bytes =
+      std::max(stats_.max_queued_bytes, stats_.queued_bytes);
+}
+
+std::unique_ptr<OutputWriterInterface> StorageHealthMonitor::CreateWriter(
+    absl::string_view file_name) {
+  std::string path(file_name);
+  {
+    absl::MutexLock lock(&mutex_);
+    UpdatePressure(absl::Now());
+    if (spilling_) {
+      path = SpillPath(file_name);
+      spilled_files_[file_name] = path;
+      stats_.spilled_files++;
+    }
+  }
+  std::unique_ptr<OutputWriterInterface> output;
+  {
+    absl::MutexLock lock(&files_mutex_);
+    output = files_.provider(path);
+  }
+  return std::make_unique<StorageMonitoredOutputWriter>(shared_from_this(),
+                                                        std::move(output));
+}
+
+void StorageHealthMonitor::Rename(absl::string_view from,
+                                  absl::string_view to) {
+  std::string from_path(from);
+  std::string to_path(to);
+  {
+    absl::MutexLock lock(&mutex_);
+    if (auto it = spilled_files_.find(from); it != spilled_files_.end()) {
+      from_path = std::move(it->second);
+      to_path = SpillPath(to);
+      spilled_files_.erase(it);
+    }
+  }
+  absl::MutexLock lock(&files_mutex_);
+  files_.renamer(from_path, to_path);
+}
+
+void StorageHealthMonitor::Remove(absl::string_view file_name) {
+  std::string path(file_name);
+  {
+    absl::MutexLock lock(&mutex_);
+    if (auto it = spilled_files_.find(file_name);
+        it != spilled_files_.end()) {
+      path = std::move(it->second);
+      spilled_files_.erase(it);
+    }
+  }
+  absl::MutexLock lock(&files_mutex_);
+  files_.remover(path);
+}
+
+StorageHealthMonitor::Stats StorageHealthMonitor::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void StorageHealthMonitor::CheckFreeSpace() {
+  int64_t free_bytes = -1;
+  for (const std::string& directory : options_.directories) {
+    int64_t directory_free_bytes = GetFreeBytes(directory);
+    if (directory_free_bytes >= 0 &&
+        (free_bytes < 0 || directory_free_bytes < free_bytes)) {
+      free_bytes = directory_free_bytes;
+    }
+  }
+  stats_.free_bytes = free_bytes;
+  if (!options_.spill_directory.empty()) {
+    stats_.spill_free_bytes = GetFreeBytes(options_.spill_directory);
+  }
+}
+
+void StorageHealthMonitor::UpdatePressure(absl::Time now) {
+  if (options_.min_free_bytes > 0 &&
+      now - last_free_space_check_ >= options_.free_space_check_interval) {
+    last_free_space_check_ = now;
+    CheckFreeSpace();
+  }
+
+  // A stalled write never finishes, so it is counted while in progress.
+  absl::Duration latency = stats_.write_latency;
+  if (!writes_in_progress_.empty()) {
+    latency = std::max(latency, now - *writes_in_progress_.begin());
+  }
+  StoragePressure pressure = StoragePressure::kNone;
+  if (stats_.queued_bytes >= options_.downscale_queued_bytes ||
+      latency >= options_.downscale_write_latency) {
+    pressure = StoragePressure::kDownscaleVideo;
+  }
+  // Spilling only helps while the spill directory has room. Without it, the
+  // queue is kept short by dropping video instead.
+  bool can_spill = !options_.spill_directory.empty() &&
+                   !(stats_.spill_free_bytes >= 0 &&
+                     stats_.spill_free_bytes < options_.min_free_bytes);
+  if (latency >= options_.spill_write_latency ||
+      (stats_.free_bytes >= 0 && stats_.free_bytes < options_.min_free_bytes)) {
+    pressure = can_spill ? StoragePressure::kSpill
+                         : StoragePressure::kDropVideo;
+  }
+  if (stats_.queued_bytes >= options_.drop_video_queued_bytes ||
+      latency >= options_.drop_video_write_latency) {
+    pressure = StoragePressure::kDropVideo;
+  }
+
+  if (pressure >= stats_.pressure) {
+    pressure_confirmed_ = now;
+  }
+  if (pressure > stats_.pressure ||
+      (pressure < stats_.pressure &&
+       now - pressure_confirmed_ >= options_.recovery_time)) {
+    pressure_confirmed_ = now;
+    LOG(WARNING) << "Storage pressure changed from "
+                 << StoragePressureName(stats_.pressure) << " to "
+                 << StoragePressureName(pressure) << ": "
+                 << stats_.queued_bytes << " bytes queued, write latency "
+                 << latency << ", " << stats_.free_bytes << " bytes free, "
+                 << stats_.spill_free_bytes << " bytes free to spill";
+    stats_.pressure = pressure;
+    stats_.pressure_changes++;
+  }
+  // Files keep spilling while video is also dropped, unless the spill
+  // directory is out of space too.
+  bool spilling = stats_.pressure >= StoragePressure::kSpill && can_spill;
+  if (spilling && !spilling_) {
+    stats_.spills++;
+  }
+  spilling_ = spilling;
+}
+
+std::string StorageHealthMonitor::SpillPath(
+    absl::string_view file_name) const {
+  size_t separator = file_name.rfind('/');
+  absl::string_view base_name = separator == absl::string_view::npos
+                                    ? file_name
+                                    : file_name.substr(separator + 1);
+  return absl::StrCat(absl::StripSuffix(options_.spill_directory, "/"), "/",
+                      base_name);
+}
+
+absl::Time StorageHealthMonitor::StartWrite() {
+  absl::Time start = absl::Now();
+  absl::MutexLock lock(&mutex_);
+  writes_in_progress_.insert(start);
+  return start;
+}
+
+void StorageHealthMonitor::FinishWrite(absl::Time start) {
+  absl::Time end = absl::Now();
+  absl::MutexLock lock(&mutex_);
+  writes_in_progress_.erase(writes_in_progress_.find(start));
+  absl::Duration latency = end - start;
+  stats_.write_latency = options_.latency_weight * latency +
+                         (1 - options_.latency_weight) * stats_.write_latency;
+  stats_.max_write_latency = std::max(stats_.max_write_latency, latency);
+}
+
+void StorageMonitoredOutputWriter::Write(const char* content,
+                                         std::streamsize size) {
+  absl::Time start = monitor_->StartWrite();
+  output_->Write(content, size);
+  monitor_->FinishWrite(start);
+}
+
+void StorageMonitoredOutputWriter::WriteChunks(
+    absl::Span<const absl::Span<const char>> chunks) {
+  absl::Time start = monitor_->StartWrite();
+  output_->WriteChunks(chunks);
+  monitor_->FinishWrite(start);
+}
+
+void StorageMonitoredOutputWriter::Flush() {
+  // Flushing writes buffered data, so it counts as a write.
+  absl::Time start = monitor_->StartWrite();
+  output_->Flush();
+  monitor_->FinishWrite(start);
+}
+
+void StorageMonitoredOutputWriter::Close() {
+  // Closing flushes buffered data, so it counts as a write.
+  absl::Time start = monitor_->StartWrite();
+  output_->Close();
+  monitor_->FinishWrite(start);
+}
+
+OutputFiles CreateStorageMonitoredOutputFiles(
+    std::shared_ptr<StorageHealthMonitor> monitor) {
+  return {.provider =
+              [monitor](absl::string_view file_name) {
+                return monitor->CreateWriter(file_name);
+              },
+          .renamer =
+              [monitor](absl::string_view from, absl::string_view to) {
+                monitor->Rename(from, to);
+              },
+          .remover =
+              [monitor](absl::string_view file_name) {
+                monitor->Remove(file_name);
+              }};
+}
+
+}  // namespace media_api_samples
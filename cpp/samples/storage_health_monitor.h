@@ -0,0 +1,223 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_STORAGE_HEALTH_MONITOR_H_
+#define CPP_SAMPLES_STORAGE_HEALTH_MONITOR_H_
+
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// How far recording is degraded to keep up with storage. Each level also takes
+// the actions of the levels below it.
+enum class StoragePressure {
+  kNone,
+  // Video frames are downscaled to half their width and height.
+  kDownscaleVideo,
+  // New files are written to the spill directory. Only entered while the
+  // spill directory has free space; otherwise storage goes to `kDropVideo`.
+  kSpill,
+  // Video frames are dropped.
+  kDropVideo,
+};
+
+absl::string_view StoragePressureName(StoragePressure pressure);
+
+// Watches the storage that media is written to, and decides how far recording
+// must degrade so that a slow or full disk does not exhaust memory.
+//
+// Frames are copied and queued for the collector thread, which blocks while
+// writing to a stalled disk. The monitor tracks the bytes of queued frames,
+// the latency of writes through the files it wraps, including writes that are
+// still in progress, and the free space of the output and spill directories.
+// From these it
+// derives a `StoragePressure`, which rises as soon as a threshold is crossed
+// and falls once the thresholds of the current level have not been crossed for
+// `recovery_time`, so that recording quality does not flap.
+//
+// Independently of the pressure, frames that would take the queue past
+// `max_queued_bytes` are dropped, whatever their kind.
+//
+// This class is thread-safe.
+class StorageHealthMonitor
+    : public std::enable_shared_from_this<StorageHealthMonitor> {
+ public:
+  struct Options {
+    // Directories that files are written to, whose file systems are checked
+    // for free space. The directory with the least free space counts. Empty
+    // disables the check.
+    std::vector<std::string> directories;
+    // Directory that new files are written to under `kSpill`, keeping their
+    // base names. Empty disables spilling, so that storage that would spill
+    // drops video instead.
+    std::string spill_directory;
+
+    // Each level is entered when any of its thresholds is crossed. Write
+    // latency is a moving average, or the age of the oldest write in progress
+    // if that is longer.
+    int64_t downscale_queued_bytes = 16 << 20;
+    absl::Duration downscale_write_latency = absl::Milliseconds(50);
+    absl::Duration spill_write_latency = absl::Milliseconds(250);
+    int64_t drop_video_queued_bytes = 64 << 20;
+    absl::Duration drop_video_write_latency = absl::Seconds(2);
+    // Free space of the output directories below which new files spill, and
+    // of the spill directory below which spilling stops. Zero disables both.
+    int64_t min_free_bytes = 0;
+
+    // Queued bytes beyond which all frames are dropped.
+    int64_t max_queued_bytes = 256 << 20;
+    absl::Duration free_space_check_interval = absl::Seconds(1);
+    // How long the pressure must stay below its level before it is lowered.
+    absl::Duration recovery_time = absl::Seconds(5);
+    // Weight of each write in the moving average of write latency.
+    double latency_weight = 0.1;
+  };
+
+  struct Stats {
+    StoragePressure pressure = StoragePressure::kNone;
+    int64_t pressure_changes = 0;
+    // Number of times new files started going to the spill directory.
+    int64_t spills = 0;
+    int64_t queued_bytes = 0;
+    int64_t max_queued_bytes = 0;
+    absl::Duration write_latency;
+    absl::Duration max_write_latency;
+    // Free space of the output directories, or -1 if not checked.
+    int64_t free_bytes = -1;
+    // Free space of the spill directory, or -1 if not checked.
+    int64_t spill_free_bytes = -1;
+    int64_t downscaled_video_frames = 0;
+    int64_t dropped_video_frames = 0;
+    int64_t dropped_audio_frames = 0;
+    int64_t spilled_files = 0;
+  };
+
+  // What to do with a frame before queueing it.
+  enum class FrameAction {
+    kWrite,
+    kDownscale,
+    kDrop,
+  };
+
+  // Creates a monitor writing files through `files`.
+  static absl::StatusOr<std::shared_ptr<StorageHealthMonitor>> Create(
+      Options options, OutputFiles files);
+
+  // Logs the stats.
+  ~StorageHealthMonitor();
+
+  // Decide what to do with a frame of `size` bytes, and count the action.
+  // Frames that are not dropped must be reported with `RecordQueuedBytes`.
+  FrameAction AdmitAudioFrame(int64_t size);
+  FrameAction AdmitVideoFrame(int64_t size);
+  // Adds `delta` to the bytes of queued frames. Frames are reported once when
+  // queued and once, negated, when handled.
+  void RecordQueuedBytes(int64_t delta);
+
+  // Opens `file_name` through the wrapped provider, in the spill directory if
+  // spilling.
+  std::unique_ptr<OutputWriterInterface> CreateWriter(
+      absl::string_view file_name);
+  // Rename and remove files created by the monitor, wherever they went.
+  void Rename(absl::string_view from, absl::string_view to);
+  void Remove(absl::string_view file_name);
+
+  Stats GetStats() const;
+
+ private:
+  friend class StorageMonitoredOutputWriter;
+
+  StorageHealthMonitor(Options options, OutputFiles files)
+      : options_(std::move(options)), files_(std::move(files)) {}
+
+  // Updates the pressure from the current measurements.
+  void UpdatePressure(absl::Time now) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Updates the free space of the output and spill directories.
+  void CheckFreeSpace() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Returns the path of `file_name` in the spill directory.
+  std::string SpillPath(absl::string_view file_name) const;
+  // Called around each write through a monitored writer.
+  absl::Time StartWrite();
+  void FinishWrite(absl::Time start);
+
+  const Options options_;
+
+  // Providers, renamers, and removers are not required to be thread-safe.
+  absl::Mutex files_mutex_;
+  OutputFiles files_ ABSL_GUARDED_BY(files_mutex_);
+
+  mutable absl::Mutex mutex_;
+  // Start times of the writes in progress.
+  std::multiset<absl::Time> writes_in_progress_ ABSL_GUARDED_BY(mutex_);
+  // Files created in the spill directory, by the name they were created with.
+  absl::flat_hash_map<std::string, std::string> spilled_files_
+      ABSL_GUARDED_BY(mutex_);
+  absl::Time last_free_space_check_ ABSL_GUARDED_BY(mutex_) =
+      absl::InfinitePast();
+  // Whether new files go to the spill directory.
+  bool spilling_ ABSL_GUARDED_BY(mutex_) = false;
+  // Last time the measurements reached the current pressure.
+  absl::Time pressure_confirmed_ ABSL_GUARDED_BY(mutex_) =
+      absl::InfinitePast();
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+// An output writer that reports the latency of each write to a
+// `StorageHealthMonitor`.
+//
+// This class is not thread-safe.
+class StorageMonitoredOutputWriter : public OutputWriterInterface {
+ public:
+  StorageMonitoredOutputWriter(std::shared_ptr<StorageHealthMonitor> monitor,
+                               std::unique_ptr<OutputWriterInterface> output)
+      : monitor_(std::move(monitor)), output_(std::move(output)) {}
+
+  void Write(const char* content, std::streamsize size) override;
+  void WriteChunks(absl::Span<const absl::Span<const char>> chunks) override;
+  void Flush() override;
+  void Close() override;
+
+ private:
+  std::shared_ptr<StorageHealthMonitor> monitor_;
+  std::unique_ptr<OutputWriterInterface> output_;
+};
+
+// Returns output files that write through `monitor`.
+OutputFiles CreateStorageMonitoredOutputFiles(
+    std::shared_ptr<StorageHealthMonitor> monitor);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_STORAGE_HEALTH_MONITOR_H_
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/storage_health_monitor.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/testing/mock_output_writer.h"
+#include "rtc_base/thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+using ::testing::_;
+using ::testing::AnyNumber;
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+using FrameAction = StorageHealthMonitor::FrameAction;
+
+// Output files that record the files they are asked for, and hand out
+// writers that discard data.
+struct FakeOutputFiles {
+  OutputFiles Get() {
+    return {.provider =
+                [this](absl::string_view file_name) {
+                  opened.emplace_back(file_name);
+                  auto writer = std::make_unique<MockOutputWriter>();
+                  EXPECT_CALL(*writer, Write(_, _)).Times(AnyNumber());
+                  EXPECT_CALL(*writer, Close).Times(AnyNumber());
+                  return writer;
+                },
+            .renamer =
+                [this](absl::string_view from, absl::string_view to) {
+                  renamed.emplace_back(from, to);
+                },
+            .remover =
+                [this](absl::string_view file_name) {
+                  removed.emplace_back(file_name);
+                }};
+  }
+
+  std::vector<std::string> opened;
+  std::vector<std::pair<std::string, std::string>> renamed;
+  std::vector<std::string> removed;
+};
+
+TEST(StorageHealthMonitorTest, DegradesVideoAsFramesQueueUp) {
+  FakeOutputFiles files;
+  absl::StatusOr<std::shared_ptr<StorageHealthMonitor>> monitor =
+      StorageHealthMonitor::Create({.downscale_queued_bytes = 100,
+                                    .drop_video_queued_bytes = 200,
+                                    .max_queued_bytes = 300},
+                                   files.Get());
+  ASSERT_TRUE(monitor.ok());
+
+  EXPECT_EQ((*monitor)->AdmitVideoFrame(10), FrameAction::kWrite);
+  (*monitor)->RecordQueuedBytes(100);
+  EXPECT_EQ((*monitor)->AdmitVideoFrame(10), FrameAction::kDownscale);
+  (*monitor)->RecordQueuedBytes(100);
+  EXPECT_EQ((*monitor)->AdmitVideoFrame(10), FrameAction::kDrop);
+  EXPECT_EQ((*monitor)->AdmitAudioFrame(10), FrameAction::kWrite);
+  // Audio is only dropped once the queue is full.
+  EXPECT_EQ((*monitor)->AdmitAudioFrame(101), FrameAction::kDrop);
+
+  StorageHealthMonitor::Stats stats = (*monitor)->GetStats();
+  EXPECT_EQ(stats.pressure, StoragePressure::kDropVideo);
+  EXPECT_EQ(stats.pressure_changes, 2);
+  EXPECT_EQ(stats.max_queued_bytes, 200);
+  EXPECT_EQ(stats.downscaled_video_frames, 1);
+  EXPECT_EQ(stats.dropped_video_frames, 1);
+  EXPECT_EQ(stats.dropped_audio_frames, 1);
+}
+
+TEST(StorageHealthMonitorTest, LowersPressureAfterRecoveryTime) {
+  FakeOutputFiles files;
+  absl::StatusOr<std::shared_ptr<StorageHealthMonitor>> monitor =
+      StorageHealthMonitor::Create({.downscale_queued_bytes = 100,
+                                    .drop_video_queued_bytes = 100,
+                                    .recovery_time = absl::Milliseconds(100)},
+                                   files.Get());
+  ASSERT_TRUE(monitor.ok());
+
+  (*monitor)->RecordQueuedBytes(100);
+  EXPECT_EQ((*monitor)->AdmitVideoFrame(10), FrameAction::kDrop);
+  (*monitor)->RecordQueuedBytes(-100);
+  EXPECT_EQ((*monitor)->AdmitVideoFrame(10), FrameAction::kDrop);
+
+  absl::SleepFor(absl::Milliseconds(150));
+  EXPECT_EQ((*monitor)->AdmitVideoFrame(10), FrameAction::kWrite);
+  EXPECT_EQ((*monitor)->GetStats().pressure_changes, 2);
+}
+
+TEST(StorageHealthMonitorTest, CountsStalledWriteWhileInProgress) {
+  absl::Notification write_started;
+  absl::Notification release_write;
+  OutputFiles files = {
+      .provider =
+          [&](absl::string_view) {
+            auto writer = std::make_unique<MockOutputWriter>();
+            EXPECT_CALL(*writer, Write(_, _)).WillOnce([&] {
+              write_started.Notify();
+              release_write.WaitForNotification();
+            });
+            return writer;
+          },
+      .renamer = [](absl::string_view, absl::string_view) {},
+      .remover = [](absl::string_view) {}};
+  absl::StatusOr<std::shared_ptr<StorageHealthMonitor>> monitor =
+      StorageHealthMonitor::Create(
+          {.drop_video_write_latency = absl::Milliseconds(20)},
+          std::move(files));
+  ASSERT_TRUE(monitor.ok());
+  std::unique_ptr<OutputWriterInterface> writer =
+      (*monitor)->CreateWriter("/out/video.yuv");
+
+  std::unique_ptr<webrtc::Thread> write_thread = webrtc::Thread::Create();
+  write_thread->Start();
+  write_thread->PostTask([&] { writer->Write("abc", 3); });
+  write_started.WaitForNotification();
+  absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while ((*monitor)->AdmitVideoFrame(10) != FrameAction::kDrop &&
+         absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  release_write.Notify();
+  write_thread->Stop();
+
+  StorageHealthMonitor::Stats stats = (*monitor)->GetStats();
+  EXPECT_GE(stats.pressure, StoragePressure::kDropVideo);
+  EXPECT_GE(stats.max_write_latency, absl::Milliseconds(20));
+}
+
+TEST(StorageHealthMonitorTest, SpillsNewFilesWhenFreeSpaceIsLow) {
+  FakeOutputFiles files;
+  absl::StatusOr<std::shared_ptr<StorageHealthMonitor>> monitor =
+      StorageHealthMonitor::Create(
+          {.directories = {::testing::TempDir()},
+           .spill_directory = "/spill/",
+           .min_free_bytes = std::numeric_limits<int64_t>::max()},
+          files.Get());
+  ASSERT_TRUE(monitor.ok());
+
+  // Video keeps being written while new files spill.
+  EXPECT_EQ((*monitor)->AdmitVideoFrame(10), FrameAction::kDownscale);
+
+  (*monitor)->CreateWriter("/out/audio_1_tmp.pcm")->Close();
+  (*monitor)->CreateWriter("/out/audio_2_tmp.pcm")->Close();
+  (*monitor)->Rename("/out/audio_1_tmp.pcm", "/out/audio_1_start_end.pcm");
+  (*monitor)->Remove("/out/audio_2_tmp.pcm");
+  (*monitor)->Rename("/out/event_log_tmp.csv", "/out/event_log.csv");
+
+  EXPECT_THAT(files.opened,
+              ElementsAre("/spill/audio_1_tmp.pcm", "/spill/audio_2_tmp.pcm"));
+  EXPECT_THAT(files.renamed,
+              ElementsAre(Pair("/spill/audio_1_tmp.pcm",
+                               "/spill/audio_1_start_end.pcm"),
+                          Pair("/out/event_log_tmp.csv",
+                               "/out/event_log.csv")));
+  EXPECT_THAT(files.removed, ElementsAre("/spill/audio_2_tmp.pcm"));
+  StorageHealthMonitor::Stats stats = (*monitor)->GetStats();
+  EXPECT_EQ(stats.pressure, StoragePressure::kSpill);
+  EXPECT_EQ(stats.spills, 1);
+  EXPECT_EQ(stats.spilled_files, 2);
+  EXPECT_GE(stats.free_bytes, 0);
+}
+
+TEST(StorageHealthMonitorTest, DropsVideoWhenFreeSpaceIsLowAndCannotSpill) {
+  FakeOutputFiles files;
+  // The spill directory is on the same, equally full, file system.
+  absl::StatusOr<std::shared_ptr<StorageHealthMonitor>> monitor =
+      StorageHealthMonitor::Create(
+          {.directories = {::testing::TempDir()},
+           .spill_directory = ::testing::TempDir(),
+           .min_free_bytes = std::numeric_limits<int64_t>::max()},
+          files.Get());
+  ASSERT_TRUE(monitor.ok());
+
+  EXPECT_EQ((*monitor)->AdmitVideoFrame(10), FrameAction::kDrop);
+  (*monitor)->CreateWriter("/out/audio_1_tmp.pcm")->Close();
+
+  EXPECT_THAT(files.opened, ElementsAre("/out/audio_1_tmp.pcm"));
+  StorageHealthMonitor::Stats stats = (*monitor)->GetStats();
+  EXPECT_EQ(stats.pressure, StoragePressure::kDropVideo);
+  EXPECT_EQ(stats.spills, 0);
+  EXPECT_GE(stats.spill_free_bytes, 0);
+}
+
+TEST(StorageHealthMonitorTest, IgnoresFreeSpaceByDefault) {
+  FakeOutputFiles files;
+  absl::StatusOr<std::shared_ptr<StorageHealthMonitor>> monitor =
+      StorageHealthMonitor::Create({.directories = {::testing::TempDir()}},
+                                   files.Get());
+  ASSERT_TRUE(monitor.ok());
+
+  EXPECT_EQ((*monitor)->AdmitVideoFrame(10), FrameAction::kWrite);
+  EXPECT_EQ((*monitor)->GetStats().free_bytes, -1);
+}
+
+TEST(StorageHealthMonitorTest, FailsWithInvalidOptions) {
+  FakeOutputFiles files;
+  EXPECT_EQ(StorageHealthMonitor::Create({.max_queued_bytes = 0}, files.Get())
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(StorageHealthMonitor::Create({.latency_weight = 0}, files.Get())
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace media_api_samples
@@ -30,6 +30,7 @@ class MockOutputWriter : public OutputWriterInterface {
  public:
   MOCK_METHOD(void, Write, (const char* content, std::streamsize size),
               (override));
+  MOCK_METHOD(void, Flush, (), (override));
   MOCK_METHOD(void, Close, (), (override));
 };
 
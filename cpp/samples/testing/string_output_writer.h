@@ -0,0 +1,53 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_TESTING_STRING_OUTPUT_WRITER_H_
+#define CPP_SAMPLES_TESTING_STRING_OUTPUT_WRITER_H_
+
+#include <ios>
+#include <string>
+
+#include "absl/base/nullability.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+namespace media_api_samples {
+
+// Output writer that appends everything written to a string, and optionally
+// records whether it was closed.
+class StringOutputWriter : public OutputWriterInterface {
+ public:
+  explicit StringOutputWriter(std::string& output) : output_(output) {}
+  StringOutputWriter(std::string& output, bool& closed)
+      : output_(output), closed_(&closed) {}
+
+  void Write(const char* content, std::streamsize size) override {
+    output_.append(content, size);
+  }
+  void Close() override {
+    if (closed_ != nullptr) {
+      *closed_ = true;
+    }
+  }
+
+ private:
+  std::string& output_;
+  bool* /*absl_nullable*/ closed_ = nullptr;
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_TESTING_STRING_OUTPUT_WRITER_H_
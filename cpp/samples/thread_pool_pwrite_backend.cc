@@ -0,0 +1,97 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "meet_clients/samples/thread_pool_pwrite_backend.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/log/check.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/async_io_backend_interface.h"
+#include "rtc_base/thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+// Writes all of `data` at `offset`, retrying short writes. Returns the number
+// of bytes written, or a negated `errno` value on failure.
+int64_t PwriteAll(int fd, absl::Span<const char> data, int64_t offset) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t result = pwrite(fd, data.data() + written, data.size() - written,
+                            offset + written);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      return -errno;
+    }
+    written += result;
+  }
+  return written;
+}
+
+}  // namespace
+
+std::unique_ptr<ThreadPoolPwriteBackend> ThreadPoolPwriteBackend::Create(
+    int thread_count, CompletionCallback on_complete) {
+  CHECK_GT(thread_count, 0);
+  std::vector<std::unique_ptr<webrtc::Thread>> threads;
+  threads.reserve(thread_count);
+  for (int i = 0; i < thread_count; ++i) {
+    std::unique_ptr<webrtc::Thread> thread = webrtc::Thread::Create();
+    thread->SetName(absl::StrCat("pwrite_thread_", i), nullptr);
+    CHECK(thread->Start());
+    threads.push_back(std::move(thread));
+  }
+  return absl::WrapUnique(
+      new ThreadPoolPwriteBackend(std::move(threads), std::move(on_complete)));
+}
+
+ThreadPoolPwriteBackend::ThreadPoolPwriteBackend(
+    std::vector<std::unique_ptr<webrtc::Thread>> threads,
+    CompletionCallback on_complete)
+    : threads_(std::move(threads)), on_complete_(std::move(on_complete)) {}
+
+ThreadPoolPwriteBackend::~ThreadPoolPwriteBackend() {
+  for (std::unique_ptr<webrtc::Thread>& thread : threads_) {
+    thread->Stop();
+  }
+}
+
+void ThreadPoolPwriteBackend::SubmitWrites(
+    absl::Span<const WriteRequest> requests) {
+  for (const WriteRequest& request : requests) {
+    webrtc::Thread& thread =
+        *threads_[next_thread_.fetch_add(1, std::memory_order_relaxed) %
+                  threads_.size()];
+    thread.PostTask([this, request] {
+      on_complete_(request.buffer_index,
+                   PwriteAll(request.fd, request.data, request.offset));
+    });
+  }
+}
+
+}  // namespace media_api_samples
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_SAMPLES_THREAD_POOL_PWRITE_BACKEND_H_
+#define CPP_SAMPLES_THREAD_POOL_PWRITE_BACKEND_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/async_io_backend_interface.h"
+#include "rtc_base/thread.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// An asynchronous I/O backend that performs blocking `pwrite` calls on a pool
+// of worker threads.
+//
+// This is the fallback for systems where io_uring is not available. Writes
+// carry explicit offsets, so they may complete in any order.
+//
+// This class is thread-safe.
+class ThreadPoolPwriteBackend : public AsyncIoBackendInterface {
+ public:
+  static std::unique_ptr<ThreadPoolPwriteBackend> Create(
+      int thread_count, CompletionCallback on_complete);
+
+  ~ThreadPoolPwriteBackend() override;
+
+  void SubmitWrites(absl::Span<const WriteRequest> requests) override;
+
+ private:
+  ThreadPoolPwriteBackend(std::vector<std::unique_ptr<webrtc::Thread>> threads,
+                          CompletionCallback on_complete);
+
+  std::vector<std::unique_ptr<webrtc::Thread>> threads_;
+  CompletionCallback on_complete_;
+  // Round-robin index of the next thread to receive a write.
+  std::atomic<unsigned> next_thread_ = 0;
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_THREAD_POOL_PWRITE_BACKEND_H_
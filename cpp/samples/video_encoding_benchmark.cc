@@ -0,0 +1,127 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Benchmarks for encoding video segments, used to size recording hosts.
+//
+// Each iteration hands one 400x400 I420 frame (the maximum resolution the
+// multi-user sample requests) to an encoded segment writer. The reported
+// `fps_per_core` counter is the number of frames one core can encode per
+// second; a host recording `n` streams at 30 fps needs about
+// `n * 30 / fps_per_core` cores for encoding.
+
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/base/nullability.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/encoded_video_segment_writer.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/video_segment_writer_interface.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
+#include "api/video_codecs/video_codec.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+constexpr int kFrameWidth = 400;
+constexpr int kFrameHeight = 400;
+// Number of distinct frames to cycle through, so that the encoder sees motion.
+constexpr int kDistinctFrames = 30;
+
+class NullOutputWriter : public OutputWriterInterface {
+ public:
+  void Write(const char* content, std::streamsize size) override {}
+  void Close() override {}
+};
+
+std::vector<webrtc::scoped_refptr<webrtc::I420BufferInterface>>
+CreateMovingFrames() {
+  std::vector<webrtc::scoped_refptr<webrtc::I420BufferInterface>> frames;
+  for (int i = 0; i < kDistinctFrames; ++i) {
+    webrtc::scoped_refptr<webrtc::I420Buffer> frame =
+        webrtc::I420Buffer::Create(kFrameWidth, kFrameHeight);
+    webrtc::I420Buffer::SetBlack(frame.get());
+    // A diagonal gradient that shifts by a few pixels every frame.
+    for (int y = 0; y < kFrameHeight; ++y) {
+      for (int x = 0; x < kFrameWidth; ++x) {
+        frame->MutableDataY()[y * frame->StrideY() + x] =
+            static_cast<uint8_t>(x + y + 4 * i);
+      }
+    }
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+void BM_EncodeVideoSegment(benchmark::State& state,
+                           VideoEncoderPool::Codec codec) {
+  absl::StatusOr<std::shared_ptr<VideoEncoderPool>> pool =
+      VideoEncoderPool::Create(
+          {.codec = codec,
+           .complexity = static_cast<webrtc::VideoCodecComplexity>(
+               state.range(0)),
+           // Never drop frames, so that every iteration is encoded.
+           .max_queued_frames = 1 << 30});
+  if (!pool.ok()) {
+    state.SkipWithError("Failed to create video encoder pool");
+    return;
+  }
+  std::vector<webrtc::scoped_refptr<webrtc::I420BufferInterface>> frames =
+      CreateMovingFrames();
+  std::unique_ptr<VideoSegmentWriterInterface> writer = (*pool)->CreateWriter(
+      std::make_unique<NullOutputWriter>(), kFrameWidth, kFrameHeight);
+
+  int64_t frame_index = 0;
+  for (auto _ : state) {
+    writer->WriteFrame(frames[frame_index % kDistinctFrames],
+                       absl::UnixEpoch() + frame_index * absl::Seconds(1) / 30);
+    frame_index++;
+  }
+  // Closing waits for the encoder thread to catch up.
+  writer->Close();
+
+  VideoEncoderPool::Stats stats = (*pool)->GetStats();
+  state.SetItemsProcessed(stats.encoded_frames);
+  state.counters["fps_per_core"] =
+      stats.EncodedFramesPerCoreSecond(/*cores_per_encoder=*/1);
+  state.counters["kbps"] = stats.encoded_frames > 0
+                               ? stats.encoded_bytes * 8.0 * 30 /
+                                     stats.encoded_frames / 1000
+                               : 0;
+}
+
+void BM_EncodeVp9(benchmark::State& state) {
+  BM_EncodeVideoSegment(state, VideoEncoderPool::Codec::kVp9);
+}
+
+void BM_EncodeAv1(benchmark::State& state) {
+  BM_EncodeVideoSegment(state, VideoEncoderPool::Codec::kAv1);
+}
+
+// Arguments are `webrtc::VideoCodecComplexity` values: low, normal and high.
+BENCHMARK(BM_EncodeVp9)->Arg(-1)->Arg(0)->Arg(1)->UseRealTime();
+BENCHMARK(BM_EncodeAv1)->Arg(-1)->Arg(0)->Arg(1)->UseRealTime();
+
+}  // namespace
+}  // namespace media_api_samples
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_VIDEO_SEGMENT_WRITER_INTERFACE_H_
+#define CPP_SAMPLES_VIDEO_SEGMENT_WRITER_INTERFACE_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Interface for writing the frames of a single video segment.
+//
+// All frames of a segment have the same resolution.
+class VideoSegmentWriterInterface {
+ public:
+  virtual ~VideoSegmentWriterInterface() = default;
+  virtual void WriteFrame(
+      webrtc::scoped_refptr<webrtc::I420BufferInterface> frame,
+      absl::Time received_time) = 0;
+  // Finishes the segment and closes its output. Once this returns, the output
+  // file may be renamed.
+  virtual void Close() = 0;
+
+  // Closes `writer` like `Close`, destroys it, then calls `on_closed`, after
+  // which the output file may be renamed. Writers that finish segments on
+  // another thread return first, and do the rest on that thread.
+  static void CloseAsync(std::unique_ptr<VideoSegmentWriterInterface> writer,
+                         absl::AnyInvocable<void() &&> on_closed) {
+    VideoSegmentWriterInterface& closing = *writer;
+    closing.StartClose(std::move(writer), std::move(on_closed));
+  }
+
+ protected:
+  // Implements `CloseAsync` for this writer, which `self` owns. By default,
+  // closes it on the calling thread.
+  virtual void StartClose(std::unique_ptr<VideoSegmentWriterInterface> self,
+                          absl::AnyInvocable<void() &&> on_closed) {
+    Close();
+    self.reset();
+    std::move(on_closed)();
+  }
+};
+
+// Describes how video segments are stored.
+struct VideoSegmentFormat {
+  using WriterFactory =
+      absl::AnyInvocable<std::unique_ptr<VideoSegmentWriterInterface>(
+          std::unique_ptr<OutputWriterInterface> output, int width,
+          int height)>;
+
+  // Extension of segment files, without the leading dot.
+  std::string file_extension;
+  // Creates a writer for a segment of `width`x`height` frames that writes to
+  // `output`.
+  WriterFactory create_writer;
+  // Whether collectors write a sidecar index of the frames of each segment,
+  // see `SegmentIndexWriter`. Only meaningful for formats that store frames
+  // uncompressed and back to back, since frame offsets are derived from the
+  // sizes of the frames before them.
+  bool index_frames = false;
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_VIDEO_SEGMENT_WRITER_INTERFACE_H_
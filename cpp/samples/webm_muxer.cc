@@ -0,0 +1,381 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/webm_muxer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/log/check.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+// EBML and Matroska element IDs, including their length markers.
+constexpr uint32_t kEbmlId = 0x1A45DFA3;
+constexpr uint32_t kEbmlVersionId = 0x4286;
+constexpr uint32_t kEbmlReadVersionId = 0x42F7;
+constexpr uint32_t kEbmlMaxIdLengthId = 0x42F2;
+constexpr uint32_t kEbmlMaxSizeLengthId = 0x42F3;
+constexpr uint32_t kDocTypeId = 0x4282;
+constexpr uint32_t kDocTypeVersionId = 0x4287;
+constexpr uint32_t kDocTypeReadVersionId = 0x4285;
+constexpr uint32_t kSegmentId = 0x18538067;
+constexpr uint32_t kInfoId = 0x1549A966;
+constexpr uint32_t kTimestampScaleId = 0x2AD7B1;
+constexpr uint32_t kMuxingAppId = 0x4D80;
+constexpr uint32_t kWritingAppId = 0x5741;
+constexpr uint32_t kDateUtcId = 0x4461;
+constexpr uint32_t kTracksId = 0x1654AE6B;
+constexpr uint32_t kTrackEntryId = 0xAE;
+constexpr uint32_t kTrackNumberId = 0xD7;
+constexpr uint32_t kTrackUidId = 0x73C5;
+constexpr uint32_t kTrackTypeId = 0x83;
+constexpr uint32_t kFlagLacingId = 0x9C;
+constexpr uint32_t kCodecIdId = 0x86;
+constexpr uint32_t kCodecPrivateId = 0x63A2;
+constexpr uint32_t kCodecDelayId = 0x56AA;
+constexpr uint32_t kSeekPreRollId = 0x56BB;
+constexpr uint32_t kVideoId = 0xE0;
+constexpr uint32_t kPixelWidthId = 0xB0;
+constexpr uint32_t kPixelHeightId = 0xBA;
+constexpr uint32_t kAudioId = 0xE1;
+constexpr uint32_t kSamplingFrequencyId = 0xB5;
+constexpr uint32_t kChannelsId = 0x9F;
+constexpr uint32_t kClusterId = 0x1F43B675;
+constexpr uint32_t kTimestampId = 0xE7;
+constexpr uint32_t kSimpleBlockId = 0xA3;
+
+constexpr int kVideoTrackNumber = 1;
+constexpr int kAudioTrackNumber = 2;
+constexpr int kVideoTrackType = 1;
+constexpr int kAudioTrackType = 2;
+// Timestamps are in milliseconds.
+constexpr int64_t kTimestampScaleNs = 1000000;
+// An 8-byte size with every value bit set means the size is unknown.
+constexpr uint64_t kUnknownSize = 0x01FFFFFFFFFFFFFF;
+constexpr uint8_t kKeyFrameFlag = 0x80;
+// Frames that arrive after their cluster was written are placed in the next
+// cluster, before its timestamp, by at most this much.
+constexpr absl::Duration kMaxLateness = absl::Seconds(10);
+constexpr absl::string_view kMuxingApp = "meet_media_api_samples";
+
+void PutBigEndian(std::vector<char>& out, uint64_t value, int size) {
+  for (int i = size - 1; i >= 0; --i) {
+    out.push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+void PutId(std::vector<char>& out, uint32_t id) {
+  int size = id > 0xFFFFFF ? 4 : id > 0xFFFF ? 3 : id > 0xFF ? 2 : 1;
+  PutBigEndian(out, id, size);
+}
+
+// Writes `size` as a variable-length integer of the fewest bytes. Values with
+// every value bit set are reserved, so they take one more byte.
+void PutSize(std::vector<char>& out, uint64_t size) {
+  int length = 1;
+  while (length < 8 && size >= (uint64_t{1} << (7 * length)) - 1) {
+    ++length;
+  }
+  PutBigEndian(out, size | (uint64_t{1} << (7 * length)), length);
+}
+
+void PutBytes(std::vector<char>& out, uint32_t id,
+              absl::Span<const char> payload) {
+  PutId(out, id);
+  PutSize(out, payload.size());
+  out.insert(out.end(), payload.begin(), payload.end());
+}
+
+void PutString(std::vector<char>& out, uint32_t id, absl::string_view value) {
+  PutBytes(out, id, absl::Span<const char>(value.data(), value.size()));
+}
+
+void PutUint(std::vector<char>& out, uint32_t id, uint64_t value) {
+  int size = 1;
+  while (size < 8 && (value >> (8 * size)) != 0) {
+    ++size;
+  }
+  PutId(out, id);
+  PutSize(out, size);
+  PutBigEndian(out, value, size);
+}
+
+void PutInt(std::vector<char>& out, uint32_t id, int64_t value) {
+  PutId(out, id);
+  PutSize(out, 8);
+  PutBigEndian(out, static_cast<uint64_t>(value), 8);
+}
+
+void PutFloat(std::vector<char>& out, uint32_t id, double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  PutId(out, id);
+  PutSize(out, 8);
+  PutBigEndian(out, bits, 8);
+}
+
+}  // namespace
+
+WebmMuxer::WebmMuxer(std::unique_ptr<OutputWriterInterface> output,
+                     absl::Time start_time, Options options)
+    : start_time_(start_time),
+      options_(std::move(options)),
+      output_(std::move(output)),
+      last_cut_time_(start_time) {
+  DCHECK_GT(options_.cluster_duration, absl::ZeroDuration());
+  DCHECK_LE(options_.cluster_duration, options_.max_cluster_duration);
+  DCHECK_LT(options_.max_cluster_duration, absl::Seconds(32));
+}
+
+WebmMuxer::~WebmMuxer() { Close(); }
+
+bool WebmMuxer::AddVideoTrack(VideoTrack track) {
+  absl::MutexLock lock(&mutex_);
+  if (header_written_ || video_track_.has_value()) {
+    return false;
+  }
+  video_track_ = std::move(track);
+  return true;
+}
+
+bool WebmMuxer::AddAudioTrack(AudioTrack track) {
+  absl::MutexLock lock(&mutex_);
+  if (header_written_ || audio_track_.has_value()) {
+    return false;
+  }
+  audio_track_ = std::move(track);
+  return true;
+}
+
+void WebmMuxer::WriteVideoFrame(absl::Span<const uint8_t> frame,
+                                absl::Time timestamp, bool key_frame) {
+  absl::MutexLock lock(&mutex_);
+  DCHECK(video_track_.has_value());
+  AddBlock({.track_number = kVideoTrackNumber,
+            .timestamp = timestamp,
+            .key_frame = key_frame,
+            .data = std::vector<uint8_t>(frame.begin(), frame.end())});
+}
+
+void WebmMuxer::WriteAudioFrame(absl::Span<const uint8_t> frame,
+                                absl::Time timestamp) {
+  absl::MutexLock lock(&mutex_);
+  DCHECK(audio_track_.has_value());
+  // Every Opus packet can be decoded on its own.
+  AddBlock({.track_number = kAudioTrackNumber,
+            .timestamp = timestamp,
+            .key_frame = true,
+            .data = std::vector<uint8_t>(frame.begin(), frame.end())});
+}
+
+void WebmMuxer::Close() {
+  absl::MutexLock lock(&mutex_);
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  WriteCluster(absl::InfiniteFuture());
+  output_->Close();
+}
+
+void WebmMuxer::AddBlock(Block block) {
+  DCHECK(!closed_);
+  if (closed_) {
+    return;
+  }
+  // Relative timestamps are 16-bit, so far older frames are moved forward.
+  block.timestamp = std::max(
+      {block.timestamp, start_time_, last_cut_time_ - kMaxLateness});
+
+  if (!pending_blocks_.empty()) {
+    absl::Duration span = block.timestamp - pending_start_time_;
+    bool cluster_point = !video_track_.has_value() ||
+                         (block.track_number == kVideoTrackNumber &&
+                          block.key_frame);
+    if (span >= options_.max_cluster_duration ||
+        (span >= options_.cluster_duration && cluster_point)) {
+      WriteCluster(block.timestamp);
+    }
+  }
+  if (pending_blocks_.empty() || block.timestamp < pending_start_time_) {
+    pending_start_time_ = block.timestamp;
+  }
+  pending_blocks_.push_back(std::move(block));
+}
+
+void WebmMuxer::WriteCluster(absl::Time cut_time) {
+  if (!header_written_) {
+    WriteHeader();
+  }
+  // Stable, so that frames of one track with equal timestamps keep their
+  // order.
+  std::stable_sort(pending_blocks_.begin(), pending_blocks_.end(),
+                   [](const Block& a, const Block& b) {
+                     return a.timestamp < b.timestamp;
+                   });
+  auto cluster_end = std::partition_point(
+      pending_blocks_.begin(), pending_blocks_.end(),
+      [&](const Block& block) { return block.timestamp < cut_time; });
+  if (cluster_end == pending_blocks_.begin()) {
+    return;
+  }
+
+  // Late frames precede the cluster's timestamp, so that cluster timestamps
+  // keep increasing.
+  int64_t cluster_timestamp = absl::ToInt64Milliseconds(
+      std::max(pending_blocks_.front().timestamp, last_cut_time_) -
+      start_time_);
+  std::vector<char> timestamp_element;
+  PutUint(timestamp_element, kTimestampId, cluster_timestamp);
+
+  // Block headers are built first and referenced by offset, since the buffer
+  // may grow.
+  std::vector<char> block_headers;
+  std::vector<size_t> block_header_ends;
+  uint64_t cluster_size = timestamp_element.size();
+  for (auto it = pending_blocks_.begin(); it != cluster_end; ++it) {
+    size_t header_start = block_headers.size();
+    int64_t relative_timestamp =
+        absl::ToInt64Milliseconds(it->timestamp - start_time_) -
+        cluster_timestamp;
+    DCHECK_GE(relative_timestamp, INT16_MIN);
+    DCHECK_LE(relative_timestamp, INT16_MAX);
+    PutId(block_headers, kSimpleBlockId);
+    // Track number, relative timestamp, and flags.
+    PutSize(block_headers, 1 + 2 + 1 + it->data.size());
+    block_headers.push_back(static_cast<char>(0x80 | it->track_number));
+    PutBigEndian(block_headers, static_cast<uint16_t>(relative_timestamp), 2);
+    block_headers.push_back(
+        static_cast<char>(it->key_frame ? kKeyFrameFlag : 0));
+    block_header_ends.push_back(block_headers.size());
+    cluster_size += block_headers.size() - header_start + it->data.size();
+  }
+
+  std::vector<char> cluster_header;
+  PutId(cluster_header, kClusterId);
+  PutSize(cluster_header, cluster_size);
+  cluster_header.insert(cluster_header.end(), timestamp_element.begin(),
+                        timestamp_element.end());
+
+  std::vector<absl::Span<const char>> chunks;
+  chunks.reserve(1 + 2 * block_header_ends.size());
+  chunks.push_back(cluster_header);
+  size_t header_start = 0;
+  auto block = pending_blocks_.begin();
+  for (size_t header_end : block_header_ends) {
+    chunks.push_back(absl::Span<const char>(&block_headers[header_start],
+                                            header_end - header_start));
+    chunks.push_back(absl::Span<const char>(
+        reinterpret_cast<const char*>(block->data.data()), block->data.size()));
+    header_start = header_end;
+    ++block;
+  }
+  output_->WriteChunks(chunks);
+
+  pending_blocks_.erase(pending_blocks_.begin(), cluster_end);
+  if (!pending_blocks_.empty()) {
+    pending_start_time_ = pending_blocks_.front().timestamp;
+  }
+  last_cut_time_ = cut_time;
+}
+
+void WebmMuxer::WriteHeader() {
+  header_written_ = true;
+
+  std::vector<char> ebml;
+  PutUint(ebml, kEbmlVersionId, 1);
+  PutUint(ebml, kEbmlReadVersionId, 1);
+  PutUint(ebml, kEbmlMaxIdLengthId, 4);
+  PutUint(ebml, kEbmlMaxSizeLengthId, 8);
+  PutString(ebml, kDocTypeId, "webm");
+  PutUint(ebml, kDocTypeVersionId, 4);
+  PutUint(ebml, kDocTypeReadVersionId, 2);
+
+  std::vector<char> info;
+  PutUint(info, kTimestampScaleId, kTimestampScaleNs);
+  PutString(info, kMuxingAppId, kMuxingApp);
+  PutString(info, kWritingAppId, kMuxingApp);
+  // Matroska dates count from the start of 2001.
+  PutInt(info, kDateUtcId,
+         absl::ToInt64Nanoseconds(start_time_ -
+                                  absl::FromUnixSeconds(978307200)));
+
+  std::vector<char> tracks;
+  if (video_track_.has_value()) {
+    std::vector<char> video;
+    PutUint(video, kPixelWidthId, video_track_->width);
+    PutUint(video, kPixelHeightId, video_track_->height);
+
+    std::vector<char> entry;
+    PutUint(entry, kTrackNumberId, kVideoTrackNumber);
+    PutUint(entry, kTrackUidId, kVideoTrackNumber);
+    PutUint(entry, kTrackTypeId, kVideoTrackType);
+    PutUint(entry, kFlagLacingId, 0);
+    PutString(entry, kCodecIdId, video_track_->codec_id);
+    PutBytes(entry, kVideoId, video);
+    PutBytes(tracks, kTrackEntryId, entry);
+  }
+  if (audio_track_.has_value()) {
+    std::vector<char> audio;
+    PutFloat(audio, kSamplingFrequencyId, audio_track_->sample_rate);
+    PutUint(audio, kChannelsId, audio_track_->channels);
+
+    std::vector<char> entry;
+    PutUint(entry, kTrackNumberId, kAudioTrackNumber);
+    PutUint(entry, kTrackUidId, kAudioTrackNumber);
+    PutUint(entry, kTrackTypeId, kAudioTrackType);
+    PutUint(entry, kFlagLacingId, 0);
+    PutString(entry, kCodecIdId, audio_track_->codec_id);
+    if (!audio_track_->codec_private.empty()) {
+      PutBytes(entry, kCodecPrivateId,
+               absl::Span<const char>(reinterpret_cast<const char*>(
+                                          audio_track_->codec_private.data()),
+                                      audio_track_->codec_private.size()));
+    }
+    PutUint(entry, kCodecDelayId,
+            absl::ToInt64Nanoseconds(audio_track_->codec_delay));
+    PutUint(entry, kSeekPreRollId,
+            absl::ToInt64Nanoseconds(audio_track_->seek_pre_roll));
+    PutBytes(entry, kAudioId, audio);
+    PutBytes(tracks, kTrackEntryId, entry);
+  }
+
+  std::vector<char> header;
+  PutBytes(header, kEbmlId, ebml);
+  // Clusters are appended as they are cut, so the segment's size is unknown.
+  PutId(header, kSegmentId);
+  PutBigEndian(header, kUnknownSize, 8);
+  PutBytes(header, kInfoId, info);
+  PutBytes(header, kTracksId, tracks);
+  output_->Write(header.data(), header.size());
+}
+
+}  // namespace media_api_samples
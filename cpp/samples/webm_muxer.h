@@ -0,0 +1,138 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_WEBM_MUXER_H_
+#define CPP_SAMPLES_WEBM_MUXER_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/output_writer_interface.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// Interleaves one video track and one audio track into a WebM file as frames
+// arrive, so that the file can be played while it is still being written.
+//
+// Since the output is not seekable, the segment has an unknown size and no
+// cues; frames are written in clusters of about `cluster_duration`, each
+// starting at a video key frame when possible. Players seek by scanning
+// cluster timestamps, and a crash loses at most the cluster being buffered.
+//
+// Frames of each track must be written in timestamp order, but the two tracks
+// may be written from different threads and be slightly out of step with each
+// other. Frames are sorted by timestamp before each cluster is written, and a
+// frame that arrives after its cluster was written is placed at the start of
+// the next one, with a negative timestamp relative to it.
+//
+// This class is thread-safe.
+class WebmMuxer {
+ public:
+  struct Options {
+    // Clusters are cut at the first video key frame after they span this
+    // long, or at any frame if the file has no video track.
+    absl::Duration cluster_duration = absl::Seconds(1);
+    // Clusters are cut at any frame once they span this long, which bounds how
+    // far a live reader lags behind when key frames are sparse. Must be below
+    // 32 seconds, the range of a block's 16-bit relative timestamp.
+    absl::Duration max_cluster_duration = absl::Seconds(5);
+  };
+
+  struct VideoTrack {
+    // Matroska codec ID, e.g. "V_VP9".
+    std::string codec_id;
+    int width = 0;
+    int height = 0;
+  };
+
+  struct AudioTrack {
+    // Matroska codec ID, e.g. "A_OPUS".
+    std::string codec_id;
+    int sample_rate = 0;
+    int channels = 0;
+    std::vector<uint8_t> codec_private;
+    // Decoder delay that players trim from the start of the track.
+    absl::Duration codec_delay;
+    // How far before a seek target decoding must start to converge.
+    absl::Duration seek_pre_roll;
+  };
+
+  // `start_time` is time zero of the file. Frames must not be older.
+  WebmMuxer(std::unique_ptr<OutputWriterInterface> output,
+            absl::Time start_time, Options options);
+  // Closes the file if `Close` was not called.
+  ~WebmMuxer();
+
+  // Declare the tracks. Tracks are listed in the file header, which is written
+  // along with the first cluster; these return false if it has already been
+  // written, or if the track was already declared.
+  bool AddVideoTrack(VideoTrack track);
+  bool AddAudioTrack(AudioTrack track);
+
+  // Buffer a frame of a declared track for the current cluster.
+  void WriteVideoFrame(absl::Span<const uint8_t> frame, absl::Time timestamp,
+                       bool key_frame);
+  void WriteAudioFrame(absl::Span<const uint8_t> frame, absl::Time timestamp);
+
+  // Writes the buffered frames and closes the output. No frames may be written
+  // afterwards.
+  void Close();
+
+ private:
+  struct Block {
+    int track_number;
+    absl::Time timestamp;
+    bool key_frame;
+    std::vector<uint8_t> data;
+  };
+
+  void AddBlock(Block block) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Writes the buffered blocks older than `cut_time` as a cluster.
+  void WriteCluster(absl::Time cut_time) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void WriteHeader() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const absl::Time start_time_;
+  const Options options_;
+
+  absl::Mutex mutex_;
+  std::unique_ptr<OutputWriterInterface> output_ ABSL_GUARDED_BY(mutex_);
+  std::optional<VideoTrack> video_track_ ABSL_GUARDED_BY(mutex_);
+  std::optional<AudioTrack> audio_track_ ABSL_GUARDED_BY(mutex_);
+  bool header_written_ ABSL_GUARDED_BY(mutex_) = false;
+  bool closed_ ABSL_GUARDED_BY(mutex_) = false;
+  // Blocks of the cluster being built, in arrival order.
+  std::vector<Block> pending_blocks_ ABSL_GUARDED_BY(mutex_);
+  // Timestamp of the oldest pending block.
+  absl::Time pending_start_time_ ABSL_GUARDED_BY(mutex_);
+  // Time at which the last cluster was cut. Blocks older than this arrived
+  // late.
+  absl::Time last_cut_time_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_WEBM_MUXER_H_
@@ -0,0 +1,412 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/webm_muxer.h"
+
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/testing/string_output_writer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+using ::testing::ElementsAre;
+
+constexpr uint32_t kEbmlId = 0x1A45DFA3;
+constexpr uint32_t kDocTypeId = 0x4282;
+constexpr uint32_t kSegmentId = 0x18538067;
+constexpr uint32_t kTracksId = 0x1654AE6B;
+constexpr uint32_t kTrackEntryId = 0xAE;
+constexpr uint32_t kTrackNumberId = 0xD7;
+constexpr uint32_t kCodecIdId = 0x86;
+constexpr uint32_t kCodecPrivateId = 0x63A2;
+constexpr uint32_t kCodecDelayId = 0x56AA;
+constexpr uint32_t kVideoId = 0xE0;
+constexpr uint32_t kPixelWidthId = 0xB0;
+constexpr uint32_t kPixelHeightId = 0xBA;
+constexpr uint32_t kClusterId = 0x1F43B675;
+constexpr uint32_t kTimestampId = 0xE7;
+constexpr uint32_t kSimpleBlockId = 0xA3;
+constexpr uint64_t kUnknownSize = ~uint64_t{0};
+
+constexpr int kVideoTrackNumber = 1;
+constexpr int kAudioTrackNumber = 2;
+const absl::Time kStartTime = absl::FromUnixSeconds(1700000000);
+
+struct Element {
+  uint32_t id;
+  // Offset and size of the element's payload.
+  size_t offset;
+  uint64_t size;
+};
+
+// Reads an EBML variable-length integer, with its length marker if
+// `keep_marker` is set, as for element IDs.
+uint64_t ReadVint(const std::string& data, size_t& offset, bool keep_marker) {
+  uint8_t first = data[offset];
+  int length = 1;
+  while (length <= 8 && !(first & (0x80 >> (length - 1)))) {
+    ++length;
+  }
+  uint64_t value = keep_marker ? first : first & (0xFF >> length);
+  bool all_ones = value == (0xFFu >> length);
+  for (int i = 1; i < length; ++i) {
+    uint8_t byte = data[offset + i];
+    all_ones = all_ones && byte == 0xFF;
+    value = (value << 8) | byte;
+  }
+  offset += length;
+  return !keep_marker && all_ones ? kUnknownSize : value;
+}
+
+// Parses the elements between `begin` and `end`. Elements of unknown size
+// extend to `end`.
+std::vector<Element> ParseElements(const std::string& data, size_t begin,
+                                   size_t end) {
+  std::vector<Element> elements;
+  size_t offset = begin;
+  while (offset < end) {
+    uint32_t id = ReadVint(data, offset, /*keep_marker=*/true);
+    uint64_t size = ReadVint(data, offset, /*keep_marker=*/false);
+    if (size == kUnknownSize) {
+      size = end - offset;
+    }
+    EXPECT_LE(offset + size, end);
+    elements.push_back({.id = id, .offset = offset, .size = size});
+    offset += size;
+  }
+  return elements;
+}
+
+std::vector<Element> ParseChildren(const std::string& data,
+                                   const Element& parent) {
+  return ParseElements(data, parent.offset, parent.offset + parent.size);
+}
+
+std::vector<Element> FindAll(const std::vector<Element>& elements,
+                             uint32_t id) {
+  std::vector<Element> found;
+  for (const Element& element : elements) {
+    if (element.id == id) {
+      found.push_back(element);
+    }
+  }
+  return found;
+}
+
+Element FindOne(const std::vector<Element>& elements, uint32_t id) {
+  std::vector<Element> found = FindAll(elements, id);
+  EXPECT_EQ(found.size(), 1u) << std::hex << id;
+  return found.empty() ? Element{} : found[0];
+}
+
+uint64_t ReadUint(const std::string& data, const Element& element) {
+  uint64_t value = 0;
+  for (uint64_t i = 0; i < element.size; ++i) {
+    value = (value << 8) | static_cast<uint8_t>(data[element.offset + i]);
+  }
+  return value;
+}
+
+std::string ReadString(const std::string& data, const Element& element) {
+  return data.substr(element.offset, element.size);
+}
+
+struct Block {
+  int track_number;
+  // Absolute timestamp in milliseconds.
+  int64_t timestamp;
+  bool key_frame;
+  std::string data;
+};
+
+struct Cluster {
+  int64_t timestamp;
+  std::vector<Block> blocks;
+};
+
+// Returns the segment's children, checking that the file starts with a WebM
+// EBML header.
+std::vector<Element> ParseSegment(const std::string& data) {
+  std::vector<Element> top_level = ParseElements(data, 0, data.size());
+  EXPECT_EQ(top_level.size(), 2u);
+  if (top_level.size() != 2) {
+    return {};
+  }
+  EXPECT_EQ(top_level[0].id, kEbmlId);
+  EXPECT_EQ(ReadString(data, FindOne(ParseChildren(data, top_level[0]),
+                                     kDocTypeId)),
+            "webm");
+  EXPECT_EQ(top_level[1].id, kSegmentId);
+  return ParseChildren(data, top_level[1]);
+}
+
+std::vector<Cluster> ParseClusters(const std::string& data) {
+  std::vector<Cluster> clusters;
+  for (const Element& element : FindAll(ParseSegment(data), kClusterId)) {
+    std::vector<Element> children = ParseChildren(data, element);
+    Cluster cluster = {
+        .timestamp = static_cast<int64_t>(
+            ReadUint(data, FindOne(children, kTimestampId)))};
+    for (const Element& block : FindAll(children, kSimpleBlockId)) {
+      size_t offset = block.offset;
+      int track_number = ReadVint(data, offset, /*keep_marker=*/false);
+      int16_t relative_timestamp = static_cast<int16_t>(
+          (static_cast<uint8_t>(data[offset]) << 8) |
+          static_cast<uint8_t>(data[offset + 1]));
+      uint8_t flags = data[offset + 2];
+      offset += 3;
+      cluster.blocks.push_back(
+          {.track_number = track_number,
+           .timestamp = cluster.timestamp + relative_timestamp,
+           .key_frame = (flags & 0x80) != 0,
+           .data = data.substr(offset, block.offset + block.size - offset)});
+    }
+    clusters.push_back(std::move(cluster));
+  }
+  return clusters;
+}
+
+std::vector<uint8_t> Payload(int index) {
+  return std::vector<uint8_t>(10 + index % 5, static_cast<uint8_t>(index));
+}
+
+TEST(WebmMuxerTest, WritesHeaderWithDeclaredTracks) {
+  std::string output;
+  bool closed = false;
+  WebmMuxer muxer(std::make_unique<StringOutputWriter>(output, closed),
+                  kStartTime, {});
+  ASSERT_TRUE(muxer.AddVideoTrack(
+      {.codec_id = "V_VP9", .width = 640, .height = 360}));
+  ASSERT_TRUE(muxer.AddAudioTrack({.codec_id = "A_OPUS",
+                                   .sample_rate = 48000,
+                                   .channels = 1,
+                                   .codec_private = {'O', 'p', 'u', 's'},
+                                   .codec_delay = absl::Microseconds(6500),
+                                   .seek_pre_roll = absl::Milliseconds(80)}));
+  muxer.WriteVideoFrame(Payload(0), kStartTime, /*key_frame=*/true);
+  muxer.Close();
+
+  EXPECT_TRUE(closed);
+  std::vector<Element> segment = ParseSegment(output);
+  std::vector<Element> tracks =
+      FindAll(ParseChildren(output, FindOne(segment, kTracksId)),
+              kTrackEntryId);
+  ASSERT_EQ(tracks.size(), 2u);
+
+  std::vector<Element> video = ParseChildren(output, tracks[0]);
+  EXPECT_EQ(ReadUint(output, FindOne(video, kTrackNumberId)),
+            kVideoTrackNumber);
+  EXPECT_EQ(ReadString(output, FindOne(video, kCodecIdId)), "V_VP9");
+  std::vector<Element> video_settings =
+      ParseChildren(output, FindOne(video, kVideoId));
+  EXPECT_EQ(ReadUint(output, FindOne(video_settings, kPixelWidthId)), 640u);
+  EXPECT_EQ(ReadUint(output, FindOne(video_settings, kPixelHeightId)), 360u);
+
+  std::vector<Element> audio = ParseChildren(output, tracks[1]);
+  EXPECT_EQ(ReadUint(output, FindOne(audio, kTrackNumberId)),
+            kAudioTrackNumber);
+  EXPECT_EQ(ReadString(output, FindOne(audio, kCodecIdId)), "A_OPUS");
+  EXPECT_EQ(ReadString(output, FindOne(audio, kCodecPrivateId)), "Opus");
+  EXPECT_EQ(ReadUint(output, FindOne(audio, kCodecDelayId)), 6500000u);
+
+  std::vector<Cluster> clusters = ParseClusters(output);
+  ASSERT_EQ(clusters.size(), 1u);
+  ASSERT_EQ(clusters[0].blocks.size(), 1u);
+  EXPECT_EQ(clusters[0].blocks[0].track_number, kVideoTrackNumber);
+  EXPECT_TRUE(clusters[0].blocks[0].key_frame);
+  EXPECT_EQ(clusters[0].blocks[0].data, std::string(10, '\0'));
+}
+
+TEST(WebmMuxerTest, RejectsTracksAfterHeaderIsWritten) {
+  std::string output;
+  bool closed = false;
+  WebmMuxer muxer(std::make_unique<StringOutputWriter>(output, closed),
+                  kStartTime, {.cluster_duration = absl::Seconds(1)});
+  ASSERT_TRUE(muxer.AddAudioTrack({.codec_id = "A_OPUS",
+                                   .sample_rate = 48000,
+                                   .channels = 1}));
+  EXPECT_FALSE(muxer.AddAudioTrack({.codec_id = "A_OPUS",
+                                    .sample_rate = 48000,
+                                    .channels = 1}));
+
+  for (int i = 0; i <= 50; ++i) {
+    muxer.WriteAudioFrame(Payload(i), kStartTime + i * absl::Milliseconds(20));
+  }
+  // A second of audio was cut into a cluster, which wrote the header.
+  EXPECT_FALSE(output.empty());
+  EXPECT_FALSE(muxer.AddVideoTrack(
+      {.codec_id = "V_VP9", .width = 640, .height = 360}));
+  muxer.Close();
+
+  std::vector<Element> segment = ParseSegment(output);
+  EXPECT_EQ(FindAll(ParseChildren(output, FindOne(segment, kTracksId)),
+                    kTrackEntryId)
+                .size(),
+            1u);
+  std::vector<Cluster> clusters = ParseClusters(output);
+  ASSERT_EQ(clusters.size(), 2u);
+  EXPECT_EQ(clusters[0].blocks.size(), 50u);
+  EXPECT_EQ(clusters[1].timestamp, 1000);
+}
+
+TEST(WebmMuxerTest, StartsClustersAtKeyFramesWhileRecording) {
+  std::string output;
+  bool closed = false;
+  WebmMuxer muxer(std::make_unique<StringOutputWriter>(output, closed),
+                  kStartTime, {.cluster_duration = absl::Seconds(1)});
+  ASSERT_TRUE(muxer.AddVideoTrack(
+      {.codec_id = "V_VP9", .width = 640, .height = 360}));
+
+  // Three seconds at 25 fps, with a key frame every 0.6 seconds.
+  for (int i = 0; i < 75; ++i) {
+    muxer.WriteVideoFrame(Payload(i),
+                          kStartTime + i * absl::Milliseconds(40),
+                          /*key_frame=*/i % 15 == 0);
+  }
+  // Clusters are written while recording, not only on close.
+  std::vector<Cluster> clusters = ParseClusters(output);
+  EXPECT_EQ(clusters.size(), 2u);
+  muxer.Close();
+
+  clusters = ParseClusters(output);
+  std::vector<int64_t> cluster_timestamps;
+  int block_count = 0;
+  for (const Cluster& cluster : clusters) {
+    cluster_timestamps.push_back(cluster.timestamp);
+    ASSERT_FALSE(cluster.blocks.empty());
+    EXPECT_TRUE(cluster.blocks[0].key_frame);
+    EXPECT_EQ(cluster.blocks[0].timestamp, cluster.timestamp);
+    for (const Block& block : cluster.blocks) {
+      EXPECT_EQ(block.timestamp, block_count * 40);
+      EXPECT_EQ(block.key_frame, block_count % 15 == 0);
+      ++block_count;
+    }
+  }
+  EXPECT_EQ(block_count, 75);
+  EXPECT_THAT(cluster_timestamps, ElementsAre(0, 1200, 2400));
+}
+
+TEST(WebmMuxerTest, CutsClustersWithoutKeyFramesAtMaxDuration) {
+  std::string output;
+  bool closed = false;
+  WebmMuxer muxer(std::make_unique<StringOutputWriter>(output, closed),
+                  kStartTime,
+                  {.cluster_duration = absl::Seconds(1),
+                   .max_cluster_duration = absl::Seconds(2)});
+  ASSERT_TRUE(muxer.AddVideoTrack(
+      {.codec_id = "V_VP9", .width = 640, .height = 360}));
+
+  for (int i = 0; i < 125; ++i) {
+    muxer.WriteVideoFrame(Payload(i),
+                          kStartTime + i * absl::Milliseconds(40),
+                          /*key_frame=*/i == 0);
+  }
+  muxer.Close();
+
+  std::vector<int64_t> cluster_timestamps;
+  for (const Cluster& cluster : ParseClusters(output)) {
+    cluster_timestamps.push_back(cluster.timestamp);
+  }
+  EXPECT_THAT(cluster_timestamps, ElementsAre(0, 2000, 4000));
+}
+
+TEST(WebmMuxerTest, InterleavesTracksThatAreOutOfStep) {
+  std::string output;
+  bool closed = false;
+  WebmMuxer muxer(std::make_unique<StringOutputWriter>(output, closed),
+                  kStartTime, {.cluster_duration = absl::Seconds(1)});
+  ASSERT_TRUE(muxer.AddVideoTrack(
+      {.codec_id = "V_VP9", .width = 640, .height = 360}));
+  ASSERT_TRUE(muxer.AddAudioTrack({.codec_id = "A_OPUS",
+                                   .sample_rate = 48000,
+                                   .channels = 1}));
+
+  // Audio packets reach the muxer 60 ms after video frames of the same time,
+  // as if their encoder were behind.
+  int audio_index = 0;
+  for (int i = 0; i < 50; ++i) {
+    absl::Time video_time = kStartTime + i * absl::Milliseconds(40);
+    muxer.WriteVideoFrame(Payload(i), video_time,
+                          /*key_frame=*/i % 25 == 0);
+    while (kStartTime + audio_index * absl::Milliseconds(20) <=
+           video_time - absl::Milliseconds(60)) {
+      muxer.WriteAudioFrame(Payload(audio_index),
+                            kStartTime + audio_index * absl::Milliseconds(20));
+      ++audio_index;
+    }
+  }
+  muxer.Close();
+
+  std::vector<Cluster> clusters = ParseClusters(output);
+  ASSERT_EQ(clusters.size(), 2u);
+  int64_t last_cluster_timestamp = -1;
+  int video_blocks = 0;
+  int audio_blocks = 0;
+  bool has_late_audio = false;
+  for (const Cluster& cluster : clusters) {
+    EXPECT_GT(cluster.timestamp, last_cluster_timestamp);
+    last_cluster_timestamp = cluster.timestamp;
+    int64_t last_timestamp = 0;
+    for (const Block& block : cluster.blocks) {
+      EXPECT_GE(block.timestamp, last_timestamp);
+      last_timestamp = block.timestamp;
+      if (block.track_number == kVideoTrackNumber) {
+        EXPECT_EQ(block.timestamp, video_blocks++ * 40);
+      } else {
+        // Audio that arrived after its cluster was written keeps its
+        // timestamp, before the start of the next cluster.
+        EXPECT_EQ(block.timestamp, audio_blocks++ * 20);
+        has_late_audio |= block.timestamp < cluster.timestamp;
+      }
+    }
+  }
+  EXPECT_TRUE(has_late_audio);
+  EXPECT_EQ(video_blocks, 50);
+  EXPECT_EQ(audio_blocks, audio_index);
+}
+
+TEST(WebmMuxerTest, WritesHeaderWhenClosedWithoutFrames) {
+  std::string output;
+  bool closed = false;
+  {
+    WebmMuxer muxer(std::make_unique<StringOutputWriter>(output, closed),
+                    kStartTime, {});
+    ASSERT_TRUE(muxer.AddAudioTrack({.codec_id = "A_OPUS",
+                                     .sample_rate = 48000,
+                                     .channels = 1}));
+  }
+
+  EXPECT_TRUE(closed);
+  std::vector<Element> segment = ParseSegment(output);
+  FindOne(segment, kTracksId);
+  EXPECT_TRUE(FindAll(segment, kClusterId).empty());
+}
+
+}  // namespace
+}  // namespace media_api_samples
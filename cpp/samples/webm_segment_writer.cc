@@ -0,0 +1,243 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/webm_segment_writer.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "meet_clients/samples/encoded_video_segment_writer.h"
+#include "meet_clients/samples/muxed_segment_writer_interface.h"
+#include "meet_clients/samples/ogg_opus_segment_writer.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/webm_muxer.h"
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+// Opus decoders converge within 80 ms of a seek, per the WebM Opus mapping.
+constexpr absl::Duration kOpusSeekPreRoll = absl::Milliseconds(80);
+
+class WebmVideoSink : public EncodedVideoSinkInterface {
+ public:
+  explicit WebmVideoSink(std::shared_ptr<WebmMuxer> muxer)
+      : muxer_(std::move(muxer)) {}
+
+  void WriteFrame(absl::Span<const uint8_t> frame, absl::Time received_time,
+                  bool key_frame) override {
+    muxer_->WriteVideoFrame(frame, received_time, key_frame);
+  }
+  // The muxer is closed once all encoders are done.
+  void Close() override {}
+
+ private:
+  std::shared_ptr<WebmMuxer> muxer_;
+};
+
+// Places the packets of one run of audio at `start_time` plus their position
+// in the run. Matroska timestamps a block by its first decoded sample, and
+// players subtract the track's codec delay to skip the pre-skip.
+class WebmAudioSink : public OpusPacketSinkInterface {
+ public:
+  WebmAudioSink(std::shared_ptr<WebmMuxer> muxer, absl::Time start_time)
+      : muxer_(std::move(muxer)), start_time_(start_time) {}
+
+  void WritePacket(absl::Span<const uint8_t> packet,
+                   int64_t end_sample) override {
+    muxer_->WriteAudioFrame(
+        packet, start_time_ + absl::Microseconds(packet_start_sample_ *
+                                                 1000000 / kOpusSampleRate));
+    packet_start_sample_ = end_sample;
+  }
+  // Matroska can only trim padding from a block group, so the few
+  // milliseconds of silence padding the last packet are played.
+  void Close(int64_t /*end_sample*/) override {}
+
+ private:
+  std::shared_ptr<WebmMuxer> muxer_;
+  const absl::Time start_time_;
+  int64_t packet_start_sample_ = 0;
+};
+
+}  // namespace
+
+// Closing the muxer writes its last cluster, so it must wait for the last
+// packets of every encoder. Each closing encoder holds a reference to this,
+// and the last one dropped closes the muxer, on whichever thread drops it.
+class WebmSegmentWriter::MuxerCloser {
+ public:
+  explicit MuxerCloser(std::shared_ptr<WebmMuxer> muxer)
+      : muxer_(std::move(muxer)) {}
+  ~MuxerCloser() {
+    muxer_->Close();
+    if (on_closed_ != nullptr) {
+      std::move(on_closed_)();
+    }
+  }
+
+  // Set before the segment writer drops its reference, so that the last
+  // reference is dropped after this.
+  void set_on_closed(absl::AnyInvocable<void() &&> on_closed) {
+    on_closed_ = std::move(on_closed);
+  }
+
+ private:
+  std::shared_ptr<WebmMuxer> muxer_;
+  /*absl_nullable*/ absl::AnyInvocable<void() &&> on_closed_;
+};
+
+WebmSegmentWriter::WebmSegmentWriter(
+    std::shared_ptr<VideoEncoderPool> video_pool,
+    std::shared_ptr<AudioEncoderPool> audio_pool,
+    std::unique_ptr<OutputWriterInterface> output, absl::Time start_time,
+    Options options)
+    : video_pool_(std::move(video_pool)),
+      audio_pool_(std::move(audio_pool)),
+      options_(std::move(options)),
+      muxer_(std::make_shared<WebmMuxer>(std::move(output), start_time,
+                                         options_.muxer)),
+      closer_(std::make_shared<MuxerCloser>(muxer_)) {
+  DCHECK(video_pool_->options().codec == VideoEncoderPool::Codec::kVp9);
+  // The audio track is always declared, since speech may start after the
+  // header is written.
+  muxer_->AddAudioTrack(
+      {.codec_id = "A_OPUS",
+       .sample_rate = kOpusSampleRate,
+       .channels = 1,
+       .codec_private = CreateOpusHead(),
+       .codec_delay = absl::Seconds(1) * kOpusPreSkip / kOpusSampleRate,
+       .seek_pre_roll = kOpusSeekPreRoll});
+}
+
+WebmSegmentWriter::~WebmSegmentWriter() {
+  if (!closed_) {
+    Close();
+  }
+}
+
+bool WebmSegmentWriter::WriteVideoFrame(
+    webrtc::scoped_refptr<webrtc::I420BufferInterface> frame,
+    absl::Time received_time) {
+  DCHECK(!closed_);
+
+  if (video_writer_ == nullptr) {
+    if (!muxer_->AddVideoTrack({.codec_id = "V_VP9",
+                                .width = frame->width(),
+                                .height = frame->height()})) {
+      return false;
+    }
+    width_ = frame->width();
+    height_ = frame->height();
+    video_writer_ = video_pool_->CreateWriter(
+        std::make_unique<WebmVideoSink>(muxer_), width_, height_);
+  } else if (frame->width() != width_ || frame->height() != height_) {
+    return false;
+  }
+  video_writer_->WriteFrame(std::move(frame), received_time);
+  return true;
+}
+
+void WebmSegmentWriter::WriteAudioSamples(std::vector<int16_t> pcm16,
+                                          absl::Time received_time) {
+  DCHECK(!closed_);
+
+  if (audio_writer_ != nullptr &&
+      received_time - last_audio_time_ > options_.audio_gap_threshold) {
+    // The run's last packets may reach the muxer after the next run's first
+    // ones, which the muxer sorts into place.
+    AudioSegmentWriterInterface::CloseAsync(
+        std::move(audio_writer_),
+        [closer = closer_]() mutable { closer.reset(); });
+  }
+  if (audio_writer_ == nullptr) {
+    audio_writer_ = audio_pool_->CreateWriter(
+        std::make_unique<WebmAudioSink>(muxer_, received_time));
+  }
+  last_audio_time_ = received_time;
+  audio_writer_->WriteSamples(std::move(pcm16));
+}
+
+void WebmSegmentWriter::Close() {
+  absl::Notification closed;
+  ReleaseEncoders([&closed] { closed.Notify(); }).reset();
+  closed.WaitForNotification();
+}
+
+void WebmSegmentWriter::StartClose(
+    std::unique_ptr<MuxedSegmentWriterInterface> self,
+    absl::AnyInvocable<void() &&> on_closed) {
+  DCHECK_EQ(self.get(), this);
+  std::shared_ptr<MuxerCloser> closer = ReleaseEncoders(std::move(on_closed));
+  self.reset();
+  // Closes the muxer here if the encoders are already done.
+  closer.reset();
+}
+
+std::shared_ptr<WebmSegmentWriter::MuxerCloser>
+WebmSegmentWriter::ReleaseEncoders(absl::AnyInvocable<void() &&> on_closed) {
+  DCHECK(!closed_);
+  closed_ = true;
+  closer_->set_on_closed(std::move(on_closed));
+  if (video_writer_ != nullptr) {
+    VideoSegmentWriterInterface::CloseAsync(
+        std::move(video_writer_),
+        [closer = closer_]() mutable { closer.reset(); });
+  }
+  if (audio_writer_ != nullptr) {
+    AudioSegmentWriterInterface::CloseAsync(
+        std::move(audio_writer_),
+        [closer = closer_]() mutable { closer.reset(); });
+  }
+  return std::move(closer_);
+}
+
+absl::StatusOr<MuxedSegmentFormat> CreateWebmSegmentFormat(
+    std::shared_ptr<VideoEncoderPool> video_pool,
+    std::shared_ptr<AudioEncoderPool> audio_pool,
+    WebmSegmentWriter::Options options) {
+  if (video_pool->options().codec != VideoEncoderPool::Codec::kVp9) {
+    return absl::InvalidArgumentError("WebM segments require VP9 video");
+  }
+  return MuxedSegmentFormat{
+      .file_extension = "webm",
+      .create_writer = [video_pool = std::move(video_pool),
+                        audio_pool = std::move(audio_pool),
+                        options = std::move(options)](
+                           std::unique_ptr<OutputWriterInterface> output,
+                           absl::Time start_time)
+          -> std::unique_ptr<MuxedSegmentWriterInterface> {
+        return std::make_unique<WebmSegmentWriter>(video_pool, audio_pool,
+                                                   std::move(output),
+                                                   start_time, options);
+      }};
+}
+
+}  // namespace media_api_samples
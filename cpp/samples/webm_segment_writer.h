@@ -0,0 +1,126 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_WEBM_SEGMENT_WRITER_H_
+#define CPP_SAMPLES_WEBM_SEGMENT_WRITER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/audio_segment_writer_interface.h"
+#include "meet_clients/samples/encoded_video_segment_writer.h"
+#include "meet_clients/samples/muxed_segment_writer_interface.h"
+#include "meet_clients/samples/ogg_opus_segment_writer.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/video_segment_writer_interface.h"
+#include "meet_clients/samples/webm_muxer.h"
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// A muxed segment writer that encodes video with VP9 and audio with Opus on
+// the pools' encoder threads, and interleaves both into a live WebM file.
+//
+// The file is playable while it is being written, which removes the need to
+// mux separate audio and video segments after the meeting.
+//
+// This class is not thread-safe.
+class WebmSegmentWriter : public MuxedSegmentWriterInterface {
+ public:
+  struct Options {
+    WebmMuxer::Options muxer;
+    // Audio only arrives while a participant is among the loudest speakers.
+    // Samples received this long after the previous ones start a new Opus
+    // stream at their received time, rather than being played right after the
+    // previous ones.
+    absl::Duration audio_gap_threshold = absl::Milliseconds(100);
+  };
+
+  WebmSegmentWriter(std::shared_ptr<VideoEncoderPool> video_pool,
+                    std::shared_ptr<AudioEncoderPool> audio_pool,
+                    std::unique_ptr<OutputWriterInterface> output,
+                    absl::Time start_time, Options options);
+  ~WebmSegmentWriter() override;
+
+  // Returns false if the segment already has video of another resolution, or
+  // if its tracks were written before the first video frame arrived.
+  bool WriteVideoFrame(webrtc::scoped_refptr<webrtc::I420BufferInterface> frame,
+                       absl::Time received_time) override;
+  // Ends each run of audio without waiting for its encoder, which finishes it
+  // on its own thread.
+  void WriteAudioSamples(std::vector<int16_t> pcm16,
+                         absl::Time received_time) override;
+  // Waits for queued media to be encoded, then writes the last cluster and
+  // closes the output. Prefer `CloseAsync`, which does so without blocking the
+  // caller.
+  void Close() override;
+
+ protected:
+  // Closes the encoders on their threads. The last one to finish writes the
+  // last cluster, closes the output and calls `on_closed`.
+  void StartClose(std::unique_ptr<MuxedSegmentWriterInterface> self,
+                  absl::AnyInvocable<void() &&> on_closed) override;
+
+ private:
+  // Closes the muxer once the encoders that write to it are done.
+  class MuxerCloser;
+
+  // Closes the encoders without waiting for them. Returns this writer's
+  // reference to the closer, which calls `on_closed` once it and the
+  // encoders' references are dropped.
+  std::shared_ptr<MuxerCloser> ReleaseEncoders(
+      absl::AnyInvocable<void() &&> on_closed);
+
+  std::shared_ptr<VideoEncoderPool> video_pool_;
+  std::shared_ptr<AudioEncoderPool> audio_pool_;
+  const Options options_;
+  bool closed_ = false;
+  // Written from the encoder threads through the encoders' sinks, which share
+  // it, so that encoders closing on their own threads can still write to it.
+  std::shared_ptr<WebmMuxer> muxer_;
+  // Referenced by every encoder that is closing, and by this writer until it
+  // is closed.
+  std::shared_ptr<MuxerCloser> closer_;
+  /*absl_nullable*/ std::unique_ptr<VideoSegmentWriterInterface>
+      video_writer_;
+  int width_ = 0;
+  int height_ = 0;
+  // Encodes the current run of audio; replaced after gaps.
+  /*absl_nullable*/ std::unique_ptr<AudioSegmentWriterInterface>
+      audio_writer_;
+  absl::Time last_audio_time_ = absl::InfinitePast();
+};
+
+// Returns a format that writes `.webm` segments with video encoded by
+// `video_pool` and audio encoded by `audio_pool`. `video_pool` must encode
+// VP9.
+absl::StatusOr<MuxedSegmentFormat> CreateWebmSegmentFormat(
+    std::shared_ptr<VideoEncoderPool> video_pool,
+    std::shared_ptr<AudioEncoderPool> audio_pool,
+    WebmSegmentWriter::Options options = {});
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_WEBM_SEGMENT_WRITER_H_
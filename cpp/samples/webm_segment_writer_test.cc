@@ -0,0 +1,156 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/webm_segment_writer.h"
+
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/encoded_video_segment_writer.h"
+#include "meet_clients/samples/muxed_segment_writer_interface.h"
+#include "meet_clients/samples/ogg_opus_segment_writer.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/testing/string_output_writer.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::StartsWith;
+
+const absl::Time kStartTime = absl::FromUnixSeconds(1700000000);
+
+webrtc::scoped_refptr<webrtc::I420BufferInterface> CreateFrame(int width,
+                                                               int height) {
+  webrtc::scoped_refptr<webrtc::I420Buffer> buffer =
+      webrtc::I420Buffer::Create(width, height);
+  webrtc::I420Buffer::SetBlack(buffer.get());
+  return buffer;
+}
+
+class WebmSegmentWriterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    absl::StatusOr<std::shared_ptr<VideoEncoderPool>> video_pool =
+        VideoEncoderPool::Create(
+            {.key_frame_interval = 10, .max_queued_frames = 100});
+    ASSERT_TRUE(video_pool.ok()) << video_pool.status();
+    video_pool_ = *std::move(video_pool);
+    absl::StatusOr<std::shared_ptr<AudioEncoderPool>> audio_pool =
+        AudioEncoderPool::Create({});
+    ASSERT_TRUE(audio_pool.ok()) << audio_pool.status();
+    audio_pool_ = *std::move(audio_pool);
+  }
+
+  std::unique_ptr<MuxedSegmentWriterInterface> CreateWriter() {
+    absl::StatusOr<MuxedSegmentFormat> format =
+        CreateWebmSegmentFormat(video_pool_, audio_pool_);
+    EXPECT_TRUE(format.ok()) << format.status();
+    EXPECT_EQ(format->file_extension, "webm");
+    return format->create_writer(
+        std::make_unique<StringOutputWriter>(output_, closed_), kStartTime);
+  }
+
+  std::shared_ptr<VideoEncoderPool> video_pool_;
+  std::shared_ptr<AudioEncoderPool> audio_pool_;
+  std::string output_;
+  bool closed_ = false;
+};
+
+TEST_F(WebmSegmentWriterTest, WritesAudioAndVideoToOneFile) {
+  std::unique_ptr<MuxedSegmentWriterInterface> writer = CreateWriter();
+
+  for (int i = 0; i < 100; ++i) {
+    absl::Time received_time = kStartTime + i * absl::Milliseconds(10);
+    if (i % 3 == 0) {
+      EXPECT_TRUE(writer->WriteVideoFrame(CreateFrame(64, 48), received_time));
+    }
+    writer->WriteAudioSamples(std::vector<int16_t>(480, 1000), received_time);
+  }
+  writer->Close();
+
+  EXPECT_TRUE(closed_);
+  EXPECT_THAT(output_, StartsWith("\x1A\x45\xDF\xA3"));
+  EXPECT_THAT(output_, HasSubstr("V_VP9"));
+  EXPECT_THAT(output_, HasSubstr("A_OPUS"));
+  EXPECT_THAT(output_, HasSubstr("OpusHead"));
+  EXPECT_EQ(video_pool_->GetStats().encoded_frames, 34);
+  EXPECT_EQ(audio_pool_->GetStats().input_samples, 100 * 480);
+}
+
+TEST_F(WebmSegmentWriterTest, ClosesAsynchronouslyAfterAudioGaps) {
+  std::unique_ptr<MuxedSegmentWriterInterface> writer = CreateWriter();
+
+  // Each gap ends a run of audio, which finishes on its encoder thread.
+  for (int i = 0; i < 30; ++i) {
+    absl::Time received_time =
+        kStartTime + i * absl::Milliseconds(10) + (i / 10) * absl::Seconds(1);
+    if (i % 3 == 0) {
+      EXPECT_TRUE(writer->WriteVideoFrame(CreateFrame(64, 48), received_time));
+    }
+    writer->WriteAudioSamples(std::vector<int16_t>(480, 1000), received_time);
+  }
+  absl::Notification closed;
+  MuxedSegmentWriterInterface::CloseAsync(std::move(writer), [&] {
+    EXPECT_TRUE(closed_);
+    closed.Notify();
+  });
+
+  ASSERT_TRUE(closed.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  EXPECT_THAT(output_, HasSubstr("A_OPUS"));
+  EXPECT_EQ(video_pool_->GetStats().encoded_frames, 10);
+  EXPECT_EQ(audio_pool_->GetStats().input_samples, 30 * 480);
+}
+
+TEST_F(WebmSegmentWriterTest, RejectsVideoOfAnotherResolution) {
+  std::unique_ptr<MuxedSegmentWriterInterface> writer = CreateWriter();
+
+  EXPECT_TRUE(writer->WriteVideoFrame(CreateFrame(64, 48), kStartTime));
+  EXPECT_FALSE(writer->WriteVideoFrame(CreateFrame(32, 24),
+                                       kStartTime + absl::Milliseconds(33)));
+  EXPECT_TRUE(writer->WriteVideoFrame(CreateFrame(64, 48),
+                                      kStartTime + absl::Milliseconds(66)));
+  writer->Close();
+
+  EXPECT_EQ(video_pool_->GetStats().encoded_frames, 2);
+}
+
+TEST_F(WebmSegmentWriterTest, RequiresVp9) {
+  absl::StatusOr<std::shared_ptr<VideoEncoderPool>> av1_pool =
+      VideoEncoderPool::Create({.codec = VideoEncoderPool::Codec::kAv1});
+  ASSERT_TRUE(av1_pool.ok()) << av1_pool.status();
+
+  EXPECT_EQ(CreateWebmSegmentFormat(*av1_pool, audio_pool_).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace media_api_samples
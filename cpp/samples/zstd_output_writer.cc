@@ -0,0 +1,196 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/zstd_output_writer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <ios>
+#include <memory>
+#include <utility>
+
+#include "absl/base/nullability.h"
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "rtc_base/thread.h"
+
+#include <zstd.h>
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+std::unique_ptr<ZstdOutputWriter> ZstdOutputWriter::Create(
+    std::unique_ptr<OutputWriterInterface> writer, const Options& options) {
+  std::unique_ptr<ZSTD_CCtx, ContextDeleter> context(ZSTD_createCCtx());
+  if (context == nullptr) {
+    LOG(ERROR) << "Failed to create zstd compressor";
+  } else {
+    size_t result = ZSTD_CCtx_setParameter(
+        context.get(), ZSTD_c_compressionLevel, options.compression_level);
+    if (!ZSTD_isError(result)) {
+      // Checksums let readers detect frames damaged by a crash.
+      result = ZSTD_CCtx_setParameter(context.get(), ZSTD_c_checksumFlag, 1);
+    }
+    if (ZSTD_isError(result)) {
+      LOG(ERROR) << "Failed to configure zstd compressor: "
+                 << ZSTD_getErrorName(result);
+      context.reset();
+    }
+  }
+  auto zstd_writer = absl::WrapUnique(
+      new ZstdOutputWriter(std::move(writer), options, std::move(context)));
+
+  if (options.flush_interval > absl::ZeroDuration() &&
+      options.flush_interval < absl::InfiniteDuration()) {
+    std::unique_ptr<webrtc::Thread> flush_thread = webrtc::Thread::Create();
+    flush_thread->SetName("zstd_flush_thread", nullptr);
+    if (flush_thread->Start()) {
+      zstd_writer->flush_thread_ = std::move(flush_thread);
+      zstd_writer->flush_thread_->PostTask(
+          [zstd_writer = zstd_writer.get()] { zstd_writer->RunFlushLoop(); });
+    } else {
+      LOG(ERROR) << "Failed to start zstd flush thread. Data will only be "
+                    "flushed when the writer is flushed or closed.";
+    }
+  }
+  return zstd_writer;
+}
+
+ZstdOutputWriter::~ZstdOutputWriter() { Close(); }
+
+void ZstdOutputWriter::Write(const char* content, std::streamsize size) {
+  absl::MutexLock lock(&mutex_);
+  if (context_ == nullptr) return;
+
+  while (size > 0) {
+    size_t chunk_size =
+        std::min<size_t>(size, frame_size_ - frame_input_size_);
+    frame_input_size_ += chunk_size;
+    Compress(content, chunk_size,
+             frame_input_size_ >= frame_size_ ? ZSTD_e_end : ZSTD_e_continue);
+    if (context_ == nullptr) return;
+    content += chunk_size;
+    size -= chunk_size;
+  }
+  if (flush_interval_ <= absl::ZeroDuration()) {
+    FlushLocked();
+  }
+}
+
+void ZstdOutputWriter::Flush() {
+  absl::MutexLock lock(&mutex_);
+  FlushLocked();
+}
+
+void ZstdOutputWriter::Close() {
+  // The flush thread is stopped first, since it flushes through `this`.
+  if (flush_thread_ != nullptr) {
+    {
+      absl::MutexLock lock(&mutex_);
+      stopping_ = true;
+    }
+    flush_thread_->Stop();
+    flush_thread_ = nullptr;
+  }
+
+  absl::MutexLock lock(&mutex_);
+  if (context_ != nullptr) {
+    if (frame_input_size_ > 0) {
+      Compress(nullptr, 0, ZSTD_e_end);
+    }
+    context_.reset();
+  }
+  if (writer_ != nullptr) {
+    writer_->Close();
+    writer_ = nullptr;
+  }
+}
+
+void ZstdOutputWriter::RunFlushLoop() {
+  absl::MutexLock lock(&mutex_);
+  while (!stopping_) {
+    mutex_.AwaitWithTimeout(absl::Condition(&stopping_), flush_interval_);
+    if (!stopping_) {
+      FlushLocked();
+    }
+  }
+}
+
+void ZstdOutputWriter::FlushLocked() {
+  if (context_ != nullptr && unflushed_) {
+    Compress(nullptr, 0, ZSTD_e_flush);
+  }
+  // A frame ended by a write leaves compressed data in the wrapped writer, even
+  // though the compressor has nothing left to flush.
+  if (writer_ != nullptr && writer_unflushed_) {
+    writer_->Flush();
+    writer_unflushed_ = false;
+  }
+}
+
+void ZstdOutputWriter::Compress(const char* content, size_t size,
+                                ZSTD_EndDirective directive) {
+  ZSTD_inBuffer input = {.src = content, .size = size, .pos = 0};
+  while (true) {
+    ZSTD_outBuffer output = {.dst = output_buffer_.data(),
+                             .size = output_buffer_.size(),
+                             .pos = 0};
+    size_t remaining =
+        ZSTD_compressStream2(context_.get(), &output, &input, directive);
+    if (ZSTD_isError(remaining)) {
+      LOG(ERROR) << "Failed to compress data: " << ZSTD_getErrorName(remaining)
+                 << ". Further data will be dropped.";
+      context_.reset();
+      return;
+    }
+    if (output.pos > 0) {
+      writer_->Write(output_buffer_.data(), output.pos);
+      writer_unflushed_ = true;
+    }
+    // With `ZSTD_e_continue`, the compressor is done once it has consumed the
+    // input. Otherwise, it is done once it has nothing left to write.
+    if (directive == ZSTD_e_continue ? input.pos == input.size
+                                     : remaining == 0) {
+      break;
+    }
+  }
+
+  if (directive == ZSTD_e_continue) {
+    unflushed_ = true;
+    return;
+  }
+  unflushed_ = false;
+  if (directive == ZSTD_e_end) {
+    frame_input_size_ = 0;
+  }
+}
+
+OutputWriterProvider CreateZstdOutputWriterProvider(
+    OutputWriterProvider provider, ZstdOutputWriter::Options options) {
+  return [provider = std::move(provider),
+          options](absl::string_view file_name) mutable
+             -> std::unique_ptr<OutputWriterInterface> {
+    return ZstdOutputWriter::Create(provider(file_name), options);
+  };
+}
+
+}  // namespace media_api_samples
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPP_SAMPLES_ZSTD_OUTPUT_WRITER_H_
+#define CPP_SAMPLES_ZSTD_OUTPUT_WRITER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <ios>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "rtc_base/thread.h"
+
+#include <zstd.h>
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+
+// An output writer that compresses data with zstd before passing it to another
+// writer.
+//
+// The output is a sequence of zstd frames, which `zstd -d` decompresses as a
+// single stream. Frames are ended every `frame_size` bytes of input, so that
+// each one can be decompressed on its own. Within a frame, written data is
+// flushed through the compressor and the wrapped writer at least every
+// `flush_interval`, so that a file cut short by a crash still decompresses up
+// to the last flush. Flushing ends the current block but keeps the compression
+// history, so frequent flushes cost little compression for text such as logs.
+//
+// This class is thread-safe, so that a flush thread can flush it while it is
+// written.
+class ZstdOutputWriter : public OutputWriterInterface {
+ public:
+  struct Options {
+    int compression_level = 3;
+    // Longest time written data stays in the compressor or in the wrapped
+    // writer before it is flushed. A positive, finite interval is kept by a
+    // flush thread, which also flushes data written right before the writer
+    // goes idle. Zero flushes on each write, and an infinite interval only on
+    // `Flush` and `Close`.
+    absl::Duration flush_interval = absl::Seconds(1);
+    // Bytes of uncompressed data after which the current frame is ended.
+    size_t frame_size = 1 << 20;
+  };
+
+  // Returns a writer compressing data into `writer`. If the compressor cannot
+  // be created, the returned writer drops all data. If the flush thread cannot
+  // be started, data is only flushed by `Flush` and `Close`.
+  static std::unique_ptr<ZstdOutputWriter> Create(
+      std::unique_ptr<OutputWriterInterface> writer, const Options& options);
+
+  ~ZstdOutputWriter() override;
+
+  void Write(const char* content, std::streamsize size) override;
+  // Passes the compressed data for everything written so far to the wrapped
+  // writer, and flushes it.
+  void Flush() override;
+  // Stops the flush thread, ends the current frame and closes the wrapped
+  // writer.
+  void Close() override;
+
+ private:
+  struct ContextDeleter {
+    void operator()(ZSTD_CCtx* context) const { ZSTD_freeCCtx(context); }
+  };
+
+  ZstdOutputWriter(std::unique_ptr<OutputWriterInterface> writer,
+                   const Options& options,
+                   /*absl_nullable*/ std::unique_ptr<ZSTD_CCtx, ContextDeleter>
+                       context)
+      : flush_interval_(options.flush_interval),
+        frame_size_(std::max<size_t>(1, options.frame_size)),
+        writer_(std::move(writer)),
+        context_(std::move(context)),
+        output_buffer_(ZSTD_CStreamOutSize()) {}
+
+  void RunFlushLoop();
+  void FlushLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Compresses `content` and writes out the compressed data that `directive`
+  // requires.
+  void Compress(const char* content, size_t size, ZSTD_EndDirective directive)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const absl::Duration flush_interval_;
+  const size_t frame_size_;
+  // The thread keeping `flush_interval_`, or null if there is none or the
+  // writer has been closed.
+  /*absl_nullable*/ std::unique_ptr<webrtc::Thread> flush_thread_;
+
+  absl::Mutex mutex_;
+  /*absl_nullable*/ std::unique_ptr<OutputWriterInterface> writer_
+      ABSL_GUARDED_BY(mutex_);
+  // The compressor, or null if it failed or the writer has been closed.
+  /*absl_nullable*/ std::unique_ptr<ZSTD_CCtx, ContextDeleter> context_
+      ABSL_GUARDED_BY(mutex_);
+  std::vector<char> output_buffer_ ABSL_GUARDED_BY(mutex_);
+  // Bytes of uncompressed data in the current frame.
+  size_t frame_input_size_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Whether data has been written to the compressor since it was last flushed.
+  bool unflushed_ ABSL_GUARDED_BY(mutex_) = false;
+  // Whether compressed data has been written to `writer_` since it was last
+  // flushed.
+  bool writer_unflushed_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+// Returns a provider that compresses the files of `provider` with
+// `ZstdOutputWriter`s.
+OutputWriterProvider CreateZstdOutputWriterProvider(
+    OutputWriterProvider provider, ZstdOutputWriter::Options options);
+
+}  // namespace media_api_samples
+
+#endif  // CPP_SAMPLES_ZSTD_OUTPUT_WRITER_H_
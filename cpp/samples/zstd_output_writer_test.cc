@@ -0,0 +1,204 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meet_clients/samples/zstd_output_writer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <ios>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/base/nullability.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "meet_clients/samples/output_writer_interface.h"
+#include "meet_clients/samples/testing/mock_output_writer.h"
+
+#include <zstd.h>
+
+ABSL_POINTERS_DEFAULT_NONNULL
+
+namespace media_api_samples {
+namespace {
+
+using ::testing::_;
+
+// Returns a mock writer that appends everything written to `output`.
+std::unique_ptr<MockOutputWriter> CreateCapturingWriter(std::string& output) {
+  auto writer = std::make_unique<MockOutputWriter>();
+  EXPECT_CALL(*writer, Write(_, _))
+      .WillRepeatedly([&output](const char* content, std::streamsize size) {
+        output.append(content, size);
+      });
+  return writer;
+}
+
+// Decompresses as much of `compressed` as possible, as a reader of a file cut
+// short by a crash would.
+std::string Decompress(absl::string_view compressed) {
+  std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context(
+      ZSTD_createDCtx(), &ZSTD_freeDCtx);
+  std::vector<char> buffer(ZSTD_DStreamOutSize());
+  std::string decompressed;
+  ZSTD_inBuffer input = {
+      .src = compressed.data(), .size = compressed.size(), .pos = 0};
+  while (true) {
+    ZSTD_outBuffer output = {
+        .dst = buffer.data(), .size = buffer.size(), .pos = 0};
+    size_t result = ZSTD_decompressStream(context.get(), &output, &input);
+    EXPECT_FALSE(ZSTD_isError(result)) << ZSTD_getErrorName(result);
+    decompressed.append(buffer.data(), output.pos);
+    if (ZSTD_isError(result) ||
+        (input.pos == input.size && output.pos < output.size)) {
+      break;
+    }
+  }
+  return decompressed;
+}
+
+int CountFrames(absl::string_view compressed) {
+  int frames = 0;
+  while (!compressed.empty()) {
+    size_t frame_size =
+        ZSTD_findFrameCompressedSize(compressed.data(), compressed.size());
+    if (ZSTD_isError(frame_size)) break;
+    compressed.remove_prefix(frame_size);
+    ++frames;
+  }
+  return frames;
+}
+
+std::string CreateTestLog(int lines) {
+  std::string log;
+  for (int i = 0; i < lines; ++i) {
+    absl::StrAppend(&log, "time=", i, ",event=updated participant resource,",
+                    "participant_id=", i % 7, "\n");
+  }
+  return log;
+}
+
+TEST(ZstdOutputWriterTest, RoundTripsDataAcrossFrames) {
+  std::string compressed;
+  auto inner = CreateCapturingWriter(compressed);
+  EXPECT_CALL(*inner, Close());
+  std::unique_ptr<ZstdOutputWriter> writer = ZstdOutputWriter::Create(
+      std::move(inner), {.flush_interval = absl::InfiniteDuration(),
+                         .frame_size = 1000});
+  std::string log = CreateTestLog(1000);
+
+  // Write in pieces that do not line up with frames.
+  for (size_t offset = 0; offset < log.size(); offset += 37) {
+    writer->Write(log.data() + offset,
+                  std::min<size_t>(37, log.size() - offset));
+  }
+  writer->Close();
+
+  EXPECT_EQ(Decompress(compressed), log);
+  EXPECT_EQ(CountFrames(compressed), (log.size() + 999) / 1000);
+  EXPECT_LT(compressed.size(), log.size() / 4);
+}
+
+TEST(ZstdOutputWriterTest, FlushesEveryWriteWithZeroInterval) {
+  std::string compressed;
+  auto inner = CreateCapturingWriter(compressed);
+  EXPECT_CALL(*inner, Flush());
+  std::unique_ptr<ZstdOutputWriter> writer = ZstdOutputWriter::Create(
+      std::move(inner), {.flush_interval = absl::ZeroDuration()});
+  std::string log = CreateTestLog(10);
+
+  writer->Write(log.data(), log.size());
+
+  // The frame has not ended, but everything written is readable.
+  EXPECT_EQ(CountFrames(compressed), 0);
+  EXPECT_EQ(Decompress(compressed), log);
+}
+
+TEST(ZstdOutputWriterTest, KeepsDataUntilFlushed) {
+  std::string compressed;
+  std::string log = CreateTestLog(10);
+  bool flushed = false;
+  auto inner = CreateCapturingWriter(compressed);
+  // Flushing passes the data through the compressor, and then flushes the
+  // wrapped writer.
+  EXPECT_CALL(*inner, Flush()).WillOnce([&] {
+    flushed = true;
+    EXPECT_EQ(Decompress(compressed), log);
+  });
+  std::unique_ptr<ZstdOutputWriter> writer = ZstdOutputWriter::Create(
+      std::move(inner), {.flush_interval = absl::InfiniteDuration()});
+
+  writer->Write(log.data(), log.size());
+  EXPECT_FALSE(flushed);
+  EXPECT_EQ(Decompress(compressed), "");
+  writer->Flush();
+
+  EXPECT_TRUE(flushed);
+}
+
+TEST(ZstdOutputWriterTest, FlushesIdleWriterOnInterval) {
+  std::string compressed;
+  std::string flushed;
+  absl::Notification flushed_notification;
+  auto inner = CreateCapturingWriter(compressed);
+  EXPECT_CALL(*inner, Flush()).WillRepeatedly([&] {
+    if (!flushed_notification.HasBeenNotified()) {
+      flushed = compressed;
+      flushed_notification.Notify();
+    }
+  });
+  std::unique_ptr<ZstdOutputWriter> writer = ZstdOutputWriter::Create(
+      std::move(inner), {.flush_interval = absl::Milliseconds(10)});
+  std::string log = CreateTestLog(10);
+
+  // No further writes follow, so only the flush thread can flush the data.
+  writer->Write(log.data(), log.size());
+
+  ASSERT_TRUE(
+      flushed_notification.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  EXPECT_EQ(Decompress(flushed), log);
+}
+
+TEST(ZstdOutputWriterTest, ProviderCompressesFilesOfWrappedProvider) {
+  std::string compressed;
+  std::vector<std::string> file_names;
+  OutputWriterProvider provider = CreateZstdOutputWriterProvider(
+      [&](absl::string_view file_name)
+          -> std::unique_ptr<OutputWriterInterface> {
+        file_names.push_back(std::string(file_name));
+        auto writer = CreateCapturingWriter(compressed);
+        EXPECT_CALL(*writer, Close());
+        return writer;
+      },
+      {});
+
+  std::unique_ptr<OutputWriterInterface> writer = provider("event_log.csv.zst");
+  writer->Write("event\n", 6);
+  writer->Close();
+
+  EXPECT_THAT(file_names, ::testing::ElementsAre("event_log.csv.zst"));
+  EXPECT_EQ(Decompress(compressed), "event\n");
+}
+
+}  // namespace
+}  // namespace media_api_samples